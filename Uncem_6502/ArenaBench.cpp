@@ -0,0 +1,192 @@
+// Compares CPU instances in an InstanceArena with one std::make_shared<MOS6502Debug>() each: the time to
+// create them, guest nanoseconds per instruction while they run round-robin (a burst of instructions each,
+// every instance in turn, which is where TLB reach shows), the time to destroy them and the memory they
+// keep resident. Every worker thread creates, runs and destroys its own share of the instances, so with
+// the arena they land on its NUMA node.
+//
+//   6502_ArenaBench [--instances n] [--threads n] [--rounds n] [--burst n] [--explicit]
+//
+// --explicit asks for MAP_HUGETLB pages, which have to be reserved first, e.g.
+// echo 1024 > /proc/sys/vm/nr_hugepages; without it the arena uses transparent hugepages where enabled.
+
+#include <barrier>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ImageStore.hpp"
+#include "InstanceArena.hpp"
+#include "MOS6502.hpp"
+
+namespace
+{
+	// INC $10, LDA $10, PHA, PLA, STA $0300,X, INX, JMP $0200: code shared through the image, three private
+	// pages written per instance (zero page, stack, $0300)
+	const uint8_t workload[] = { 0xE6, 0x10, 0xA5, 0x10, 0x48, 0x68, 0x9D, 0x00, 0x03, 0xE8, 0x4C, 0x00, 0x02 };
+	constexpr uint16_t workloadStart = 0x0200;
+
+	struct Options
+	{
+		std::size_t instances = 8192;
+		std::size_t threads = 1;
+		std::size_t rounds = 20;
+		uint64_t burst = 200;
+		bool explicitHugePages = false;
+	};
+
+	struct Result
+	{
+		double createMs = 0;
+		double runNsPerInstruction = 0;
+		double destroyMs = 0;
+		double residentMiB = 0;
+	};
+
+	double residentMiB()
+	{
+		// second field of statm, in pages
+		std::ifstream statm("/proc/self/statm");
+		std::size_t size = 0;
+		std::size_t resident = 0;
+		statm >> size >> resident;
+		return resident * 4096.0 / (1 << 20);
+	}
+
+	// make and drop construct and destroy instance i on the calling worker thread
+	Result measure(const Options& options, const std::shared_ptr<const ProgramImage>& image,
+		const std::function<MOS6502Debug*(std::size_t i)>& make, const std::function<void(std::size_t i, MOS6502Debug* cpu)>& drop)
+	{
+		using Clock = std::chrono::steady_clock;
+		std::vector<Clock::time_point> marks;
+		double residentBefore = residentMiB();
+		double residentAfter = 0;
+		// the completion step runs on one thread while all others wait
+		auto mark = [&]() noexcept { marks.push_back(Clock::now()); };
+		std::barrier<decltype(mark)> phase(static_cast<std::ptrdiff_t>(options.threads), mark);
+		std::vector<uint64_t> executed(options.threads, 0);
+
+		std::vector<std::thread> threads;
+		for (std::size_t t = 0; t < options.threads; t++)
+		{
+			threads.emplace_back([&, t]() {
+				std::size_t first = options.instances * t / options.threads;
+				std::size_t last = options.instances * (t + 1) / options.threads;
+				std::vector<MOS6502Debug*> cpus;
+				phase.arrive_and_wait();
+				for (std::size_t i = first; i < last; i++)
+				{
+					MOS6502Debug* cpu = make(i);
+					if (!cpu) { break; }
+					cpu->ISDEBUG = false;
+					cpu->mapImage(image);
+					cpu->setProgramCounter(workloadStart);
+					cpus.push_back(cpu);
+				}
+				phase.arrive_and_wait();
+				uint64_t before = 0;
+				for (MOS6502Debug* cpu : cpus) { before += cpu->instructions(); }
+				for (std::size_t round = 0; round < options.rounds; round++)
+				{
+					for (MOS6502Debug* cpu : cpus)
+					{
+						cpu->execute(options.burst);
+					}
+				}
+				uint64_t after = 0;
+				for (MOS6502Debug* cpu : cpus) { after += cpu->instructions(); }
+				executed[t] = after - before;
+				phase.arrive_and_wait();
+				if (t == 0) { residentAfter = residentMiB(); }
+				phase.arrive_and_wait();
+				for (std::size_t i = 0; i < cpus.size(); i++)
+				{
+					drop(first + i, cpus[i]);
+				}
+				phase.arrive_and_wait();
+			});
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		uint64_t instructions = 0;
+		for (uint64_t count : executed) { instructions += count; }
+		auto between = [&](std::size_t from, std::size_t to) {
+			return std::chrono::duration<double, std::nano>(marks[to] - marks[from]).count();
+		};
+		Result result;
+		result.createMs = between(0, 1) / 1e6;
+		result.runNsPerInstruction = instructions ? between(1, 2) / instructions : 0;
+		result.destroyMs = between(3, 4) / 1e6;
+		result.residentMiB = residentAfter - residentBefore;
+		return result;
+	}
+
+	void print(const std::string& name, const Result& result)
+	{
+		char line[160];
+		std::snprintf(line, sizeof(line), "%-36s %10.1f %14.2f %11.1f %13.1f", name.c_str(), result.createMs,
+			result.runNsPerInstruction, result.destroyMs, result.residentMiB);
+		std::cout << line << "\n";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--instances" && hasValue) { options.instances = std::strtoul(argv[++i], nullptr, 10); }
+		else if (arg == "--threads" && hasValue) { options.threads = std::strtoul(argv[++i], nullptr, 10); }
+		else if (arg == "--rounds" && hasValue) { options.rounds = std::strtoul(argv[++i], nullptr, 10); }
+		else if (arg == "--burst" && hasValue) { options.burst = std::strtoull(argv[++i], nullptr, 10); }
+		else if (arg == "--explicit") { options.explicitHugePages = true; }
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--instances n] [--threads n] [--rounds n] [--burst n] [--explicit]" << std::endl;
+			return 2;
+		}
+	}
+	if (options.instances == 0 || options.threads == 0)
+	{
+		std::cerr << "ArenaBench: needs at least one instance and one thread" << std::endl;
+		return 2;
+	}
+
+	auto image = std::make_shared<const ProgramImage>(workload, sizeof(workload), workloadStart);
+	std::cout << "Instances " << options.instances << " x " << sizeof(MOS6502Debug) << " bytes, " << options.threads
+		<< " threads, " << options.rounds << " rounds of " << options.burst << " instructions, "
+		<< HugePageRegion::nodeCount() << " NUMA nodes\n";
+	std::cout << "                                      create ms   run ns/instr  destroy ms  resident MiB\n";
+
+	std::vector<std::shared_ptr<MOS6502Debug>> owners(options.instances);
+	Result heap = measure(options, image,
+		[&](std::size_t i) { owners[i] = std::make_shared<MOS6502Debug>(); return owners[i].get(); },
+		[&](std::size_t i, MOS6502Debug*) { owners[i].reset(); });
+	print("std::make_shared<MOS6502Debug>()", heap);
+
+	Result arena;
+	std::string backing;
+	{
+		InstanceArena<MOS6502Debug> instances(options.instances, options.explicitHugePages);
+		if (!instances.ok())
+		{
+			return 1;
+		}
+		backing = HugePageRegion::backingName(instances.backing());
+		arena = measure(options, image,
+			[&](std::size_t) { return instances.create(); },
+			[&](std::size_t, MOS6502Debug* cpu) { instances.destroy(cpu); });
+	}
+	print("InstanceArena (" + backing + ")", arena);
+	return 0;
+}
@@ -0,0 +1,215 @@
+#include "AsyncCpu.hpp"
+
+#include <algorithm>
+
+AsyncCpu::AsyncCpu(MOS6502& cpu, uint64_t quantum, Runner run)
+	: mCpu(cpu), mQuantum(quantum ? quantum : 1), mRun(std::move(run))
+{
+	if (!mRun)
+	{
+		mRun = [this](uint64_t instructions) { return mCpu.execute(instructions); };
+	}
+	publish();
+	mThread = std::thread([this]() { loop(); });
+}
+
+AsyncCpu::~AsyncCpu()
+{
+	Command quit;
+	quit.kind = QUIT;
+	send(std::move(quit));
+	mThread.join();
+}
+
+std::future<AsyncCpu::Reply> AsyncCpu::send(Command command)
+{
+	std::future<Reply> reply = command.reply.get_future();
+	// a full ring drains within a quantum, so there is nothing to gain from sleeping here
+	while (!mQueue.push(std::move(command)))
+	{
+		std::this_thread::yield();
+	}
+	mSignal.fetch_add(1, std::memory_order_release);
+	mSignal.notify_one();
+	return reply;
+}
+
+std::future<AsyncCpu::Reply> AsyncCpu::resume()
+{
+	Command command;
+	command.kind = RESUME;
+	return send(std::move(command));
+}
+
+std::future<AsyncCpu::Reply> AsyncCpu::step(uint64_t instructions)
+{
+	Command command;
+	command.kind = STEP;
+	command.count = instructions;
+	return send(std::move(command));
+}
+
+std::future<AsyncCpu::Reply> AsyncCpu::pause()
+{
+	Command command;
+	command.kind = PAUSE;
+	return send(std::move(command));
+}
+
+std::future<AsyncCpu::Reply> AsyncCpu::read(uint16_t address, std::size_t size)
+{
+	Command command;
+	command.kind = READ;
+	command.address = address;
+	command.count = size;
+	return send(std::move(command));
+}
+
+std::future<AsyncCpu::Reply> AsyncCpu::write(uint16_t address, std::vector<uint8_t> bytes)
+{
+	Command command;
+	command.kind = WRITE;
+	command.address = address;
+	command.bytes = std::move(bytes);
+	return send(std::move(command));
+}
+
+std::future<AsyncCpu::Reply> AsyncCpu::irq()
+{
+	Command command;
+	command.kind = IRQ;
+	return send(std::move(command));
+}
+
+void AsyncCpu::loop()
+{
+	for (;;)
+	{
+		// read the signal before looking at the ring: a push after this point changes it and wait() returns
+		uint32_t seen = mSignal.load(std::memory_order_acquire);
+		Command command;
+		while (mQueue.pop(command))
+		{
+			if (!handle(command))
+			{
+				if (mRunning) { endRun(STOP_NONE); }
+				return;
+			}
+		}
+		if (mRunning)
+		{
+			runQuantum();
+			continue;
+		}
+		mSignal.wait(seen, std::memory_order_acquire);
+	}
+}
+
+bool AsyncCpu::handle(Command& command)
+{
+	switch (command.kind)
+	{
+	case RESUME:
+		startRun(command, UINT64_MAX);
+		break;
+	case STEP:
+		startRun(command, command.count);
+		break;
+	case PAUSE:
+		if (mRunning) { endRun(STOP_NONE); }
+		command.reply.set_value(state());
+		break;
+	case READ:
+	{
+		Reply reply = state();
+		std::size_t size = static_cast<std::size_t>(std::min<uint64_t>(command.count, 0x10000u - command.address));
+		reply.bytes.resize(size);
+		mCpu.copyMemory(command.address, reply.bytes.data(), size);
+		command.reply.set_value(std::move(reply));
+		break;
+	}
+	case WRITE:
+		mCpu.loadProgram(command.bytes.data(), std::min<std::size_t>(command.bytes.size(), 0x10000u - command.address), command.address);
+		command.reply.set_value(state());
+		break;
+	case IRQ:
+		mIrqs.push_back(std::move(command.reply));
+		break;
+	case QUIT:
+		return false;
+	}
+	return true;
+}
+
+void AsyncCpu::startRun(Command& command, uint64_t budget)
+{
+	// a run that is replaced ends here, the CPU carries on from the same place
+	bool wasRunning = mRunning;
+	if (mRunning) { endRun(STOP_NONE); }
+	mRunReply = std::move(command.reply);
+	mBudget = budget;
+	mRunning = true;
+	if (!wasRunning) { mCpu.resumeOverBreakpoint(); }
+	mRunningFlag.store(true, std::memory_order_release);
+	if (mBudget == 0) { endRun(STOP_BUDGET); }
+}
+
+void AsyncCpu::endRun(StopReason reason)
+{
+	mRunning = false;
+	publish();
+	Reply reply = state();
+	reply.reason = reason;
+	mRunReply.set_value(std::move(reply));
+	mRunReply = std::promise<Reply>();
+}
+
+void AsyncCpu::takeIrq()
+{
+	if (mIrqs.empty() || !mCpu.irq()) { return; }
+	// one interrupt entry serves every request raised so far, as with a shared level-triggered line
+	Reply reply = state();
+	for (std::promise<Reply>& waiting : mIrqs)
+	{
+		waiting.set_value(reply);
+	}
+	mIrqs.clear();
+}
+
+void AsyncCpu::runQuantum()
+{
+	takeIrq();
+	uint64_t window = std::min(mQuantum, mBudget);
+	uint64_t before = mCpu.instructions();
+	StopReason reason = mRun(window);
+	uint64_t executed = mCpu.instructions() - before;
+	mBudget = mBudget == UINT64_MAX ? mBudget : mBudget - std::min(executed, mBudget);
+	if (reason != STOP_BUDGET)
+	{
+		endRun(reason);
+	}
+	else if (mBudget == 0)
+	{
+		endRun(STOP_BUDGET);
+	}
+	else
+	{
+		publish();
+	}
+}
+
+AsyncCpu::Reply AsyncCpu::state() const
+{
+	Reply reply;
+	reply.pc = mCpu.programCounter();
+	reply.instructions = mCpu.instructions();
+	reply.cycles = mCpu.cycles();
+	return reply;
+}
+
+void AsyncCpu::publish()
+{
+	mPc.store(mCpu.programCounter(), std::memory_order_relaxed);
+	mInstructions.store(mCpu.instructions(), std::memory_order_relaxed);
+	mRunningFlag.store(mRunning, std::memory_order_release);
+}
@@ -0,0 +1,117 @@
+#ifndef ASYNCCPU_HPP
+#define ASYNCCPU_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <thread>
+#include <vector>
+#include "MOS6502.hpp"
+#include "SpscQueue.hpp"
+
+// Runs a CPU on a thread of its own and drives it with commands from one control thread (the UI, a
+// debugger front end, a device model). Commands go through a lock-free SPSC ring and are only looked at
+// between quanta of guest instructions, so a running guest pays for the queue once per quantum rather
+// than once per instruction; the answer to every command comes back through a future. The worker sleeps
+// on an atomic while the CPU is paused, so an idle AsyncCpu costs no host time.
+//
+// A quantum is one call of the runner (default MOS6502::execute()); a run steps over a breakpoint on the
+// instruction it starts at, see MOS6502::resumeOverBreakpoint(), and stops at every other one, also on
+// quantum boundaries.
+class AsyncCpu
+{
+public:
+	// the CPU state when a command was carried out; totals since the CPU was created
+	struct Reply
+	{
+		StopReason reason = STOP_NONE;  // how a run ended: STOP_NONE after pause(), STOP_BUDGET after a complete step()
+		uint16_t pc = 0;
+		uint64_t instructions = 0;
+		uint64_t cycles = 0;
+		std::vector<uint8_t> bytes;     // read() only
+	};
+
+	// runs up to the given number of instructions and returns why it stopped; the default runs execute()
+	using Runner = std::function<StopReason(uint64_t instructions)>;
+
+	static constexpr std::size_t queueSize = 64;
+
+	// the CPU is not owned and starts paused; nothing else may touch it until the AsyncCpu is gone
+	explicit AsyncCpu(MOS6502& cpu, uint64_t quantum = 10000, Runner run = nullptr);
+	// stops the worker at the next boundary; a run in progress resolves as if paused, IRQs not taken yet
+	// leave their futures broken (std::future_error)
+	~AsyncCpu();
+	AsyncCpu(const AsyncCpu&) = delete;
+	AsyncCpu& operator=(const AsyncCpu&) = delete;
+
+	// run until the guest stops or pause(); resolves when the run ends. A resume() or step() issued while a
+	// run is in progress replaces it, the earlier future resolves with STOP_NONE
+	std::future<Reply> resume();
+	// run up to instructions more, in quanta, then stop with STOP_BUDGET
+	std::future<Reply> step(uint64_t instructions);
+	// stop at the next boundary; resolves right away when the CPU is not running
+	std::future<Reply> pause();
+	// guest memory, at the next boundary without stopping a run; writes past $FFFF are cut off
+	std::future<Reply> read(uint16_t address, std::size_t size);
+	std::future<Reply> write(uint16_t address, std::vector<uint8_t> bytes);
+	// raise the IRQ line: taken before the next instruction that runs with I clear, the future resolves then
+	std::future<Reply> irq();
+
+	// published after every quantum, for polling without a command round trip
+	bool running() const { return mRunningFlag.load(std::memory_order_acquire); }
+	uint16_t pc() const { return mPc.load(std::memory_order_relaxed); }
+	uint64_t instructions() const { return mInstructions.load(std::memory_order_relaxed); }
+
+private:
+	enum Kind : uint8_t
+	{
+		RESUME,
+		STEP,
+		PAUSE,
+		READ,
+		WRITE,
+		IRQ,
+		QUIT
+	};
+
+	struct Command
+	{
+		Kind kind = PAUSE;
+		uint16_t address = 0;
+		uint64_t count = 0;
+		std::vector<uint8_t> bytes;
+		std::promise<Reply> reply;
+	};
+
+	std::future<Reply> send(Command command);
+	void loop();
+	// false once the worker has to exit
+	bool handle(Command& command);
+	void runQuantum();
+	void startRun(Command& command, uint64_t budget);
+	void endRun(StopReason reason);
+	void takeIrq();
+	Reply state() const;
+	void publish();
+
+	MOS6502& mCpu;
+	uint64_t mQuantum;
+	Runner mRun;
+	SpscQueue<Command, queueSize> mQueue;
+	std::atomic<uint32_t> mSignal{ 0 };     // bumped after every push, the paused worker waits on it
+
+	// worker only
+	bool mRunning = false;
+	uint64_t mBudget = 0;
+	std::promise<Reply> mRunReply;
+	std::vector<std::promise<Reply>> mIrqs;
+
+	std::atomic<bool> mRunningFlag{ false };
+	std::atomic<uint16_t> mPc{ 0 };
+	std::atomic<uint64_t> mInstructions{ 0 };
+	std::thread mThread;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#include "BusScheduler.hpp"
+
+BusScheduler::BusScheduler(uint64_t quantumCycles)
+	: mQuantum(quantumCycles ? quantumCycles : 1), mNow(0), mSwitches(0)
+{
+}
+
+std::size_t BusScheduler::addCpu(MOS6502& cpu)
+{
+	std::size_t participant = mParticipants.size();
+	mParticipants.push_back({ runCpu(cpu, participant), STOP_NONE });
+	return participant;
+}
+
+std::size_t BusScheduler::addTask(Task task)
+{
+	mParticipants.push_back({ std::move(task), STOP_NONE });
+	return mParticipants.size() - 1;
+}
+
+BusScheduler::Task BusScheduler::runCpu(MOS6502& cpu, std::size_t participant)
+{
+	// deadlines advance by whole quanta from where the CPU started, so the instruction that overshoots
+	// one deadline does not push the later ones back
+	uint64_t deadline = cpu.cycles();
+	for (;;)
+	{
+		deadline += mQuantum;
+		StopReason reason = cpu.execute(UINT64_MAX, deadline);
+		if (reason != STOP_BUDGET)
+		{
+			mParticipants[participant].result = reason;
+			co_return;
+		}
+		co_await nextQuantum();
+	}
+}
+
+std::size_t BusScheduler::run(uint64_t maxCycles)
+{
+	uint64_t end = maxCycles > UINT64_MAX - mNow ? UINT64_MAX : mNow + maxCycles;
+	while (mNow < end)
+	{
+		bool running = false;
+		// by index, a participant may add others while it runs
+		for (std::size_t i = 0; i < mParticipants.size(); i++)
+		{
+			auto handle = mParticipants[i].task.mHandle;
+			if (!handle.done())
+			{
+				handle.resume();
+				mSwitches++;
+				running = true;
+			}
+		}
+		if (!running)
+		{
+			break;
+		}
+		mNow += mQuantum;
+	}
+
+	std::size_t remaining = 0;
+	for (const Participant& participant : mParticipants)
+	{
+		remaining += !participant.task.mHandle.done();
+	}
+	return remaining;
+}
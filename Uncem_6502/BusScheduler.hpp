@@ -0,0 +1,90 @@
+#ifndef BUSSCHEDULER_HPP
+#define BUSSCHEDULER_HPP
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MOS6502.hpp"
+
+// Cooperative scheduler for several CPUs (and device models) on one host thread. Every participant is a
+// C++20 coroutine that runs for one quantum of guest cycles and then yields; the scheduler resumes them
+// round-robin in the order they were added, so the interleaving, and with it the order of every access
+// to pages shared through MOS6502::mapSharedPage(), is the same on every run. A switch is a coroutine
+// resume, no thread, lock or stack switch is involved.
+//
+// A quantum of 1 cycle interleaves the cores instruction by instruction, larger quanta trade coupling
+// for fewer switches.
+class BusScheduler
+{
+public:
+	class Task
+	{
+	public:
+		struct promise_type
+		{
+			Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+			std::suspend_always initial_suspend() noexcept { return {}; }
+			std::suspend_always final_suspend() noexcept { return {}; }
+			void return_void() {}
+			void unhandled_exception() { throw; }
+		};
+
+		Task(Task&& other) noexcept : mHandle(other.mHandle) { other.mHandle = nullptr; }
+		Task(const Task&) = delete;
+		Task& operator=(const Task&) = delete;
+		~Task()
+		{
+			if (mHandle) { mHandle.destroy(); }
+		}
+
+	private:
+		friend class BusScheduler;
+		explicit Task(std::coroutine_handle<promise_type> handle) : mHandle(handle) {}
+		std::coroutine_handle<promise_type> mHandle;
+	};
+
+	// co_await scheduler.nextQuantum() hands control to the next participant until the following quantum
+	struct Yield
+	{
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(std::coroutine_handle<>) const noexcept {}
+		void await_resume() const noexcept {}
+	};
+
+	explicit BusScheduler(uint64_t quantumCycles = 64);
+
+	// cpu runs from its current program counter until it stops; the scheduler does not own it
+	std::size_t addCpu(MOS6502& cpu);
+	// any other participant, e.g. a device model written as a coroutine that co_awaits nextQuantum()
+	std::size_t addTask(Task task);
+
+	Yield nextQuantum() const { return {}; }
+	uint64_t quantum() const { return mQuantum; }
+	// start of the current quantum in scheduler time, cycles since run() was first called
+	uint64_t now() const { return mNow; }
+
+	// run until every participant has finished or maxCycles of scheduler time have passed;
+	// returns the number of participants still running
+	std::size_t run(uint64_t maxCycles = UINT64_MAX);
+
+	// why a CPU added with addCpu() stopped, STOP_NONE while it is still running
+	StopReason result(std::size_t participant) const { return mParticipants[participant].result; }
+	uint64_t switches() const { return mSwitches; }
+
+private:
+	struct Participant
+	{
+		Task task;
+		StopReason result;
+	};
+
+	Task runCpu(MOS6502& cpu, std::size_t participant);
+
+	uint64_t mQuantum;
+	uint64_t mNow;
+	uint64_t mSwitches;
+	std::vector<Participant> mParticipants;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef CALLSTACK_HPP
+#define CALLSTACK_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Shadow of the guest's subroutine calls: JSR pushes a frame, RTS and RTI drop every frame whose JSR found
+// the stack pointer at or below where the return leaves it (see MOS6502::attachCallStack()). Unwinding by
+// stack pointer keeps the shadow in step with code that drops return addresses off the stack, host hooks that
+// return for the routine they replace, and calls nested deeper than maxDepth, which are not recorded.
+class CallStack
+{
+public:
+	static constexpr std::size_t maxDepth = 64;
+
+	struct Frame
+	{
+		uint16_t entry;       // the called address
+		uint8_t stack;        // stack pointer before the JSR
+	};
+
+	void call(uint16_t entry, uint8_t stack)
+	{
+		if (mDepth < maxDepth)
+		{
+			mFrames[mDepth++] = { entry, stack };
+		}
+	}
+
+	void unwind(uint8_t stack)
+	{
+		while (mDepth != 0 && mFrames[mDepth - 1].stack <= stack)
+		{
+			mDepth--;
+		}
+	}
+
+	void clear() { mDepth = 0; }
+
+	std::size_t depth() const { return mDepth; }
+	const Frame* frames() const { return mFrames; }     // outermost call first
+
+private:
+	Frame mFrames[maxDepth];
+	std::size_t mDepth = 0;
+};
+
+#endif
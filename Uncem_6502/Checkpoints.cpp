@@ -0,0 +1,155 @@
+#include "Checkpoints.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace
+{
+	const char magic[8] = { '6', '5', '0', '2', 'C', 'K', 'P', 'T' };
+	constexpr uint32_t version = 1;
+	constexpr std::size_t recordSize = 4 * 8 + 1;
+
+	void put(std::vector<uint8_t>& out, uint64_t value, unsigned bytes)
+	{
+		for (unsigned i = 0; i < bytes; i++)
+		{
+			out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+		}
+	}
+
+	uint64_t take(const uint8_t*& in, unsigned bytes)
+	{
+		uint64_t value = 0;
+		for (unsigned i = 0; i < bytes; i++)
+		{
+			value |= static_cast<uint64_t>(*in++) << (8 * i);
+		}
+		return value;
+	}
+}
+
+CheckpointStream::CheckpointStream(uint64_t interval)
+	: mInterval(interval ? interval : 1)
+{
+}
+
+StopReason CheckpointStream::record(MOS6502& cpu, uint64_t maxInstructions, const Runner& run)
+{
+	mCheckpoints.clear();
+	add(cpu, 0, STOP_NONE);
+	uint64_t done = 0;
+	while (done < maxInstructions)
+	{
+		uint64_t window = std::min(mInterval, maxInstructions - done);
+		StopReason reason = run ? run(window) : cpu.execute(window);
+		if (reason != STOP_BUDGET)
+		{
+			add(cpu, done, reason);
+			return reason;
+		}
+		done += window;
+		add(cpu, done, STOP_NONE);
+	}
+	return STOP_BUDGET;
+}
+
+void CheckpointStream::add(MOS6502& cpu, uint64_t instructions, StopReason reason)
+{
+	// cycles stay out of the chain like they stay out of the state hash
+	Checkpoint checkpoint = { instructions, cpu.cycles(), cpu.stateHash(), 0, reason };
+	std::vector<uint8_t> fields;
+	put(fields, instructions, 8);
+	put(fields, checkpoint.state, 8);
+	put(fields, reason, 1);
+	uint64_t previous = mCheckpoints.empty() ? 0 : mCheckpoints.back().chain;
+	checkpoint.chain = ProgramImage::hashBytes(fields.data(), fields.size(), previous ^ 0xCBF29CE484222325ULL);
+	mCheckpoints.push_back(checkpoint);
+}
+
+bool CheckpointStream::save(const std::string& path) const
+{
+	std::vector<uint8_t> data(magic, magic + sizeof(magic));
+	put(data, version, 4);
+	put(data, mInterval, 8);
+	put(data, mCheckpoints.size(), 8);
+	for (const Checkpoint& checkpoint : mCheckpoints)
+	{
+		put(data, checkpoint.instructions, 8);
+		put(data, checkpoint.cycles, 8);
+		put(data, checkpoint.state, 8);
+		put(data, checkpoint.chain, 8);
+		put(data, checkpoint.reason, 1);
+	}
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file.write(reinterpret_cast<const char*>(data.data()), data.size()))
+	{
+		std::cerr << "Checkpoints: could not write " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool CheckpointStream::load(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "Checkpoints: could not read " << path << std::endl;
+		return false;
+	}
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	constexpr std::size_t headerSize = sizeof(magic) + 4 + 8 + 8;
+	const uint8_t* in = data.data() + sizeof(magic);
+	if (data.size() < headerSize || memcmp(data.data(), magic, sizeof(magic)) != 0 || take(in, 4) != version)
+	{
+		std::cerr << "Checkpoints: " << path << " is not a checkpoint stream" << std::endl;
+		return false;
+	}
+	uint64_t interval = take(in, 8);
+	uint64_t count = take(in, 8);
+	if (interval == 0 || (data.size() - headerSize) % recordSize != 0 || count != (data.size() - headerSize) / recordSize)
+	{
+		std::cerr << "Checkpoints: " << path << " is truncated" << std::endl;
+		return false;
+	}
+
+	mInterval = interval;
+	mCheckpoints.resize(count);
+	for (Checkpoint& checkpoint : mCheckpoints)
+	{
+		checkpoint.instructions = take(in, 8);
+		checkpoint.cycles = take(in, 8);
+		checkpoint.state = take(in, 8);
+		checkpoint.chain = take(in, 8);
+		checkpoint.reason = static_cast<StopReason>(take(in, 1));
+	}
+	return true;
+}
+
+std::size_t CheckpointStream::firstDivergence(const CheckpointStream& a, const CheckpointStream& b)
+{
+	if (a.mInterval != b.mInterval)
+	{
+		return 0;
+	}
+	// chain hashes match on a common prefix and nowhere after it, so the boundary can be bisected
+	std::size_t low = 0;
+	std::size_t high = std::min(a.mCheckpoints.size(), b.mCheckpoints.size());
+	while (low < high)
+	{
+		std::size_t middle = low + (high - low) / 2;
+		if (a.mCheckpoints[middle].chain == b.mCheckpoints[middle].chain)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	return low;
+}
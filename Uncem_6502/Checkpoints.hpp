@@ -0,0 +1,62 @@
+#ifndef CHECKPOINTS_HPP
+#define CHECKPOINTS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "MOS6502.hpp"
+
+// Stream of state hashes taken every interval instructions, for finding where two cores or two builds stop
+// agreeing without dumping any state. Each checkpoint also carries a chained hash over itself and every
+// checkpoint before it, so two streams agree up to some index and differ from there on; firstDivergence()
+// finds that index by binary search.
+//
+// To find the instruction, record both runs again from the start of the divergent window (run that many
+// instructions first, or restore a copy of the CPU) with an interval of 1.
+//
+// Saved streams are a small header followed by the checkpoints, all little endian:
+//   "6502CKPT", u32 version, u64 interval, u64 count, per checkpoint { u64 instructions, u64 cycles,
+//   u64 state, u64 chain, u8 StopReason }
+// Cycles are recorded for reference but, like in the state hash, left out of the chain.
+class CheckpointStream
+{
+public:
+	struct Checkpoint
+	{
+		uint64_t instructions;     // instructions run before the checkpoint; see reason for the last one
+		uint64_t cycles;
+		uint64_t state;            // MOS6502::stateHash()
+		uint64_t chain;            // hash over this and all earlier checkpoints
+		StopReason reason;         // STOP_NONE, or why the run ended in the window before this checkpoint
+	};
+
+	// runs up to the given number of instructions and returns why it stopped; the default runs execute()
+	using Runner = std::function<StopReason(uint64_t instructions)>;
+
+	explicit CheckpointStream(uint64_t interval = 1000);
+
+	uint64_t interval() const { return mInterval; }
+	const std::vector<Checkpoint>& checkpoints() const { return mCheckpoints; }
+
+	// record the state cpu starts in and one checkpoint per interval, until the guest stops or
+	// maxInstructions ran; a run that stops inside a window records the partial window with the stop
+	// reason and the window's start as its instruction count
+	StopReason record(MOS6502& cpu, uint64_t maxInstructions = UINT64_MAX, const Runner& run = nullptr);
+
+	bool save(const std::string& path) const;
+	bool load(const std::string& path);
+
+	// index of the first checkpoint that differs, the length of the shorter stream if one is a prefix of
+	// the other, and 0 if the intervals do not match
+	static std::size_t firstDivergence(const CheckpointStream& a, const CheckpointStream& b);
+
+private:
+	void add(MOS6502& cpu, uint64_t instructions, StopReason reason);
+
+	uint64_t mInterval;
+	std::vector<Checkpoint> mCheckpoints;
+};
+
+#endif
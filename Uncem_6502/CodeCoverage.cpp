@@ -0,0 +1,248 @@
+#include "CodeCoverage.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+	struct SourceLine
+	{
+		bool executed = false;
+		std::vector<uint16_t> branches;    // conditional branches on the line
+	};
+
+	bool openReport(std::ofstream& file, const std::string& path)
+	{
+		file.open(path, std::ios::out | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cerr << "Could not open coverage file \"" << path << "\" !" << std::endl;
+			return false;
+		}
+		return true;
+	}
+}
+
+CodeCoverage::CodeCoverage()
+{
+	reset();
+}
+
+void CodeCoverage::merge(const CodeCoverage& other)
+{
+	for (std::size_t word = 0; word < words; word++)
+	{
+		mExecuted[word] |= other.mExecuted[word];
+		mTaken[word] |= other.mTaken[word];
+		mNotTaken[word] |= other.mNotTaken[word];
+	}
+}
+
+void CodeCoverage::reset()
+{
+	memset(mExecuted, 0, sizeof(mExecuted));
+	memset(mTaken, 0, sizeof(mTaken));
+	memset(mNotTaken, 0, sizeof(mNotTaken));
+}
+
+CodeCoverage::Summary CodeCoverage::summary() const
+{
+	Summary summary = { 0, 0, 0 };
+	for (std::size_t word = 0; word < words; word++)
+	{
+		summary.instructions += std::popcount(mExecuted[word]);
+		summary.branches += std::popcount(mTaken[word] | mNotTaken[word]);
+		summary.bothWays += std::popcount(mTaken[word] & mNotTaken[word]);
+	}
+	return summary;
+}
+
+static void writeRecord(std::ostream& out, const std::string& source, const CodeCoverage& coverage, const std::map<unsigned, SourceLine>& lines)
+{
+	// one lcov record; hits are 0 or 1 since the bitmaps do not count, and a branch that never ran is "-"
+	std::size_t linesHit = 0;
+	std::size_t branchesFound = 0;
+	std::size_t branchesHit = 0;
+	out << "TN:\nSF:" << source << "\n";
+	for (const auto& [number, line] : lines)
+	{
+		for (std::size_t block = 0; block < line.branches.size(); block++)
+		{
+			uint16_t addr = line.branches[block];
+			for (bool taken : { true, false })
+			{
+				out << "BRDA:" << number << "," << block << "," << !taken << ",";
+				if (coverage.executed(addr))
+				{
+					bool hit = taken ? coverage.taken(addr) : coverage.notTaken(addr);
+					out << hit << "\n";
+					branchesHit += hit;
+				}
+				else
+				{
+					out << "-\n";
+				}
+				branchesFound++;
+			}
+		}
+	}
+	for (const auto& [number, line] : lines)
+	{
+		out << "DA:" << number << "," << line.executed << "\n";
+		linesHit += line.executed;
+	}
+	out << "BRF:" << branchesFound << "\nBRH:" << branchesHit << "\n";
+	out << "LF:" << lines.size() << "\nLH:" << linesHit << "\nend_of_record\n";
+}
+
+bool CodeCoverage::writeLcov(const std::string& path, const std::string& listingPath, const uint8_t* memory, uint16_t first, uint16_t last) const
+{
+	std::ofstream listing;
+	std::ofstream file;
+	if (!openReport(listing, listingPath) || !openReport(file, path))
+	{
+		return false;
+	}
+
+	std::map<unsigned, SourceLine> lines;
+	unsigned number = 0;
+	uint32_t addr = first;
+	while (addr <= last)
+	{
+		std::size_t length = instructionTable[memory[addr]].length;
+		length = std::min<std::size_t>(length, last - addr + 1);
+		for (std::size_t i = 1; i < length; i++)
+		{
+			if (executed(static_cast<uint16_t>(addr + i)))
+			{
+				// an instruction that ran starts inside this one, so this one is data or dead code
+				length = 1;
+				break;
+			}
+		}
+
+		char text[Disassembler::maxListingLine + 8];
+		std::size_t written;
+		if (length == instructionTable[memory[addr]].length || instructionTable[memory[addr]].length == 1)
+		{
+			written = Disassembler::formatListing(memory + addr, length, static_cast<uint16_t>(addr), text, sizeof(text));
+		}
+		else
+		{
+			// cut short: a byte of data rather than an instruction with missing operands
+			length = 1;
+			written = static_cast<std::size_t>(std::snprintf(text, sizeof(text), "%04X  %02X        .byte $%02X\n", addr, memory[addr], memory[addr]));
+		}
+		listing.write(text, written);
+
+		SourceLine& line = lines[++number];
+		line.executed = executed(static_cast<uint16_t>(addr));
+		if (length == 2 && instructionTable[memory[addr]].mode == REL)
+		{
+			line.branches.push_back(static_cast<uint16_t>(addr));
+		}
+		addr += static_cast<uint32_t>(length);
+	}
+
+	writeRecord(file, listingPath, *this, lines);
+	return listing.good() && file.good();
+}
+
+bool CodeCoverage::writeLcov(const std::string& path, const std::string& mapPath) const
+{
+	std::ifstream map(mapPath);
+	if (!map.is_open())
+	{
+		std::cerr << "Could not open address map \"" << mapPath << "\" !" << std::endl;
+		return false;
+	}
+
+	std::map<std::string, std::map<unsigned, SourceLine>> sources;
+	std::string text;
+	unsigned lineNumber = 0;
+	while (std::getline(map, text))
+	{
+		lineNumber++;
+		if (text.empty() || text[0] == '#')
+		{
+			continue;
+		}
+		std::istringstream fields(text);
+		std::string location;
+		unsigned long addr;
+		std::size_t colon;
+		if (!(fields >> std::hex >> addr >> location) || addr > 0xFFFF || (colon = location.rfind(':')) == std::string::npos)
+		{
+			std::cerr << "Address map \"" << mapPath << "\" line " << lineNumber << ": expected <hex address> <file>:<line>" << std::endl;
+			return false;
+		}
+		unsigned sourceLine = static_cast<unsigned>(std::strtoul(location.c_str() + colon + 1, nullptr, 10));
+		SourceLine& line = sources[location.substr(0, colon)][sourceLine];
+		uint16_t instruction = static_cast<uint16_t>(addr);
+		line.executed = line.executed || executed(instruction);
+		if (executed(instruction) && (taken(instruction) || notTaken(instruction)))
+		{
+			line.branches.push_back(instruction);
+		}
+	}
+
+	std::ofstream file;
+	if (!openReport(file, path))
+	{
+		return false;
+	}
+	for (const auto& [source, lines] : sources)
+	{
+		writeRecord(file, source, *this, lines);
+	}
+	return file.good();
+}
+
+bool CodeCoverage::writeJson(const std::string& path) const
+{
+	std::ofstream file;
+	if (!openReport(file, path))
+	{
+		return false;
+	}
+
+	Summary totals = summary();
+	file << "{\"summary\": {\"instructions\": " << totals.instructions << ", \"branches\": " << totals.branches
+		<< ", \"bothWays\": " << totals.bothWays << "},\n\"executed\": [";
+	const char* separator = "";
+	for (std::size_t word = 0; word < words; word++)
+	{
+		for (uint64_t bits = mExecuted[word]; bits != 0; bits &= bits - 1)
+		{
+			file << separator << word * 64 + std::countr_zero(bits);
+			separator = ", ";
+		}
+	}
+	file << "],\n\"branches\": [";
+	separator = "";
+	for (uint32_t addr = 0; addr < addressCount; addr++)
+	{
+		uint16_t branch = static_cast<uint16_t>(addr);
+		if (!taken(branch) && !notTaken(branch)) { continue; }
+		file << separator << "\n  {\"address\": " << addr << ", \"taken\": " << (taken(branch) ? "true" : "false")
+			<< ", \"notTaken\": " << (notTaken(branch) ? "true" : "false") << "}";
+		separator = ",";
+	}
+	file << "]}\n";
+	return file.good();
+}
+
+void CodeCoverage::printSummary(std::ostream& out) const
+{
+	Summary totals = summary();
+	out << std::dec << "Coverage: " << totals.instructions << " instruction addresses executed, " << totals.branches
+		<< " conditional branches, " << totals.bothWays << " of them taken both ways" << std::endl;
+}
@@ -0,0 +1,76 @@
+#ifndef CODECOVERAGE_HPP
+#define CODECOVERAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include "Disassembler.hpp"
+
+// Which guest instructions ran and which way every conditional branch went, one bit per address each:
+// executed, branch taken and branch not taken (a branch to the next instruction counts as not taken).
+// Attached with MOS6502::attachCodeCoverage(), it costs one bit set per instruction and one more per branch.
+//
+// A CPU writes its coverage without synchronisation, so CPUs on different threads need their own; merge()
+// them afterwards. Reports are lcov tracefiles, against a disassembly listing of a memory snapshot or against
+// an assembler address map, or JSON.
+class CodeCoverage
+{
+public:
+	static constexpr std::size_t addressCount = 65536;
+
+	struct Summary
+	{
+		std::size_t instructions;      // executed instruction addresses
+		std::size_t branches;          // executed conditional branches
+		std::size_t bothWays;          // of those, the ones seen both taken and not taken
+	};
+
+	CodeCoverage();
+
+	void record(uint16_t pc, uint8_t opcode, uint16_t next)
+	{
+		std::size_t word = pc >> 6;
+		uint64_t bit = 1ULL << (pc & 63);
+		mExecuted[word] |= bit;
+		if (instructionTable[opcode].mode == REL)
+		{
+			uint64_t* direction = next == static_cast<uint16_t>(pc + 2) ? mNotTaken : mTaken;
+			direction[word] |= bit;
+		}
+	}
+
+	bool executed(uint16_t addr) const { return (mExecuted[addr >> 6] >> (addr & 63)) & 1; }
+	bool taken(uint16_t addr) const { return (mTaken[addr >> 6] >> (addr & 63)) & 1; }
+	bool notTaken(uint16_t addr) const { return (mNotTaken[addr >> 6] >> (addr & 63)) & 1; }
+
+	void merge(const CodeCoverage& other);
+	void reset();
+	Summary summary() const;
+
+	// lcov tracefile for [first, last] of memory, a 64 KiB snapshot (see MOS6502::copyMemory()). The range is
+	// disassembled into listingPath, one instruction per line, and the tracefile refers to that listing as its
+	// source file. Disassembly is linear, but restarts at every executed address so that the code that ran is
+	// always listed as it ran; branches that never ran are reported as "-"
+	bool writeLcov(const std::string& path, const std::string& listingPath, const uint8_t* memory, uint16_t first, uint16_t last) const;
+
+	// lcov tracefile against the sources of an assembler address map: one "<hex address> <file>:<line>" line per
+	// instruction, e.g. produced from an assembler listing; empty lines and lines starting with '#' are ignored.
+	// Without the code only executed branches are known, so only those are reported
+	bool writeLcov(const std::string& path, const std::string& mapPath) const;
+
+	// {"summary": {...}, "executed": [address, ...], "branches": [{"address": a, "taken": t, "notTaken": n}, ...]}
+	// listing every executed instruction and branch, addresses in decimal
+	bool writeJson(const std::string& path) const;
+
+	void printSummary(std::ostream& out) const;
+
+private:
+	static constexpr std::size_t words = addressCount / 64;
+
+	uint64_t mExecuted[words];
+	uint64_t mTaken[words];
+	uint64_t mNotTaken[words];
+};
+
+#endif
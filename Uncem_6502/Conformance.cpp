@@ -0,0 +1,522 @@
+// Conformance runner for single-instruction test vectors in the SingleStepTests layout: one JSON file per
+// opcode ("a9.json", ...), each an array of cases
+//
+//   { "name": "...",
+//     "initial": { "pc": n, "s": n, "a": n, "x": n, "y": n, "p": n, "ram": [[address, value], ...] },
+//     "final":   { same fields },
+//     "cycles":  [[address, value, "read" | "write"], ...] }
+//
+// Every case loads its initial state into a CPU, runs one step() and compares registers, flags and the final
+// RAM; a write to an address the final state does not list fails the case as well. Bits 4 and 5 of P do not
+// exist in the CPU and are ignored. The cycle count is only compared with --cycles, the core adds the base
+// cycles of each opcode without page crossing and branch penalties.
+//
+// Files are spread over all cores, each thread reuses one CPU and only clears the addresses a case touched,
+// so a full set of vectors runs in seconds. Opcodes without an entry in instructionTable are reported as not
+// implemented without running them; $02 (HYP) and $FF (HALT) are this emulator's own and are left out.
+//
+//   6502_Conformance [--threads n] [--cycles] [--verbose] <directory or file.json>...
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MOS6502.hpp"
+
+namespace
+{
+	struct State
+	{
+		uint16_t pc = 0;
+		uint8_t s = 0, a = 0, x = 0, y = 0, p = 0;
+		std::vector<std::pair<uint16_t, uint8_t>> ram;
+	};
+
+	struct TestCase
+	{
+		std::string name;
+		State initial;
+		State final;
+		std::size_t cycles = 0;
+	};
+
+	// just enough JSON for the vector files: objects, arrays, non-negative integers and strings without
+	// escapes that matter; unknown keys are skipped
+	class Parser
+	{
+	public:
+		Parser(const char* data, std::size_t size) : mPos(data), mEnd(data + size) {}
+
+		bool parseFile(std::vector<TestCase>& cases)
+		{
+			if (!expect('[')) { return false; }
+			if (peek() == ']') { return true; }
+			do
+			{
+				cases.emplace_back();
+				if (!parseCase(cases.back())) { return false; }
+			} while (expect(','));
+			return expect(']');
+		}
+
+		std::size_t offset(const char* data) const { return mPos - data; }
+
+	private:
+		char peek()
+		{
+			while (mPos < mEnd && (*mPos == ' ' || *mPos == '\n' || *mPos == '\r' || *mPos == '\t')) { mPos++; }
+			return mPos < mEnd ? *mPos : '\0';
+		}
+
+		bool expect(char c)
+		{
+			if (peek() != c) { return false; }
+			mPos++;
+			return true;
+		}
+
+		bool parseNumber(unsigned long& value)
+		{
+			peek();
+			if (mPos >= mEnd || *mPos < '0' || *mPos > '9') { return false; }
+			value = 0;
+			while (mPos < mEnd && *mPos >= '0' && *mPos <= '9')
+			{
+				value = value * 10 + (*mPos++ - '0');
+			}
+			return true;
+		}
+
+		bool parseString(std::string& value)
+		{
+			if (!expect('"')) { return false; }
+			const char* start = mPos;
+			while (mPos < mEnd && *mPos != '"')
+			{
+				mPos += (*mPos == '\\') ? 2 : 1;
+			}
+			if (mPos >= mEnd) { return false; }
+			value.assign(start, mPos++);
+			return true;
+		}
+
+		bool skipValue()
+		{
+			char c = peek();
+			if (c == '"')
+			{
+				std::string ignored;
+				return parseString(ignored);
+			}
+			if (c == '[' || c == '{')
+			{
+				char close = c == '[' ? ']' : '}';
+				mPos++;
+				if (peek() == close)
+				{
+					mPos++;
+					return true;
+				}
+				do
+				{
+					if (c == '{')
+					{
+						std::string key;
+						if (!parseString(key) || !expect(':')) { return false; }
+					}
+					if (!skipValue()) { return false; }
+				} while (expect(','));
+				return expect(close);
+			}
+			// numbers, true, false, null
+			const char* start = mPos;
+			while (mPos < mEnd && *mPos != ',' && *mPos != ']' && *mPos != '}' && *mPos != ' ' && *mPos != '\n') { mPos++; }
+			return mPos != start;
+		}
+
+		template <typename T>
+		bool parseField(T& field)
+		{
+			unsigned long value;
+			if (!parseNumber(value)) { return false; }
+			field = static_cast<T>(value);
+			return true;
+		}
+
+		bool parseRam(std::vector<std::pair<uint16_t, uint8_t>>& ram)
+		{
+			if (!expect('[')) { return false; }
+			if (peek() == ']')
+			{
+				mPos++;
+				return true;
+			}
+			do
+			{
+				uint16_t addr;
+				uint8_t value;
+				if (!expect('[') || !parseField(addr) || !expect(',') || !parseField(value) || !expect(']')) { return false; }
+				ram.emplace_back(addr, value);
+			} while (expect(','));
+			return expect(']');
+		}
+
+		bool parseState(State& state)
+		{
+			if (!expect('{')) { return false; }
+			do
+			{
+				std::string key;
+				if (!parseString(key) || !expect(':')) { return false; }
+				bool ok;
+				if (key == "pc") { ok = parseField(state.pc); }
+				else if (key == "s") { ok = parseField(state.s); }
+				else if (key == "a") { ok = parseField(state.a); }
+				else if (key == "x") { ok = parseField(state.x); }
+				else if (key == "y") { ok = parseField(state.y); }
+				else if (key == "p") { ok = parseField(state.p); }
+				else if (key == "ram") { ok = parseRam(state.ram); }
+				else { ok = skipValue(); }
+				if (!ok) { return false; }
+			} while (expect(','));
+			return expect('}');
+		}
+
+		bool parseCycles(std::size_t& cycles)
+		{
+			// only the count is used, see --cycles
+			if (!expect('[')) { return false; }
+			if (peek() == ']')
+			{
+				mPos++;
+				return true;
+			}
+			do
+			{
+				if (!skipValue()) { return false; }
+				cycles++;
+			} while (expect(','));
+			return expect(']');
+		}
+
+		bool parseCase(TestCase& test)
+		{
+			if (!expect('{')) { return false; }
+			do
+			{
+				std::string key;
+				if (!parseString(key) || !expect(':')) { return false; }
+				bool ok;
+				if (key == "name") { ok = parseString(test.name); }
+				else if (key == "initial") { ok = parseState(test.initial); }
+				else if (key == "final") { ok = parseState(test.final); }
+				else if (key == "cycles") { ok = parseCycles(test.cycles); }
+				else { ok = skipValue(); }
+				if (!ok) { return false; }
+			} while (expect(','));
+			return expect('}');
+		}
+
+		const char* mPos;
+		const char* mEnd;
+	};
+
+	struct OpcodeResult
+	{
+		bool present = false;
+		bool skipped = false;
+		uint64_t passed = 0;
+		uint64_t failed = 0;
+		std::vector<std::string> failures;         // first few, for --verbose
+	};
+
+	struct Options
+	{
+		unsigned threads = 0;
+		bool cycles = false;
+		bool verbose = false;
+	};
+
+	constexpr std::size_t reportedFailures = 3;
+
+	// one per thread; remembers every address written so stray writes can be caught and cleared
+	class TestCpu : public MOS6502Debug, private AccessObserver
+	{
+	public:
+		TestCpu()
+		{
+			ISDEBUG = false;
+			attachObserver(this);
+		}
+
+		// returns false if the opcode is not implemented, otherwise fills failure when the case does not match
+		bool run(const TestCase& test, bool compareCycles, std::string& failure)
+		{
+			const State& in = test.initial;
+			const State& out = test.final;
+			for (const auto& [addr, value] : in.ram) { setMemory(addr, value); }
+			setProgramCounter(in.pc);
+			setStackPointer(in.s);
+			setAccumulator(in.a);
+			setRegisterX(in.x);
+			setRegisterY(in.y);
+			setStatus(in.p);
+			mWritten.clear();
+			uint64_t start = mCycles;
+
+			StopReason reason = step();
+			bool implemented = reason != STOP_UNKNOWN_OPCODE;
+			if (implemented)
+			{
+				compare(test, compareCycles ? static_cast<int64_t>(mCycles - start) : -1, failure);
+			}
+
+			// leave memory blank for the next case
+			for (const auto& [addr, value] : in.ram) { setMemory(addr, 0); }
+			for (const auto& [addr, value] : out.ram) { setMemory(addr, 0); }
+			for (uint16_t addr : mWritten) { setMemory(addr, 0); }
+			return implemented;
+		}
+
+	private:
+		void observe(MemoryProfile::Access kind, uint16_t addr, uint8_t) override
+		{
+			if (kind == MemoryProfile::Write) { mWritten.push_back(addr); }
+		}
+
+		void compare(const TestCase& test, int64_t cycles, std::string& failure)
+		{
+			const State& out = test.final;
+			char text[128];
+			auto mismatch = [&](const char* what, unsigned got, unsigned expected)
+			{
+				std::snprintf(text, sizeof(text), " %s=%02x (expected %02x)", what, got, expected);
+				failure += text;
+			};
+			if (getProgramCounter() != out.pc) { mismatch("pc", getProgramCounter(), out.pc); }
+			if (getStackPointer() != out.s) { mismatch("s", getStackPointer(), out.s); }
+			if (getAccumulator() != out.a) { mismatch("a", getAccumulator(), out.a); }
+			if (getRegisterX() != out.x) { mismatch("x", getRegisterX(), out.x); }
+			if (getRegisterY() != out.y) { mismatch("y", getRegisterY(), out.y); }
+			if ((getStatus() | 0x30) != (out.p | 0x30)) { mismatch("p", getStatus() | 0x30, out.p | 0x30); }
+			for (const auto& [addr, value] : out.ram)
+			{
+				if (getMemory(addr) != value)
+				{
+					std::snprintf(text, sizeof(text), " [%04x]=%02x (expected %02x)", addr, getMemory(addr), value);
+					failure += text;
+				}
+			}
+			for (uint16_t addr : mWritten)
+			{
+				auto listed = [addr](const auto& entry) { return entry.first == addr; };
+				if (std::none_of(out.ram.begin(), out.ram.end(), listed))
+				{
+					std::snprintf(text, sizeof(text), " stray write to %04x", addr);
+					failure += text;
+				}
+			}
+			if (cycles >= 0 && static_cast<std::size_t>(cycles) != test.cycles)
+			{
+				std::snprintf(text, sizeof(text), " cycles=%lld (expected %zu)", static_cast<long long>(cycles), test.cycles);
+				failure += text;
+			}
+		}
+
+		std::vector<uint16_t> mWritten;
+	};
+
+	int opcodeOf(const std::filesystem::path& file)
+	{
+		std::string stem = file.stem().string();
+		if (stem.size() != 2 || !std::isxdigit(static_cast<unsigned char>(stem[0])) || !std::isxdigit(static_cast<unsigned char>(stem[1])))
+		{
+			return -1;
+		}
+		return static_cast<int>(std::strtoul(stem.c_str(), nullptr, 16));
+	}
+
+	bool runFile(const std::filesystem::path& file, TestCpu& cpu, const Options& options, OpcodeResult& result)
+	{
+		std::ifstream stream(file, std::ios::binary);
+		if (!stream)
+		{
+			std::cerr << "Conformance: cannot read " << file.string() << std::endl;
+			return false;
+		}
+		std::string text((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+		std::vector<TestCase> cases;
+		Parser parser(text.data(), text.size());
+		if (!parser.parseFile(cases))
+		{
+			std::cerr << "Conformance: " << file.string() << ": malformed vector file near offset " << parser.offset(text.data()) << std::endl;
+			return false;
+		}
+
+		result.present = true;
+		for (const TestCase& test : cases)
+		{
+			std::string failure;
+			if (!cpu.run(test, options.cycles, failure))
+			{
+				result.skipped = true;
+				return true;
+			}
+			if (failure.empty())
+			{
+				result.passed++;
+				continue;
+			}
+			result.failed++;
+			if (result.failures.size() < reportedFailures)
+			{
+				result.failures.push_back(test.name + ":" + failure);
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	std::vector<std::filesystem::path> files;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--threads" && i + 1 < argc)
+		{
+			options.threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (arg == "--cycles")
+		{
+			options.cycles = true;
+		}
+		else if (arg == "--verbose")
+		{
+			options.verbose = true;
+		}
+		else if (std::filesystem::is_directory(arg))
+		{
+			for (const auto& entry : std::filesystem::directory_iterator(arg))
+			{
+				if (entry.path().extension() == ".json") { files.push_back(entry.path()); }
+			}
+		}
+		else
+		{
+			files.emplace_back(arg);
+		}
+	}
+	if (files.empty())
+	{
+		std::cerr << "Usage: " << argv[0] << " [--threads n] [--cycles] [--verbose] <directory or file.json>..." << std::endl;
+		return 2;
+	}
+
+	// one opcode per file; files that are not named after one, $02 and $FF are left out
+	std::vector<std::pair<int, std::filesystem::path>> work;
+	std::vector<OpcodeResult> results(256);
+	for (const auto& file : files)
+	{
+		int opcode = opcodeOf(file);
+		if (opcode < 0)
+		{
+			std::cerr << "Conformance: " << file.string() << " is not named after an opcode, skipped" << std::endl;
+		}
+		else if (opcode == HYPERCALL || opcode == HALT)
+		{
+			continue;
+		}
+		else if (!instructionTable[opcode].mnemonic)
+		{
+			results[opcode].present = true;
+			results[opcode].skipped = true;
+		}
+		else
+		{
+			work.emplace_back(opcode, file);
+		}
+	}
+	// the slowest files first, so no thread is left with a big one at the end
+	std::sort(work.begin(), work.end(), [](const auto& a, const auto& b)
+	{
+		std::error_code ignored;
+		return std::filesystem::file_size(a.second, ignored) > std::filesystem::file_size(b.second, ignored);
+	});
+
+	unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+	threads = static_cast<unsigned>(std::min<std::size_t>(threads, std::max<std::size_t>(work.size(), 1)));
+	std::atomic<std::size_t> next{ 0 };
+	std::atomic<bool> readErrors{ false };
+	auto started = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> pool;
+	for (unsigned t = 0; t < threads; t++)
+	{
+		pool.emplace_back([&]
+		{
+			TestCpu cpu;
+			for (std::size_t i = next++; i < work.size(); i = next++)
+			{
+				OpcodeResult result;
+				if (!runFile(work[i].second, cpu, options, result))
+				{
+					readErrors = true;
+					continue;
+				}
+				static std::mutex merge;
+				std::lock_guard<std::mutex> lock(merge);
+				OpcodeResult& total = results[work[i].first];
+				total.present |= result.present;
+				total.skipped |= result.skipped;
+				total.passed += result.passed;
+				total.failed += result.failed;
+				for (auto& failure : result.failures)
+				{
+					if (total.failures.size() < reportedFailures) { total.failures.push_back(std::move(failure)); }
+				}
+			}
+		});
+	}
+	for (auto& thread : pool) { thread.join(); }
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+	uint64_t passed = 0, failed = 0;
+	unsigned opcodes = 0, failing = 0, skipped = 0;
+	for (int opcode = 0; opcode < 256; opcode++)
+	{
+		const OpcodeResult& result = results[opcode];
+		if (!result.present) { continue; }
+		opcodes++;
+		passed += result.passed;
+		failed += result.failed;
+		if (result.skipped && result.passed + result.failed == 0)
+		{
+			skipped++;
+			continue;
+		}
+		if (result.failed == 0) { continue; }
+		failing++;
+		std::printf("%02x %-4s %llu of %llu failed\n", opcode, instructionTable[opcode].mnemonic,
+			static_cast<unsigned long long>(result.failed), static_cast<unsigned long long>(result.passed + result.failed));
+		if (options.verbose)
+		{
+			for (const auto& failure : result.failures) { std::printf("     %s\n", failure.c_str()); }
+		}
+	}
+	std::printf("%u opcodes, %u failing, %u not implemented; %llu cases passed, %llu failed in %.2fs on %u threads\n",
+		opcodes, failing, skipped, static_cast<unsigned long long>(passed), static_cast<unsigned long long>(failed), seconds, threads);
+	return failed == 0 && !readErrors ? 0 : 1;
+}
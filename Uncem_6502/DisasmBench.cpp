@@ -0,0 +1,101 @@
+// Throughput of Disassembler::formatListing in bytes of guest code per second, over a random 64 KiB image
+// (every byte value, undefined opcodes included) and over one made of implemented instructions only, each
+// listed into a buffer that holds the whole text, as a trace or coverage writer would.
+//
+//   6502_DisasmBench [--seconds s] [--seed n]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "Disassembler.hpp"
+
+namespace
+{
+	struct Options
+	{
+		double seconds = 1;
+		uint32_t seed = 6502;
+	};
+
+	bool parse(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (i + 1 >= argc) { return false; }
+			if (arg == "--seconds") { options.seconds = std::strtod(argv[++i], nullptr); }
+			else if (arg == "--seed") { options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)); }
+			else { return false; }
+		}
+		return options.seconds > 0;
+	}
+
+	std::vector<uint8_t> randomImage(std::mt19937& random)
+	{
+		std::vector<uint8_t> image(0x10000);
+		for (uint8_t& byte : image)
+		{
+			byte = static_cast<uint8_t>(random());
+		}
+		return image;
+	}
+
+	std::vector<uint8_t> validImage(std::mt19937& random)
+	{
+		// opcodes drawn from the implemented ones, operands random
+		std::vector<uint8_t> opcodes;
+		for (std::size_t opcode = 0; opcode < instructionTable.size(); opcode++)
+		{
+			if (instructionTable[opcode].mnemonic) { opcodes.push_back(static_cast<uint8_t>(opcode)); }
+		}
+		std::vector<uint8_t> image(0x10000);
+		for (std::size_t offset = 0; offset < image.size();)
+		{
+			uint8_t opcode = opcodes[random() % opcodes.size()];
+			image[offset++] = opcode;
+			for (std::size_t i = 1; i < instructionTable[opcode].length && offset < image.size(); i++)
+			{
+				image[offset++] = static_cast<uint8_t>(random());
+			}
+		}
+		return image;
+	}
+
+	void measure(const char* name, const std::vector<uint8_t>& image, double seconds)
+	{
+		using Clock = std::chrono::steady_clock;
+		// at most one line per byte
+		std::vector<char> text(image.size() * Disassembler::maxListingLine);
+		uint64_t bytes = 0;
+		uint64_t characters = 0;
+		Clock::time_point start = Clock::now();
+		Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+		Clock::time_point now;
+		do
+		{
+			std::size_t consumed = 0;
+			characters += Disassembler::formatListing(image.data(), image.size(), 0x0000, text.data(), text.size(), &consumed);
+			bytes += consumed;
+			now = Clock::now();
+		} while (now < end);
+		double elapsed = std::chrono::duration<double>(now - start).count();
+		std::printf("%-8s %8.1f MB/s of code, %8.1f MB/s of text\n", name, bytes / elapsed / 1e6, characters / elapsed / 1e6);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!parse(argc, argv, options))
+	{
+		std::fprintf(stderr, "Usage: %s [--seconds s] [--seed n]\n", argv[0]);
+		return 2;
+	}
+	std::mt19937 random(options.seed);
+	measure("random", randomImage(random), options.seconds);
+	measure("valid", validImage(random), options.seconds);
+	return 0;
+}
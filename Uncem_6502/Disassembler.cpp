@@ -0,0 +1,212 @@
+#include "Disassembler.hpp"
+
+#include <cstring>
+
+// both digits of every byte, so a byte costs one two-character copy
+struct HexPairs
+{
+	char digits[256][2];
+};
+
+static constexpr HexPairs makeHexPairs()
+{
+	HexPairs pairs{};
+	const char* digits = "0123456789ABCDEF";
+	for (std::size_t value = 0; value < 256; value++)
+	{
+		pairs.digits[value][0] = digits[value >> 4];
+		pairs.digits[value][1] = digits[value & 0xF];
+	}
+	return pairs;
+}
+
+static constexpr HexPairs hexPairs = makeHexPairs();
+
+static inline char* putHex8(char* out, uint8_t value)
+{
+	memcpy(out, hexPairs.digits[value], 2);
+	return out + 2;
+}
+
+static inline char* putHex16(char* out, uint16_t value)
+{
+	return putHex8(putHex8(out, value >> 8), value & 0xFF);
+}
+
+// Per-opcode text around the operand, e.g. "LDA ($" + xx + "),Y". Built once from instructionTable so the
+// formatters do fixed-size copies instead of switching on the addressing mode for every instruction.
+struct InstructionTemplate
+{
+	char prefix[8];
+	char suffix[4];
+	uint8_t prefixLength;
+	uint8_t suffixLength;
+	uint8_t operand;      // 0 none, 1 byte, 2 word, 3 branch target, 4 the opcode itself (.byte)
+};
+
+static constexpr std::array<InstructionTemplate, 256> makeTemplates()
+{
+	std::array<InstructionTemplate, 256> templates{};
+	for (std::size_t opcode = 0; opcode < templates.size(); opcode++)
+	{
+		const InstructionInfo& info = instructionTable[opcode];
+		InstructionTemplate& entry = templates[opcode];
+		const char* prefix = "";
+		const char* suffix = "";
+		if (!info.mnemonic)
+		{
+			entry = { { '.', 'b', 'y', 't', 'e', ' ', '$' }, {}, 7, 0, 4 };
+			continue;
+		}
+		switch (info.mode)
+		{
+		case IMD: prefix = " #$"; entry.operand = 1; break;
+		case ZPG: prefix = " $"; entry.operand = 1; break;
+		case ZPX: prefix = " $"; suffix = ",X"; entry.operand = 1; break;
+		case ZPY: prefix = " $"; suffix = ",Y"; entry.operand = 1; break;
+		case ABS: prefix = " $"; entry.operand = 2; break;
+		case ABX: prefix = " $"; suffix = ",X"; entry.operand = 2; break;
+		case ABY: prefix = " $"; suffix = ",Y"; entry.operand = 2; break;
+		case INDX: prefix = " ($"; suffix = ",X)"; entry.operand = 1; break;
+		case INDY: prefix = " ($"; suffix = "),Y"; entry.operand = 1; break;
+		case IND: prefix = " ($"; suffix = ")"; entry.operand = 2; break;
+		case REL: prefix = " $"; entry.operand = 3; break;
+		case A: prefix = " A"; break;
+		default: break;
+		}
+		std::size_t length = 0;
+		for (std::size_t i = 0; i < 3; i++)
+		{
+			entry.prefix[length++] = info.mnemonic[i];
+		}
+		for (; *prefix; prefix++)
+		{
+			entry.prefix[length++] = *prefix;
+		}
+		entry.prefixLength = static_cast<uint8_t>(length);
+		for (length = 0; *suffix; suffix++)
+		{
+			entry.suffix[length++] = *suffix;
+		}
+		entry.suffixLength = static_cast<uint8_t>(length);
+	}
+	return templates;
+}
+
+static constexpr std::array<InstructionTemplate, 256> instructionTemplates = makeTemplates();
+
+// Writes up to 8 + 4 + 4 characters whatever the real length is, callers keep that much room in out.
+// low and high are the operand bytes, 0 where the code ends early.
+static inline char* putInstruction(char* out, uint8_t opcode, uint8_t low, uint8_t high, uint16_t pc)
+{
+	const InstructionTemplate& entry = instructionTemplates[opcode];
+	memcpy(out, entry.prefix, sizeof(entry.prefix));
+	out += entry.prefixLength;
+	switch (entry.operand)
+	{
+	case 0:
+		break;
+	case 4:
+		out = putHex8(out, opcode);
+		break;
+	case 1:
+		out = putHex8(out, low);
+		break;
+	case 2:
+		out = putHex16(out, low | (high << 8));
+		break;
+	default:
+		out = putHex16(out, static_cast<uint16_t>(pc + 2 + static_cast<int8_t>(low)));
+		break;
+	}
+	memcpy(out, entry.suffix, sizeof(entry.suffix));
+	return out + entry.suffixLength;
+}
+
+std::size_t Disassembler::formatInstruction(const uint8_t* bytes, std::size_t available, uint16_t pc, char* out)
+{
+	// the template copies may run past the text, so format into scratch space first
+	char text[maxInstructionText + 8];
+	uint8_t low = available > 1 ? bytes[1] : 0;
+	uint8_t high = available > 2 ? bytes[2] : 0;
+	std::size_t length = putInstruction(text, bytes[0], low, high, pc) - text;
+	memcpy(out, text, length);
+	return length;
+}
+
+std::size_t Disassembler::formatListing(const uint8_t* code, std::size_t size, uint16_t base, char* out, std::size_t outSize, std::size_t* consumed)
+{
+	// "1000  A9 83     LDA #$83\n": address, up to three raw bytes padded to 9 columns, instruction text
+	static constexpr std::size_t slack = 8;
+	std::size_t offset = 0;
+	char* start = out;
+	char* end = out + outSize;
+
+	// while three bytes are left every operand byte can be read, a shorter tail goes the careful way below
+	while (offset + 3 <= size && end - out >= static_cast<std::ptrdiff_t>(maxListingLine + slack))
+	{
+		uint16_t pc = static_cast<uint16_t>(base + offset);
+		uint8_t opcode = code[offset];
+		uint8_t low = code[offset + 1];
+		uint8_t high = code[offset + 2];
+		std::size_t length = instructionTable[opcode].length;
+
+		// all three raw byte columns are written, the ones the instruction does not have are blanked again
+		char columns[16] = { 0, 0, 0, 0, ' ', ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', ' ' };
+		memcpy(columns, hexPairs.digits[pc >> 8], 2);
+		memcpy(columns + 2, hexPairs.digits[pc & 0xFF], 2);
+		memcpy(columns + 6, hexPairs.digits[opcode], 2);
+		memcpy(columns + 9, hexPairs.digits[low], 2);
+		memcpy(columns + 12, hexPairs.digits[high], 2);
+		if (length < 3) { memcpy(columns + 12, "  ", 2); }
+		if (length < 2) { memcpy(columns + 9, "  ", 2); }
+		memcpy(out, columns, sizeof(columns));
+		out = putInstruction(out + sizeof(columns), opcode, low, high, pc);
+		*out++ = '\n';
+		offset += length;
+	}
+
+	while (offset < size && end - out >= static_cast<std::ptrdiff_t>(maxListingLine + slack))
+	{
+		uint16_t pc = static_cast<uint16_t>(base + offset);
+		std::size_t available = size - offset;
+		std::size_t length = instructionTable[code[offset]].length;
+		if (length > available)
+		{
+			length = available;
+		}
+
+		out = putHex16(out, pc);
+		memcpy(out, "            ", 12);
+		out += 2;
+		for (std::size_t i = 0; i < length; i++)
+		{
+			putHex8(out + i * 3, code[offset + i]);
+		}
+		out += 10;
+		out = putInstruction(out, code[offset], available > 1 ? code[offset + 1] : 0, available > 2 ? code[offset + 2] : 0, pc);
+		*out++ = '\n';
+		offset += length;
+	}
+
+	// the last lines, formatted through scratch space so nothing is written past outSize
+	while (offset < size && end - out >= static_cast<std::ptrdiff_t>(maxListingLine))
+	{
+		char line[maxListingLine + slack];
+		std::size_t taken = 0;
+		std::size_t written = formatListing(code + offset, size - offset, static_cast<uint16_t>(base + offset), line, sizeof(line), &taken);
+		if (taken == 0)
+		{
+			break;
+		}
+		memcpy(out, line, written);
+		out += written;
+		offset += taken;
+	}
+
+	if (consumed)
+	{
+		*consumed = offset;
+	}
+	return out - start;
+}
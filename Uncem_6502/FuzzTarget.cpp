@@ -0,0 +1,113 @@
+// libFuzzer entry point for fuzzing guest code: every input is copied into a region of guest memory and the
+// guest runs from a fixed entry point for a bounded number of cycles. Coverage is the guest's own control
+// flow, see MOS6502::attachCoverage(); the counters live in libFuzzer's extra counters section, so the
+// emulator itself does not have to be built with coverage instrumentation.
+//
+// Configured through the environment:
+//   M6502_FUZZ_IMAGE        base image file (required)
+//   M6502_FUZZ_LOAD         load address of the image, hex (default 0)
+//   M6502_FUZZ_ENTRY        entry PC, hex (default: the reset vector)
+//   M6502_FUZZ_INPUT        address of the input region, hex (default 0200)
+//   M6502_FUZZ_INPUT_SIZE   size of the input region, longer inputs are cut (default 256)
+//   M6502_FUZZ_LENGTH       if set, address where the input length is stored as a little-endian word, hex
+//   M6502_FUZZ_CYCLES       cycle budget per input (default 1000000)
+//   M6502_FUZZ_ALLOW_UNKNOWN  if set, an unknown opcode ends the run quietly instead of counting as a crash
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+#include "MOS6502.hpp"
+
+namespace
+{
+	constexpr std::size_t coverageSize = 1 << 16;
+
+#if defined(__linux__)
+	__attribute__((section("__libfuzzer_extra_counters")))
+#endif
+	uint8_t coverage[coverageSize];
+
+	struct FuzzConfig
+	{
+		uint16_t input = 0x0200;
+		std::size_t inputSize = 256;
+		bool storeLength = false;
+		uint16_t length = 0;
+		uint64_t cycles = 1000000;
+		bool allowUnknown = false;
+	};
+
+	FuzzConfig config;
+	// the state every input starts from; its memory is frozen, so restoring it copies no page
+	MOS6502Debug* base = nullptr;
+	MOS6502Debug* cpu = nullptr;
+
+	unsigned long long setting(const char* name, unsigned long long fallback, int radix = 16)
+	{
+		const char* value = std::getenv(name);
+		return value ? std::strtoull(value, nullptr, radix) : fallback;
+	}
+}
+
+extern "C" int LLVMFuzzerInitialize(int*, char***)
+{
+	const char* imagePath = std::getenv("M6502_FUZZ_IMAGE");
+	std::ifstream file(imagePath ? imagePath : "", std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "Fuzz target: set M6502_FUZZ_IMAGE to a readable image file" << std::endl;
+		std::exit(1);
+	}
+	std::vector<uint8_t> image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	config.input = static_cast<uint16_t>(setting("M6502_FUZZ_INPUT", config.input));
+	config.inputSize = std::min<std::size_t>(setting("M6502_FUZZ_INPUT_SIZE", config.inputSize, 10), 0x10000 - config.input);
+	config.storeLength = std::getenv("M6502_FUZZ_LENGTH") != nullptr;
+	config.length = static_cast<uint16_t>(setting("M6502_FUZZ_LENGTH", 0));
+	config.cycles = setting("M6502_FUZZ_CYCLES", config.cycles, 10);
+	config.allowUnknown = std::getenv("M6502_FUZZ_ALLOW_UNKNOWN") != nullptr;
+
+	base = new MOS6502Debug();
+	base->ISDEBUG = false;
+	base->loadProgram(image.data(), image.size(), static_cast<uint16_t>(setting("M6502_FUZZ_LOAD", 0)));
+	if (std::getenv("M6502_FUZZ_ENTRY"))
+	{
+		base->setProgramCounter(static_cast<uint16_t>(setting("M6502_FUZZ_ENTRY", 0)));
+	}
+	else
+	{
+		base->reset();
+	}
+	base->attachCoverage(coverage, coverageSize);
+	base->freeze();
+	cpu = new MOS6502Debug(*base);
+	return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, std::size_t size)
+{
+	// restoring copies registers and page pointers only; the input region and whatever the previous run
+	// wrote become private pages again on first write
+	*cpu = *base;
+
+	std::size_t used = std::min(size, config.inputSize);
+	cpu->loadProgram(data, used, config.input);
+	if (config.storeLength)
+	{
+		cpu->setMemory(config.length, static_cast<uint8_t>(used));
+		cpu->setMemory(static_cast<uint16_t>(config.length + 1), static_cast<uint8_t>(used >> 8));
+	}
+
+	StopReason reason = cpu->execute(UINT64_MAX, cpu->cycles() + config.cycles);
+	if (reason == STOP_UNKNOWN_OPCODE && !config.allowUnknown)
+	{
+		// the guest ran into bytes that are not code, e.g. through a corrupted return address
+		std::fprintf(stderr, "Fuzz target: unknown opcode at $%04x\n", cpu->getProgramCounter());
+		std::abort();
+	}
+	return 0;
+}
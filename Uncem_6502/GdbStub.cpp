@@ -0,0 +1,466 @@
+#include "GdbStub.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static const char hexDigits[] = "0123456789abcdef";
+
+static void appendHex(std::string& out, uint8_t value)
+{
+	out += hexDigits[value >> 4];
+	out += hexDigits[value & 0xF];
+}
+
+static int hexValue(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+// parses hex digits starting at pos, leaves pos on the first non-hex character
+static uint32_t parseHex(const std::string& text, std::size_t& pos)
+{
+	uint32_t value = 0;
+	while (pos < text.size() && hexValue(text[pos]) >= 0)
+	{
+		value = (value << 4) | hexValue(text[pos]);
+		pos++;
+	}
+	return value;
+}
+
+GdbStub::GdbStub(MOS6502Debug& cpu, uint64_t quantum)
+	: mCpu(cpu), mQuantum(quantum), mListenFd(-1), mClientFd(-1), mNoAck(false), mDisconnected(false), mInputPos(0)
+{
+}
+
+GdbStub::~GdbStub()
+{
+	if (mClientFd >= 0) ::close(mClientFd);
+	if (mListenFd >= 0) ::close(mListenFd);
+	if (!mUnixPath.empty()) ::unlink(mUnixPath.c_str());
+}
+
+bool GdbStub::listenTcp(uint16_t port)
+{
+	mListenFd = socket(AF_INET, SOCK_STREAM, 0);
+	int reuse = 1;
+	setsockopt(mListenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (mListenFd < 0 || bind(mListenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(mListenFd, 1) != 0)
+	{
+		std::cerr << "GDB stub: could not listen on localhost:" << std::dec << port << " (" << strerror(errno) << ")" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool GdbStub::listenUnix(const std::string& path)
+{
+	mListenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path))
+	{
+		std::cerr << "GDB stub: socket path too long: " << path << std::endl;
+		return false;
+	}
+	strcpy(addr.sun_path, path.c_str());
+	::unlink(path.c_str());
+	if (mListenFd < 0 || bind(mListenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(mListenFd, 1) != 0)
+	{
+		std::cerr << "GDB stub: could not listen on " << path << " (" << strerror(errno) << ")" << std::endl;
+		return false;
+	}
+	mUnixPath = path;
+	return true;
+}
+
+bool GdbStub::serve()
+{
+	mClientFd = accept(mListenFd, nullptr, nullptr);
+	if (mClientFd < 0)
+	{
+		std::cerr << "GDB stub: accept failed (" << strerror(errno) << ")" << std::endl;
+		return false;
+	}
+	mNoAck = false;
+	mDisconnected = false;
+	mInput.clear();
+	mInputPos = 0;
+
+	std::string packet;
+	while (receivePacket(packet))
+	{
+		if (!handlePacket(packet))
+		{
+			break;
+		}
+	}
+
+	::close(mClientFd);
+	mClientFd = -1;
+	return true;
+}
+
+bool GdbStub::handlePacket(const std::string& packet)
+{
+	std::size_t pos = 1;
+	char command = packet.empty() ? 0 : packet[0];
+
+	switch (command)
+	{
+	case '?':
+		return sendPacket("S05");
+	case 'g':
+		return sendPacket(readRegisters());
+	case 'G':
+		for (unsigned index = 0; index < 6 && pos + 1 < packet.size(); index++)
+		{
+			unsigned bytes = index == 4 ? 2 : 1;
+			uint32_t value = 0;
+			for (unsigned i = 0; i < bytes && pos + 1 < packet.size(); i++, pos += 2)
+			{
+				value |= ((hexValue(packet[pos]) << 4) | hexValue(packet[pos + 1])) << (8 * i);
+			}
+			writeRegister(index, value);
+		}
+		return sendPacket("OK");
+	case 'p':
+	{
+		unsigned index = parseHex(packet, pos);
+		std::string regs = readRegisters();
+		static const unsigned offsets[] = { 0, 2, 4, 6, 8, 12 };
+		if (index > 5)
+		{
+			return sendPacket("E01");
+		}
+		return sendPacket(regs.substr(offsets[index], index == 4 ? 4 : 2));
+	}
+	case 'P':
+	{
+		unsigned index = parseHex(packet, pos);
+		if (pos >= packet.size() || packet[pos] != '=')
+		{
+			return sendPacket("E01");
+		}
+		pos++;
+		// register values are sent in target (little endian) byte order
+		uint32_t value = 0;
+		for (unsigned shift = 0; pos + 1 < packet.size(); shift += 8, pos += 2)
+		{
+			value |= ((hexValue(packet[pos]) << 4) | hexValue(packet[pos + 1])) << shift;
+		}
+		return sendPacket(writeRegister(index, value) ? "OK" : "E01");
+	}
+	case 'm':
+	{
+		uint32_t addr = parseHex(packet, pos);
+		pos++;
+		uint32_t length = parseHex(packet, pos);
+		std::string reply;
+		for (uint32_t i = 0; i < length; i++)
+		{
+			appendHex(reply, mCpu.getMemory(static_cast<uint16_t>(addr + i)));
+		}
+		return sendPacket(reply);
+	}
+	case 'M':
+	{
+		uint32_t addr = parseHex(packet, pos);
+		pos++;
+		uint32_t length = parseHex(packet, pos);
+		pos++;
+		for (uint32_t i = 0; i < length && pos + 1 < packet.size(); i++, pos += 2)
+		{
+			mCpu.setMemory(static_cast<uint16_t>(addr + i), (hexValue(packet[pos]) << 4) | hexValue(packet[pos + 1]));
+		}
+		return sendPacket("OK");
+	}
+	case 'c':
+	case 's':
+	{
+		if (pos < packet.size())
+		{
+			mCpu.setProgramCounter(parseHex(packet, pos));
+		}
+		std::string reply = resume(command == 'c' ? RESUME_CONTINUE : RESUME_STEP);
+		// a client that went away while the guest ran is treated like a detach
+		return !mDisconnected && sendPacket(reply);
+	}
+	case 'Z':
+	case 'z':
+		return sendPacket(updateTrap(command == 'Z', packet.substr(1)));
+	case 'H':
+		return sendPacket("OK");
+	case 'k':
+		return false;
+	case 'D':
+		sendPacket("OK");
+		return false;
+	case 'q':
+		if (packet.rfind("qSupported", 0) == 0)
+		{
+			return sendPacket("PacketSize=4000;QStartNoAckMode+;swbreak+");
+		}
+		if (packet == "qAttached")
+		{
+			return sendPacket("1");
+		}
+		if (packet == "qC")
+		{
+			return sendPacket("QC1");
+		}
+		return sendPacket("");
+	case 'Q':
+		if (packet == "QStartNoAckMode")
+		{
+			bool sent = sendPacket("OK");
+			mNoAck = true;
+			return sent;
+		}
+		return sendPacket("");
+	default:
+		return sendPacket("");
+	}
+}
+
+std::string GdbStub::resume(ResumeMode mode)
+{
+	if (mode == RESUME_STEP)
+	{
+		return stopReply(mCpu.step());
+	}
+
+	while (true)
+	{
+		StopReason reason = mCpu.execute(mQuantum);
+		if (reason != STOP_BUDGET)
+		{
+			return stopReply(reason);
+		}
+		// quantum boundary: the only place the client is looked at while the guest runs
+		if (clientInterrupted())
+		{
+			return mDisconnected ? "" : "S02";
+		}
+	}
+}
+
+std::string GdbStub::stopReply(StopReason reason)
+{
+	switch (reason)
+	{
+	case STOP_HALT:
+		return "W00";
+	case STOP_UNKNOWN_OPCODE:
+		return "S04";
+	case STOP_WATCHPOINT:
+	{
+		MOS6502::TrapHit hit = mCpu.getTrapHit();
+		std::string reply = "T05watch:";
+		appendHex(reply, hit.addr >> 8);
+		appendHex(reply, hit.addr & 0xFF);
+		return reply + ";";
+	}
+	case STOP_BREAKPOINT:
+		return "T05swbreak:;";
+	default:
+		return "S05";
+	}
+}
+
+std::string GdbStub::readRegisters()
+{
+	std::string regs;
+	appendHex(regs, mCpu.getAccumulator());
+	appendHex(regs, mCpu.getRegisterX());
+	appendHex(regs, mCpu.getRegisterY());
+	appendHex(regs, mCpu.getStackPointer());
+	appendHex(regs, mCpu.getProgramCounter() & 0xFF);
+	appendHex(regs, mCpu.getProgramCounter() >> 8);
+	appendHex(regs, mCpu.getStatus());
+	return regs;
+}
+
+bool GdbStub::writeRegister(unsigned index, uint32_t value)
+{
+	switch (index)
+	{
+	case 0: mCpu.setAccumulator(value); return true;
+	case 1: mCpu.setRegisterX(value); return true;
+	case 2: mCpu.setRegisterY(value); return true;
+	case 3: mCpu.setStackPointer(value); return true;
+	case 4: mCpu.setProgramCounter(value); return true;
+	case 5: mCpu.setStatus(value); return true;
+	default: return false;
+	}
+}
+
+std::string GdbStub::updateTrap(bool insert, const std::string& args)
+{
+	// type,addr,kind: 0/1 = breakpoint, 2 = write, 3 = read, 4 = access watchpoint
+	std::size_t pos = 0;
+	int type = parseHex(args, pos);
+	pos++;
+	uint16_t addr = parseHex(args, pos);
+	pos++;
+	uint16_t length = parseHex(args, pos);
+
+	if (type == 0 || type == 1)
+	{
+		if (insert) mCpu.addBreakpoint(addr);
+		else mCpu.removeBreakpoint(addr);
+		return "OK";
+	}
+	if (type < 2 || type > 4)
+	{
+		return "";
+	}
+
+	auto key = std::make_tuple(type, addr, length);
+	if (insert)
+	{
+		if (mWatchpoints.count(key))
+		{
+			return "OK"; // gdb may insert the same watchpoint again, it stays one watchpoint
+		}
+		uint8_t kinds = type == 2 ? TRAP_WRITE : type == 3 ? TRAP_READ : (TRAP_READ | TRAP_WRITE);
+		uint16_t last = static_cast<uint16_t>(addr + (length ? length - 1 : 0));
+		mWatchpoints[key] = mCpu.addWatchpoint(addr, last, kinds);
+	}
+	else
+	{
+		auto found = mWatchpoints.find(key);
+		if (found != mWatchpoints.end())
+		{
+			mCpu.removeWatchpoint(found->second);
+			mWatchpoints.erase(found);
+		}
+	}
+	return "OK";
+}
+
+bool GdbStub::receiveByte(char& c)
+{
+	if (mInputPos == mInput.size())
+	{
+		char buffer[4096];
+		ssize_t received = recv(mClientFd, buffer, sizeof(buffer), 0);
+		if (received <= 0)
+		{
+			return false;
+		}
+		mInput.assign(buffer, received);
+		mInputPos = 0;
+	}
+	c = mInput[mInputPos++];
+	return true;
+}
+
+bool GdbStub::receivePacket(std::string& packet)
+{
+	char c;
+	while (true)
+	{
+		do
+		{
+			if (!receiveByte(c)) return false;
+		} while (c != '$');
+
+		packet.clear();
+		uint8_t sum = 0;
+		while (true)
+		{
+			if (!receiveByte(c)) return false;
+			if (c == '#') break;
+			packet += c;
+			sum += static_cast<uint8_t>(c);
+		}
+
+		char checksum[2];
+		if (!receiveByte(checksum[0]) || !receiveByte(checksum[1])) return false;
+		if (mNoAck)
+		{
+			return true;
+		}
+		bool valid = ((hexValue(checksum[0]) << 4) | hexValue(checksum[1])) == sum;
+		send(mClientFd, valid ? "+" : "-", 1, MSG_NOSIGNAL);
+		if (valid)
+		{
+			return true;
+		}
+	}
+}
+
+bool GdbStub::sendPacket(const std::string& data)
+{
+	uint8_t sum = 0;
+	for (char c : data)
+	{
+		sum += static_cast<uint8_t>(c);
+	}
+	std::string frame = "$" + data + "#";
+	appendHex(frame, sum);
+
+	while (true)
+	{
+		if (send(mClientFd, frame.data(), frame.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(frame.size()))
+		{
+			return false;
+		}
+		if (mNoAck)
+		{
+			return true;
+		}
+		char ack;
+		if (!receiveByte(ack)) return false;
+		if (ack != '-')
+		{
+			if (ack != '+') mInputPos--; // not an ack, leave it for receivePacket()
+			return true;
+		}
+	}
+}
+
+bool GdbStub::clientInterrupted()
+{
+	// Ctrl-C arrives as a raw 0x03 byte outside of any packet. Anything else the client sends while the guest
+	// runs stays buffered for receivePacket(); a closed connection stops the guest as well
+	pollfd fd = { mClientFd, POLLIN, 0 };
+	if (poll(&fd, 1, 0) > 0)
+	{
+		char buffer[4096];
+		ssize_t received = recv(mClientFd, buffer, sizeof(buffer), 0);
+		if (received <= 0)
+		{
+			mDisconnected = true;
+			return true;
+		}
+		mInput.erase(0, mInputPos);
+		mInputPos = 0;
+		mInput.append(buffer, received);
+	}
+	std::size_t interrupt = mInput.find('\x03', mInputPos);
+	if (interrupt == std::string::npos)
+	{
+		return false;
+	}
+	mInput.erase(interrupt, 1);
+	return true;
+}
@@ -0,0 +1,60 @@
+#ifndef GDBSTUB_HPP
+#define GDBSTUB_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include "MOS6502.hpp"
+
+// GDB remote serial protocol server for one MOS6502Debug, on a localhost TCP port or a Unix domain socket.
+// While the guest runs, the client connection is only polled between quanta of executed instructions, so an
+// attached guest runs at almost full speed until it hits a breakpoint or watchpoint.
+//
+// Registers, in 'g' packet order, all one byte except PC: A, X, Y, SP, PC (little endian), P.
+class GdbStub
+{
+public:
+	explicit GdbStub(MOS6502Debug& cpu, uint64_t quantum = 100000);
+	~GdbStub();
+
+	bool listenTcp(uint16_t port);
+	bool listenUnix(const std::string& path);
+
+	// block until a client connects, then serve it until it detaches, kills the guest or disconnects
+	bool serve();
+
+private:
+	enum ResumeMode
+	{
+		RESUME_NONE,
+		RESUME_CONTINUE,
+		RESUME_STEP
+	};
+
+	bool handlePacket(const std::string& packet);
+	std::string resume(ResumeMode mode);
+	std::string stopReply(StopReason reason);
+	std::string readRegisters();
+	bool writeRegister(unsigned index, uint32_t value);
+	std::string updateTrap(bool insert, const std::string& args);
+
+	bool receivePacket(std::string& packet);
+	bool sendPacket(const std::string& data);
+	bool receiveByte(char& c);
+	bool clientInterrupted();
+
+	MOS6502Debug& mCpu;
+	uint64_t mQuantum;
+	int mListenFd;
+	int mClientFd;
+	std::string mUnixPath;
+	bool mNoAck;
+	bool mDisconnected;             // the client closed the connection while the guest was running
+	std::string mInput;
+	std::size_t mInputPos;
+	// (type, address, length) of a Z2/Z3/Z4 packet -> watchpoint id
+	std::map<std::tuple<int, uint16_t, uint16_t>, int> mWatchpoints;
+};
+
+#endif
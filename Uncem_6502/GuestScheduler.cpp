@@ -0,0 +1,273 @@
+#include "GuestScheduler.hpp"
+
+#include <algorithm>
+#include <bit>
+
+uint64_t GuestScheduler::Stats::latencyPercentile(double fraction) const
+{
+	uint64_t total = 0;
+	for (uint64_t count : latency) { total += count; }
+	uint64_t wanted = static_cast<uint64_t>(fraction * total);
+	uint64_t seen = 0;
+	for (std::size_t bucket = 0; bucket < latencyBuckets; bucket++)
+	{
+		seen += latency[bucket];
+		if (seen > wanted || seen == total) { return uint64_t(2) << bucket; }
+	}
+	return 0;
+}
+
+GuestScheduler::GuestScheduler(std::size_t threads, uint64_t quantumCycles)
+	: mQuantum(quantumCycles ? quantumCycles : 1), mQueues(new RunQueue[threads ? threads : 1]), mQueueCount(threads ? threads : 1)
+{
+}
+
+GuestScheduler::~GuestScheduler()
+{
+	stop();
+}
+
+GuestScheduler::Guest& GuestScheduler::guest(GuestId id) const
+{
+	std::lock_guard<std::mutex> lock(mGuestsLock);
+	return *mGuests[id];
+}
+
+GuestScheduler::GuestId GuestScheduler::add(MOS6502& cpu, unsigned weight)
+{
+	auto added = std::make_unique<Guest>();
+	added->cpu = &cpu;
+	added->weight.store(weight ? weight : 1, std::memory_order_relaxed);
+	Guest& guest = *added;
+	GuestId id;
+	{
+		std::lock_guard<std::mutex> lock(mGuestsLock);
+		id = mGuests.size();
+		mGuests.push_back(std::move(added));
+	}
+	std::size_t lightest = 0;
+	for (std::size_t queue = 1; queue < mQueueCount; queue++)
+	{
+		if (mQueues[queue].weight.load(std::memory_order_relaxed) < mQueues[lightest].weight.load(std::memory_order_relaxed)) { lightest = queue; }
+	}
+	enqueue(lightest, guest, true);
+	return id;
+}
+
+void GuestScheduler::setWeight(GuestId id, unsigned weight)
+{
+	guest(id).weight.store(weight ? weight : 1, std::memory_order_relaxed);
+}
+
+bool GuestScheduler::wake(GuestId id)
+{
+	Guest& woken = guest(id);
+	std::unique_lock<std::mutex> lock(woken.lock);
+	switch (woken.state)
+	{
+	case GUEST_PARKED:
+		woken.state = GUEST_RUNNABLE;
+		lock.unlock();
+		mWakes.fetch_add(1, std::memory_order_relaxed);
+		enqueue(woken.home, woken, true);
+		return true;
+	case GUEST_RUNNING:
+		woken.wakePending = true;
+		return true;
+	case GUEST_RUNNABLE:
+		break;
+	}
+	return false;
+}
+
+void GuestScheduler::enqueue(std::size_t queue, Guest& guest, bool woken)
+{
+	RunQueue& target = mQueues[queue];
+	{
+		std::lock_guard<std::mutex> lock(target.lock);
+		// a guest that slept does not get to catch up on the time it was away, it lines up with the others
+		if (woken) { guest.vruntime = std::max(guest.vruntime, target.minVruntime); }
+		guest.home = queue;
+		guest.woken = woken;
+		guest.runnableSince = Clock::now();
+		guest.queuedWeight = guest.weight.load(std::memory_order_relaxed);
+		target.weight.store(target.weight.load(std::memory_order_relaxed) + guest.queuedWeight, std::memory_order_relaxed);
+		target.guests.emplace(guest.vruntime, &guest);
+	}
+	// pairs with the sleeper's increment of mSleepers before it checks mRunnable, so one of them sees the other
+	mRunnable.fetch_add(1);
+	if (mSleepers.load() != 0)
+	{
+		std::lock_guard<std::mutex> lock(mIdleLock);
+		mIdle.notify_one();
+	}
+}
+
+GuestScheduler::Guest* GuestScheduler::take(std::size_t worker)
+{
+	RunQueue& own = mQueues[worker];
+	{
+		std::lock_guard<std::mutex> lock(own.lock);
+		if (!own.guests.empty())
+		{
+			own.minVruntime = std::max(own.minVruntime, own.guests.begin()->first);
+			return remove(own, own.guests.begin());
+		}
+	}
+
+	// steal the guest the victim would run last, so the victim's next pick is not delayed
+	for (std::size_t offset = 1; offset < mQueueCount; offset++)
+	{
+		RunQueue& victim = mQueues[(worker + offset) % mQueueCount];
+		Guest* taken = nullptr;
+		uint64_t victimMin = 0;
+		{
+			std::lock_guard<std::mutex> lock(victim.lock);
+			if (victim.guests.empty()) { continue; }
+			victimMin = victim.minVruntime;
+			taken = remove(victim, std::prev(victim.guests.end()));
+		}
+		std::lock_guard<std::mutex> lock(own.lock);
+		// keep the guest's lead or lag over its old queue in the new one
+		taken->vruntime = taken->vruntime - std::min(taken->vruntime, victimMin) + own.minVruntime;
+		bump(own.steals);
+		return taken;
+	}
+	return nullptr;
+}
+
+GuestScheduler::Guest* GuestScheduler::remove(RunQueue& queue, std::set<std::pair<uint64_t, Guest*>>::iterator position)
+{
+	// with the queue's lock held
+	Guest* guest = position->second;
+	queue.guests.erase(position);
+	queue.weight.store(queue.weight.load(std::memory_order_relaxed) - guest->queuedWeight, std::memory_order_relaxed);
+	mRunnable.fetch_sub(1, std::memory_order_relaxed);
+	return guest;
+}
+
+void GuestScheduler::work(std::size_t worker)
+{
+	RunQueue& own = mQueues[worker];
+	while (!mStopping.load(std::memory_order_relaxed))
+	{
+		Clock::time_point picking = Clock::now();
+		Guest* guest = take(worker);
+		if (!guest)
+		{
+			mSleepers.fetch_add(1);
+			{
+				std::unique_lock<std::mutex> lock(mIdleLock);
+				mIdle.wait(lock, [this]() { return mRunnable.load() > 0 || mStopping.load(); });
+			}
+			mSleepers.fetch_sub(1);
+			continue;
+		}
+		{
+			std::lock_guard<std::mutex> lock(guest->lock);
+			guest->state = GUEST_RUNNING;
+		}
+		Clock::time_point running = Clock::now();
+		if (guest->woken)
+		{
+			uint64_t waited = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(running - guest->runnableSince).count());
+			bump(own.latency[std::min<std::size_t>(std::bit_width(waited | 1) - 1, latencyBuckets - 1)]);
+		}
+
+		MOS6502& cpu = *guest->cpu;
+		uint64_t start = cpu.cycles();
+		StopReason reason = cpu.execute(UINT64_MAX, start + mQuantum);
+		uint64_t ran = cpu.cycles() - start;
+		Clock::time_point finished = Clock::now();
+
+		guest->cycles.store(guest->cycles.load(std::memory_order_relaxed) + ran, std::memory_order_relaxed);
+		guest->vruntime += ran * defaultWeight / guest->weight.load(std::memory_order_relaxed);
+		bool runnable = reason == STOP_BUDGET;
+		{
+			std::lock_guard<std::mutex> lock(guest->lock);
+			if (!runnable)
+			{
+				guest->lastStop = reason;
+				runnable = guest->wakePending;
+				guest->wakePending = false;
+			}
+			guest->state = runnable ? GUEST_RUNNABLE : GUEST_PARKED;
+		}
+		if (runnable)
+		{
+			enqueue(worker, *guest, false);
+		}
+		else
+		{
+			bump(own.parks);
+		}
+
+		bump(own.quanta);
+		bump(own.guestNs, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(finished - running).count()));
+		bump(own.schedulerNs, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			(running - picking) + (Clock::now() - finished)).count()));
+	}
+}
+
+void GuestScheduler::start()
+{
+	if (!mThreads.empty()) { return; }
+	mStopping.store(false);
+	for (std::size_t worker = 0; worker < mQueueCount; worker++)
+	{
+		mThreads.emplace_back([this, worker]() { work(worker); });
+	}
+}
+
+void GuestScheduler::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mIdleLock);
+		mStopping.store(true);
+	}
+	mIdle.notify_all();
+	for (std::thread& thread : mThreads)
+	{
+		thread.join();
+	}
+	mThreads.clear();
+}
+
+GuestScheduler::GuestState GuestScheduler::state(GuestId id) const
+{
+	Guest& queried = guest(id);
+	std::lock_guard<std::mutex> lock(queried.lock);
+	return queried.state;
+}
+
+StopReason GuestScheduler::lastStop(GuestId id) const
+{
+	Guest& queried = guest(id);
+	std::lock_guard<std::mutex> lock(queried.lock);
+	return queried.lastStop;
+}
+
+uint64_t GuestScheduler::cycles(GuestId id) const
+{
+	return guest(id).cycles.load(std::memory_order_relaxed);
+}
+
+GuestScheduler::Stats GuestScheduler::stats() const
+{
+	Stats stats;
+	for (std::size_t worker = 0; worker < mQueueCount; worker++)
+	{
+		const RunQueue& queue = mQueues[worker];
+		stats.quanta += queue.quanta.load(std::memory_order_relaxed);
+		stats.steals += queue.steals.load(std::memory_order_relaxed);
+		stats.parks += queue.parks.load(std::memory_order_relaxed);
+		stats.guestNs += queue.guestNs.load(std::memory_order_relaxed);
+		stats.schedulerNs += queue.schedulerNs.load(std::memory_order_relaxed);
+		for (std::size_t bucket = 0; bucket < latencyBuckets; bucket++)
+		{
+			stats.latency[bucket] += queue.latency[bucket].load(std::memory_order_relaxed);
+		}
+	}
+	stats.wakes = mWakes.load(std::memory_order_relaxed);
+	return stats;
+}
@@ -0,0 +1,153 @@
+#ifndef GUESTSCHEDULER_HPP
+#define GUESTSCHEDULER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "MOS6502.hpp"
+
+// Time-slice scheduler for many long-lived guests on a fixed pool of host threads (M:N), for interactive
+// guests that never run to completion. Every thread has a run queue ordered by virtual runtime: a guest's
+// virtual runtime grows by the cycles it ran divided by its weight, and a thread always runs the guest that
+// is furthest behind for one quantum of guest cycles, so over time every guest gets cycles in proportion to
+// its weight. New guests go to the thread with the least weight queued, and a thread whose queue is empty
+// steals the least urgent guest from another thread; there is no other rebalancing between threads.
+//
+// A guest that stops (HALT, a host function returning HOST_STOP, a breakpoint, an unknown opcode) is parked
+// and costs nothing until wake() makes it runnable again; HALT leaves the program counter behind it, so
+// HALT works like a wait-for-event instruction. Waking a guest that is running makes its next stop return
+// at once, so a wake-up that races with the guest going to sleep is not lost. A breakpoint also parks a
+// guest when its quantum ended right on it; a guest woken from a breakpoint steps over that one once.
+//
+// Unlike ParallelScheduler, guests are not kept within a quantum of each other; they should only talk
+// through concurrent shared pages (see MOS6502::mapSharedPage()) and wake-ups.
+class GuestScheduler
+{
+public:
+	using GuestId = std::size_t;
+
+	static constexpr unsigned defaultWeight = 1024;
+	static constexpr std::size_t latencyBuckets = 48;
+
+	enum GuestState : uint8_t
+	{
+		GUEST_RUNNABLE,
+		GUEST_RUNNING,
+		GUEST_PARKED
+	};
+
+	struct Stats
+	{
+		uint64_t quanta = 0;            // time slices run
+		uint64_t steals = 0;            // guests taken from another thread's queue
+		uint64_t parks = 0;
+		uint64_t wakes = 0;             // parked guests made runnable again
+		uint64_t guestNs = 0;           // host time spent running guest code
+		uint64_t schedulerNs = 0;       // host time spent picking and queueing guests, idle waits excluded
+		// time from add() or wake() to running, what an interactive guest feels: bucket b counts waits of
+		// [2^b, 2^(b+1)) ns. Preempted guests are not counted, their wait is the round-robin of their queue
+		uint64_t latency[latencyBuckets] = {};
+
+		// upper bound of the bucket the given fraction of the waits fall into, e.g. 0.99 for the 99th percentile
+		uint64_t latencyPercentile(double fraction) const;
+	};
+
+	explicit GuestScheduler(std::size_t threads, uint64_t quantumCycles = 10000);
+	// stop()s the threads; the guests are not owned and keep their state
+	~GuestScheduler();
+	GuestScheduler(const GuestScheduler&) = delete;
+	GuestScheduler& operator=(const GuestScheduler&) = delete;
+
+	// cpu becomes runnable from its current program counter, on the threads in turn; any thread may add guests
+	GuestId add(MOS6502& cpu, unsigned weight = defaultWeight);
+	// from the next quantum on; twice the weight, twice the cycles
+	void setWeight(GuestId guest, unsigned weight);
+	// a parked guest becomes runnable on the thread it last ran on; false if it was runnable already
+	bool wake(GuestId guest);
+
+	void start();
+	// running quanta finish first; guests stay runnable or parked and start() carries on with them
+	void stop();
+
+	GuestState state(GuestId guest) const;
+	// why the guest was last parked, STOP_NONE if it never was
+	StopReason lastStop(GuestId guest) const;
+	// guest cycles run under this scheduler
+	uint64_t cycles(GuestId guest) const;
+	std::size_t threads() const { return mQueueCount; }
+	Stats stats() const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Guest
+	{
+		MOS6502* cpu;
+		std::atomic<unsigned> weight;
+		std::atomic<uint64_t> cycles{ 0 };
+		// belong to whoever holds the guest: its queue's lock or the running thread
+		uint64_t vruntime = 0;
+		unsigned queuedWeight = 0;      // what enqueue() added to its queue's weight
+		bool woken = false;
+		Clock::time_point runnableSince;
+
+		mutable std::mutex lock;        // guards the fields below
+		GuestState state = GUEST_RUNNABLE;
+		bool wakePending = false;
+		StopReason lastStop = STOP_NONE;
+		std::size_t home = 0;           // queue it was last in
+	};
+
+	struct alignas(64) RunQueue
+	{
+		std::mutex lock;
+		std::set<std::pair<uint64_t, Guest*>> guests;   // by virtual runtime
+		uint64_t minVruntime = 0;       // of the last guest taken; woken and stolen guests are placed relative to it
+		std::atomic<uint64_t> weight{ 0 };  // of the guests in the queue, read without the lock by add()
+
+		// written by the queue's thread only
+		std::atomic<uint64_t> quanta{ 0 };
+		std::atomic<uint64_t> steals{ 0 };
+		std::atomic<uint64_t> parks{ 0 };
+		std::atomic<uint64_t> guestNs{ 0 };
+		std::atomic<uint64_t> schedulerNs{ 0 };
+		std::atomic<uint64_t> latency[latencyBuckets] = {};
+	};
+
+	Guest& guest(GuestId id) const;
+	void enqueue(std::size_t queue, Guest& guest, bool woken);
+	Guest* take(std::size_t worker);
+	Guest* remove(RunQueue& queue, std::set<std::pair<uint64_t, Guest*>>::iterator position);
+	void work(std::size_t worker);
+	static void bump(std::atomic<uint64_t>& counter, uint64_t value = 1)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+
+	uint64_t mQuantum;
+	std::unique_ptr<RunQueue[]> mQueues;
+	std::size_t mQueueCount;
+	mutable std::mutex mGuestsLock;
+	std::deque<std::unique_ptr<Guest>> mGuests;
+	std::atomic<uint64_t> mWakes{ 0 };
+
+	// idle threads sleep until something is queued; a queueing thread only takes mIdleLock when someone sleeps.
+	// Signed: a guest can be taken before the thread that queued it has counted it
+	std::atomic<std::ptrdiff_t> mRunnable{ 0 };
+	std::atomic<std::size_t> mSleepers{ 0 };
+	std::mutex mIdleLock;
+	std::condition_variable mIdle;
+	std::atomic<bool> mStopping{ false };
+	std::vector<std::thread> mThreads;
+};
+
+#endif
@@ -0,0 +1,154 @@
+#include "HostCounters.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+	const uint64_t hardwareEvents[HostCounters::NANOSECONDS] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_BRANCH_MISSES,
+		PERF_COUNT_HW_CACHE_MISSES
+	};
+
+	int openEvent(uint64_t config)
+	{
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = config;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+	}
+
+#if defined(__x86_64__) || defined(__i386__)
+	inline uint64_t rdpmc(uint32_t counter)
+	{
+		uint32_t low, high;
+		asm volatile("rdpmc" : "=a"(low), "=d"(high) : "c"(counter));
+		return (static_cast<uint64_t>(high) << 32) | low;
+	}
+#endif
+}
+
+HostCounters::~HostCounters()
+{
+	for (std::size_t counter = 0; counter < NANOSECONDS; counter++)
+	{
+		if (mPages[counter]) { munmap(mPages[counter], sysconf(_SC_PAGESIZE)); }
+		if (mFds[counter] >= 0) { close(mFds[counter]); }
+	}
+}
+
+bool HostCounters::open()
+{
+	bool any = false;
+	int error = 0;
+	for (std::size_t counter = 0; counter < NANOSECONDS; counter++)
+	{
+		if (mFds[counter] >= 0) { any = true; continue; }
+		mFds[counter] = openEvent(hardwareEvents[counter]);
+		if (mFds[counter] < 0)
+		{
+			error = errno;
+			continue;
+		}
+		any = true;
+		// the first page of the ring buffer tells whether and how the counter can be read with rdpmc
+		void* page = mmap(nullptr, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, mFds[counter], 0);
+		mPages[counter] = page == MAP_FAILED ? nullptr : static_cast<perf_event_mmap_page*>(page);
+	}
+	if (!any)
+	{
+		std::cerr << "Host counters: perf_event_open failed (" << strerror(error) << "), only host time is measured" << std::endl;
+	}
+	return any;
+}
+
+bool HostCounters::available(Counter counter) const
+{
+	return counter == NANOSECONDS || mFds[counter] >= 0;
+}
+
+bool HostCounters::userRead(Counter counter) const
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return counter == NANOSECONDS || (mPages[counter] && mPages[counter]->cap_user_rdpmc);
+#else
+	return counter == NANOSECONDS;
+#endif
+}
+
+uint64_t HostCounters::readCounter(Counter counter) const
+{
+	if (mFds[counter] < 0) { return 0; }
+#if defined(__x86_64__) || defined(__i386__)
+	// the seqlock protocol from linux/perf_event.h: retry if the kernel updated the page while we read it
+	if (const perf_event_mmap_page* page = mPages[counter])
+	{
+		uint32_t sequence;
+		uint64_t count;
+		bool scheduled;
+		do
+		{
+			sequence = page->lock;
+			std::atomic_signal_fence(std::memory_order_acquire);
+			uint32_t index = page->index;
+			scheduled = page->cap_user_rdpmc && index != 0;
+			count = page->offset;
+			if (scheduled)
+			{
+				unsigned shift = 64 - page->pmc_width;
+				count += static_cast<uint64_t>(static_cast<int64_t>(rdpmc(index - 1) << shift) >> shift);
+			}
+			std::atomic_signal_fence(std::memory_order_acquire);
+		} while (page->lock != sequence);
+		if (scheduled) { return count; }
+	}
+#endif
+	uint64_t count = 0;
+	return ::read(mFds[counter], &count, sizeof(count)) == sizeof(count) ? count : 0;
+}
+
+void HostCounters::read(uint64_t values[counterCount]) const
+{
+	for (std::size_t counter = 0; counter < NANOSECONDS; counter++)
+	{
+		values[counter] = readCounter(static_cast<Counter>(counter));
+	}
+	values[NANOSECONDS] = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void HostCounters::calibrate(uint64_t overhead[counterCount], unsigned rounds) const
+{
+	std::fill(overhead, overhead + counterCount, UINT64_MAX);
+	uint64_t before[counterCount];
+	uint64_t after[counterCount];
+	for (unsigned round = 0; round < rounds; round++)
+	{
+		read(before);
+		read(after);
+		for (std::size_t counter = 0; counter < counterCount; counter++)
+		{
+			overhead[counter] = std::min(overhead[counter], after[counter] - before[counter]);
+		}
+	}
+}
+
+const char* HostCounters::name(Counter counter)
+{
+	static const char* const names[counterCount] = { "cycles", "instructions", "branch-misses", "cache-misses", "ns" };
+	return names[counter];
+}
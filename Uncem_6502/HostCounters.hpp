@@ -0,0 +1,56 @@
+#ifndef HOSTCOUNTERS_HPP
+#define HOSTCOUNTERS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+struct perf_event_mmap_page;
+
+// Hardware performance counters of the calling thread through Linux perf_event_open, user space only, plus
+// host nanoseconds from the steady clock. Meant for measuring stretches as short as one guest instruction:
+// where the kernel allows it, counters are read in user space with rdpmc, otherwise with a read() call that
+// costs far more than what it measures.
+//
+// Each counter is opened on its own, so a host without some of them (virtual machines, containers,
+// perf_event_paranoid > 2) still gets the rest; NANOSECONDS is always available.
+class HostCounters
+{
+public:
+	enum Counter
+	{
+		CYCLES = 0,
+		INSTRUCTIONS,
+		BRANCH_MISSES,
+		CACHE_MISSES,
+		NANOSECONDS,
+		counterCount
+	};
+
+	HostCounters() = default;
+	~HostCounters();
+	HostCounters(const HostCounters&) = delete;
+	HostCounters& operator=(const HostCounters&) = delete;
+
+	// opens every hardware counter the host has; false and a message on cerr if it has none
+	bool open();
+
+	bool available(Counter counter) const;
+	// read in user space, without a system call
+	bool userRead(Counter counter) const;
+
+	// current value of every counter, 0 for the unavailable ones
+	void read(uint64_t values[counterCount]) const;
+
+	// smallest difference seen between two back-to-back read()s, i.e. what reading itself costs
+	void calibrate(uint64_t overhead[counterCount], unsigned rounds = 1000) const;
+
+	static const char* name(Counter counter);
+
+private:
+	uint64_t readCounter(Counter counter) const;
+
+	int mFds[NANOSECONDS] = { -1, -1, -1, -1 };
+	perf_event_mmap_page* mPages[NANOSECONDS] = {};
+};
+
+#endif
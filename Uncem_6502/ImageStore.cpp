@@ -0,0 +1,105 @@
+#include "ImageStore.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+static uint64_t imageHash(const uint8_t* program, std::size_t size, uint16_t offset)
+{
+	uint64_t header[2] = { offset, size };
+	return ProgramImage::hashBytes(program, size, ProgramImage::hashBytes(reinterpret_cast<const uint8_t*>(header), sizeof(header)));
+}
+
+ProgramImage::ProgramImage(const uint8_t* program, std::size_t size, uint16_t offset)
+	: mOffset(offset), mSize(size), mHash(imageHash(program, size, offset))
+{
+	if (size == 0 || offset + size > 0x10000)
+	{
+		throw std::out_of_range("Program image does not fit into the 64 KiB address space");
+	}
+
+	std::size_t lastPage = (offset + size - 1) / pageSize;
+	mPages.assign((lastPage - firstPage() + 1) * pageSize, 0);
+	memcpy(mPages.data() + (offset & 0xFF), program, size);
+}
+
+const uint8_t* ProgramImage::page(std::size_t guestPage) const
+{
+	if (guestPage < firstPage() || guestPage >= firstPage() + pageCount())
+	{
+		return nullptr;
+	}
+	return mPages.data() + (guestPage - firstPage()) * pageSize;
+}
+
+std::size_t ProgramImage::pageBegin(std::size_t guestPage) const
+{
+	return guestPage == firstPage() ? (mOffset & 0xFF) : 0;
+}
+
+std::size_t ProgramImage::pageEnd(std::size_t guestPage) const
+{
+	std::size_t end = mOffset + mSize;
+	return guestPage == (end - 1) / pageSize ? end - guestPage * pageSize : pageSize;
+}
+
+bool ProgramImage::sameContents(const uint8_t* program, std::size_t size, uint16_t offset) const
+{
+	return offset == mOffset && size == mSize && memcmp(mPages.data() + (offset & 0xFF), program, size) == 0;
+}
+
+// FNV-1a, good enough to key images; equal hashes are always confirmed with a byte compare
+uint64_t ProgramImage::hashBytes(const uint8_t* data, std::size_t size, uint64_t seed)
+{
+	uint64_t hash = seed;
+	for (std::size_t i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+std::shared_ptr<const ProgramImage> ImageStore::load(const uint8_t* program, std::size_t size, uint16_t offset)
+{
+	uint64_t hash = imageHash(program, size, offset);
+
+	std::lock_guard<std::mutex> guard(mLock);
+
+	auto range = mImages.equal_range(hash);
+	for (auto iter = range.first; iter != range.second;)
+	{
+		std::shared_ptr<const ProgramImage> image = iter->second.lock();
+		if (!image)
+		{
+			iter = mImages.erase(iter);
+			continue;
+		}
+		if (image->sameContents(program, size, offset))
+		{
+			return image;
+		}
+		++iter;
+	}
+
+	auto image = std::make_shared<const ProgramImage>(program, size, offset);
+	mImages.emplace(hash, image);
+	return image;
+}
+
+std::size_t ImageStore::residentImages()
+{
+	std::lock_guard<std::mutex> guard(mLock);
+
+	std::size_t count = 0;
+	for (auto iter = mImages.begin(); iter != mImages.end();)
+	{
+		if (iter->second.expired())
+		{
+			iter = mImages.erase(iter);
+			continue;
+		}
+		count++;
+		++iter;
+	}
+	return count;
+}
@@ -0,0 +1,61 @@
+#ifndef IMAGESTORE_HPP
+#define IMAGESTORE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Immutable copy of a program loaded at a fixed guest address, cut into 256-byte guest pages.
+// MOS6502 instances map these pages read-only and only copy a page on their first write to it,
+// so any number of CPUs running the same image share one copy of its code and ROM bytes.
+class ProgramImage
+{
+public:
+	static constexpr std::size_t pageSize = 256;
+
+	ProgramImage(const uint8_t* program, std::size_t size, uint16_t offset);
+
+	uint16_t offset() const { return mOffset; }
+	std::size_t size() const { return mSize; }
+	uint64_t hash() const { return mHash; }
+
+	uint8_t firstPage() const { return mOffset >> 8; }
+	std::size_t pageCount() const { return mPages.size() / pageSize; }
+
+	// guest page contents (bytes the image does not cover are zero), nullptr if the page is not part of the image
+	const uint8_t* page(std::size_t guestPage) const;
+
+	// covered byte range [begin, end) inside a guest page of the image
+	std::size_t pageBegin(std::size_t guestPage) const;
+	std::size_t pageEnd(std::size_t guestPage) const;
+
+	bool sameContents(const uint8_t* program, std::size_t size, uint16_t offset) const;
+
+	static uint64_t hashBytes(const uint8_t* data, std::size_t size, uint64_t seed = 0xCBF29CE484222325ULL);
+
+private:
+	uint16_t mOffset;
+	std::size_t mSize;
+	uint64_t mHash;
+	std::vector<uint8_t> mPages;
+};
+
+// Deduplicating store of program images. Loading the same bytes at the same offset twice hands out
+// the same ProgramImage; the store only keeps weak references, so an image is freed once the last
+// CPU mapping it is gone.
+class ImageStore
+{
+public:
+	std::shared_ptr<const ProgramImage> load(const uint8_t* program, std::size_t size, uint16_t offset);
+
+	std::size_t residentImages();
+
+private:
+	std::mutex mLock;
+	std::multimap<uint64_t, std::weak_ptr<const ProgramImage>> mImages;
+};
+
+#endif
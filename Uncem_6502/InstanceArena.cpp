@@ -0,0 +1,140 @@
+#include "InstanceArena.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+HugePageRegion::~HugePageRegion()
+{
+	unmap();
+}
+
+void HugePageRegion::unmap()
+{
+	if (mMapping)
+	{
+#ifdef __linux__
+		munmap(mMapping, mMappingSize);
+#else
+		::operator delete(mMapping, std::align_val_t(hugePageSize));
+#endif
+	}
+	mData = nullptr;
+	mSize = 0;
+	mMapping = nullptr;
+	mMappingSize = 0;
+	mBacking = BACKING_NONE;
+}
+
+bool HugePageRegion::map(std::size_t size, bool explicitHugePages)
+{
+	unmap();
+	size = (size + hugePageSize - 1) / hugePageSize * hugePageSize;
+	if (size == 0)
+	{
+		return false;
+	}
+#ifdef __linux__
+	if (explicitHugePages)
+	{
+		void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (21 << MAP_HUGE_SHIFT), -1, 0);
+		if (mapping != MAP_FAILED)
+		{
+			mMapping = mData = static_cast<uint8_t*>(mapping);
+			mMappingSize = mSize = size;
+			mBacking = BACKING_EXPLICIT;
+			return true;
+		}
+		std::cerr << "Huge pages: no explicit 2 MiB pages (" << strerror(errno) << "), see /proc/sys/vm/nr_hugepages; trying transparent ones" << std::endl;
+	}
+
+	// one hugepage more than needed, so that the region can start on a hugepage boundary
+	std::size_t mappingSize = size + hugePageSize;
+	void* mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (mapping == MAP_FAILED)
+	{
+		std::cerr << "Huge pages: could not map " << size << " bytes: " << strerror(errno) << std::endl;
+		return false;
+	}
+	uintptr_t start = (reinterpret_cast<uintptr_t>(mapping) + hugePageSize - 1) & ~(hugePageSize - 1);
+	mMapping = mapping;
+	mMappingSize = mappingSize;
+	mData = reinterpret_cast<uint8_t*>(start);
+	mSize = size;
+	mBacking = madvise(mData, mSize, MADV_HUGEPAGE) == 0 ? BACKING_TRANSPARENT : BACKING_PAGES;
+	return true;
+#else
+	mMapping = ::operator new(size, std::align_val_t(hugePageSize), std::nothrow);
+	if (!mMapping)
+	{
+		std::cerr << "Huge pages: could not allocate " << size << " bytes" << std::endl;
+		return false;
+	}
+	mData = static_cast<uint8_t*>(mMapping);
+	mMappingSize = mSize = size;
+	mBacking = BACKING_HEAP;
+	return true;
+#endif
+}
+
+const char* HugePageRegion::backingName(Backing backing)
+{
+	switch (backing)
+	{
+	case BACKING_NONE: return "none";
+	case BACKING_HEAP: return "heap";
+	case BACKING_PAGES: return "4 KiB pages";
+	case BACKING_TRANSPARENT: return "transparent hugepages";
+	case BACKING_EXPLICIT: return "explicit hugepages";
+	}
+	return "?";
+}
+
+bool HugePageRegion::bindToNode(std::size_t offset, std::size_t size, int node)
+{
+#ifdef __linux__
+	// MPOL_PREFERRED rather than MPOL_BIND: a full node falls back to the others instead of failing the page fault
+	if (!mData || offset + size > mSize || node < 0 || node >= 1024) { return false; }
+	unsigned long mask[1024 / (8 * sizeof(unsigned long))] = {};
+	mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+	return syscall(SYS_mbind, mData + offset, size, MPOL_PREFERRED, mask, 1024, 0) == 0;
+#else
+	(void)offset;
+	(void)size;
+	(void)node;
+	return false;
+#endif
+}
+
+int HugePageRegion::currentNode()
+{
+#ifdef __linux__
+	unsigned cpu = 0;
+	unsigned node = 0;
+	return syscall(SYS_getcpu, &cpu, &node, nullptr) == 0 ? static_cast<int>(node) : 0;
+#else
+	return 0;
+#endif
+}
+
+int HugePageRegion::nodeCount()
+{
+	// "0" or "0-3", the last number is the highest node; cached, nodes do not come and go under us
+	static const int count = []() {
+		std::ifstream online("/sys/devices/system/node/online");
+		std::string text;
+		if (!std::getline(online, text) || text.empty()) { return 1; }
+		std::size_t last = text.find_last_of(",-");
+		return std::atoi(text.c_str() + (last == std::string::npos ? 0 : last + 1)) + 1;
+	}();
+	return count;
+}
@@ -0,0 +1,205 @@
+#ifndef INSTANCEARENA_HPP
+#define INSTANCEARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// One anonymous mapping backed by 2 MiB pages where the host allows it: explicit hugetlbfs pages if asked
+// for and the pool has them, else transparent hugepages, else ordinary pages. Nothing is touched up front,
+// so memory is only committed where it is first written, on the NUMA node that thread runs on unless
+// bindToNode() said otherwise.
+class HugePageRegion
+{
+public:
+	enum Backing
+	{
+		BACKING_NONE,
+		BACKING_HEAP,           // no mmap on this host
+		BACKING_PAGES,          // ordinary pages, transparent hugepages are switched off
+		BACKING_TRANSPARENT,    // madvise(MADV_HUGEPAGE)
+		BACKING_EXPLICIT        // MAP_HUGETLB
+	};
+
+	static constexpr std::size_t hugePageSize = std::size_t(2) << 20;
+
+	HugePageRegion() = default;
+	~HugePageRegion();
+	HugePageRegion(const HugePageRegion&) = delete;
+	HugePageRegion& operator=(const HugePageRegion&) = delete;
+
+	// size is rounded up to whole hugepages; the start is hugepage aligned
+	bool map(std::size_t size, bool explicitHugePages = false);
+
+	uint8_t* data() const { return mData; }
+	std::size_t size() const { return mSize; }
+	Backing backing() const { return mBacking; }
+	static const char* backingName(Backing backing);
+
+	// prefer node for pages of [offset, offset + size) not touched yet; false where NUMA policy is not available
+	bool bindToNode(std::size_t offset, std::size_t size, int node);
+
+	// the NUMA node the calling thread runs on, 0 without NUMA
+	static int currentNode();
+	// nodes online, 1 without NUMA
+	static int nodeCount();
+
+private:
+	void unmap();
+
+	uint8_t* mData = nullptr;
+	std::size_t mSize = 0;
+	void* mMapping = nullptr;          // what to give back, mData may be aligned into it
+	std::size_t mMappingSize = 0;
+	Backing mBacking = BACKING_NONE;
+};
+
+// Slots for many CPU instances side by side in a HugePageRegion, for hosts that run tens of thousands of
+// them: one mapping instead of one heap block each, and the hot head of every instance (see the register
+// block in MOS6502) on few TLB entries. The region is cut into blocks of whole hugepages, each block holds
+// as many slots as fit, and every block belongs to one NUMA node: create() takes its slot from a block of
+// the node the calling thread runs on, binding a fresh block to that node before anything in it is
+// touched. So create each instance on the worker thread that is going to run it.
+//
+// create() and destroy() may be called from any thread; the instances themselves are not synchronised.
+template <typename Cpu>
+class InstanceArena
+{
+public:
+	static constexpr std::size_t slotAlignment = alignof(Cpu) > 64 ? alignof(Cpu) : 64;
+	static constexpr std::size_t slotSize = (sizeof(Cpu) + slotAlignment - 1) / slotAlignment * slotAlignment;
+
+	// room for at least capacity instances, plus one partly used block per further NUMA node when
+	// numaLocal; false from ok() if the mapping failed
+	explicit InstanceArena(std::size_t capacity, bool explicitHugePages = false, bool numaLocal = true)
+		: mNumaLocal(numaLocal)
+	{
+		mBlockSlots = slotSize < HugePageRegion::hugePageSize ? HugePageRegion::hugePageSize / slotSize : 1;
+		mBlockSize = (mBlockSlots * slotSize + HugePageRegion::hugePageSize - 1) / HugePageRegion::hugePageSize * HugePageRegion::hugePageSize;
+		mBlocks = (capacity + mBlockSlots - 1) / mBlockSlots + (numaLocal ? HugePageRegion::nodeCount() - 1 : 0);
+		if (mRegion.map(mBlocks * mBlockSize, explicitHugePages))
+		{
+			mLive.assign(mBlocks * mBlockSlots, false);
+		}
+		else
+		{
+			mBlocks = 0;
+		}
+	}
+
+	~InstanceArena()
+	{
+		for (std::size_t slot = 0; slot < mLive.size(); slot++)
+		{
+			if (mLive[slot]) { at(slot)->~Cpu(); }
+		}
+	}
+
+	InstanceArena(const InstanceArena&) = delete;
+	InstanceArena& operator=(const InstanceArena&) = delete;
+
+	bool ok() const { return mBlocks != 0; }
+	HugePageRegion::Backing backing() const { return mRegion.backing(); }
+	std::size_t live() const
+	{
+		std::lock_guard<std::mutex> lock(mLock);
+		return mLiveCount;
+	}
+
+	// a new instance constructed from args in a slot near the calling thread; nullptr when the arena is full
+	template <typename... Args>
+	Cpu* create(Args&&... args)
+	{
+		std::size_t slot;
+		{
+			std::lock_guard<std::mutex> lock(mLock);
+			if (!claim(mNumaLocal ? HugePageRegion::currentNode() : 0, slot)) { return nullptr; }
+		}
+		// constructed outside the lock: this is the first touch that commits the slot's pages
+		Cpu* cpu = new (mRegion.data() + offsetOf(slot)) Cpu(std::forward<Args>(args)...);
+		std::lock_guard<std::mutex> lock(mLock);
+		mLive[slot] = true;
+		mLiveCount++;
+		return cpu;
+	}
+
+	// the slot goes back to the node it was placed on; its pages stay committed for the next create() there
+	void destroy(Cpu* cpu)
+	{
+		if (!cpu) { return; }
+		std::size_t slot = slotOf(cpu);
+		cpu->~Cpu();
+		std::lock_guard<std::mutex> lock(mLock);
+		mLive[slot] = false;
+		mLiveCount--;
+		mNodes[mBlockNodes[slot / mBlockSlots]].free.push_back(slot);
+	}
+
+private:
+	struct Node
+	{
+		std::vector<std::size_t> free;  // destroyed slots, reused first
+		std::size_t block = SIZE_MAX;   // block being filled
+		std::size_t next = 0;           // next untouched slot in it
+	};
+
+	std::size_t offsetOf(std::size_t slot) const { return slot / mBlockSlots * mBlockSize + slot % mBlockSlots * slotSize; }
+	Cpu* at(std::size_t slot) const { return reinterpret_cast<Cpu*>(mRegion.data() + offsetOf(slot)); }
+
+	std::size_t slotOf(const Cpu* cpu) const
+	{
+		std::size_t offset = reinterpret_cast<const uint8_t*>(cpu) - mRegion.data();
+		return offset / mBlockSize * mBlockSlots + offset % mBlockSize / slotSize;
+	}
+
+	bool claim(int nodeIndex, std::size_t& slot)
+	{
+		if (takeSlot(mNodes[nodeIndex], slot)) { return true; }
+		if (mNextBlock < mBlocks)
+		{
+			Node& node = mNodes[nodeIndex];
+			node.block = mNextBlock++;
+			node.next = 0;
+			mBlockNodes.push_back(nodeIndex);
+			if (mNumaLocal) { mRegion.bindToNode(node.block * mBlockSize, mBlockSize, nodeIndex); }
+			return takeSlot(node, slot);
+		}
+		// no blocks left: a remote slot is better than none
+		for (auto& [other, node] : mNodes)
+		{
+			if (takeSlot(node, slot)) { return true; }
+		}
+		return false;
+	}
+
+	bool takeSlot(Node& node, std::size_t& slot)
+	{
+		if (!node.free.empty())
+		{
+			slot = node.free.back();
+			node.free.pop_back();
+			return true;
+		}
+		if (node.block == SIZE_MAX || node.next == mBlockSlots) { return false; }
+		slot = node.block * mBlockSlots + node.next++;
+		return true;
+	}
+
+	HugePageRegion mRegion;
+	bool mNumaLocal;
+	std::size_t mBlockSlots = 0;
+	std::size_t mBlockSize = 0;
+	std::size_t mBlocks = 0;
+	mutable std::mutex mLock;
+	std::size_t mNextBlock = 0;
+	std::vector<int> mBlockNodes;       // per block handed out so far
+	std::unordered_map<int, Node> mNodes;
+	std::vector<bool> mLive;
+	std::size_t mLiveCount = 0;
+};
+
+#endif
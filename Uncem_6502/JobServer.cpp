@@ -0,0 +1,590 @@
+#include "JobServer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "MOS6502.hpp"
+
+namespace
+{
+	// bounds-checked little-endian reader over one message payload
+	struct Reader
+	{
+		const uint8_t* data;
+		std::size_t size;
+		std::size_t pos;
+		bool ok;
+
+		uint64_t take(unsigned bytes)
+		{
+			uint64_t value = 0;
+			if (size - pos < bytes)
+			{
+				ok = false;
+				return 0;
+			}
+			for (unsigned i = 0; i < bytes; i++)
+			{
+				value |= static_cast<uint64_t>(data[pos++]) << (8 * i);
+			}
+			return value;
+		}
+
+		const uint8_t* bytes(std::size_t count)
+		{
+			if (size - pos < count)
+			{
+				ok = false;
+				return nullptr;
+			}
+			pos += count;
+			return data + pos - count;
+		}
+	};
+
+	void put(std::vector<uint8_t>& out, uint64_t value, unsigned bytes)
+	{
+		for (unsigned i = 0; i < bytes; i++)
+		{
+			out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+		}
+	}
+
+}
+
+JobServer::JobServer(unsigned workers, std::size_t batchSize)
+	: mWorkerCount(workers ? workers : std::max(1u, std::thread::hardware_concurrency())),
+	mBatchSize(batchSize ? batchSize : 1), mListenFd(-1), mStopping(false), mMetrics(), mNextWorker(0)
+{
+}
+
+JobServer::~JobServer()
+{
+	if (mListenFd >= 0) ::close(mListenFd);
+	if (!mPath.empty()) ::unlink(mPath.c_str());
+}
+
+bool JobServer::listen(const std::string& path)
+{
+	mListenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path))
+	{
+		std::cerr << "Job server: socket path too long: " << path << std::endl;
+		return false;
+	}
+	strcpy(addr.sun_path, path.c_str());
+	::unlink(path.c_str());
+	if (mListenFd < 0 || bind(mListenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(mListenFd, 64) != 0)
+	{
+		std::cerr << "Job server: could not listen on " << path << " (" << strerror(errno) << ")" << std::endl;
+		return false;
+	}
+	mPath = path;
+	return true;
+}
+
+bool JobServer::publishLiveMetrics(const std::string& segment)
+{
+	return mLive.create(segment, mWorkerCount);
+}
+
+bool JobServer::serve()
+{
+	if (mListenFd < 0)
+	{
+		std::cerr << "Job server: not listening" << std::endl;
+		return false;
+	}
+
+	for (unsigned i = 0; i < mWorkerCount; i++)
+	{
+		mWorkers.emplace_back(&JobServer::worker, this);
+	}
+
+	std::vector<std::shared_ptr<Connection>> connections;
+	std::vector<pollfd> fds;
+	while (!mStopping)
+	{
+		fds.assign(1, { mListenFd, POLLIN, 0 });
+		for (const auto& connection : connections)
+		{
+			std::lock_guard<std::mutex> lock(connection->sendLock);
+			fds.push_back({ connection->fd, static_cast<short>(connection->output.empty() ? POLLIN : POLLIN | POLLOUT), 0 });
+		}
+		// the timeout only bounds how long requestStop() takes to be noticed
+		if (poll(fds.data(), fds.size(), 100) < 0 && errno != EINTR)
+		{
+			std::cerr << "Job server: poll failed (" << strerror(errno) << ")" << std::endl;
+			break;
+		}
+
+		std::size_t kept = 0;
+		for (std::size_t i = 0; i < connections.size(); i++)
+		{
+			bool keep = true;
+			if (fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))
+			{
+				keep = receive(connections[i]);
+			}
+			{
+				// replies a worker could not send at once; a connection the workers gave up on is closed here
+				std::lock_guard<std::mutex> lock(connections[i]->sendLock);
+				keep = keep && connections[i]->open && flush(*connections[i]);
+			}
+			if (keep)
+			{
+				connections[kept++] = connections[i];
+			}
+			else
+			{
+				// queued jobs of a closed connection still run, their replies are dropped
+				std::lock_guard<std::mutex> lock(connections[i]->sendLock);
+				connections[i]->open = false;
+				::close(connections[i]->fd);
+			}
+		}
+		connections.resize(kept);
+
+		if (fds[0].revents & POLLIN)
+		{
+			int fd = accept(mListenFd, nullptr, nullptr);
+			// non-blocking, so that neither a worker nor this loop ever waits for a client to read
+			if (fd >= 0 && fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0)
+			{
+				::close(fd);
+				fd = -1;
+			}
+			if (fd >= 0)
+			{
+				auto connection = std::make_shared<Connection>();
+				connection->fd = fd;
+				connections.push_back(std::move(connection));
+			}
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mQueueLock);
+		mStopping = true;
+	}
+	mQueueReady.notify_all();
+	for (std::thread& thread : mWorkers)
+	{
+		thread.join();
+	}
+	mWorkers.clear();
+	for (const auto& connection : connections)
+	{
+		std::lock_guard<std::mutex> lock(connection->sendLock);
+		connection->open = false;
+		::close(connection->fd);
+	}
+	return true;
+}
+
+JobServer::Metrics JobServer::metrics()
+{
+	Metrics metrics;
+	{
+		std::lock_guard<std::mutex> lock(mMetricsLock);
+		metrics = mMetrics;
+	}
+	std::lock_guard<std::mutex> lock(mQueueLock);
+	metrics.queueDepth = static_cast<uint32_t>(mQueue.size());
+	return metrics;
+}
+
+bool JobServer::receive(const std::shared_ptr<Connection>& connection)
+{
+	uint8_t buffer[65536];
+	ssize_t received = ::recv(connection->fd, buffer, sizeof(buffer), 0);
+	if (received < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+	{
+		return true;
+	}
+	if (received <= 0)
+	{
+		return false;
+	}
+
+	std::vector<uint8_t>& input = connection->input;
+	input.insert(input.end(), buffer, buffer + received);
+	std::size_t pos = 0;
+	while (input.size() - pos >= 4)
+	{
+		uint32_t length = input[pos] | (input[pos + 1] << 8) | (input[pos + 2] << 16) | (static_cast<uint32_t>(input[pos + 3]) << 24);
+		if (length == 0 || length > maxMessageSize)
+		{
+			std::cerr << "Job server: bad message length " << std::dec << length << std::endl;
+			return false;
+		}
+		if (input.size() - pos - 4 < length)
+		{
+			break;
+		}
+		if (!handleMessage(connection, input.data() + pos + 4, length))
+		{
+			return false;
+		}
+		pos += 4 + length;
+	}
+	input.erase(input.begin(), input.begin() + pos);
+	return true;
+}
+
+bool JobServer::handleMessage(const std::shared_ptr<Connection>& connection, const uint8_t* data, std::size_t size)
+{
+	if (data[0] == MSG_METRICS)
+	{
+		Metrics metrics = this->metrics();
+		std::vector<uint8_t> reply;
+		put(reply, metrics.queueDepth, 4);
+		put(reply, metrics.peakQueueDepth, 4);
+		put(reply, metrics.accepted, 8);
+		put(reply, metrics.completed, 8);
+		put(reply, metrics.rejected, 8);
+		put(reply, metrics.batches, 8);
+		put(reply, metrics.latencySumUs, 8);
+		put(reply, metrics.latencyMaxUs, 8);
+		for (uint64_t count : metrics.latency)
+		{
+			put(reply, count, 8);
+		}
+		put(reply, metrics.deduplicated, 8);
+		return send(*connection, MSG_METRICS_REPLY, reply);
+	}
+	if (data[0] != MSG_JOB)
+	{
+		std::cerr << "Job server: unknown message type " << std::dec << static_cast<int>(data[0]) << std::endl;
+		return false;
+	}
+
+	Job job;
+	std::string error;
+	if (!parseJob(data + 1, size - 1, job, error))
+	{
+		if (error.empty())
+		{
+			std::cerr << "Job server: truncated job message" << std::endl;
+			return false;
+		}
+		// well-formed but unusable, the connection stays up
+		std::vector<uint8_t> reply;
+		put(reply, job.id, 4);
+		reply.insert(reply.end(), error.begin(), error.end());
+		{
+			std::lock_guard<std::mutex> lock(mMetricsLock);
+			mMetrics.rejected++;
+		}
+		return send(*connection, MSG_ERROR, reply);
+	}
+	job.connection = connection;
+	job.arrived = Clock::now();
+
+	std::size_t depth;
+	{
+		std::lock_guard<std::mutex> lock(mQueueLock);
+		mQueue.push_back(std::move(job));
+		depth = mQueue.size();
+	}
+	mQueueReady.notify_one();
+
+	std::lock_guard<std::mutex> lock(mMetricsLock);
+	mMetrics.accepted++;
+	mMetrics.peakQueueDepth = std::max(mMetrics.peakQueueDepth, static_cast<uint32_t>(depth));
+	return true;
+}
+
+bool JobServer::parseJob(const uint8_t* data, std::size_t size, Job& job, std::string& error)
+{
+	// false with an empty error for a malformed message, with an error text for a job that cannot run
+	Reader in = { data, size, 0, true };
+	job.id = static_cast<uint32_t>(in.take(4));
+	uint16_t load = static_cast<uint16_t>(in.take(2));
+	job.entry = static_cast<uint16_t>(in.take(2));
+	job.budget = in.take(8);
+	uint32_t imageSize = static_cast<uint32_t>(in.take(4));
+	const uint8_t* image = in.bytes(imageSize);
+
+	uint16_t patches = static_cast<uint16_t>(in.take(2));
+	for (uint16_t i = 0; i < patches && in.ok; i++)
+	{
+		uint16_t address = static_cast<uint16_t>(in.take(2));
+		uint32_t patchSize = static_cast<uint32_t>(in.take(4));
+		const uint8_t* bytes = in.bytes(patchSize);
+		if (in.ok)
+		{
+			if (address + patchSize > 0x10000)
+			{
+				error = "patch past $FFFF";
+			}
+			job.patches.push_back({ address, std::vector<uint8_t>(bytes, bytes + patchSize) });
+		}
+	}
+
+	uint16_t ranges = static_cast<uint16_t>(in.take(2));
+	std::size_t replySize = 0;
+	for (uint16_t i = 0; i < ranges && in.ok; i++)
+	{
+		uint16_t address = static_cast<uint16_t>(in.take(2));
+		uint32_t rangeSize = static_cast<uint32_t>(in.take(4));
+		if (address + rangeSize > 0x10000)
+		{
+			error = "range past $FFFF";
+		}
+		replySize += rangeSize;
+		if (replySize > maxMessageSize - 32)
+		{
+			error = "ranges too large for one reply";
+		}
+		job.ranges.push_back({ address, rangeSize });
+	}
+
+	if (!in.ok || in.pos != in.size)
+	{
+		error.clear();
+		return false;
+	}
+	if (load + imageSize > 0x10000)
+	{
+		error = "image past $FFFF";
+	}
+	if (!error.empty())
+	{
+		return false;
+	}
+	if (imageSize != 0)
+	{
+		job.image = mImages.load(image, imageSize, load);
+	}
+	return true;
+}
+
+void JobServer::worker()
+{
+	// one CPU per worker, reset from a blank one for every job so only the pages a job touched get copied;
+	// the blank CPU's page hashes are computed once here, so a job only hashes the pages it brings
+	MOS6502Debug blank;
+	blank.stateHash();
+	auto cpu = std::make_unique<MOS6502Debug>();
+	// totals over the jobs before the current one, the CPU counts the current one
+	LiveMetrics::Slot* live = mLive.claim("worker " + std::to_string(mNextWorker++));
+	uint64_t instructions = 0;
+	uint64_t cycles = 0;
+	uint64_t interrupts = 0;
+	std::vector<Job> batch;
+	std::vector<uint8_t> reply;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mQueueLock);
+			mQueueReady.wait(lock, [this] { return mStopping || !mQueue.empty(); });
+			if (mStopping)
+			{
+				mLive.release(live);
+				return;
+			}
+			while (!mQueue.empty() && batch.size() < mBatchSize)
+			{
+				batch.push_back(std::move(mQueue.front()));
+				mQueue.pop_front();
+			}
+		}
+		{
+			std::lock_guard<std::mutex> lock(mMetricsLock);
+			mMetrics.batches++;
+		}
+
+		for (Job& job : batch)
+		{
+			*cpu = blank;
+			cpu->ISDEBUG = false;
+			if (job.image)
+			{
+				cpu->mapImage(job.image);
+			}
+			for (const Patch& patch : job.patches)
+			{
+				cpu->loadProgram(patch.bytes.data(), patch.bytes.size(), patch.address);
+			}
+			cpu->setProgramCounter(job.entry);
+
+			reply.clear();
+			put(reply, job.id, 4);
+			std::vector<uint8_t> key;
+			put(key, cpu->stateHash(), 8);
+			put(key, job.budget, 8);
+			for (const auto& range : job.ranges)
+			{
+				put(key, range.first, 2);
+				put(key, range.second, 4);
+			}
+			uint64_t keyHash = ProgramImage::hashBytes(key.data(), key.size());
+			bool cached = cachedResult(keyHash, job, reply);
+			if (live) { live->cacheLookup(cached); }
+			if (cached)
+			{
+				send(*job.connection, MSG_RESULT, reply);
+				finished(job);
+				continue;
+			}
+
+			StopReason reason;
+			if (live)
+			{
+				// the same run in windows, with an update after each
+				live->running(true, STOP_NONE);
+				do
+				{
+					reason = cpu->execute(liveWindow, job.budget);
+					live->update(cpu->programCounter(), instructions + cpu->instructions(), cycles + cpu->cycles(), interrupts + cpu->interrupts());
+				} while (reason == STOP_BUDGET && cpu->cycles() < job.budget);
+				live->running(false, reason);
+				instructions += cpu->instructions();
+				cycles += cpu->cycles();
+				interrupts += cpu->interrupts();
+			}
+			else
+			{
+				reason = cpu->execute(UINT64_MAX, job.budget);
+			}
+			put(reply, reason, 1);
+			put(reply, cpu->getProgramCounter(), 2);
+			put(reply, cpu->getAccumulator(), 1);
+			put(reply, cpu->getRegisterX(), 1);
+			put(reply, cpu->getRegisterY(), 1);
+			put(reply, cpu->getStackPointer(), 1);
+			put(reply, cpu->getStatus(), 1);
+			put(reply, cpu->cycles(), 8);
+			for (const auto& range : job.ranges)
+			{
+				for (uint32_t i = 0; i < range.second; i++)
+				{
+					reply.push_back(cpu->getMemory(static_cast<uint16_t>(range.first + i)));
+				}
+			}
+			cacheResult(keyHash, job, reply);
+			send(*job.connection, MSG_RESULT, reply);
+			finished(job);
+		}
+		batch.clear();
+	}
+}
+
+bool JobServer::cachedResult(uint64_t key, const Job& job, std::vector<uint8_t>& reply)
+{
+	// appends the cached result to reply, which holds the job id so far; a job that only shares the hash
+	// with the cached one is run
+	{
+		std::lock_guard<std::mutex> lock(mResultLock);
+		auto found = mResults.find(key);
+		if (found == mResults.end())
+		{
+			return false;
+		}
+		const CachedResult& cached = found->second;
+		if (cached.image != job.image || cached.entry != job.entry || cached.budget != job.budget
+			|| cached.patches != job.patches || cached.ranges != job.ranges)
+		{
+			return false;
+		}
+		reply.insert(reply.end(), cached.reply.begin(), cached.reply.end());
+	}
+	std::lock_guard<std::mutex> lock(mMetricsLock);
+	mMetrics.deduplicated++;
+	return true;
+}
+
+void JobServer::cacheResult(uint64_t key, const Job& job, const std::vector<uint8_t>& reply)
+{
+	// the first job with a given hash keeps its entry
+	CachedResult cached = { job.image, job.patches, job.entry, job.budget, job.ranges, std::vector<uint8_t>(reply.begin() + 4, reply.end()) };
+	std::lock_guard<std::mutex> lock(mResultLock);
+	if (!mResults.emplace(key, std::move(cached)).second)
+	{
+		return;
+	}
+	mResultOrder.push_back(key);
+	if (mResultOrder.size() > resultCacheSize)
+	{
+		mResults.erase(mResultOrder.front());
+		mResultOrder.pop_front();
+	}
+}
+
+void JobServer::finished(const Job& job)
+{
+	uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - job.arrived).count();
+	std::size_t bucket = 0;
+	while (bucket + 1 < latencyBuckets && latency >= (uint64_t(1) << bucket))
+	{
+		bucket++;
+	}
+
+	std::lock_guard<std::mutex> lock(mMetricsLock);
+	mMetrics.completed++;
+	mMetrics.latencySumUs += latency;
+	mMetrics.latencyMaxUs = std::max(mMetrics.latencyMaxUs, latency);
+	mMetrics.latency[bucket]++;
+}
+
+bool JobServer::send(Connection& connection, uint8_t type, const std::vector<uint8_t>& payload)
+{
+	// queues the message and sends what the socket takes right away; the rest goes out from serve()'s loop
+	uint32_t length = static_cast<uint32_t>(payload.size() + 1);
+	std::lock_guard<std::mutex> lock(connection.sendLock);
+	if (!connection.open)
+	{
+		return false;
+	}
+	if (connection.output.size() + payload.size() > maxPendingOutput)
+	{
+		std::cerr << "Job server: client does not read its replies, closing the connection" << std::endl;
+		connection.open = false;
+		connection.output.clear();
+		return false;
+	}
+	put(connection.output, length, 4);
+	connection.output.push_back(type);
+	connection.output.insert(connection.output.end(), payload.begin(), payload.end());
+	if (!flush(connection))
+	{
+		connection.open = false;
+		return false;
+	}
+	return true;
+}
+
+bool JobServer::flush(Connection& connection)
+{
+	// with sendLock held; false once the connection is broken
+	std::size_t done = 0;
+	while (done < connection.output.size())
+	{
+		ssize_t sent = ::send(connection.fd, connection.output.data() + done, connection.output.size() - done, MSG_NOSIGNAL);
+		if (sent < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			break;
+		}
+		if (sent <= 0)
+		{
+			return false;
+		}
+		done += sent;
+	}
+	connection.output.erase(connection.output.begin(), connection.output.begin() + done);
+	return true;
+}
@@ -0,0 +1,175 @@
+#ifndef JOBSERVER_HPP
+#define JOBSERVER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "ImageStore.hpp"
+#include "LiveMetrics.hpp"
+
+// Long-running server that runs guest programs for many local clients over a Unix domain socket, so a job
+// costs a message round trip instead of a process start. Jobs from all connections go into one queue; a pool
+// of worker threads takes them off in batches and answers each job on the connection it came from, in
+// completion order. Images are deduplicated through an ImageStore, so clients resubmitting the same program
+// share its pages. A job whose starting state (memory, registers, cycle budget and requested ranges) hashes
+// the same as a recent one, see MOS6502::stateHash(), and that was sent with the same image, patches, entry,
+// budget and ranges is answered from that job's result instead of being run again.
+//
+// Every message in either direction is a little-endian u32 payload length followed by the payload, whose
+// first byte is the message type. Multi-byte fields are little endian.
+//
+//   client -> server
+//     JOB      u32 id, u16 load address, u16 entry PC, u64 cycle budget, u32 image size, image bytes,
+//              u16 patch count, per patch { u16 address, u32 size, bytes },
+//              u16 range count, per range { u16 address, u32 size }
+//     METRICS  no fields
+//
+//   server -> client
+//     RESULT   u32 id, u8 StopReason (STOP_BUDGET when the cycle budget ran out), u16 PC, u8 A, X, Y, SP, P,
+//              u64 cycles, then the bytes of every requested range in request order
+//     ERROR    u32 id, message text
+//     METRICS  u32 queue depth, u32 peak queue depth, u64 jobs accepted, completed and rejected, u64 batches,
+//              u64 latency sum and maximum in microseconds, u64 latencyBuckets counts; bucket i counts jobs
+//              answered within 2^i microseconds of arriving, the last one all slower jobs; u64 jobs
+//              answered from an earlier identical job
+//
+// Patches and ranges must not run past $FFFF. A malformed or oversized message closes the connection, and so
+// does a client that lets more than maxPendingOutput bytes of replies pile up without reading them. Replies
+// the socket does not take at once are sent from the accept/receive loop, which never blocks on a client.
+class JobServer
+{
+public:
+	enum MessageType
+	{
+		MSG_JOB = 0x01,
+		MSG_METRICS = 0x02,
+		MSG_RESULT = 0x81,
+		MSG_ERROR = 0x82,
+		MSG_METRICS_REPLY = 0x83
+	};
+
+	static constexpr std::size_t maxMessageSize = 1 << 20;
+	static constexpr std::size_t maxPendingOutput = 16 * maxMessageSize;   // unsent replies before a client is dropped
+	static constexpr std::size_t latencyBuckets = 24;
+	static constexpr std::size_t resultCacheSize = 4096;
+	static constexpr uint64_t liveWindow = 100000;     // instructions between live metrics updates
+
+	struct Metrics
+	{
+		uint32_t queueDepth;
+		uint32_t peakQueueDepth;
+		uint64_t accepted;
+		uint64_t completed;
+		uint64_t rejected;
+		uint64_t batches;
+		uint64_t latencySumUs;
+		uint64_t latencyMaxUs;
+		uint64_t latency[latencyBuckets];
+		uint64_t deduplicated;
+	};
+
+	// workers == 0 uses one per hardware thread; a worker takes up to batchSize queued jobs at a time
+	explicit JobServer(unsigned workers = 0, std::size_t batchSize = 16);
+	~JobServer();
+
+	bool listen(const std::string& path);
+
+	// publish every worker's counters in the shared memory segment named segment, one slot per worker, see
+	// LiveMetrics; the result cache counts as the slot's cache. Call before serve()
+	bool publishLiveMetrics(const std::string& segment);
+
+	// serve connections until requestStop(); returns false if the server could not start
+	bool serve();
+	// safe from any thread and from signal handlers
+	void requestStop() { mStopping = true; }
+
+	Metrics metrics();
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Connection
+	{
+		int fd;                              // non-blocking, closed by serve()'s loop only
+		std::mutex sendLock;                 // workers answer concurrently, one message at a time
+		bool open = true;                    // guarded by sendLock, false once replies are no longer wanted
+		std::vector<uint8_t> output;         // guarded by sendLock, replies the socket did not take yet
+		std::vector<uint8_t> input;
+	};
+
+	struct Patch
+	{
+		uint16_t address;
+		std::vector<uint8_t> bytes;
+
+		bool operator==(const Patch&) const = default;
+	};
+
+	struct Job
+	{
+		std::shared_ptr<Connection> connection;
+		uint32_t id;
+		uint16_t entry;
+		uint64_t budget;
+		std::shared_ptr<const ProgramImage> image;
+		std::vector<Patch> patches;
+		std::vector<std::pair<uint16_t, uint32_t>> ranges;
+		Clock::time_point arrived;
+	};
+
+	bool receive(const std::shared_ptr<Connection>& connection);
+	bool handleMessage(const std::shared_ptr<Connection>& connection, const uint8_t* data, std::size_t size);
+	bool parseJob(const uint8_t* data, std::size_t size, Job& job, std::string& error);
+	void worker();
+	bool cachedResult(uint64_t key, const Job& job, std::vector<uint8_t>& reply);
+	void cacheResult(uint64_t key, const Job& job, const std::vector<uint8_t>& reply);
+	void finished(const Job& job);
+	bool send(Connection& connection, uint8_t type, const std::vector<uint8_t>& payload);
+	bool flush(Connection& connection);
+
+	unsigned mWorkerCount;
+	std::size_t mBatchSize;
+	int mListenFd;
+	std::string mPath;
+	std::atomic<bool> mStopping;
+	ImageStore mImages;
+
+	std::mutex mQueueLock;
+	std::condition_variable mQueueReady;
+	std::deque<Job> mQueue;
+	std::vector<std::thread> mWorkers;
+
+	// a recent job's reply without its id, and what the job started from; equal hashes are confirmed by
+	// comparing the latter, the image by identity since ImageStore keeps one per contents
+	struct CachedResult
+	{
+		std::shared_ptr<const ProgramImage> image;
+		std::vector<Patch> patches;
+		uint16_t entry;
+		uint64_t budget;
+		std::vector<std::pair<uint16_t, uint32_t>> ranges;
+		std::vector<uint8_t> reply;
+	};
+
+	// keyed by the hash of the job's starting state; oldest out first
+	std::mutex mResultLock;
+	std::unordered_map<uint64_t, CachedResult> mResults;
+	std::deque<uint64_t> mResultOrder;
+
+	std::mutex mMetricsLock;
+	Metrics mMetrics;
+
+	LiveMetrics mLive;
+	std::atomic<unsigned> mNextWorker;
+};
+
+#endif
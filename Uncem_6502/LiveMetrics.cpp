@@ -0,0 +1,229 @@
+#include "LiveMetrics.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <csignal>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MOS6502.hpp"
+
+static_assert(sizeof(LiveMetrics::Header) == 64, "the header is part of the segment layout");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "slots are shared with other processes");
+
+namespace
+{
+	const char magic[8] = { '6', '5', '0', '2', 'L', 'I', 'V', 'E' };
+
+	const char* reasonName(uint32_t reason)
+	{
+		switch (reason)
+		{
+		case STOP_NONE: return "none";
+		case STOP_HALT: return "halt";
+		case STOP_UNKNOWN_OPCODE: return "unknown_opcode";
+		case STOP_BREAKPOINT: return "breakpoint";
+		case STOP_WATCHPOINT: return "watchpoint";
+		case STOP_BUDGET: return "budget";
+		}
+		return "unknown";
+	}
+
+	std::string labelValue(const char* text, std::size_t size)
+	{
+		// the slot name as written by the owner, which is not synchronised with this read, escaped for a label
+		std::string value;
+		for (std::size_t i = 0; i < size && text[i] != '\0'; i++)
+		{
+			if (text[i] == '\\' || text[i] == '"') { value += '\\'; }
+			value += text[i] == '\n' ? ' ' : text[i];
+		}
+		return value;
+	}
+}
+
+LiveMetrics::~LiveMetrics()
+{
+	unmap();
+}
+
+void LiveMetrics::unmap()
+{
+	if (mMapping)
+	{
+		munmap(mMapping, mSize);
+		if (mOwner) { shm_unlink(("/" + mName).c_str()); }
+	}
+	mMapping = nullptr;
+	mHeader = nullptr;
+	mSlots = nullptr;
+	mOwner = false;
+}
+
+bool LiveMetrics::create(const std::string& name, std::size_t slots)
+{
+	unmap();
+	std::string path = "/" + name;
+	int fd = shm_open(path.c_str(), O_CREAT | O_RDWR, 0644);
+	std::size_t size = sizeof(Header) + slots * sizeof(Slot);
+	// truncating to 0 first clears whatever a crashed earlier owner left behind
+	if (fd < 0 || ftruncate(fd, 0) != 0 || ftruncate(fd, static_cast<off_t>(size)) != 0)
+	{
+		std::cerr << "Live metrics: could not create " << path << ": " << strerror(errno) << std::endl;
+		if (fd >= 0) { close(fd); }
+		return false;
+	}
+	void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+	{
+		std::cerr << "Live metrics: could not map " << path << ": " << strerror(errno) << std::endl;
+		shm_unlink(path.c_str());
+		return false;
+	}
+
+	mName = name;
+	mMapping = mapping;
+	mSize = size;
+	mOwner = true;
+	mHeader = static_cast<Header*>(mapping);
+	mSlots = reinterpret_cast<Slot*>(static_cast<uint8_t*>(mapping) + sizeof(Header));
+	for (std::size_t i = 0; i < slots; i++)
+	{
+		new (&mSlots[i]) Slot{};
+	}
+	mHeader->version = version;
+	mHeader->slotCount = static_cast<uint32_t>(slots);
+	mHeader->slotSize = sizeof(Slot);
+	mHeader->pid = static_cast<uint32_t>(getpid());
+	// readers check the magic last
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(mHeader->magic, magic, sizeof(magic));
+	return true;
+}
+
+bool LiveMetrics::open(const std::string& name)
+{
+	unmap();
+	std::string path = "/" + name;
+	int fd = shm_open(path.c_str(), O_RDONLY, 0);
+	struct stat status;
+	if (fd < 0 || fstat(fd, &status) != 0 || static_cast<std::size_t>(status.st_size) < sizeof(Header))
+	{
+		std::cerr << "Live metrics: could not open " << path << ": " << (fd < 0 ? strerror(errno) : "not a metrics segment") << std::endl;
+		if (fd >= 0) { close(fd); }
+		return false;
+	}
+	std::size_t size = static_cast<std::size_t>(status.st_size);
+	void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+	{
+		std::cerr << "Live metrics: could not map " << path << ": " << strerror(errno) << std::endl;
+		return false;
+	}
+
+	const Header* header = static_cast<const Header*>(mapping);
+	bool isSegment = memcmp(header->magic, magic, sizeof(magic)) == 0;
+	// pairs with the release fence in create(): once the magic is there, so is the rest of the header
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (!isSegment || header->version != version || header->slotSize != sizeof(Slot)
+		|| sizeof(Header) + static_cast<std::size_t>(header->slotCount) * sizeof(Slot) > size)
+	{
+		std::cerr << "Live metrics: " << path << " is not a version " << version << " metrics segment" << std::endl;
+		munmap(mapping, size);
+		return false;
+	}
+	mName = name;
+	mMapping = mapping;
+	mSize = size;
+	mHeader = static_cast<Header*>(mapping);
+	mSlots = reinterpret_cast<Slot*>(static_cast<uint8_t*>(mapping) + sizeof(Header));
+	return true;
+}
+
+bool LiveMetrics::creatorAlive() const
+{
+	return mHeader && (kill(static_cast<pid_t>(mHeader->pid), 0) == 0 || errno == EPERM);
+}
+
+LiveMetrics::Slot* LiveMetrics::claim(const std::string& slotName)
+{
+	if (!mOwner) { return nullptr; }
+	std::lock_guard<std::mutex> lock(mClaimLock);
+	for (std::size_t i = 0; i < mHeader->slotCount; i++)
+	{
+		Slot& slot = mSlots[i];
+		if (slot.state.load(std::memory_order_relaxed) != SLOT_FREE) { continue; }
+		// a slot given back by an earlier owner starts from zero again
+		for (std::atomic<uint64_t>* counter : { &slot.instructions, &slot.cycles, &slot.interrupts, &slot.cacheLookups, &slot.cacheHits, &slot.updates })
+		{
+			counter->store(0, std::memory_order_relaxed);
+		}
+		slot.pc.store(0, std::memory_order_relaxed);
+		slot.stopReason.store(STOP_NONE, std::memory_order_relaxed);
+		memset(slot.name, 0, nameSize);
+		strncpy(slot.name, slotName.c_str(), nameSize - 1);
+		slot.state.store(SLOT_IDLE, std::memory_order_release);
+		return &slot;
+	}
+	return nullptr;
+}
+
+void LiveMetrics::release(Slot* slot)
+{
+	if (slot) { slot->state.store(SLOT_FREE, std::memory_order_release); }
+}
+
+void LiveMetrics::writePrometheus(std::ostream& out) const
+{
+	struct Family
+	{
+		const char* name;
+		const char* type;
+		const char* help;
+		uint64_t (*value)(const Slot& slot);
+	};
+	static const Family families[] = {
+		{ "m6502_instructions_total", "counter", "Guest instructions retired.",
+			[](const Slot& slot) -> uint64_t { return slot.instructions.load(std::memory_order_relaxed); } },
+		{ "m6502_cycles_total", "counter", "Guest base cycles.",
+			[](const Slot& slot) -> uint64_t { return slot.cycles.load(std::memory_order_relaxed); } },
+		{ "m6502_interrupts_total", "counter", "Entries through the IRQ/BRK vector.",
+			[](const Slot& slot) -> uint64_t { return slot.interrupts.load(std::memory_order_relaxed); } },
+		{ "m6502_cache_lookups_total", "counter", "Lookups in the slot owner's cache.",
+			[](const Slot& slot) -> uint64_t { return slot.cacheLookups.load(std::memory_order_relaxed); } },
+		{ "m6502_cache_hits_total", "counter", "Hits in the slot owner's cache.",
+			[](const Slot& slot) -> uint64_t { return slot.cacheHits.load(std::memory_order_relaxed); } },
+		{ "m6502_updates_total", "counter", "Updates of the slot.",
+			[](const Slot& slot) -> uint64_t { return slot.updates.load(std::memory_order_relaxed); } },
+		{ "m6502_pc", "gauge", "Guest program counter at the last update.",
+			[](const Slot& slot) -> uint64_t { return slot.pc.load(std::memory_order_relaxed); } },
+		{ "m6502_running", "gauge", "1 while the guest runs.",
+			[](const Slot& slot) -> uint64_t { return slot.state.load(std::memory_order_relaxed) == SLOT_RUNNING; } },
+		{ "m6502_last_stop", "gauge", "Why the last run ended, in the reason label.", nullptr }
+	};
+
+	for (const Family& family : families)
+	{
+		out << "# HELP " << family.name << " " << family.help << "\n# TYPE " << family.name << " " << family.type << "\n";
+		for (std::size_t i = 0; i < slotCount(); i++)
+		{
+			const Slot& slot = mSlots[i];
+			if (slot.state.load(std::memory_order_acquire) == SLOT_FREE) { continue; }
+			out << family.name << "{segment=\"" << labelValue(mName.c_str(), mName.size()) << "\",slot=\"" << i
+				<< "\",name=\"" << labelValue(slot.name, nameSize) << "\"";
+			if (family.value)
+			{
+				out << "} " << family.value(slot) << "\n";
+			}
+			else
+			{
+				out << ",reason=\"" << reasonName(slot.stopReason.load(std::memory_order_relaxed)) << "\"} 1\n";
+			}
+		}
+	}
+}
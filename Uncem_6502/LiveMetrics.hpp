@@ -0,0 +1,115 @@
+#ifndef LIVEMETRICS_HPP
+#define LIVEMETRICS_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+// Counters of running CPUs in a POSIX shared memory segment (/dev/shm/<name> on Linux), so that other
+// processes can watch them at any rate without locks and without stopping a guest. The process that
+// creates the segment hands out one slot per CPU or worker; whoever runs that CPU updates the slot with
+// relaxed atomic stores between runs of the guest, readers map the segment read-only and load the same
+// fields. Values are only consistent per field, not across a slot.
+//
+// Layout, native endian and alignment, so readers have to run on the same host:
+//   Header { char magic[8] "6502LIVE", u32 version, u32 slot count, u32 slot size, u32 creator pid },
+//   padded to 64 bytes, then the slots, 64-byte aligned, see Slot.
+class LiveMetrics
+{
+public:
+	static constexpr uint32_t version = 1;
+	static constexpr std::size_t nameSize = 32;
+
+	enum SlotState : uint32_t
+	{
+		SLOT_FREE = 0,
+		SLOT_IDLE,          // claimed, the CPU is not running
+		SLOT_RUNNING
+	};
+
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t slotCount;
+		uint32_t slotSize;
+		uint32_t pid;
+		uint8_t reserved[40];
+	};
+
+	struct alignas(64) Slot
+	{
+		std::atomic<uint32_t> state;        // SlotState; name is valid once it is not SLOT_FREE (acquire)
+		std::atomic<uint32_t> stopReason;   // why the last run ended, a StopReason
+		std::atomic<uint32_t> pc;
+		std::atomic<uint64_t> instructions; // totals over every run in the slot
+		std::atomic<uint64_t> cycles;
+		std::atomic<uint64_t> interrupts;
+		std::atomic<uint64_t> cacheLookups; // whatever the owner caches, e.g. job results
+		std::atomic<uint64_t> cacheHits;
+		std::atomic<uint64_t> updates;      // bumped by every update(), shows a slot is alive
+		char name[nameSize];
+
+		// running totals, stored without a read-modify-write: only the owner of a slot writes to it
+		void update(uint16_t programCounter, uint64_t totalInstructions, uint64_t totalCycles, uint64_t totalInterrupts)
+		{
+			pc.store(programCounter, std::memory_order_relaxed);
+			instructions.store(totalInstructions, std::memory_order_relaxed);
+			cycles.store(totalCycles, std::memory_order_relaxed);
+			interrupts.store(totalInterrupts, std::memory_order_relaxed);
+			updates.store(updates.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+
+		void cacheLookup(bool hit)
+		{
+			cacheLookups.store(cacheLookups.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			if (hit) { cacheHits.store(cacheHits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+		}
+
+		void running(bool isRunning, uint32_t reason)
+		{
+			stopReason.store(reason, std::memory_order_relaxed);
+			state.store(isRunning ? SLOT_RUNNING : SLOT_IDLE, std::memory_order_relaxed);
+		}
+	};
+
+	LiveMetrics() = default;
+	~LiveMetrics();
+	LiveMetrics(const LiveMetrics&) = delete;
+	LiveMetrics& operator=(const LiveMetrics&) = delete;
+
+	// publisher: a fresh segment with slots free slots, replacing a stale one of the same name; it is
+	// removed again when this object goes away. name is a single path component without the leading '/'
+	bool create(const std::string& name, std::size_t slots);
+	// reader: maps an existing segment read-only
+	bool open(const std::string& name);
+
+	// a free slot, named for the metrics; nullptr once all are taken
+	Slot* claim(const std::string& slotName);
+	void release(Slot* slot);
+
+	std::size_t slotCount() const { return mHeader ? mHeader->slotCount : 0; }
+	const Slot& slot(std::size_t index) const { return mSlots[index]; }
+	const std::string& name() const { return mName; }
+	// whether the process that created the segment still runs; a segment outlives it for readers that have it open
+	bool creatorAlive() const;
+
+	// every claimed slot in the Prometheus text exposition format, labelled with segment, slot and name
+	void writePrometheus(std::ostream& out) const;
+
+private:
+	void unmap();
+
+	std::string mName;
+	void* mMapping = nullptr;
+	std::size_t mSize = 0;
+	bool mOwner = false;
+	Header* mHeader = nullptr;
+	Slot* mSlots = nullptr;
+	std::mutex mClaimLock;
+};
+
+#endif
@@ -0,0 +1,2656 @@
+#ifndef MOS6502_HPP
+#define MOS6502_HPP
+
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "CallStack.hpp"
+#include "CodeCoverage.hpp"
+#include "Disassembler.hpp"
+#include "ImageStore.hpp"
+#include "MemoryDump.hpp"
+#include "MemoryProfile.hpp"
+#include "OpCodes.hpp"
+
+enum StopReason // why execute() or step() handed control back to the caller
+{
+	STOP_NONE = 0,
+	STOP_HALT,
+	STOP_UNKNOWN_OPCODE,
+	STOP_BREAKPOINT,
+	STOP_WATCHPOINT,
+	STOP_BUDGET
+};
+
+enum trapKind // bits of the per-page trap bitmap, pages with none of them set take the plain fast path
+{
+	TRAP_EXECUTE = 1,
+	TRAP_READ = 2,
+	TRAP_WRITE = 4,
+	PAGE_ATOMIC = 8, // not a trap, shared page that CPUs on other threads access concurrently
+	PAGE_HOOK = 16   // not a trap, page with a PC hook, see MOS6502::addHook()
+};
+
+enum HostResult // what a host function behind a hypercall or PC hook wants to happen next
+{
+	HOST_CONTINUE = 0, // done, carry on at the program counter the function left
+	HOST_EMULATE,      // not handled, run the guest code as if there was no host function
+	HOST_STOP          // stop execution like HALT
+};
+
+// sees every guest memory access with its value, for tools that need more than MemoryProfile's counts
+class AccessObserver
+{
+public:
+	virtual ~AccessObserver() = default;
+	virtual void observe(MemoryProfile::Access kind, uint16_t addr, uint8_t value) = 0;
+};
+
+class MOS6502
+{
+public:
+	bool ISDEBUG = true; // change this manually in code to set it to either debug or usual mode (true for debug, false for usual)
+
+	struct Watchpoint
+	{
+		uint16_t first, last;             // watched addresses, inclusive
+		uint8_t kinds;                    // TRAP_READ and/or TRAP_WRITE
+		bool matchValue;                  // only trigger when the value read or written equals value
+		uint8_t value;
+		uint16_t pcFirst, pcLast;         // only trigger for instructions starting in this range, inclusive
+	};
+
+	struct TrapHit
+	{
+		StopReason reason;
+		uint16_t pc;                      // instruction that hit the trap
+		uint16_t addr;
+		uint8_t value;
+		int watchpoint;                   // index into mWatchpoints, -1 for breakpoints
+	};
+
+	// the guest as seen by host functions: registers, flags and memory, read and written like instructions do
+	class Host
+	{
+	public:
+		explicit Host(MOS6502& cpu) : mCpu(cpu) {}
+
+		uint8_t& a() { return mCpu.mAccumulator; }
+		uint8_t& x() { return mCpu.mRegisterX; }
+		uint8_t& y() { return mCpu.mRegisterY; }
+		uint8_t& sp() { return mCpu.mStackPointer; }
+		uint16_t& pc() { return mCpu.mProgramCounter; }
+		uint8_t& c() { return mCpu.C; }
+		uint8_t& z() { return mCpu.Z; }
+		uint8_t& i() { return mCpu.I; }
+		uint8_t& d() { return mCpu.D; }
+		uint8_t& b() { return mCpu.B; }
+		uint8_t& v() { return mCpu.V; }
+		uint8_t& n() { return mCpu.N; }
+
+		uint8_t read(uint16_t addr) { return mCpu.read(addr); }
+		void write(uint16_t addr, uint8_t value) { mCpu.write(addr, value); }
+		// without counting it as a guest access
+		uint8_t peek(uint16_t addr) const { return mCpu.peek(addr); }
+
+		// run one guest instruction from inside the host function; a watchpoint it hits is still reported
+		// by the step() that called the host function
+		StopReason step()
+		{
+			StopReason reason = mCpu.step();
+			if (reason == STOP_WATCHPOINT) { mCpu.mWatchpointHit = true; }
+			return reason;
+		}
+
+		// leave like the replaced routine's RTS would
+		void returnFromSubroutine() { mCpu.returnFromSubroutine(); }
+		// cycles the replaced guest code would have taken, on top of the trap instruction itself
+		void addCycles(uint64_t cycles) { mCpu.mCycles += cycles; }
+
+	private:
+		MOS6502& mCpu;
+	};
+
+	using HostFunction = std::function<HostResult(Host& host)>;
+
+	MOS6502()
+		: mAccumulator(0), mRegisterX(0), mRegisterY(0), mProgramCounter(0), mStackPointer(0xFF), C(0), Z(0), I(0), D(0), B(0), V(0), N(0)
+	{
+		// every page starts out mapped to the shared blank page, mMemory is only touched on first write
+		for (std::size_t page = 0; page < pageCount; page++)
+		{
+			mPages[page] = blankPage;
+			mTrapPages[page] = 0;
+		}
+	}
+
+	MOS6502(const MOS6502& other)
+	{
+		for (std::size_t page = 0; page < pageCount; page++)
+		{
+			mTrapPages[page] = 0;
+		}
+		copyFrom(other);
+	}
+
+	MOS6502& operator=(const MOS6502& other)
+	{
+		if (this != &other)
+		{
+			copyFrom(other);
+		}
+		return *this;
+	}
+
+	void loadProgram(const uint8_t* program, std::size_t size, uint16_t offset)
+	{
+		// private copy of the program, see mapImage() for pages shared between instances
+		std::size_t addr = offset;
+		while (size > 0 && addr < sizeof(mMemory))
+		{
+			std::size_t chunk = std::min(size, pageSize - (addr & 0xFF));
+			unshare(addr >> 8);
+			memcpy(writablePage(addr >> 8) + (addr & 0xFF), program, chunk);
+			program += chunk;
+			addr += chunk;
+			size -= chunk;
+		}
+	}
+
+	void mapImage(std::shared_ptr<const ProgramImage> image)
+	{
+		// same result as loadProgram() with the image bytes, but pages are mapped read-only from the
+		// image instead of being copied, and only get copied on the first write
+		for (std::size_t page = image->firstPage(); page < image->firstPage() + image->pageCount(); page++)
+		{
+			std::size_t begin = image->pageBegin(page);
+			std::size_t end = image->pageEnd(page);
+			unshare(page);
+			if (mPages[page] == blankPage || (begin == 0 && end == pageSize))
+			{
+				mPages[page] = image->page(page);
+				mHashDirty[page / 64] |= 1ULL << (page % 64);
+			}
+			else
+			{
+				memcpy(writablePage(page) + begin, image->page(page) + begin, end - begin);
+			}
+		}
+		if (std::find(mImages.begin(), mImages.end(), image) == mImages.end())
+		{
+			mImages.push_back(std::move(image));
+		}
+	}
+
+	void attachProfile(MemoryProfile* profile)
+	{
+		// count reads, writes and instruction fetches into profile, nullptr switches counting off again
+		mProfile = profile;
+	}
+
+	void attachObserver(AccessObserver* observer)
+	{
+		// like attachProfile(), not owned and not carried over to copies
+		mObserver = observer;
+	}
+
+	void setHypercall(uint8_t number, HostFunction function)
+	{
+		// HYP #number calls function from now on, an empty function removes it
+		if (mHypercalls.size() <= number)
+		{
+			mHypercalls.resize(number + 1);
+		}
+		mHypercalls[number] = std::move(function);
+	}
+
+	void addHook(uint16_t pc, HostFunction function)
+	{
+		// high-level emulation: whenever execution reaches pc, function runs instead of the guest instruction
+		// there. It has to leave the same architectural state as the guest code it replaces, or return
+		// HOST_EMULATE to let the guest code run after all
+		mHooks[pc] = std::move(function);
+		mTrapPages[pc >> 8] |= PAGE_HOOK;
+	}
+
+	void removeHook(uint16_t pc)
+	{
+		mHooks.erase(pc);
+		rebuildTrapPages();
+	}
+
+	void enableHostCalls(bool enabled)
+	{
+		// switches hypercalls and hooks on or off together, off runs everything as plain guest code
+		mHostCallsEnabled = enabled;
+	}
+
+	bool hostCallsEnabled() const { return mHostCallsEnabled; }
+
+	void attachCoverage(uint8_t* bitmap, std::size_t size)
+	{
+		// guest edge coverage for fuzzing: every branch, jump, call and return bumps the 8-bit counter of the
+		// edge (instruction address, next PC) in bitmap, AFL style. size has to be a power of two. Not owned;
+		// unlike a profile it is carried over to copies, so a CPU restored from a snapshot keeps counting
+		mCoverage = bitmap;
+		mCoverageMask = size - 1;
+	}
+
+	void attachCallStack(CallStack* stack)
+	{
+		// keep stack in step with JSR, RTS and RTI, nullptr switches that off again. Not owned and, like a
+		// profile, not carried over to copies: the shadow belongs to one run of one CPU
+		mCallStack = stack;
+	}
+
+	void attachCodeCoverage(CodeCoverage* coverage)
+	{
+		// executed addresses and branch directions for coverage reports, nullptr switches recording off again.
+		// Not owned; carried over to copies like attachCoverage(), so give CPUs on other threads their own
+		mCodeCoverage = coverage;
+	}
+
+	void mapSharedPage(uint8_t page, uint8_t* memory, bool concurrent = false)
+	{
+		// guest page backed by pageSize bytes of caller-owned memory that other CPUs can map too; reads and
+		// writes go straight to memory and are never copied. The memory has to outlive the CPU and its copies.
+		// concurrent pages are read with acquire and written with release semantics, for CPUs running on
+		// different threads; every access is atomic on its own, read-modify-write instructions are not
+		mPages[page] = memory;
+		mSharedPages[page] = memory;
+		mHashShared[page / 64] |= 1ULL << (page % 64);
+		mTrapPages[page] = concurrent ? (mTrapPages[page] | PAGE_ATOMIC) : (mTrapPages[page] & ~PAGE_ATOMIC);
+	}
+
+	uint64_t cycles() const
+	{
+		// base cycles of the instructions executed so far, see InstructionInfo::cycles
+		return mCycles;
+	}
+
+	uint64_t instructions() const
+	{
+		// instructions retired so far, HYP included, routines replaced by a PC hook not; carried over to copies
+		return mInstructions;
+	}
+
+	uint64_t interrupts() const
+	{
+		// entries through the IRQ/BRK vector so far
+		return mInterrupts;
+	}
+
+	bool irq()
+	{
+		// maskable interrupt request between two instructions: with I clear, push the return address and the
+		// flags with B clear and continue at the IRQ/BRK vector with interrupts disabled. With I set nothing
+		// happens and the caller keeps the request pending, like a level-triggered IRQ line
+		if (I) { return false; }
+		write(stackOffset + mStackPointer, mProgramCounter >> 8);
+		mStackPointer--;
+		write(stackOffset + mStackPointer, mProgramCounter & 0xFF);
+		mStackPointer--;
+		pushStatusToStack(false);
+		I = 1;
+		mInterrupts++;
+		mCycles += 7;
+		uint8_t low = read(irqVector);
+		mProgramCounter = low | (read(irqVector + 1) << 8);
+		return true;
+	}
+
+	bool breakpointAt(uint16_t pc) const
+	{
+		return (mTrapPages[pc >> 8] & TRAP_EXECUTE) && !mBreakpoints.empty() && mBreakpoints[pc];
+	}
+
+	void resumeOverBreakpoint()
+	{
+		// the next execute() runs the instruction at mProgramCounter even if it has a breakpoint, as it does
+		// after stopping there; for "continue" from a place the CPU was moved to rather than stopped at
+		mResumeOver = mProgramCounter;
+		mResumeInstructions = mInstructions;
+	}
+
+	uint16_t programCounter() const
+	{
+		// where the next instruction starts, for tools outside the debugger such as SamplingProfiler
+		return mProgramCounter;
+	}
+
+	std::size_t privatePages() const
+	{
+		std::size_t count = 0;
+		for (std::size_t page = 0; page < pageCount; page++)
+		{
+			count += isPrivatePage(page);
+		}
+		return count;
+	}
+
+	void reset()
+	{
+		mProgramCounter = resetVector;
+		mProgramCounter = fetch16();
+	}
+
+	void executeFrom(uint16_t start)
+	{
+		mProgramCounter = start;
+		execute();
+	}
+
+	StopReason execute(uint64_t maxInstructions = UINT64_MAX, uint64_t untilCycle = UINT64_MAX)
+	{
+		// execute from current mProgramCounter; a breakpoint stops before its instruction runs. The breakpoint
+		// the last call stopped at is stepped over once when execution resumes there, any other one stops even
+		// on the first instruction, so a run split into several calls stops where a single call would.
+		// Returns STOP_BUDGET after maxInstructions or once cycles() reaches untilCycle, whichever comes first
+		bool resumed = mResumeOver == mProgramCounter && mResumeInstructions == mInstructions;
+		mResumeOver = -1;
+		for (uint64_t executed = 0; executed < maxInstructions && mCycles < untilCycle; executed++)
+		{
+			if ((mTrapPages[mProgramCounter >> 8] & TRAP_EXECUTE) && mBreakpoints[mProgramCounter] && !(resumed && executed == 0))
+			{
+				mTrapHit = { STOP_BREAKPOINT, mProgramCounter, mProgramCounter, 0, -1 };
+				resumeOverBreakpoint();
+				return STOP_BREAKPOINT;
+			}
+			StopReason reason = step();
+			if (reason != STOP_NONE) { return reason; }
+		}
+		return STOP_BUDGET;
+	}
+
+	bool executeUntil(uint16_t start, uint16_t stopAddress, uint64_t maxInstructions)
+	{
+		// like executeFrom(), but returns true as soon as mProgramCounter reaches stopAddress
+		mProgramCounter = start;
+		for (uint64_t executed = 0; executed < maxInstructions; executed++)
+		{
+			if (mProgramCounter == stopAddress) { return true; }
+			if (step() != STOP_NONE) { return false; }
+		}
+		return mProgramCounter == stopAddress;
+	}
+
+	StopReason step()
+	{
+		// execute a single instruction
+		mInstructionStart = mProgramCounter;
+		if ((mTrapPages[mProgramCounter >> 8] & PAGE_HOOK) && mHostCallsEnabled)
+		{
+			auto hook = mHooks.find(mProgramCounter);
+			if (hook != mHooks.end())
+			{
+				HostResult result = callHost(hook->second);
+				if (result != HOST_EMULATE)
+				{
+					return result == HOST_STOP ? STOP_HALT : hostReturned();
+				}
+			}
+		}
+		uint8_t opcode = fetch();
+		if (opcode == HALT) { return STOP_HALT; }
+		mCycles += instructionTable[opcode].cycles;
+		mInstructions++;
+		if (opcode == HYPERCALL)
+		{
+			// the operand picks the host function; without one, or with host calls switched off, HYP is a
+			// two byte NOP and the guest code after it runs instead
+			uint8_t number = fetch();
+			if (mCodeCoverage) { mCodeCoverage->record(mInstructionStart, opcode, mProgramCounter); }
+			if (mHostCallsEnabled && number < mHypercalls.size() && mHypercalls[number])
+			{
+				if (callHost(mHypercalls[number]) == HOST_STOP) { return STOP_HALT; }
+			}
+			else if (ISDEBUG)
+			{
+				printInstruction(mInstructionStart);
+				printRegisterInfo();
+			}
+			return hostReturned();
+		}
+		if (!executeOpcode((OpCode)opcode))
+		{
+			if (ISDEBUG)
+			{
+				// zero page, stack and the code around the opcode rather than all of memory
+				uint16_t around = static_cast<uint16_t>(std::max(mInstructionStart & 0xFFF0, 0x10) - 0x10);
+				std::cout << "\n";                      // ends the line printInstruction() started
+				printMemory(0x0000, 0x200);
+				printMemory(around, 0x30);
+				std::cerr << "Unknown opcode: " << std::hex << static_cast<int>(opcode) << std::dec << std::endl;
+			}
+			// STOP_UNKNOWN_OPCODE is the report outside debug mode; fuzzers and servers hit it on every bad input
+			return STOP_UNKNOWN_OPCODE;
+		}
+		if (mCodeCoverage) { mCodeCoverage->record(mInstructionStart, opcode, mProgramCounter); }
+		if (mCoverage && isControlFlow(opcode))
+		{
+			// hashed so that edges within a page do not all land in neighbouring counters
+			uint32_t from = (mInstructionStart * 0x9E3779B1u) >> 16;
+			uint32_t to = (mProgramCounter * 0x9E3779B1u) >> 16;
+			mCoverage[(from ^ (to >> 1)) & mCoverageMask]++;
+		}
+		if (mWatchpointHit)
+		{
+			mWatchpointHit = false;
+			return STOP_WATCHPOINT;
+		}
+		return STOP_NONE;
+	}
+
+	void freeze()
+	{
+		// move every page written so far into an immutable image; copies of this CPU made afterwards share
+		// all of their memory with it and copy nothing until they write
+		if (privatePages() == 0)
+		{
+			return;
+		}
+		std::vector<uint8_t> contents(sizeof(mMemory));
+		for (std::size_t addr = 0; addr < contents.size(); addr++)
+		{
+			contents[addr] = peek(addr);
+		}
+		auto image = std::make_shared<const ProgramImage>(contents.data(), contents.size(), 0);
+		for (std::size_t page = 0; page < pageCount; page++)
+		{
+			if (isPrivatePage(page))
+			{
+				mPages[page] = image->page(page);
+			}
+		}
+		mImages.push_back(std::move(image));
+	}
+
+	uint64_t pageHash(uint8_t page)
+	{
+		// hash of one guest page's contents
+		memoryHash();
+		return mHashTree[pageCount + page];
+	}
+
+	uint64_t memoryHash()
+	{
+		// root of a Merkle tree over the page hashes. Only pages written or remapped since the last call, and
+		// the nodes above them, are hashed again, so hashing every few thousand instructions costs little more
+		// than the pages the guest actually wrote. Pages mapped with mapSharedPage() or handed to the host with
+		// exposePage() can change behind this CPU's back and are hashed on every call
+		std::size_t changed = 0;
+		uint8_t changedPages[pageCount];
+		for (std::size_t word = 0; word < pageCount / 64; word++)
+		{
+			uint64_t dirty = mHashDirty[word] | mHashShared[word] | mHashExposed[word];
+			mHashDirty[word] = 0;
+			while (dirty)
+			{
+				std::size_t page = word * 64 + std::countr_zero(dirty);
+				dirty &= dirty - 1;
+				uint64_t hash = hashPage(mPages[page]);
+				if (hash != mHashTree[pageCount + page])
+				{
+					mHashTree[pageCount + page] = hash;
+					changedPages[changed++] = static_cast<uint8_t>(page);
+				}
+			}
+		}
+
+		if (!mHashTreeBuilt || changed > pageCount / 8)
+		{
+			// children are stored behind their parents, so walking down the indices rebuilds bottom up
+			for (std::size_t node = pageCount - 1; node >= 1; node--)
+			{
+				mHashTree[node] = combineHash(mHashTree[2 * node], mHashTree[2 * node + 1]);
+			}
+			mHashTreeBuilt = true;
+			return mHashTree[1];
+		}
+		for (std::size_t i = 0; i < changed; i++)
+		{
+			for (std::size_t node = (pageCount + changedPages[i]) / 2; node >= 1; node /= 2)
+			{
+				mHashTree[node] = combineHash(mHashTree[2 * node], mHashTree[2 * node + 1]);
+			}
+		}
+		return mHashTree[1];
+	}
+
+	uint64_t stateHash()
+	{
+		// architectural state: memory plus registers and flags; the cycle count is left out so that cores
+		// which count cycles differently still agree
+		uint8_t status = C | (Z << 1) | (I << 2) | (D << 3) | (B << 4) | (V << 6) | (N << 7);
+		uint64_t registers = static_cast<uint64_t>(mAccumulator) | (static_cast<uint64_t>(mRegisterX) << 8)
+			| (static_cast<uint64_t>(mRegisterY) << 16) | (static_cast<uint64_t>(mStackPointer) << 24)
+			| (static_cast<uint64_t>(mProgramCounter) << 32) | (static_cast<uint64_t>(status) << 48);
+		return combineHash(memoryHash(), registers);
+	}
+
+	std::vector<uint8_t> differingPages(MOS6502& other)
+	{
+		// pages whose contents differ from other's, found by descending only into subtrees whose hashes differ
+		std::vector<uint8_t> pages;
+		if (memoryHash() == other.memoryHash())
+		{
+			return pages;
+		}
+		std::vector<std::size_t> pending = { 1 };
+		while (!pending.empty())
+		{
+			std::size_t node = pending.back();
+			pending.pop_back();
+			if (mHashTree[node] == other.mHashTree[node]) { continue; }
+			if (node >= pageCount)
+			{
+				pages.push_back(static_cast<uint8_t>(node - pageCount));
+				continue;
+			}
+			pending.push_back(2 * node + 1);
+			pending.push_back(2 * node);
+		}
+		return pages;
+	}
+
+	void copyMemory(uint16_t addr, uint8_t* out, std::size_t size) const
+	{
+		// size bytes from addr on, wrapping at $FFFF; bypasses watchpoints and profiling like peek()
+		while (size > 0)
+		{
+			std::size_t chunk = std::min(size, pageSize - (addr & 0xFF));
+			memcpy(out, mPages[addr >> 8] + (addr & 0xFF), chunk);
+			out += chunk;
+			size -= chunk;
+			addr = static_cast<uint16_t>(addr + chunk);
+		}
+	}
+
+	void printMemory(uint16_t first = 0, std::size_t size = sizeof(mMemory))
+	{
+		// hexdump, see MemoryDump::formatHex(); repeated lines such as untouched memory are collapsed
+		size = std::min(size, sizeof(mMemory) - first);
+		std::vector<uint8_t> bytes(size);
+		copyMemory(first, bytes.data(), size);
+		MemoryDump::printHex(std::cout, bytes.data(), size, first);
+	}
+
+protected:
+	// what every step() touches starts on a cache line of its own: registers, flags and the counters; the
+	// 64 KiB of guest memory comes last, so the hot state stays on the first pages of the object. Only the
+	// first field is aligned, alignas on a declaration with several names would align each of them
+	alignas(64) uint8_t mAccumulator;
+	uint8_t mRegisterX, mRegisterY;
+	uint16_t mProgramCounter;
+	uint8_t mStackPointer;
+	uint8_t C, Z, I, D, B, V, N;
+	uint64_t mCycles = 0;
+	uint64_t mInstructions = 0;
+
+	static constexpr uint16_t stackOffset = 0x100;
+	static constexpr uint16_t resetVector = 0xFFFE;
+	static constexpr uint16_t irqVector = 0xFFFE;
+	static constexpr std::size_t pageSize = ProgramImage::pageSize;
+	static constexpr std::size_t pageCount = 256;
+	static constexpr uint8_t blankPage[pageSize] = {};
+
+	// guest page -> backing bytes, either the page in mMemory or a read-only page shared with other instances
+	const uint8_t* mPages[pageCount];
+	std::vector<std::shared_ptr<const ProgramImage>> mImages;
+	MemoryProfile* mProfile = nullptr; // not owned, not carried over to copies
+	CallStack* mCallStack = nullptr;   // the same
+	AccessObserver* mObserver = nullptr;
+	uint8_t* mSharedPages[pageCount] = {};
+	uint64_t mInterrupts = 0;
+
+	// state hashing, see memoryHash(); one bit per page in the masks
+	uint64_t mHashTree[2 * pageCount] = {};   // heap order, node 1 is the root and pages are the leaves
+	uint64_t mHashDirty[pageCount / 64] = { ~0ULL, ~0ULL, ~0ULL, ~0ULL };
+	uint64_t mHashShared[pageCount / 64] = {};
+	uint64_t mHashExposed[pageCount / 64] = {};
+	bool mHashTreeBuilt = false;
+
+	// host functions are configuration rather than debugger state, copies keep them
+	std::vector<HostFunction> mHypercalls;
+	std::unordered_map<uint16_t, HostFunction> mHooks;
+	bool mHostCallsEnabled = true;
+	uint8_t* mCoverage = nullptr;
+	std::size_t mCoverageMask = 0;
+	CodeCoverage* mCodeCoverage = nullptr;
+
+	// breakpoints and watchpoints are debugger state and are not carried over to copies either;
+	// mTrapPages keeps pages without any trap on the plain fast path
+	uint8_t mTrapPages[pageCount];
+	std::vector<bool> mBreakpoints;     // sized on the first breakpoint
+	std::vector<Watchpoint> mWatchpoints;
+	std::vector<bool> mWatchpointActive;
+	bool mWatchpointHit = false;
+	TrapHit mTrapHit = { STOP_NONE, 0, 0, 0, -1 };
+	int32_t mResumeOver = -1;           // breakpoint to step over, valid while no instruction ran since
+	uint64_t mResumeInstructions = 0;
+	uint16_t mInstructionStart = 0;
+
+	alignas(64) uint8_t mMemory[65536];
+
+	static constexpr bool isControlFlow(uint8_t opcode)
+	{
+		return instructionTable[opcode].mode == REL || opcode == JMPAbs || opcode == JMPInd || opcode == JSRAbs
+			|| opcode == RTS || opcode == RTI || opcode == BRK;
+	}
+
+	static constexpr uint64_t mixHash(uint64_t value)
+	{
+		value ^= value >> 33;
+		value *= 0xFF51AFD7ED558CCDULL;
+		value ^= value >> 33;
+		value *= 0xC4CEB9FE1A85EC53ULL;
+		return value ^ (value >> 33);
+	}
+
+	static constexpr uint64_t combineHash(uint64_t left, uint64_t right)
+	{
+		return mixHash(left ^ mixHash(right + 0x9E3779B97F4A7C15ULL));
+	}
+
+	static uint64_t hashPage(const uint8_t* bytes)
+	{
+		// eight bytes at a time, little endian so hashes compare across hosts
+		uint64_t hash = 0;
+		for (std::size_t i = 0; i < pageSize; i += 8)
+		{
+			uint64_t word;
+			memcpy(&word, bytes + i, sizeof(word));
+			if constexpr (std::endian::native == std::endian::big)
+			{
+				word = 0;
+				for (std::size_t b = 0; b < 8; b++)
+				{
+					word |= static_cast<uint64_t>(bytes[i + b]) << (8 * b);
+				}
+			}
+			hash = (hash ^ word) * 0x9E3779B97F4A7C15ULL;
+			hash ^= hash >> 29;
+		}
+		return mixHash(hash);
+	}
+
+	uint8_t peek(uint16_t addr) const
+	{
+		return mPages[addr >> 8][addr & 0xFF];
+	}
+
+	void poke(uint16_t addr, uint8_t value)
+	{
+		writablePage(addr >> 8)[addr & 0xFF] = value;
+	}
+
+	uint8_t read(uint16_t addr)
+	{
+		if (mProfile) { mProfile->record(MemoryProfile::Read, addr); }
+		uint8_t traps = mTrapPages[addr >> 8];
+		uint8_t value = (traps & PAGE_ATOMIC)
+			? std::atomic_ref<uint8_t>(mSharedPages[addr >> 8][addr & 0xFF]).load(std::memory_order_acquire)
+			: peek(addr);
+		if (traps & TRAP_READ) { checkWatchpoints(TRAP_READ, addr, value); }
+		if (mObserver) { mObserver->observe(MemoryProfile::Read, addr, value); }
+		return value;
+	}
+
+	void write(uint16_t addr, uint8_t value)
+	{
+		if (mProfile) { mProfile->record(MemoryProfile::Write, addr); }
+		if (mObserver) { mObserver->observe(MemoryProfile::Write, addr, value); }
+		uint8_t traps = mTrapPages[addr >> 8];
+		if (traps & TRAP_WRITE) { checkWatchpoints(TRAP_WRITE, addr, value); }
+		if (traps & PAGE_ATOMIC)
+		{
+			std::atomic_ref<uint8_t>(mSharedPages[addr >> 8][addr & 0xFF]).store(value, std::memory_order_release);
+			return;
+		}
+		writablePage(addr >> 8)[addr & 0xFF] = value;
+	}
+
+	void checkWatchpoints(uint8_t kind, uint16_t addr, uint8_t value)
+	{
+		for (std::size_t i = 0; i < mWatchpoints.size(); i++)
+		{
+			const Watchpoint& watch = mWatchpoints[i];
+			if (mWatchpointActive[i] && (watch.kinds & kind) && addr >= watch.first && addr <= watch.last
+				&& (!watch.matchValue || watch.value == value)
+				&& mInstructionStart >= watch.pcFirst && mInstructionStart <= watch.pcLast)
+			{
+				mTrapHit = { STOP_WATCHPOINT, mInstructionStart, addr, value, static_cast<int>(i) };
+				mWatchpointHit = true;
+				return;
+			}
+		}
+	}
+
+	void rebuildTrapPages()
+	{
+		for (std::size_t page = 0; page < pageCount; page++)
+		{
+			mTrapPages[page] &= PAGE_ATOMIC;
+		}
+		for (const auto& hook : mHooks)
+		{
+			mTrapPages[hook.first >> 8] |= PAGE_HOOK;
+		}
+		for (std::size_t addr = 0; addr < mBreakpoints.size(); addr++)
+		{
+			if (mBreakpoints[addr]) { mTrapPages[addr >> 8] |= TRAP_EXECUTE; }
+		}
+		for (std::size_t i = 0; i < mWatchpoints.size(); i++)
+		{
+			if (!mWatchpointActive[i]) { continue; }
+			for (std::size_t page = mWatchpoints[i].first >> 8; page <= (std::size_t)(mWatchpoints[i].last >> 8); page++)
+			{
+				mTrapPages[page] |= mWatchpoints[i].kinds;
+			}
+		}
+	}
+
+	HostResult callHost(const HostFunction& function)
+	{
+		Host host(*this);
+		HostResult result = function(host);
+		if (ISDEBUG && result != HOST_EMULATE)
+		{
+			std::cout << std::hex << std::setw(4) << std::setfill('0') << mInstructionStart << std::setfill(' ') << "\t(host)";
+			printRegisterInfo();
+		}
+		return result;
+	}
+
+	StopReason hostReturned()
+	{
+		if (mWatchpointHit)
+		{
+			mWatchpointHit = false;
+			return STOP_WATCHPOINT;
+		}
+		return STOP_NONE;
+	}
+
+	bool isPrivatePage(std::size_t page) const
+	{
+		return mPages[page] == mMemory + page * pageSize;
+	}
+
+	void unshare(std::size_t page)
+	{
+		// a page loaded or mapped over stops being a shared page; bytes of it that are not overwritten keep
+		// the shared memory's current contents, copied into the CPU's own memory on the first write
+		if (!mSharedPages[page]) { return; }
+		mSharedPages[page] = nullptr;
+		mHashShared[page / 64] &= ~(1ULL << (page % 64));
+		mHashDirty[page / 64] |= 1ULL << (page % 64);
+		mTrapPages[page] &= ~PAGE_ATOMIC;
+	}
+
+	uint8_t* writablePage(std::size_t page)
+	{
+		uint8_t* own = mMemory + page * pageSize;
+		mHashDirty[page / 64] |= 1ULL << (page % 64);
+		if (mPages[page] != own)
+		{
+			if (mSharedPages[page]) { return mSharedPages[page]; }
+			memcpy(own, mPages[page], pageSize);
+			mPages[page] = own;
+		}
+		return own;
+	}
+
+	uint8_t* exposePage(std::size_t page)
+	{
+		// the page's memory for the host to write at any time, without telling the CPU; the page is hashed
+		// on every memoryHash() from now on, also after it is loaded or mapped over
+		mHashExposed[page / 64] |= 1ULL << (page % 64);
+		return writablePage(page);
+	}
+
+	void copyFrom(const MOS6502& other)
+	{
+		// shared pages stay shared, only the pages other has written to are copied
+		ISDEBUG = other.ISDEBUG;
+		mAccumulator = other.mAccumulator;
+		mRegisterX = other.mRegisterX;
+		mRegisterY = other.mRegisterY;
+		mProgramCounter = other.mProgramCounter;
+		mStackPointer = other.mStackPointer;
+		C = other.C; Z = other.Z; I = other.I; D = other.D; B = other.B; V = other.V; N = other.N;
+		mCycles = other.mCycles;
+		mInstructions = other.mInstructions;
+		mInterrupts = other.mInterrupts;
+		mHypercalls = other.mHypercalls;
+		mHooks = other.mHooks;
+		mHostCallsEnabled = other.mHostCallsEnabled;
+		mCoverage = other.mCoverage;
+		mCoverageMask = other.mCoverageMask;
+		mCodeCoverage = other.mCodeCoverage;
+		mImages = other.mImages;
+		// the pages end up with other's contents, so other's hashes stay valid
+		memcpy(mHashTree, other.mHashTree, sizeof(mHashTree));
+		memcpy(mHashDirty, other.mHashDirty, sizeof(mHashDirty));
+		memcpy(mHashShared, other.mHashShared, sizeof(mHashShared));
+		for (std::size_t word = 0; word < pageCount / 64; word++)
+		{
+			// other's exposed pages may have changed since it last hashed them; the copies are not exposed
+			mHashDirty[word] |= other.mHashExposed[word];
+		}
+		mHashTreeBuilt = other.mHashTreeBuilt;
+		for (std::size_t page = 0; page < pageCount; page++)
+		{
+			if (other.isPrivatePage(page))
+			{
+				memcpy(mMemory + page * pageSize, other.mMemory + page * pageSize, pageSize);
+				mPages[page] = mMemory + page * pageSize;
+			}
+			else
+			{
+				mPages[page] = other.mPages[page];
+			}
+			mSharedPages[page] = other.mSharedPages[page];
+			mTrapPages[page] = (mTrapPages[page] & ~(PAGE_ATOMIC | PAGE_HOOK)) | (other.mTrapPages[page] & (PAGE_ATOMIC | PAGE_HOOK));
+		}
+	}
+
+	bool executeOpcode(OpCode opcode)
+	{
+		if (ISDEBUG)
+		{
+			// fetch already performed before, so the instruction starts at PC - 1
+			printInstruction(mProgramCounter - 1);
+		}
+		switch (opcode)
+		{
+		case JMPAbs:
+			mProgramCounter = jumpAbsolute();
+			break;
+		case JMPInd:
+			mProgramCounter = jumpIndirect();
+			break;
+		case JSRAbs:
+			mProgramCounter = jumpAbsoluteSavingAddress();
+			break;
+
+			//LOAD OPERATIONS
+
+		case LDAIndX:
+			mAccumulator = loadIndirectX();
+			setZeroAndNegativeFlags(mAccumulator);
+			break;
+		case LDAZeroP:
+			mAccumulator = loadZeroPage();
+			setZeroAndNegativeFlags(mAccumulator);
+			break;
+		case LDAImmediate:
+			mAccumulator = loadImmediate();
+			setZeroAndNegativeFlags(mAccumulator);
+			break;
+		case LDAAbs:
+			mAccumulator = loadAbsolute();
+			setZeroAndNegativeFlags(mAccumulator);
+			break;
+		case LDAIndY:
+			mAccumulator = loadIndirectY();
+			setZeroAndNegativeFlags(mAccumulator);
+			break;
+		case LDAZeroPX:
+			mAccumulator = loadZeroPageX();
+			setZeroAndNegativeFlags(mAccumulator);
+			break;
+		case LDAAbsY:
+			mAccumulator = loadAbsoluteY();
+			setZeroAndNegativeFlags(mAccumulator);
+			break;
+		case LDAAbsX:
+			mAccumulator = loadAbsoluteX();
+			setZeroAndNegativeFlags(mAccumulator);
+			break;
+
+		case LDXAbsY:
+			mRegisterX = loadAbsoluteY();
+			setZeroAndNegativeFlags(mRegisterX);
+			break;
+		case LDXZeroP:
+			mRegisterX = loadZeroPage();
+			setZeroAndNegativeFlags(mRegisterX);
+			break;
+		case LDXZeroPY:
+			mRegisterX = loadZeroPageY();
+			setZeroAndNegativeFlags(mRegisterX);
+			break;
+		case LDXAbs:
+			mRegisterX = loadAbsolute();
+			setZeroAndNegativeFlags(mRegisterX);
+			break;
+		case LDXImmediate:
+			mRegisterX = loadImmediate();
+			setZeroAndNegativeFlags(mRegisterX);
+			break;
+
+		case LDYAbsX:
+			mRegisterY = loadAbsoluteX();
+			setZeroAndNegativeFlags(mRegisterY);
+			break;
+		case LDYZeroP:
+			mRegisterY = loadZeroPage();
+			setZeroAndNegativeFlags(mRegisterY);
+			break;
+		case LDYZeroPX:
+			mRegisterY = loadZeroPageX();
+			setZeroAndNegativeFlags(mRegisterY);
+			break;
+		case LDYAbs:
+			mRegisterY = loadAbsolute();
+			setZeroAndNegativeFlags(mRegisterY);
+			break;
+		case LDYImmediate:
+			mRegisterY = loadImmediate();
+			setZeroAndNegativeFlags(mRegisterY);
+			break;
+
+			//SAVE OPERATIONS
+
+		case STAZeroP:
+			saveZeroPage(mAccumulator);
+			break;
+		case STAZeroPX:
+			saveZeroPageX(mAccumulator);
+			break;
+		case STAAbs:
+			saveAbsolute(mAccumulator);
+			break;
+		case STAAbsX:
+			saveAbsoluteX(mAccumulator);
+			break;
+		case STAAbsY:
+			saveAbsoluteY(mAccumulator);
+			break;
+		case STAIndX:
+			saveIndirectX(mAccumulator);
+			break;
+		case STAIndY:
+			saveIndirectY(mAccumulator);
+			break;
+
+
+		case STXZeroP:
+			saveZeroPage(mRegisterX);
+			break;
+		case STXZeroPY:
+			saveZeroPageY(mRegisterX);
+			break;
+		case STXAbs:
+			saveAbsolute(mRegisterX);
+			break;
+
+
+		case STYZeroP:
+			saveZeroPage(mRegisterY);
+			break;
+		case STYZeroPX:
+			saveZeroPageX(mRegisterY);
+			break;
+		case STYAbs:
+			saveAbsolute(mRegisterY);
+			break;
+
+			//INCREMENT AND DECREMENT
+
+		case INY:
+			mRegisterY++;
+			setZeroAndNegativeFlags(mRegisterY);
+			break;
+		case INX:
+			mRegisterX++;
+			setZeroAndNegativeFlags(mRegisterX);
+			break;
+		case INCZeroP:
+			incrementZeroPage();
+			break;
+		case INCZeroPX:
+			incrementZeroPageX();
+			break;
+		case INCAbs:
+			incrementAbsolute();
+			break;
+		case INCAbsX:
+			incrementAbsoluteX();
+			break;
+
+		case DEX:
+			mRegisterX--;
+			setZeroAndNegativeFlags(mRegisterX);
+			break;
+		case DEY:
+			mRegisterY--;
+			setZeroAndNegativeFlags(mRegisterY);
+			break;
+		case DECZeroP:
+			decrementZeroPage();
+			break;
+		case DECZeroPX:
+			decrementZeroPageX();
+			break;
+		case DECAbs:
+			decrementAbsolute();
+			break;
+		case DECAbsX:
+			decrementAbsoluteX();
+			break;
+
+			//FLAG OPERATIONS
+
+		case CLC:
+			C = 0;
+			break;
+		case CLD:
+			D = 0;
+			break;
+		case CLI:
+			I = 0;
+			break;
+		case CLV:
+			V = 0;
+			break;
+		case SEC:
+			C = 1;
+			break;
+		case SEI:
+			I = 1;
+			break;
+		case SED:
+			D = 1;
+			break;
+
+			//LOGICAL AND ARITHMETICAL OPERATIONS
+
+		case ORAImmediate:                        //or with memory or accumulator
+			orWithMemoryOrAccImmediate();
+			break;
+		case ORAZeroP:
+			orWithMemoryOrAccZeroP();
+			break;
+		case ORAZeroPX:
+			orWithMemoryOrAccZeroPX();
+			break;
+		case ORAAbs:
+			orWithMemoryOrAccAbs();
+			break;
+		case ORAAbsX:
+			orWithMemoryOrAccAbsX();
+			break;
+		case ORAAbsY:
+			orWithMemoryOrAccAbsY();
+			break;
+		case ORAIndX:
+			orWithMemoryOrAccIndX();
+			break;
+		case ORAIndY:
+			orWithMemoryOrAccIndY();
+			break;
+
+		case EORImmediate:                        //xor with memory or accumulator
+			xorWithMemoryOrAccImmediate();
+			break;
+		case EORZeroP:
+			xorWithMemoryOrAccZeroP();
+			break;
+		case EORZeroPX:
+			xorWithMemoryOrAccZeroPX();
+			break;
+		case EORAbs:
+			xorWithMemoryOrAccAbs();
+			break;
+		case EORAbsX:
+			xorWithMemoryOrAccAbsX();
+			break;
+		case EORAbsY:
+			xorWithMemoryOrAccAbsY();
+			break;
+		case EORIndX:
+			xorWithMemoryOrAccIndX();
+			break;
+		case EORIndY:
+			xorWithMemoryOrAccIndY();
+			break;
+
+
+		case ANDImmediate:
+			andWithMemoryOrAccImmediate();
+			break;
+		case ANDZeroP:
+			andWithMemoryOrAccZeroP();
+			break;
+		case ANDZeroPX:
+			andWithMemoryOrAccZeroPX();
+			break;
+		case ANDAbs:
+			andWithMemoryOrAccAbs();
+			break;
+		case ANDAbsX:
+			andWithMemoryOrAccAbsX();
+			break;
+		case ANDAbsY:
+			andWithMemoryOrAccAbsY();
+			break;
+		case ANDIndX:
+			andWithMemoryOrAccIndX();
+			break;
+		case ANDIndY:
+			andWithMemoryOrAccIndY();
+			break;
+
+
+		case ADCImmediate:
+			adcWithMemoryOrAccImmediate();
+			break;
+		case ADCZeroP:
+			adcWithMemoryOrAccZeroP();
+			break;
+		case ADCZeroPX:
+			adcWithMemoryOrAccZeroPX();
+			break;
+		case ADCAbs:
+			adcWithMemoryOrAccAbs();
+			break;
+		case ADCAbsX:
+			adcWithMemoryOrAccAbsX();
+			break;
+		case ADCAbsY:
+			adcWithMemoryOrAccAbsY();
+			break;
+		case ADCIndX:
+			adcWithMemoryOrAccIndX();
+			break;
+		case ADCIndY:
+			adcWithMemoryOrAccIndY();
+			break;
+
+		case SBCImmediate:
+			sbcWithMemoryOrAccImmediate();
+			break;
+		case SBCZeroP:
+			sbcWithMemoryOrAccZeroP();
+			break;
+		case SBCZeroPX:
+			sbcWithMemoryOrAccZeroPX();
+			break;
+		case SBCAbs:
+			sbcWithMemoryOrAccAbs();
+			break;
+		case SBCAbsX:
+			sbcWithMemoryOrAccAbsX();
+			break;
+		case SBCAbsY:
+			sbcWithMemoryOrAccAbsY();
+			break;
+		case SBCIndX:
+			sbcWithMemoryOrAccIndX();
+			break;
+		case SBCIndY:
+			sbcWithMemoryOrAccIndY();
+			break;
+
+
+		case RORAcc:
+			rotateRightAccumulator();
+			break;
+		case RORZeroP:
+			rotateRightZeroPage();
+			break;
+		case RORZeroPX:
+			rotateRightZeroPageX();
+			break;
+		case RORAbs:
+			rotateRightAbsolute();
+			break;
+		case RORAbsX:
+			rotateRightAbsoluteX();
+			break;
+
+		case ROLAcc:
+			rotateLeftAccumulator();
+			break;
+		case ROLZeroP:
+			rotateLeftZeroPage();
+			break;
+		case ROLZeroPX:
+			rotateLeftZeroPageX();
+			break;
+		case ROLAbs:
+			rotateLeftAbsolute();
+			break;
+		case ROLAbsX:
+			rotateLeftAbsoluteX();
+			break;
+
+		case LSRAcc:
+			shiftRightAccumulator();
+			break;
+		case LSRZeroP:
+			shiftRightZeroPage();
+			break;
+		case LSRZeroPX:
+			shiftRightZeroPageX();
+			break;
+		case LSRAbs:
+			shiftRightAbsolute();
+			break;
+		case LSRAbsX:
+			shiftRightAbsoluteX();
+			break;
+
+		case ASLAcc:
+			shiftLeftAccumulator();
+			break;
+		case ASLZeroP:
+			shiftLeftZeroPage();
+			break;
+		case ASLZeroPX:
+			shiftLeftZeroPageX();
+			break;
+		case ASLAbs:
+			shiftLeftAbsolute();
+			break;
+		case ASLAbsX:
+			shiftLeftAbsoluteX();
+			break;
+
+			//TRANSFER OPERATIONS
+
+		case TAX:
+			transferAccToX();
+			break;
+		case TAY:
+			transferAccToY();
+			break;
+		case TSX:
+			transferStackToX();
+			break;
+		case TYA:
+			transferYToAcc();
+			break;
+		case TXA:
+			transferXToAcc();
+			break;
+		case TXS:
+			transferXToStack();
+			break;
+
+			//BRANCHING OPERATIONS
+
+		case BNE:
+			branchNonZero();
+			break;
+		case BCS:
+			branchCarrySet();
+			break;
+		case BCC:
+			branchCarryClear();
+			break;
+		case BEQ:
+			branchZero();
+			break;
+		case BMI:
+			branchMinus();
+			break;
+		case BPL:
+			branchPlus();
+			break;
+		case BVC:
+			branchOverflowClear();
+			break;
+		case BVS:
+			branchOverflowSet();
+			break;
+
+			//COMPARE OPERATIONS
+
+		case CPXImmediate:
+			compareImmediate(mRegisterX);
+			break;
+		case CPXAbs:
+			compareAbsolute(mRegisterX);
+			break;
+		case CPXZeroP:
+			compareZeroPage(mRegisterX);
+			break;
+
+		case CPYImmediate:
+			compareImmediate(mRegisterY);
+			break;
+		case CPYAbs:
+			compareAbsolute(mRegisterY);
+			break;
+		case CPYZeroP:
+			compareZeroPage(mRegisterY);
+			break;
+
+		case CMPImmediate:
+			compareImmediate(mAccumulator);
+			break;
+		case CMPZeroP:
+			compareZeroPage(mAccumulator);
+			break;
+		case CMPZeroPX:
+			compareZeroPageX(mAccumulator);
+			break;
+		case CMPAbs:
+			compareAbsolute(mAccumulator);
+			break;
+		case CMPAbsX:
+			compareAbsoluteX(mAccumulator);
+			break;
+		case CMPAbsY:
+			compareAbsoluteY(mAccumulator);
+			break;
+		case CMPIndX:
+			compareIndX(mAccumulator);
+			break;
+		case CMPIndY:
+			compareIndY(mAccumulator);
+			break;
+
+
+		case BITAbs:
+			bitTestAbsolute();
+			break;
+		case BITZeroP:
+			bitTestZeroPage();
+			break;
+
+			//MISCELANNEOUS OPERATIONS
+		case BRK:
+			breakCPU();          //Its Breaking Bad time!
+			break;
+		case RTI:
+			returnFromInterrupt();
+			break;
+		case RTS:
+			returnFromSubroutine();
+			break;
+		case PLP:
+			pullStatusFromStack();
+			break;
+		case PHA:
+			pushAccToStack();
+			break;
+		case PLA:
+			pullAccFromStack();
+			break;
+		case PHP:
+			pushStatusToStack();
+			break;
+		case NOP:
+			break;
+		default:
+			return false;
+		}
+		if (ISDEBUG)
+		{
+			printRegisterInfo();
+		}
+
+		return true;
+	}
+
+	// instruction helpers; protected so that RecompiledCpu can run translated code with the same semantics
+
+	uint8_t fetch()
+	{
+		uint8_t data = peek(mProgramCounter);
+		if (mProfile) { mProfile->record(MemoryProfile::Execute, mProgramCounter); }
+		if (mObserver) { mObserver->observe(MemoryProfile::Execute, mProgramCounter, data); }
+		mProgramCounter++;
+		return data;
+	}
+
+	uint16_t fetch16()
+	{
+		uint8_t low = fetch();
+		return low | (fetch() << 8);
+	}
+
+	uint16_t readPointer(uint8_t zeroPage)
+	{
+		// the high byte of a pointer at $FF comes from $00, indexed indirect modes never leave page zero
+		uint8_t low = read(zeroPage);
+		return low | (read(static_cast<uint8_t>(zeroPage + 1)) << 8);
+	}
+
+	void printInstruction(uint16_t pc)
+	{
+		uint8_t bytes[3] = { peek(pc), peek(pc + 1), peek(pc + 2) };
+		char text[8 + Disassembler::maxInstructionText];
+		char* end = text;
+		for (int shift = 12; shift >= 0; shift -= 4)
+		{
+			*end++ = "0123456789abcdef"[(pc >> shift) & 0xF];
+		}
+		*end++ = '\t';
+		end += Disassembler::formatInstruction(bytes, sizeof(bytes), pc, end);
+		std::cout.write(text, end - text);
+	}
+
+	void printRegisterInfo()
+	{
+		std::cout << std::hex << "\t" << ";"
+			<< std::setfill('0')
+			<< " A:" << std::setw(2) << (unsigned int)mAccumulator
+			<< " X:" << std::setw(2) << (unsigned int)mRegisterX
+			<< " Y:" << std::setw(2) << (unsigned int)mRegisterY
+			<< " ST: CZIDBVN " << std::setw(1) << (int)C << (int)Z << (int)I << (int)D << (int)B << (int)V << (int)N
+			<< " PC:" << std::setw(4) << (uint16_t)mProgramCounter
+			<< " SP:" << std::setw(2) << (int)mStackPointer
+			<< std::setw(0) << std::setfill(' ')
+			<< "\n";
+	}
+
+	void breakCPU()
+	{
+		// BRK skips a padding byte, pushes the return address and the flags with B set, and continues at the
+		// IRQ/BRK vector with interrupts disabled
+		uint16_t returnAddress = mProgramCounter + 1;
+		write(stackOffset + mStackPointer, returnAddress >> 8);
+		mStackPointer--;
+		write(stackOffset + mStackPointer, returnAddress & 0xFF);
+		mStackPointer--;
+		pushStatusToStack();
+		I = 1;
+		mInterrupts++;
+		uint8_t low = read(irqVector);
+		mProgramCounter = low | (read(irqVector + 1) << 8);
+	}
+
+
+
+	void incrementZeroPage()
+	{
+		uint8_t addr = fetch();
+		uint8_t value = read(addr) + 1;
+		write(addr, value);
+		setZeroAndNegativeFlags(value);
+	}
+
+	void incrementZeroPageX()
+	{
+		uint8_t addr = fetch() + mRegisterX;
+		uint8_t value = read(addr) + 1;
+		write(addr, value);
+		setZeroAndNegativeFlags(value);
+	}
+
+	void incrementAbsoluteX()
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr + mRegisterX) + 1;
+		write(addr + mRegisterX, value);
+		setZeroAndNegativeFlags(value);
+	}
+
+	void incrementAbsolute()
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr) + 1;
+		write(addr, value);
+		setZeroAndNegativeFlags(value);
+	}
+
+
+	void decrementZeroPage()
+	{
+		uint8_t addr = fetch();
+		uint8_t value = read(addr) - 1;
+		write(addr, value);
+		setZeroAndNegativeFlags(value);
+	}
+
+	void decrementZeroPageX()
+	{
+		uint8_t addr = fetch() + mRegisterX;
+		uint8_t value = read(addr) - 1;
+		write(addr, value);
+		setZeroAndNegativeFlags(value);
+	}
+
+	void decrementAbsoluteX()
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr + mRegisterX) - 1;
+		write(addr + mRegisterX, value);
+		setZeroAndNegativeFlags(value);
+	}
+
+	void decrementAbsolute()
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr) - 1;
+		write(addr, value);
+		setZeroAndNegativeFlags(value);
+	}
+
+
+	uint8_t rotateright(uint8_t value)
+	{
+		uint8_t resultingvalue = (value >> 1) | (C ? 0x80 : 0); //I rotate the entered value by 1 position right, replacing the left-most bit of the ROTATED VALUE with carry (either 1 or 0)
+		C = value & 0x1;                                      //I store the bit that disappears due to shifting of the number in the carry flag
+		setZeroAndNegativeFlags(resultingvalue);              //I also set the correct flags if the resulting value after shifting appears to be zero or negative
+		return resultingvalue;                                //I return the value
+	}
+
+	uint8_t rotateleft(uint8_t value)
+	{
+		uint8_t resultingvalue = (value << 1) | (C ? 1 : 0);  //I rotate the entered value 1 position left, replacing the right-most bit of the ROTATED VALUE with value of carry
+		C = (value & 0x80) != 0;                              //I store the left-most bit that disappears due to shifting into carry flag
+		setZeroAndNegativeFlags(resultingvalue);              //I check if the value is negative or zero
+		return resultingvalue;                                //I return the value
+	}
+
+	uint8_t shiftleft(uint8_t value)
+	{
+		uint8_t resultingvalue = value << 1;                  //I rotate the entered value 1 position left, replacing the right-most bit of the ROTATED VALUE with 0
+		C = (value & 0x80) != 0;                              //I store the left-most bit that disappears due to shifting into carry flag
+		setZeroAndNegativeFlags(resultingvalue);              //I check if the value is negative or zero
+		return resultingvalue;                                //I return the value
+	}
+
+	uint8_t shifteright(uint8_t value)
+	{
+		uint8_t resultingvalue = value >> 1;                  //I rotate the entered value by 1 position right, replacing the left-most bit of the ROTATED VALUE with 0
+		C = value & 0x1;                                      //I store the bit that disappears due to shifting of the number in the carry flag
+		setZeroAndNegativeFlags(resultingvalue);              //I also set the correct flags if the resulting value after shifting appears to be zero or negative
+		return resultingvalue;                                //I return the value
+	}
+
+
+
+	// NV1BDIZC -> flags register (byte construction)
+	// to add Carry -> directly add 0x01
+	// to add Zero -> directly add 0x02
+	// to add Interrupt disable -> directly add 0x04
+	// to add Decimal -> directly add 0x08
+	// to add Break -> directly add 0x10
+	// to add 5th bit -> directly add 0x20
+	// to add Overflow -> directly add 0x40
+	// to add Negative -> directly add 0x80
+	void pushStatusToStack(bool breakFlag = true)
+	{
+		uint8_t Status = 0x00;
+		Status += (N ? 0x80 : 0);
+		Status += (V ? 0x40 : 0);
+		Status += 0x20;
+		Status += (breakFlag ? 0x10 : 0);
+		Status += (D ? 0x08 : 0);
+		Status += (I ? 0x04 : 0);
+		Status += (Z ? 0x02 : 0);
+		Status += (C ? 0x01 : 0);
+		write(stackOffset + mStackPointer, Status);
+		mStackPointer--;
+	}
+
+	void pullStatusFromStack()
+	{
+		mStackPointer++;
+		uint8_t Status = read(stackOffset + mStackPointer);
+		C = (Status & 0x01) != 0;
+		Z = (Status & 0x02) != 0;
+		I = (Status & 0x04) != 0;
+		D = (Status & 0x08) != 0;
+		V = (Status & 0x40) != 0;
+		N = (Status & 0x80) != 0;
+	}
+
+	void pushAccToStack()
+	{
+		write(stackOffset + mStackPointer, mAccumulator);
+		mStackPointer--;
+	}
+
+	void pullAccFromStack()
+	{
+		mStackPointer++;
+		mAccumulator = read(stackOffset + mStackPointer);
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void returnFromInterrupt()
+	{
+		mStackPointer++;
+		uint8_t Status = read(stackOffset + mStackPointer);
+		C = (Status & 0x01) != 0;
+		Z = (Status & 0x02) != 0;
+		I = (Status & 0x04) != 0;
+		D = (Status & 0x08) != 0;
+		V = (Status & 0x40) != 0;
+		N = (Status & 0x80) != 0;
+		mStackPointer++;
+		uint16_t ProgramCounter = read(stackOffset + mStackPointer);
+		mStackPointer++;
+		ProgramCounter += (read(stackOffset + mStackPointer) << 8);
+		mProgramCounter = ProgramCounter;
+		if (mCallStack) { mCallStack->unwind(mStackPointer); }
+	}
+
+	void returnFromSubroutine()
+	{
+		mStackPointer++;
+		uint16_t ProgramCounter = read(stackOffset + mStackPointer);
+		mStackPointer++;
+		ProgramCounter += (read(stackOffset + mStackPointer) << 8);
+		mProgramCounter = ProgramCounter + 1;
+		if (mCallStack) { mCallStack->unwind(mStackPointer); }
+	}
+
+	void rotateLeftAccumulator()
+	{
+		mAccumulator = rotateleft(mAccumulator);
+	}
+
+	void rotateLeftZeroPage()
+	{
+		uint8_t addr = fetch();                               // ADDR WILL BE NEEDED FOR OUTPUT, NO QUESTIONS ASKED, IT WONT WORK OTHER WAY
+		write(addr, rotateleft(read(addr)));
+	}
+
+	void rotateLeftZeroPageX()
+	{
+		uint8_t addr = fetch() + mRegisterX;
+		write(addr, rotateleft(read(addr)));
+	}
+
+	void rotateLeftAbsoluteX()
+	{
+		uint16_t addr = fetch16();
+		write(addr + mRegisterX, rotateleft(read(addr + mRegisterX)));
+	}
+
+	void rotateLeftAbsolute()
+	{
+		uint16_t addr = fetch16();
+		write(addr, rotateleft(read(addr)));
+	}
+
+
+
+	void shiftLeftAccumulator()
+	{
+		mAccumulator = shiftleft(mAccumulator);
+	}
+
+	void shiftLeftZeroPage()
+	{
+		uint8_t addr = fetch();                               // ADDR WILL BE NEEDED FOR OUTPUT, NO QUESTIONS ASKED, IT WONT WORK OTHER WAY
+		write(addr, shiftleft(read(addr)));
+	}
+
+	void shiftLeftZeroPageX()
+	{
+		uint8_t addr = fetch() + mRegisterX;
+		write(addr, shiftleft(read(addr)));
+	}
+
+	void shiftLeftAbsoluteX()
+	{
+		uint16_t addr = fetch16();
+		write(addr + mRegisterX, shiftleft(read(addr + mRegisterX)));
+	}
+
+	void shiftLeftAbsolute()
+	{
+		uint16_t addr = fetch16();
+		write(addr, shiftleft(read(addr)));
+	}
+
+
+
+	void rotateRightZeroPage()
+	{
+		uint8_t addr = fetch();
+		write(addr, rotateright(read(addr)));
+	}
+
+	void rotateRightAccumulator()
+	{
+		mAccumulator = rotateright(mAccumulator);
+	}
+
+	void rotateRightZeroPageX()
+	{
+		uint8_t addr = fetch() + mRegisterX;
+		write(addr, rotateright(read(addr)));
+	}
+
+	void rotateRightAbsoluteX()
+	{
+		uint16_t addr = fetch16();
+		write(addr + mRegisterX, rotateright(read(addr + mRegisterX)));
+	}
+
+	void rotateRightAbsolute()
+	{
+		uint16_t addr = fetch16();
+		write(addr, rotateright(read(addr)));
+	}
+
+
+
+	void shiftRightZeroPage()
+	{
+		uint8_t addr = fetch();
+		write(addr, shifteright(read(addr)));
+	}
+
+	void shiftRightAccumulator()
+	{
+		mAccumulator = shifteright(mAccumulator);
+	}
+
+	void shiftRightZeroPageX()
+	{
+		uint8_t addr = fetch() + mRegisterX;
+		write(addr, shifteright(read(addr)));
+	}
+
+	void shiftRightAbsoluteX()
+	{
+		uint16_t addr = fetch16();
+		write(addr + mRegisterX, shifteright(read(addr + mRegisterX)));
+	}
+
+	void shiftRightAbsolute()
+	{
+		uint16_t addr = fetch16();
+		write(addr, shifteright(read(addr)));
+	}
+
+
+
+	void transferAccToX()
+	{
+		mRegisterX = mAccumulator;
+		setZeroAndNegativeFlags(mRegisterX);
+	}
+
+	void transferAccToY()
+	{
+		mRegisterY = mAccumulator;
+		setZeroAndNegativeFlags(mRegisterY);
+	}
+
+	void transferStackToX()
+	{
+		mRegisterX = mStackPointer;
+		setZeroAndNegativeFlags(mRegisterX);
+	}
+
+	void transferXToAcc()
+	{
+		mAccumulator = mRegisterX;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void transferYToAcc()
+	{
+		mAccumulator = mRegisterY;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void transferXToStack()
+	{
+		mStackPointer = mRegisterX;
+	}
+
+	uint8_t add(uint8_t valueA, uint8_t valueB, bool carry, bool bcd)
+	{
+		int result = valueA + valueB + (carry ? 1 : 0);
+		Z = (result & 0xFF) == 0;                             // from the binary sum in decimal mode too
+
+		if (!bcd)
+		{
+			C = result > 0xFF;
+			V = ((valueA ^ result) & (valueB ^ result) & 0x80) != 0;
+			N = (result & 0x80) != 0;
+			return static_cast<uint8_t>(result);
+		}
+
+		// decimal mode as on the NMOS 6502: N and V are taken before the high digit is adjusted
+		int low = (valueA & 0x0F) + (valueB & 0x0F) + (carry ? 1 : 0);
+		if (low >= 0x0A)
+		{
+			low = ((low + 0x06) & 0x0F) + 0x10;
+		}
+		result = (valueA & 0xF0) + (valueB & 0xF0) + low;
+		int signedResult = static_cast<int8_t>(valueA & 0xF0) + static_cast<int8_t>(valueB & 0xF0) + low;
+		N = (result & 0x80) != 0;
+		V = signedResult < -128 || signedResult > 127;
+		if (result >= 0xA0)
+		{
+			result += 0x60;
+		}
+		C = result > 0xFF;
+		return static_cast<uint8_t>(result);
+	}
+
+	uint8_t sub(uint8_t valueA, uint8_t valueB, bool carry, bool bcd)
+	{
+		// all flags come from the binary difference, also in decimal mode; carry is the inverted borrow
+		int result = valueA - valueB - (carry ? 0 : 1);
+		C = result >= 0;
+		V = ((valueA ^ valueB) & (valueA ^ result) & 0x80) != 0;
+		Z = (result & 0xFF) == 0;
+		N = (result & 0x80) != 0;
+
+		if (bcd)
+		{
+			int low = (valueA & 0x0F) - (valueB & 0x0F) - (carry ? 0 : 1);
+			if (low < 0)
+			{
+				low = ((low - 0x06) & 0x0F) - 0x10;
+			}
+			result = (valueA & 0xF0) - (valueB & 0xF0) + low;
+			if (result < 0)
+			{
+				result -= 0x60;
+			}
+		}
+		return static_cast<uint8_t>(result);
+	}
+
+	void compareBase(uint8_t valueA, uint8_t valueB)
+	{
+		uint8_t tempVSave = V;
+		uint8_t result = sub(valueA, valueB, true, false);
+		V = tempVSave;
+	}
+
+	//OR WITH MEMORY OR ACCUMULATOR
+
+	void orWithMemoryOrAccImmediate()
+	{
+		uint8_t value = fetch();
+		mAccumulator = value | mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void orWithMemoryOrAccZeroP()
+	{
+		uint8_t addr = fetch();
+		uint8_t value = read(addr);
+		mAccumulator = value | mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void orWithMemoryOrAccZeroPX()
+	{
+		uint8_t addr = fetch() + mRegisterX;
+		uint8_t value = read(addr);
+		mAccumulator = value | mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void orWithMemoryOrAccAbs()
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr);
+		mAccumulator = value | mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void orWithMemoryOrAccAbsX()
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr + mRegisterX);
+		mAccumulator = value | mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void orWithMemoryOrAccAbsY()
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr + mRegisterY);
+		mAccumulator = value | mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void orWithMemoryOrAccIndX()
+	{
+		uint8_t lookupaddress = fetch() + mRegisterX;
+		uint8_t value = read(readPointer(lookupaddress));
+		mAccumulator = value | mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void orWithMemoryOrAccIndY()
+	{
+		uint8_t lookupaddress = fetch();
+		uint8_t value = read(readPointer(lookupaddress) + mRegisterY);
+		mAccumulator = value | mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	//XOR WITH MEMORY OR ACCUMULATOR
+
+	void xorWithMemoryOrAccImmediate()
+	{
+		uint8_t value = fetch();
+		mAccumulator = value ^ mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void xorWithMemoryOrAccZeroP()
+	{
+		uint8_t addr = fetch();
+		uint8_t value = read(addr);
+		mAccumulator = value ^ mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void xorWithMemoryOrAccZeroPX()
+	{
+		uint8_t addr = fetch() + mRegisterX;
+		uint8_t value = read(addr);
+		mAccumulator = value ^ mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void xorWithMemoryOrAccAbs()
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr);
+		mAccumulator = value ^ mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void xorWithMemoryOrAccAbsX()
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr + mRegisterX);
+		mAccumulator = value ^ mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void xorWithMemoryOrAccAbsY()
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr + mRegisterY);
+		mAccumulator = value ^ mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void xorWithMemoryOrAccIndX()
+	{
+		uint8_t lookupaddress = fetch() + mRegisterX;
+		uint8_t value = read(readPointer(lookupaddress));
+		mAccumulator = value ^ mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void xorWithMemoryOrAccIndY()
+	{
+		uint8_t lookupaddress = fetch();
+		uint8_t value = read(readPointer(lookupaddress) + mRegisterY);
+		mAccumulator = value ^ mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	// AND WITH MEMORY OR ACCUMULATOR
+
+	void andWithMemoryOrAccImmediate()
+	{
+		uint8_t value = fetch();
+		mAccumulator = value & mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void andWithMemoryOrAccZeroP()
+	{
+		uint8_t addr = fetch();
+		uint8_t value = read(addr);
+		mAccumulator = value & mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void andWithMemoryOrAccZeroPX()
+	{
+		uint8_t addr = fetch() + mRegisterX;
+		uint8_t value = read(addr);
+		mAccumulator = value & mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void andWithMemoryOrAccAbs()
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr);
+		mAccumulator = value & mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void andWithMemoryOrAccAbsX()
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr + mRegisterX);
+		mAccumulator = value & mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void andWithMemoryOrAccAbsY()
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr + mRegisterY);
+		mAccumulator = value & mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void andWithMemoryOrAccIndX()
+	{
+		uint8_t lookupaddress = fetch() + mRegisterX;
+		uint8_t value = read(readPointer(lookupaddress));
+		mAccumulator = value & mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	void andWithMemoryOrAccIndY()
+	{
+		uint8_t lookupaddress = fetch();
+		uint8_t value = read(readPointer(lookupaddress) + mRegisterY);
+		mAccumulator = value & mAccumulator;
+		setZeroAndNegativeFlags(mAccumulator);
+	}
+
+	//ADC
+
+	void adcWithMemoryOrAccImmediate()
+	{
+		uint8_t value = fetch();
+		mAccumulator = add(value, mAccumulator, C, D);
+	}
+
+	void adcWithMemoryOrAccZeroP()
+	{
+		uint8_t addr = fetch();
+		uint8_t value = read(addr);
+		mAccumulator = add(value, mAccumulator, C, D);
+	}
+
+	void adcWithMemoryOrAccZeroPX()
+	{
+		uint8_t addr = fetch() + mRegisterX;
+		uint8_t value = read(addr);
+		mAccumulator = add(value, mAccumulator, C, D);
+	}
+
+	void adcWithMemoryOrAccAbs()
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr);
+		mAccumulator = add(value, mAccumulator, C, D);
+	}
+
+	void adcWithMemoryOrAccAbsX()
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr + mRegisterX);
+		mAccumulator = add(value, mAccumulator, C, D);
+	}
+
+	void adcWithMemoryOrAccAbsY()
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr + mRegisterY);
+		mAccumulator = add(value, mAccumulator, C, D);
+	}
+
+	void adcWithMemoryOrAccIndX()
+	{
+		uint8_t lookupaddress = fetch() + mRegisterX;
+		uint8_t value = read(readPointer(lookupaddress));
+		mAccumulator = add(value, mAccumulator, C, D);
+	}
+
+	void adcWithMemoryOrAccIndY()
+	{
+		uint8_t lookupaddress = fetch();
+		uint8_t value = read(readPointer(lookupaddress) + mRegisterY);
+		mAccumulator = add(value, mAccumulator, C, D);
+	}
+
+	//SBC
+
+	void sbcWithMemoryOrAccImmediate()
+	{
+		uint8_t value = fetch();
+		mAccumulator = sub(mAccumulator, value, C, D);
+	}
+
+	void sbcWithMemoryOrAccZeroP()
+	{
+		uint8_t addr = fetch();
+		uint8_t value = read(addr);
+		mAccumulator = sub(mAccumulator, value, C, D);
+	}
+
+	void sbcWithMemoryOrAccZeroPX()
+	{
+		uint8_t addr = fetch() + mRegisterX;
+		uint8_t value = read(addr);
+		mAccumulator = sub(mAccumulator, value, C, D);
+	}
+
+	void sbcWithMemoryOrAccAbs()
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr);
+		mAccumulator = sub(mAccumulator, value, C, D);
+	}
+
+	void sbcWithMemoryOrAccAbsX()
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr + mRegisterX);
+		mAccumulator = sub(mAccumulator, value, C, D);
+	}
+
+	void sbcWithMemoryOrAccAbsY()
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr + mRegisterY);
+		mAccumulator = sub(mAccumulator, value, C, D);
+	}
+
+	void sbcWithMemoryOrAccIndX()
+	{
+		uint8_t lookupaddress = fetch() + mRegisterX;
+		uint8_t value = read(readPointer(lookupaddress));
+		mAccumulator = sub(mAccumulator, value, C, D);
+	}
+
+	void sbcWithMemoryOrAccIndY()
+	{
+		uint8_t lookupaddress = fetch();
+		uint8_t value = read(readPointer(lookupaddress) + mRegisterY);
+		mAccumulator = sub(mAccumulator, value, C, D);
+	}
+
+	//"VAL" IN ALL COMPARE OPERATIONS IS VALUE OF THE CHOSEN REGISTER AND IS NOT THE VALUE IT IS BEING COMPARED WITH.
+	//VALUE THAT IT IS BEING COMPARED TO IS NAMED "VALUE" IN CODE
+
+
+
+	void compareImmediate(uint8_t val)
+	{
+		uint8_t value = fetch();
+		compareBase(val, value);
+	}
+
+	void compareAbsolute(uint8_t val)
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr);
+		compareBase(val, value);
+	}
+
+	void compareZeroPage(uint8_t val)
+	{
+		uint8_t addr = fetch();
+		uint8_t value = read(addr);
+		compareBase(val, value);
+	}
+
+	void compareZeroPageX(uint8_t val)
+	{
+		uint8_t addr = fetch() + mRegisterX;
+		uint8_t value = read(addr);
+		compareBase(val, value);
+	}
+
+	void compareAbsoluteX(uint8_t val)
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr + mRegisterX);
+		compareBase(val, value);
+	}
+
+	void compareAbsoluteY(uint8_t val)
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr + mRegisterY);
+		compareBase(val, value);
+	}
+
+	void compareIndY(uint8_t val)
+	{
+		uint8_t lookupaddress = fetch();
+
+		//uint16_t addr = (read(lookupaddress) + read(lookupaddress + 1) << 8) + mRegisterY;
+		uint8_t value = read(readPointer(lookupaddress) + mRegisterY);
+		compareBase(val, value);
+	}
+
+	void compareIndX(uint8_t val)
+	{
+		uint8_t lookupaddress = fetch() + mRegisterX;
+
+		//uint16_t addr = (read(lookupaddress + mRegisterX) + read(lookupaddress + mRegisterX + 1) << 8);
+		uint8_t value = read(readPointer(lookupaddress));
+		compareBase(val, value);
+	}
+
+
+
+
+	void bitTestAbsolute()
+	{
+		uint16_t addr = fetch16();
+		uint8_t value = read(addr);
+		N = (value & 0x80) != 0;
+		V = (value & 0x40) != 0;
+		Z = (value & mAccumulator) == 0;
+	}
+
+	void bitTestZeroPage()
+	{
+		uint8_t addr = fetch();
+		uint8_t value = read(addr);
+		N = (value & 0x80) != 0;
+		V = (value & 0x40) != 0;
+		Z = (value & mAccumulator) == 0;
+	}
+
+
+
+	void branchNonZero()
+	{
+		int8_t fetchedByte = branchBase();
+		if (Z == 0)
+		{
+			mProgramCounter += fetchedByte;
+		}
+	}
+
+	void branchCarrySet()
+	{
+		int8_t fetchedByte = branchBase();
+		if (C == 1)
+		{
+			mProgramCounter += fetchedByte;
+		}
+	}
+
+	void branchCarryClear()
+	{
+		int8_t fetchedByte = branchBase();
+		if (C == 0)
+		{
+			mProgramCounter += fetchedByte;
+		}
+	}
+
+	void branchZero()
+	{
+		int8_t fetchedByte = branchBase();
+		if (Z == 1)
+		{
+			mProgramCounter += fetchedByte;
+		}
+	}
+
+	void branchMinus()
+	{
+		int8_t fetchedByte = branchBase();
+		if (N == 1)
+		{
+			mProgramCounter += fetchedByte;
+		}
+	}
+
+	void branchPlus()
+	{
+		int8_t fetchedByte = branchBase();
+		if (N == 0)
+		{
+			mProgramCounter += fetchedByte;
+		}
+	}
+
+	void branchOverflowClear()
+	{
+		int8_t fetchedByte = branchBase();
+		if (V == 0)
+		{
+			mProgramCounter += fetchedByte;
+		}
+	}
+
+	void branchOverflowSet()
+	{
+		int8_t fetchedByte = branchBase();
+		if (V == 1)
+		{
+			mProgramCounter += fetchedByte;
+		}
+	}
+
+	int8_t branchBase()
+	{
+		return fetch();
+	}
+
+
+	uint16_t jumpAbsolute()
+	{
+		//std::cout << "JMP (absolute) started, PC: " << mProgramCounter << std::endl;
+
+		uint16_t jumpAddress = fetch16();
+
+		//std::cout << "New Address: " << jumpAddress << std::endl;
+		return jumpAddress;
+	}
+
+	uint16_t jumpAbsoluteSavingAddress()
+	{
+		//std::cout << "JMP (absolute) started, PC: " << mProgramCounter << std::endl;
+
+		uint16_t jumpAddress = fetch16();
+		uint16_t savedPosition = mProgramCounter - 1; // address of end of current instruction
+		if (mCallStack) { mCallStack->call(jumpAddress, mStackPointer); }
+		write(stackOffset + mStackPointer, ((savedPosition >> 8) & 0xFF));
+		mStackPointer--;
+		write(stackOffset + mStackPointer, savedPosition & 0xFF);
+		mStackPointer--;
+		//std::cout << "New Address: " << jumpAddress << std::endl;
+		return jumpAddress;
+	}
+
+	uint16_t jumpIndirect()
+	{
+		//std::cout << "JMP (indirect) started, PC: " << mProgramCounter << std::endl;
+
+		uint16_t lookupAddress = fetch16();
+		//std::cout << "Lookup Address: " << lookupAddress << std::endl;
+
+		// like the NMOS part, a pointer at $xxFF takes its high byte from $xx00
+		uint8_t low = read(lookupAddress);
+		uint16_t jumpAddress = low | (read((lookupAddress & 0xFF00) | ((lookupAddress + 1) & 0xFF)) << 8);
+		//std::cout << "New Address: " << jumpAddress << std::endl;
+		return jumpAddress;
+	}
+
+	uint8_t loadIndirectX()
+	{
+		uint8_t lookupAddress = fetch();
+
+
+		lookupAddress += mRegisterX;
+		//std::cout << "Lookup address: " << std::hex << static_cast<int>(lookupAddress) << ", x being: " << std::hex << static_cast<int>(mRegisterX) << std::endl;
+
+		uint16_t address = readPointer(lookupAddress);
+		//std::cout << "Address: " << std::hex << static_cast<int>(address) << " lookupA: " << std::hex << static_cast<int>(lookupAddress) << std::endl;
+
+		uint8_t result = read(address);
+		//std::cout << "Loading " << std::hex << static_cast<int>(result) << " into A" << std::endl;
+
+		return result;
+	}
+
+	uint8_t loadZeroPage()
+	{
+		uint8_t addr = fetch();
+		uint8_t result = read(addr);
+		//std::cout << "Loading " << std::hex << static_cast<int>(result) << " into A" << std::endl;
+		return result;
+	}
+
+	uint8_t loadImmediate()
+	{
+		uint8_t result = fetch();
+		//std::cout << "Loading " << std::hex << static_cast<int>(result) << " into A" << std::endl;
+		return result;
+	}
+
+	uint8_t loadAbsolute()
+	{
+		uint16_t addr = fetch16();
+		uint8_t result = read(addr);
+		//std::cout << "Loading " << std::hex << static_cast<int>(result) << " into A" << std::endl;
+		return result;
+	}
+
+	uint8_t loadIndirectY()
+	{
+		uint8_t lookupAddress = fetch();
+		//std::cout << "Lookup address: " << std::hex << static_cast<int>(lookupAddress) << ", y: " << std::hex << static_cast<int>(mRegisterY) << std::endl;
+
+		uint16_t address = readPointer(lookupAddress) + mRegisterY;
+		//std::cout << "Address: " << std::hex << static_cast<int>(address) << std::endl;
+
+		uint8_t result = read(address);
+		//std::cout << "Loading " << std::hex << static_cast<int>(result) << " into A" << std::endl;
+		return result;
+	}
+
+	uint8_t loadZeroPageX()
+	{
+		uint8_t base = fetch();
+		uint8_t	address = mRegisterX + base;
+		uint8_t result = read(address);
+		//std::cout << "LDA " << std::hex << static_cast<int>(result) << " into A, address: " << std::hex << static_cast<int>(address) << std::endl;
+		return result;
+	}
+
+	uint8_t loadZeroPageY()
+	{
+		uint8_t base = fetch();
+		uint8_t	address = mRegisterY + base;
+		uint8_t result = read(address);
+		//std::cout << "LDA " << std::hex << static_cast<int>(result) << " into A, address: " << std::hex << static_cast<int>(address) << std::endl;
+		return result;
+	}
+
+	uint8_t loadAbsoluteY()
+	{
+		uint16_t base = fetch16();
+		uint8_t result = read(base + mRegisterY);
+		//std::cout << "Loading " << std::hex << static_cast<int>(result) << " into A" << std::endl;
+		return result;
+	}
+
+	uint8_t loadAbsoluteX()
+	{
+		uint16_t base = fetch16();
+		uint8_t result = read(base + mRegisterX);
+		//std::cout << "Loading " << std::hex << static_cast<int>(result) << " into A" << std::endl;
+		return result;
+	}
+
+
+
+	//save instructions
+
+	void saveIndirectY(uint8_t value)
+	{
+		uint8_t lookupAddress = fetch();
+
+		uint16_t address = readPointer(lookupAddress) + mRegisterY;
+
+		write(address, value);
+	}
+
+	void saveIndirectX(uint8_t value)
+	{
+		uint8_t lookupAddress = fetch();
+
+		lookupAddress += mRegisterX;
+		uint16_t address = readPointer(lookupAddress);
+		write(address, value);
+	}
+
+	void saveZeroPage(uint8_t value)
+	{
+		uint8_t addr = fetch();
+		write(addr, value);
+	}
+
+	void saveAbsolute(uint8_t value)
+	{
+		uint16_t addr = fetch16();
+		write(addr, value);
+	}
+
+	void saveZeroPageX(uint8_t value)
+	{
+		uint8_t base = fetch();
+		uint8_t	address = mRegisterX + base;
+		write(address, value);
+	}
+
+	void saveZeroPageY(uint8_t value)
+	{
+		uint8_t base = fetch();
+		uint8_t	address = mRegisterY + base;
+		write(address, value);
+	}
+
+	void saveAbsoluteY(uint8_t value)
+	{
+		uint16_t base = fetch16();
+		write(base + mRegisterY, value);
+	}
+
+	void saveAbsoluteX(uint8_t value)
+	{
+		uint16_t base = fetch16();
+		write(base + mRegisterX, value);
+	}
+
+	void setZeroAndNegativeFlags(uint8_t value)
+	{
+		Z = value == 0;
+		N = (value & 0x80) != 0;
+	}
+};
+
+class MOS6502Debug : public MOS6502
+{
+public:
+	uint8_t  getAccumulator() { return mAccumulator; }
+	uint16_t getProgramCounter() { return mProgramCounter; }
+	uint8_t  getStackPointer() { return mStackPointer; }
+	uint8_t  getRegisterX() { return mRegisterX; }
+	uint8_t  getRegisterY() { return mRegisterY; }
+
+	uint8_t  getMemory(uint16_t addr) { return peek(addr); }
+
+	// NV1BDIZC, same layout PHP pushes
+	uint8_t getStatus()
+	{
+		return (N ? 0x80 : 0) | (V ? 0x40 : 0) | 0x20 | (B ? 0x10 : 0) | (D ? 0x08 : 0) | (I ? 0x04 : 0) | (Z ? 0x02 : 0) | (C ? 0x01 : 0);
+	}
+
+	void setAccumulator(uint8_t value) { mAccumulator = value; }
+	void setProgramCounter(uint16_t value) { mProgramCounter = value; }
+	void setStackPointer(uint8_t value) { mStackPointer = value; }
+	void setRegisterX(uint8_t value) { mRegisterX = value; }
+	void setRegisterY(uint8_t value) { mRegisterY = value; }
+
+	void setStatus(uint8_t status)
+	{
+		C = (status & 0x01) != 0;
+		Z = (status & 0x02) != 0;
+		I = (status & 0x04) != 0;
+		D = (status & 0x08) != 0;
+		B = (status & 0x10) != 0;
+		V = (status & 0x40) != 0;
+		N = (status & 0x80) != 0;
+	}
+
+	// bypasses watchpoints and profiling, like getMemory()
+	void setMemory(uint16_t addr, uint8_t value) { poke(addr, value); }
+
+	void addBreakpoint(uint16_t addr)
+	{
+		if (mBreakpoints.empty())
+		{
+			mBreakpoints.resize(65536);
+		}
+		mBreakpoints[addr] = true;
+		mTrapPages[addr >> 8] |= TRAP_EXECUTE;
+	}
+
+	void removeBreakpoint(uint16_t addr)
+	{
+		if (!mBreakpoints.empty())
+		{
+			mBreakpoints[addr] = false;
+			rebuildTrapPages();
+		}
+	}
+
+	// returns an id for removeWatchpoint(); kinds is TRAP_READ and/or TRAP_WRITE
+	int addWatchpoint(uint16_t first, uint16_t last, uint8_t kinds)
+	{
+		return addWatchpoint({ first, last, kinds, false, 0, 0x0000, 0xFFFF });
+	}
+
+	int addWatchpoint(const Watchpoint& watch)
+	{
+		// ids of removed watchpoints are handed out again, so add/remove round trips do not grow the list
+		std::size_t id = std::find(mWatchpointActive.begin(), mWatchpointActive.end(), false) - mWatchpointActive.begin();
+		if (id == mWatchpoints.size())
+		{
+			mWatchpoints.push_back(watch);
+			mWatchpointActive.push_back(true);
+		}
+		else
+		{
+			mWatchpoints[id] = watch;
+			mWatchpointActive[id] = true;
+		}
+		rebuildTrapPages();
+		return static_cast<int>(id);
+	}
+
+	void removeWatchpoint(int id)
+	{
+		if (id >= 0 && id < static_cast<int>(mWatchpoints.size()))
+		{
+			mWatchpointActive[id] = false;
+			while (!mWatchpointActive.empty() && !mWatchpointActive.back())
+			{
+				mWatchpoints.pop_back();
+				mWatchpointActive.pop_back();
+			}
+			rebuildTrapPages();
+		}
+	}
+
+	std::size_t watchpointSlots() const
+	{
+		// removed watchpoints in the middle keep their slot until an addWatchpoint() reuses it
+		return mWatchpoints.size();
+	}
+
+	void clearTraps()
+	{
+		mBreakpoints.clear();
+		mWatchpoints.clear();
+		mWatchpointActive.clear();
+		rebuildTrapPages();
+	}
+
+	// what stopped the last execute() with STOP_BREAKPOINT or STOP_WATCHPOINT
+	TrapHit getTrapHit() { return mTrapHit; }
+};
+
+#endif
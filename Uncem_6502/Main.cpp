@@ -1,2250 +1,1110 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
-#include <iomanip>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include "AsyncCpu.hpp"
+#include "BusScheduler.hpp"
+#include "Checkpoints.hpp"
 #include "Config.hpp"
-
-enum OpCode
-{
-	BRK = 0,
-	JMPAbs = 0x4C,
-	JMPInd = 0x6C,
-	JSRAbs = 0x20,
-	NOP = 0xEA,
-	PHP = 0x08,
-	PLP = 0x28,
-	PLA = 0x68,
-	PHA = 0x48,
-	RTS = 0x60,
-	RTI = 0x40,
-
-	//Load Instructions
-
-	LDAIndX = 0xA1,
-	LDAZeroP = 0xA5,
-	LDAImmediate = 0xA9,
-	LDAAbs = 0xAD,
-	LDAIndY = 0xB1,
-	LDAZeroPX = 0xB5,
-	LDAAbsY = 0xB9,
-	LDAAbsX = 0xBD,
-
-	LDXImmediate = 0xA2,
-	LDXZeroP = 0xA6,
-	LDXZeroPY = 0xB6,
-	LDXAbsY = 0xAE,
-	LDXAbs = 0xBE,
-
-	LDYImmediate = 0xA0,
-	LDYZeroP = 0xA4,
-	LDYZeroPX = 0xB4,
-	LDYAbsX = 0xAC,
-	LDYAbs = 0xBC,
-
-	//Save instructions
-
-	STAZeroP = 0x85,
-	STAZeroPX = 0x95,
-	STAAbs = 0x8D,
-	STAAbsX = 0x9D,
-	STAAbsY = 0x99,
-	STAIndX = 0x81,
-	STAIndY = 0x91,
-
-	STXZeroP = 0x86,
-	STXZeroPY = 0x96,
-	STXAbs = 0x8E,
-
-	STYZeroP = 0x84,
-	STYZeroPX = 0x94,
-	STYAbs = 0x8C,
-
-	//increment, decrement instructions
-
-	INY = 0xC8,
-	INX = 0xE8,
-	INCZeroP = 0xE6,
-	INCZeroPX = 0xF6,
-	INCAbs = 0xEE,
-	INCAbsX = 0xFE,
-
-	DEX = 0xCA, // Decrement X by 1
-	DEY = 0x88, // Decrement Y by 1
-	DECZeroP = 0xC6,
-	DECZeroPX = 0xD6,
-	DECAbs = 0xCE,
-	DECAbsX = 0xDE,
-
-
-	//flag instructions
-
-	CLC = 0x18, //Clear carry
-	CLD = 0xD8, //Clear Decimal Mode
-	CLI = 0x58, //Clear Interrupt Disable Bit
-	CLV = 0xB8, //Clear Overflow flag
-	SEC = 0x38, //Set carry flag
-	SEI = 0x78, //Set Interruption flag
-	SED = 0xF8, //Set Decimal Flag
-
-	//Transfer instructions
-
-	TAX = 0xAA, //Transfer Accumulator to X
-	TAY = 0xA8, //Transfer Accumulator to Y
-	TSX = 0xBA, //Transfer Stack Pointer to X
-	TXA = 0x8A, //Transfer X to Accumulator
-	TXS = 0x9A, //Transfer X to Stack Pointer
-	TYA = 0x98, // Transfer Y to Accumulator
-
-	// Logical and arithmetical instructions
-
-	ADCImmediate = 0x69, // immediate	ADC #oper	69	2	2
-	ADCZeroP = 0x65,      // zeropage	ADC oper	65	2	3
-	ADCZeroPX = 0x75,    //zeropage, X	ADC oper, X	75	2	4
-	ADCAbs = 0x6D,        //absolute	ADC oper	6D	3	4
-	ADCAbsX = 0x7D,       //absolute, X	ADC oper, X	7D	3	4 *
-	ADCAbsY = 0x79,       //absolute, Y	ADC oper, Y	79	3	4 *
-	ADCIndX = 0x61,        //(indirect, X)	ADC(oper, X)	61	2	6
-	ADCIndY = 0x71,		//(indirect), Y	ADC(oper), Y	71	2	5 *
-
-	SBCImmediate = 0xE9,//immediate	SBC #oper	E9	2	2
-	SBCZeroP = 0xE5,//zeropage	SBC oper	E5	2	3
-	SBCZeroPX = 0xF5,//zeropage, X	SBC oper, X	F5	2	4
-	SBCAbs = 0xED,//absolute	SBC oper	ED	3	4
-	SBCAbsX = 0xFD,//absolute, X	SBC oper, X	FD	3	4 *
-	SBCAbsY = 0xF9,//absolute, Y	SBC oper, Y	F9	3	4 *
-	SBCIndX = 0xE1,//(indirect, X)	SBC(oper, X)	E1	2	6
-	SBCIndY = 0xF1,//(indirect), Y	SBC(oper), Y	F1	2	5 *
-
-
-	ROLAcc = 0x2A, // Rotate left
-	ROLZeroP = 0x26,
-	ROLZeroPX = 0x36,
-	ROLAbs = 0x2E,
-	ROLAbsX = 0x3E,
-
-	RORAcc = 0x6A, // Rotate right
-	RORZeroP = 0x66,
-	RORZeroPX = 0x76,
-	RORAbs = 0x6E,
-	RORAbsX = 0x7E,
-
-	ASLAcc = 0x0A, //Arithmetic shift left
-	ASLZeroP = 0x06,
-	ASLZeroPX = 0x16,
-	ASLAbs = 0x0E,
-	ASLAbsX = 0x1E,
-
-	LSRAcc = 0x4A, //Logical shift right
-	LSRZeroP = 0x46,
-	LSRZeroPX = 0x56,
-	LSRAbs = 0x4E,
-	LSRAbsX = 0x5E,
-
-	ORAImmediate = 0x09,  //or with memory or accumulator
-	ORAZeroP = 0x05,
-	ORAZeroPX = 0x15,
-	ORAAbs = 0x0D,
-	ORAAbsX = 0x1D,
-	ORAAbsY = 0x19,
-	ORAIndX = 0x01,
-	ORAIndY = 0x11,
-
-	EORImmediate = 0x49,  //xor with memory or accumulator
-	EORZeroP = 0x45,
-	EORZeroPX = 0x55,
-	EORAbs = 0x4D,
-	EORAbsX = 0x5D,
-	EORAbsY = 0x59,
-	EORIndX = 0x41,
-	EORIndY = 0x51,
-
-	ANDImmediate = 0x29, //and with memory or accumulator
-	ANDZeroP = 0x25,
-	ANDZeroPX = 0x35,
-	ANDAbs = 0x2D,
-	ANDAbsX = 0x3D,
-	ANDAbsY = 0x39,
-	ANDIndX = 0x21,
-	ANDIndY = 0x31,
-
-	//Branch instructions
-
-	BCC = 0x90, //Branch on Carry Clear
-	BCS = 0xB0, //Branch on Carry Set
-	BEQ = 0xF0, //Branch on Result Zero
-	BMI = 0x30,  //Branch on result minus
-	BNE = 0xD0,  //Branch on result non zero
-	BPL = 0x10,  //Branch on result plus
-	BVC = 0x50,
-	BVS = 0x70,
-
-	//Compare instructions
-
-	CMPImmediate = 0xC9,
-	CMPZeroP = 0xC5,
-	CMPZeroPX = 0xD5,
-	CMPAbs = 0xCD,
-	CMPAbsX = 0xDD,
-	CMPAbsY = 0xD9,
-	CMPIndX = 0xC1,
-	CMPIndY = 0xD1,
-
-	CPXImmediate = 0xE0, //Compare X With Memory
-	CPXZeroP = 0xE4,
-	CPXAbs = 0xEC,
-
-	CPYImmediate = 0xC0, //Compare Y With Memory
-	CPYZeroP = 0xC4,
-	CPYAbs = 0xCC,
-
-	BITAbs = 0x2C,
-	BITZeroP = 0x24,
-
-	HALT = 0xFF // Undocumented code, used for testing
+#include "Disassembler.hpp"
+#include "GuestScheduler.hpp"
+#include "ImageStore.hpp"
+#include "MOS6502.hpp"
+#include "MemoryDump.hpp"
+#include "MemoryProfile.hpp"
+#include "ParallelScheduler.hpp"
+#include "Recompiled.hpp"
+#include "SamplingProfiler.hpp"
+#include "SubroutineMemo.hpp"
+#include "WarmStart.hpp"
+#ifndef _WIN32
+#include "GdbStub.hpp"
+#include "JobServer.hpp"
+#include "LiveMetrics.hpp"
+#include <csignal>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+static const uint8_t basicOpsProgram[] = {
+	0xA9, 0x83, 0x8D, 0x01, 0x00, 0xA9, 0x05, 0x8D,
+	0x02, 0x00, 0xA9, 0x81, 0x8D, 0x03, 0x00, 0xA9,
+	0x73, 0x8D, 0x04, 0x00, 0x18, 0x20, 0x44, 0x10,
+	0xFF, 0xA9, 0xFA, 0x8D, 0x01, 0x00, 0xA9, 0x03, //first was 0xea but changed to 0xff (halt)
+	0x8D, 0x02, 0x00, 0x20, 0x51, 0x10, 0xFF, 0xA9, // seventh was ea but is now ff
+	0x07, 0x8D, 0x01, 0x00, 0xA9, 0x06, 0x8D, 0x02,
+	0x00, 0x20, 0x74, 0x10, 0xEA, 0xA9, 0x0A, 0x8D,
+	0x01, 0x00, 0xA9, 0x05, 0x8D, 0x02, 0x00, 0x20,
+	0x91, 0x10, 0xFF, 0x00, 0xA5, 0x01, 0x65, 0x03, // third was EA, now is 0xff
+	0x85, 0x05, 0xA5, 0x02, 0x65, 0x04, 0x85, 0x06,
+	0x60, 0xA9, 0x00, 0x85, 0x03, 0x85, 0x04, 0xA5,
+	0x01, 0xC9, 0x00, 0xF0, 0x16, 0xA5, 0x02, 0xC9,
+	0x00, 0xF0, 0x10, 0xC6, 0x02, 0xA5, 0x03, 0x18,
+	0x65, 0x01, 0x85, 0x03, 0x90, 0xEF, 0xE6, 0x04,
+	0x4C, 0x5D, 0x10, 0x60, 0xA9, 0x00, 0x85, 0x03,
+	0xA5, 0x01, 0xC9, 0x00, 0xF0, 0x12, 0xA5, 0x02,
+	0xC9, 0x00, 0xF0, 0x0C, 0xC6, 0x02, 0xA5, 0x03,
+	0x18, 0x65, 0x01, 0x85, 0x03, 0x4C, 0x7E, 0x10,
+	0x60, 0xA9, 0x00, 0x85, 0x03, 0xA5, 0x01, 0x85,
+	0x04, 0xC5, 0x02, 0x30, 0x10, 0xE6, 0x03, 0xA5,
+	0x04, 0x38, 0xE5, 0x02, 0x85, 0x04, 0xC5, 0x02,
+	0x30, 0x03, 0x4C, 0x9D, 0x10, 0x60, 0xFF
 };
 
-enum addressMode // Prototype enum for addressing modes, used for unified output function.
-{
-	IMD = 1,
-	ZPG = 2,
-	ZPX = 3,
-	ZPY = 4,
-	ABS = 5,
-	ABX = 6,
-	ABY = 7,
-	INDX = 8,
-	INDY = 9,
-	NON = 10,
-	A = 11 //Accumulator as address mode, used in few commands
-};
-
-class MOS6502
-{
-public:
-	bool ISDEBUG = true; // change this manually in code to set it to either debug or usual mode (true for debug, false for usual)
-
-	MOS6502()
-		: mAccumulator(0), mRegisterX(0), mRegisterY(0), mProgramCounter(0), mStackPointer(0xFF), C(0), Z(0), I(0), D(0), B(0), V(0), N(0)
-	{
-		for (std::size_t i = 0; i < sizeof(mMemory); i++)
-		{
-			mMemory[i] = 0;
-		}
-	}
-
-	void loadProgram(const uint8_t* program, std::size_t size, uint16_t offset)
-	{
-		memcpy(mMemory + offset, program, size);
-	}
-
-	void reset()
-	{
-		mProgramCounter = 0xFFFE;
-		mProgramCounter = fetch16();
-	}
-
-	void executeFrom(uint16_t start)
-	{
-		mProgramCounter = start;
-		while (true)
-		{
-			uint8_t opcode = fetch();
-			if (opcode == HALT) { return; }
-			if (!executeOpcode((OpCode)opcode))
-			{
-				printMemory();
-				std::cerr << "Unknown opcode: " << std::hex << static_cast<int>(opcode) << std::endl;
-				return;
-			}
-		}
-	}
-
-	void execute()
-	{
-		// execute from current mProgramCounter
-		while (true)
-		{
-			uint8_t opcode = fetch();
-			if (opcode == HALT) { return; }
-			if (!executeOpcode((OpCode)opcode))
-			{
-				printMemory();
-				std::cerr << "Unknown opcode: " << std::hex << static_cast<int>(opcode) << std::endl;
-				return;
-			}
-		}
-	}
-
-	void printMemory()
-	{
-		for (std::size_t i = 0; i < sizeof(mMemory); i++)
-		{
-			std::cout << std::hex << static_cast<int>(mMemory[i]) << ", ";
-		}
-		std::cout << std::endl;
-	}
-
-protected:
-	uint8_t mMemory[65536];
-	uint8_t mAccumulator, mRegisterX, mRegisterY;
-	uint16_t mProgramCounter;
-	uint8_t mStackPointer;
-	uint8_t C, Z, I, D, B, V, N;
-
-	static constexpr uint16_t stackOffset = 0x100;
-
-	bool executeOpcode(OpCode opcode)
-	{
-		if (ISDEBUG)
-		{
-			// fetch already performed before, so we write PC before fetch
-			std::cout << std::hex << std::setw(4) << std::setfill('0') << (mProgramCounter - 1) << std::setfill(' ') << std::setw(0) << "\t";
-		}
-		switch (opcode)
-		{
-		case JMPAbs:
-			mProgramCounter = jumpAbsolute();
-			break;
-		case JMPInd:
-			mProgramCounter = jumpIndirect();
-			break;
-		case JSRAbs:
-			mProgramCounter = jumpAbsoluteSavingAddress();
-			break;
-
-			//LOAD OPERATIONS
-
-		case LDAIndX:
-			mAccumulator = loadIndirectX("LDA");
-			setZeroAndNegativeFlags(mAccumulator);
-			break;
-		case LDAZeroP:
-			mAccumulator = loadZeroPage("LDA");
-			setZeroAndNegativeFlags(mAccumulator);
-			break;
-		case LDAImmediate:
-			mAccumulator = loadImmediate("LDA");
-			setZeroAndNegativeFlags(mAccumulator);
-			break;
-		case LDAAbs:
-			mAccumulator = loadAbsolute("LDA");
-			setZeroAndNegativeFlags(mAccumulator);
-			break;
-		case LDAIndY:
-			mAccumulator = loadIndirectY("LDA");
-			setZeroAndNegativeFlags(mAccumulator);
-			break;
-		case LDAZeroPX:
-			mAccumulator = loadZeroPageX("LDA");
-			setZeroAndNegativeFlags(mAccumulator);
-			break;
-		case LDAAbsY:
-			mAccumulator = loadAbsoluteY("LDA");
-			setZeroAndNegativeFlags(mAccumulator);
-			break;
-		case LDAAbsX:
-			mAccumulator = loadAbsoluteX("LDA");
-			setZeroAndNegativeFlags(mAccumulator);
-			break;
-
-		case LDXAbsY:
-			mRegisterX = loadAbsoluteY("LDX");
-			setZeroAndNegativeFlags(mRegisterX);
-			break;
-		case LDXZeroP:
-			mRegisterX = loadZeroPage("LDX");
-			setZeroAndNegativeFlags(mRegisterX);
-			break;
-		case LDXZeroPY:
-			mRegisterX = loadZeroPageY("LDX");
-			setZeroAndNegativeFlags(mRegisterX);
-			break;
-		case LDXAbs:
-			mRegisterX = loadAbsolute("LDX");
-			setZeroAndNegativeFlags(mRegisterX);
-			break;
-		case LDXImmediate:
-			mRegisterX = loadImmediate("LDX");
-			setZeroAndNegativeFlags(mRegisterX);
-			break;
-
-		case LDYAbsX:
-			mRegisterY = loadAbsoluteX("LDY");
-			setZeroAndNegativeFlags(mRegisterY);
-			break;
-		case LDYZeroP:
-			mRegisterY = loadZeroPage("LDY");
-			setZeroAndNegativeFlags(mRegisterY);
-			break;
-		case LDYZeroPX:
-			mRegisterY = loadZeroPageX("LDY");
-			setZeroAndNegativeFlags(mRegisterY);
-			break;
-		case LDYAbs:
-			mRegisterY = loadAbsolute("LDY");
-			setZeroAndNegativeFlags(mRegisterY);
-			break;
-		case LDYImmediate:
-			mRegisterY = loadImmediate("LDY");
-			setZeroAndNegativeFlags(mRegisterY);
-			break;
-
-			//SAVE OPERATIONS
-
-		case STAZeroP:
-			saveZeroPage("STA", mAccumulator);
-			break;
-		case STAZeroPX:
-			saveZeroPageX("STA", mAccumulator);
-			break;
-		case STAAbs:
-			saveAbsolute("STA", mAccumulator);
-			break;
-		case STAAbsX:
-			saveAbsoluteX("STA", mAccumulator);
-			break;
-		case STAAbsY:
-			saveAbsoluteY("STA", mAccumulator);
-			break;
-		case STAIndX:
-			saveIndirectX("STA", mAccumulator);
-			break;
-		case STAIndY:
-			saveIndirectY("STA", mAccumulator);
-			break;
-
-
-		case STXZeroP:
-			saveZeroPage("STX", mRegisterX);
-			break;
-		case STXZeroPY:
-			saveZeroPageY("STX", mRegisterX);
-			break;
-		case STXAbs:
-			saveAbsolute("STX", mRegisterX);
-			break;
-
-
-		case STYZeroP:
-			saveZeroPage("STY", mRegisterY);
-			break;
-		case STYZeroPX:
-			saveZeroPageX("STY", mRegisterY);
-			break;
-		case STYAbs:
-			saveAbsolute("STY", mRegisterY);
-			break;
-
-			//INCREMENT AND DECREMENT
-
-		case INY:
-			if (ISDEBUG) { std::cout << "INY" << "\t"; }
-			mRegisterY++;
-			setZeroAndNegativeFlags(mRegisterY);
-			break;
-		case INX:
-			if (ISDEBUG) { std::cout << "INX" << "\t"; }
-			mRegisterX++;
-			setZeroAndNegativeFlags(mRegisterX);
-			break;
-		case INCZeroP:
-			incrementZeroPage();
-			break;
-		case INCZeroPX:
-			incrementZeroPageX();
-			break;
-		case INCAbs:
-			incrementAbsolute();
-			break;
-		case INCAbsX:
-			incrementAbsoluteX();
-			break;
-
-		case DEX:
-			if (ISDEBUG) { std::cout << "DEX" << "\t"; }
-			mRegisterX--;
-			setZeroAndNegativeFlags(mRegisterX);
-			break;
-		case DEY:
-			if (ISDEBUG) { std::cout << "DEY" << "\t"; }
-			mRegisterY--;
-			setZeroAndNegativeFlags(mRegisterY);
-			break;
-		case DECZeroP:
-			decrementZeroPage();
-			break;
-		case DECZeroPX:
-			decrementZeroPageX();
-			break;
-		case DECAbs:
-			decrementAbsolute();
-			break;
-		case DECAbsX:
-			decrementAbsoluteX();
-			break;
-
-			//FLAG OPERATIONS
-
-		case CLC:
-			if (ISDEBUG) { std::cout << "CLC" << "\t"; }
-			C = 0;
-			break;
-		case CLD:
-			if (ISDEBUG) { std::cout << "CLD" << "\t"; }
-			D = 0;
-			break;
-		case CLI:
-			if (ISDEBUG) { std::cout << "CLI" << "\t"; }
-			I = 0;
-			break;
-		case CLV:
-			if (ISDEBUG) { std::cout << "CLV" << "\t"; }
-			V = 0;
-			break;
-		case SEC:
-			if (ISDEBUG) { std::cout << "SEC" << "\t"; }
-			C = 1;
-			break;
-		case SEI:
-			if (ISDEBUG) { std::cout << "SEI" << "\t"; }
-			I = 1;
-			break;
-		case SED:
-			if (ISDEBUG) { std::cout << "SED" << "\t"; }
-			D = 1;
-			break;
-
-			//LOGICAL AND ARITHMETICAL OPERATIONS
-
-		case ORAImmediate:                        //or with memory or accumulator
-			orWithMemoryOrAccImmediate();
-			break;
-		case ORAZeroP:
-			orWithMemoryOrAccZeroP();
-			break;
-		case ORAZeroPX:
-			orWithMemoryOrAccZeroPX();
-			break;
-		case ORAAbs:
-			orWithMemoryOrAccAbs();
-			break;
-		case ORAAbsX:
-			orWithMemoryOrAccAbsX();
-			break;
-		case ORAAbsY:
-			orWithMemoryOrAccAbsY();
-			break;
-		case ORAIndX:
-			orWithMemoryOrAccIndX();
-			break;
-		case ORAIndY:
-			orWithMemoryOrAccIndY();
-			break;
-
-		case EORImmediate:                        //or with memory or accumulator
-			orWithMemoryOrAccImmediate();
-			break;
-		case EORZeroP:
-			orWithMemoryOrAccZeroP();
-			break;
-		case EORZeroPX:
-			orWithMemoryOrAccZeroPX();
-			break;
-		case EORAbs:
-			orWithMemoryOrAccAbs();
-			break;
-		case EORAbsX:
-			orWithMemoryOrAccAbsX();
-			break;
-		case EORAbsY:
-			orWithMemoryOrAccAbsY();
-			break;
-		case EORIndX:
-			orWithMemoryOrAccIndX();
-			break;
-		case EORIndY:
-			orWithMemoryOrAccIndY();
-			break;
-
-
-		case ANDImmediate:
-			andWithMemoryOrAccImmediate();
-			break;
-		case ANDZeroP:
-			andWithMemoryOrAccZeroP();
-			break;
-		case ANDZeroPX:
-			andWithMemoryOrAccZeroPX();
-			break;
-		case ANDAbs:
-			andWithMemoryOrAccAbs();
-			break;
-		case ANDAbsX:
-			andWithMemoryOrAccAbsX();
-			break;
-		case ANDAbsY:
-			andWithMemoryOrAccAbsY();
-			break;
-		case ANDIndX:
-			andWithMemoryOrAccIndX();
-			break;
-		case ANDIndY:
-			andWithMemoryOrAccIndY();
-			break;
-
-
-		case ADCImmediate:
-			adcWithMemoryOrAccImmediate();
-			break;
-		case ADCZeroP:
-			adcWithMemoryOrAccZeroP();
-			break;
-		case ADCZeroPX:
-			adcWithMemoryOrAccZeroPX();
-			break;
-		case ADCAbs:
-			adcWithMemoryOrAccAbs();
-			break;
-		case ADCAbsX:
-			adcWithMemoryOrAccAbsX();
-			break;
-		case ADCAbsY:
-			adcWithMemoryOrAccAbsY();
-			break;
-		case ADCIndX:
-			adcWithMemoryOrAccIndX();
-			break;
-		case ADCIndY:
-			adcWithMemoryOrAccIndY();
-			break;
-
-		case SBCImmediate:
-			sbcWithMemoryOrAccImmediate();
-			break;
-		case SBCZeroP:
-			sbcWithMemoryOrAccZeroP();
-			break;
-		case SBCZeroPX:
-			sbcWithMemoryOrAccZeroPX();
-			break;
-		case SBCAbs:
-			sbcWithMemoryOrAccAbs();
-			break;
-		case SBCAbsX:
-			sbcWithMemoryOrAccAbsX();
-			break;
-		case SBCAbsY:
-			sbcWithMemoryOrAccAbsY();
-			break;
-		case SBCIndX:
-			sbcWithMemoryOrAccIndX();
-			break;
-		case SBCIndY:
-			sbcWithMemoryOrAccIndY();
-			break;
-
-
-		case RORAcc:
-			rotateRightAccumulator();
-			break;
-		case RORZeroP:
-			rotateRightAccumulator();
-			break;
-		case RORZeroPX:
-			rotateRightAccumulator();
-			break;
-		case RORAbs:
-			rotateRightAccumulator();
-			break;
-		case RORAbsX:
-			rotateRightAccumulator();
-			break;
-
-		case ROLAcc:
-			rotateLeftAccumulator();
-			break;
-		case ROLZeroP:
-			rotateLeftAccumulator();
-			break;
-		case ROLZeroPX:
-			rotateLeftAccumulator();
-			break;
-		case ROLAbs:
-			rotateLeftAccumulator();
-			break;
-		case ROLAbsX:
-			rotateLeftAccumulator();
-			break;
-
-		case LSRAcc:
-			shiftLeftAccumulator();
-			break;
-		case LSRZeroP:
-			shiftLeftZeroPage();
-			break;
-		case LSRZeroPX:
-			shiftLeftZeroPageX();
-			break;
-		case LSRAbs:
-			shiftLeftAbsolute();
-			break;
-		case LSRAbsX:
-			shiftLeftAbsoluteX();
-			break;
-
-		case ASLAcc:
-			shiftRightAccumulator();
-			break;
-		case ASLZeroP:
-			shiftRightZeroPage();
-			break;
-		case ASLZeroPX:
-			shiftRightZeroPageX();
-			break;
-		case ASLAbs:
-			shiftRightAbsolute();
-			break;
-		case ASLAbsX:
-			shiftRightAbsoluteX();
-			break;
-
-			//TRANSFER OPERATIONS
-
-		case TAX:
-			transferAccToX();
-			break;
-		case TAY:
-			transferAccToY();
-			break;
-		case TSX:
-			transferStackToX();
-			break;
-		case TYA:
-			transferYToAcc();
-			break;
-		case TXA:
-			transferXToAcc();
-			break;
-		case TXS:
-			transferXToStack();
-			break;
-
-			//BRANCHING OPERATIONS
-
-		case BNE:
-			branchNonZero();
-			break;
-		case BCS:
-			branchCarrySet();
-			break;
-		case BCC:
-			branchCarryClear();
-			break;
-		case BEQ:
-			branchZero();
-			break;
-		case BMI:
-			branchMinus();
-			break;
-		case BPL:
-			branchPlus();
-			break;
-		case BVC:
-			branchOverflowClear();
-			break;
-		case BVS:
-			branchOverflowSet();
-			break;
-
-			//COMPARE OPERATIONS
-
-		case CPXImmediate:
-			compareImmediate("CPX", mRegisterX);
-			break;
-		case CPXAbs:
-			compareAbsolute("CPX", mRegisterX);
-			break;
-		case CPXZeroP:
-			compareZeroPage("CPX", mRegisterX);
-			break;
-
-		case CPYImmediate:
-			compareImmediate("CPY", mRegisterY);
-			break;
-		case CPYAbs:
-			compareAbsolute("CPY", mRegisterY);
-			break;
-		case CPYZeroP:
-			compareZeroPage("CPY", mRegisterY);
-			break;
-
-		case CMPImmediate:
-			compareImmediate("CMP", mAccumulator);
-			break;
-		case CMPZeroP:
-			compareZeroPage("CMP", mAccumulator);
-			break;
-		case CMPZeroPX:
-			compareZeroPageX("CMP", mAccumulator);
-			break;
-		case CMPAbs:
-			compareAbsolute("CMP", mAccumulator);
-			break;
-		case CMPAbsX:
-			compareAbsoluteX("CMP", mAccumulator);
-			break;
-		case CMPAbsY:
-			compareAbsoluteY("CMP", mAccumulator);
-			break;
-		case CMPIndX:
-			compareIndX("CMP", mAccumulator);
-			break;
-		case CMPIndY:
-			compareIndY("CMP", mAccumulator);
-			break;
-
-
-		case BITAbs:
-			bitTestAbsolute();
-			break;
-		case BITZeroP:
-			bitTestAbsolute();
-			break;
-
-			//MISCELANNEOUS OPERATIONS
-		case BRK:
-			breakCPU();          //Its Breaking Bad time!
-			break;
-		case RTI:
-			returnFromInterrupt();
-			break;
-		case RTS:
-			returnFromSubroutine();
-			break;
-		case PLP:
-			pullStatusFromStack();
-			break;
-		case PHA:
-			pushAccToStack();
-			break;
-		case PLA:
-			pullAccFromStack();
-			break;
-		case PHP:
-			pushStatusToStack();
-			break;
-		case NOP:
-			if (ISDEBUG) { std::cout << "NOP" << "\t"; }
-			break;
-		default:
-			return false;
-		}
-		if (ISDEBUG)
-		{
-			printRegisterInfo();
-		}
-
-		return true;
-	}
-
-private:
-
-	uint8_t fetch()
-	{
-		uint8_t data = mMemory[mProgramCounter];
-		mProgramCounter++;
-		return data;
-	}
-
-	uint16_t fetch16()
-	{
-		return fetch() + (fetch() << 8);
-	}
-
-	void printRegisterInfo()
-	{
-		std::cout << std::hex << "\t" << ";"
-			<< std::setfill('0')
-			<< " A:" << std::setw(2) << (unsigned int)mAccumulator
-			<< " X:" << std::setw(2) << (unsigned int)mRegisterX
-			<< " Y:" << std::setw(2) << (unsigned int)mRegisterY
-			<< " ST: CZIDBVN " << std::setw(1) << (int)C << (int)Z << (int)I << (int)D << (int)B << (int)V << (int)N
-			<< " PC:" << std::setw(4) << (uint16_t)mProgramCounter
-			<< " SP:" << std::setw(2) << (int)mStackPointer
-			<< std::setw(0) << std::setfill(' ')
-			<< "\n";
-	}
-
-	void breakCPU()
-	{
-		mMemory[stackOffset + mStackPointer] = (mProgramCounter & 0xF0) >> 8;
-		mStackPointer--;
-		mMemory[stackOffset + mStackPointer] = mProgramCounter & 0x0F;
-		mStackPointer--;
-		uint8_t Status = 0x00;
-		Status += (N ? 0x80 : 0);
-		Status += (V ? 0x40 : 0);
-		Status += 0x20;
-		Status += 0x10;
-		Status += (D ? 0x08 : 0);
-		Status += 0x04;
-		Status += (Z ? 0x02 : 0);
-		Status += (C ? 0x01 : 0);
-		mMemory[stackOffset + mStackPointer] = Status;
-		mStackPointer--;
-		if (ISDEBUG) { std::cout << "BRK" << "\t"; }
-	}
-
-
-
-	void incrementZeroPage()
-	{
-		uint8_t addr = fetch();
-		mMemory[addr]++;
-		OutForComAndModeENUM("INC", ZPG, addr);
-		setZeroAndNegativeFlags(mMemory[addr]);
-	}
-
-	void incrementZeroPageX()
-	{
-		uint8_t addr = fetch();
-		mMemory[addr + mRegisterX]++;
-		OutForComAndModeENUM("INC", ZPG, addr);
-		setZeroAndNegativeFlags(mMemory[addr + mRegisterX]);
-	}
-
-	void incrementAbsoluteX()
-	{
-		uint16_t addr = fetch16();
-		mMemory[addr + mRegisterX]++;
-		OutForComAndModeENUM("INC", ABX, addr);
-		setZeroAndNegativeFlags(mMemory[addr + mRegisterX]);
-	}
-
-	void incrementAbsolute()
-	{
-		uint16_t addr = fetch16();
-		mMemory[addr]++;
-		OutForComAndModeENUM("INC", ABS, addr);
-		setZeroAndNegativeFlags(mMemory[addr]);
-	}
-
-
-	void decrementZeroPage()
-	{
-		uint8_t addr = fetch();
-		mMemory[addr]--;
-		OutForComAndModeENUM("DEC", ZPG, addr);
-		setZeroAndNegativeFlags(mMemory[addr]);
-	}
-
-	void decrementZeroPageX()
-	{
-		uint8_t addr = fetch();
-		mMemory[addr + mRegisterX]--;
-		OutForComAndModeENUM("DEC", ZPG, addr);
-		setZeroAndNegativeFlags(mMemory[addr + mRegisterX]);
-	}
-
-	void decrementAbsoluteX()
-	{
-		uint16_t addr = fetch16();
-		mMemory[addr + mRegisterX]--;
-		OutForComAndModeENUM("DEC", ABX, addr);
-		setZeroAndNegativeFlags(mMemory[addr + mRegisterX]);
-	}
-
-	void decrementAbsolute()
-	{
-		uint16_t addr = fetch16();
-		mMemory[addr]--;
-		OutForComAndModeENUM("DEC", ABS, addr);
-		setZeroAndNegativeFlags(mMemory[addr]);
-	}
-
-
-	uint8_t rotateright(uint8_t value)
-	{
-		uint8_t resultingvalue = (value >> 1) | (C ? 0x80 : 0); //I rotate the entered value by 1 position right, replacing the left-most bit of the ROTATED VALUE with carry (either 1 or 0)
-		C = value & 0x1;                                      //I store the bit that disappears due to shifting of the number in the carry flag
-		setZeroAndNegativeFlags(resultingvalue);              //I also set the correct flags if the resulting value after shifting appears to be zero or negative
-		return resultingvalue;                                //I return the value
-	}
-
-	uint8_t rotateleft(uint8_t value)
-	{
-		uint8_t resultingvalue = (value << 1) | (C ? 1 : 0);  //I rotate the entered value 1 position left, replacing the right-most bit of the ROTATED VALUE with value of carry
-		C = value & 0x80;                                     //I store the left-most bit that disappears due to shifting into carry flag
-		setZeroAndNegativeFlags(resultingvalue);              //I check if the value is negative or zero
-		return resultingvalue;                                //I return the value
-	}
-
-	uint8_t shiftleft(uint8_t value)
-	{
-		uint8_t resultingvalue = value << 1;                  //I rotate the entered value 1 position left, replacing the right-most bit of the ROTATED VALUE with 0
-		C = value & 0x80;                                     //I store the left-most bit that disappears due to shifting into carry flag
-		setZeroAndNegativeFlags(resultingvalue);              //I check if the value is negative or zero
-		return resultingvalue;                                //I return the value
-	}
-
-	uint8_t shifteright(uint8_t value)
-	{
-		uint8_t resultingvalue = value >> 1;                  //I rotate the entered value by 1 position right, replacing the left-most bit of the ROTATED VALUE with 0
-		C = value & 0x1;                                      //I store the bit that disappears due to shifting of the number in the carry flag
-		setZeroAndNegativeFlags(resultingvalue);              //I also set the correct flags if the resulting value after shifting appears to be zero or negative
-		return resultingvalue;                                //I return the value
-	}
-
-	//VERSION OF UNIFIED OUTPUT FUNCTION WITH ENUMS USED
-	void OutForComAndModeENUM(const char* instruction, addressMode mode, uint16_t addr)
-	{
-		// addrmode should be made to enum, if you wish. This version is already working one, but i didnt implement it widely
-		if (ISDEBUG)
-		{
-			switch (mode)
-			{
-			case IMD:
-				std::cout << instruction << "\t" << "#" << "$" << std::hex << std::setw(2) << std::setfill('0') << addr;
-				break;
-			case ZPG:
-				std::cout << instruction << "\t" << "$" << std::hex << std::setw(2) << std::setfill('0') << addr;
-				break;
-			case ZPX:
-				std::cout << instruction << "\t" << "$" << std::hex << std::setw(2) << std::setfill('0') << addr << ",x";
-				break;
-			case ZPY:
-				std::cout << instruction << "\t" << "$" << std::hex << std::setw(2) << std::setfill('0') << addr << ",y";
-				break;
-			case ABS:
-				std::cout << instruction << "\t" << "$" << std::hex << std::setw(4) << std::setfill('0') << addr;
-				break;
-			case ABX:
-				std::cout << instruction << "\t" << "$" << std::hex << std::setw(4) << std::setfill('0') << addr << ",x";
-				break;
-			case ABY:
-				std::cout << instruction << "\t" << "$" << std::hex << std::setw(4) << std::setfill('0') << addr << ",y";
-				break;
-			case INDX:
-				std::cout << instruction << "\t" << "(" << "$" << std::hex << std::setw(4) << std::setfill('0') << addr << ",x)";
-				break;
-			case INDY:
-				std::cout << instruction << "\t" << "(" << "$" << std::hex << std::setw(4) << std::setfill('0') << addr << "),y";
-				break;
-			case A:
-				std::cout << instruction << "\t" << "A";
-				break;
-			default:
-				std::cout << instruction << "\t";
-				break;
-			}
-		}
-	}
-
-
-	// NV1BDIZC -> flags register (byte construction)
-	// to add Carry -> directly add 0x01
-	// to add Zero -> directly add 0x02
-	// to add Interrupt disable -> directly add 0x04
-	// to add Decimal -> directly add 0x08
-	// to add Break -> directly add 0x10
-	// to add 5th bit -> directly add 0x20
-	// to add Overflow -> directly add 0x40
-	// to add Negative -> directly add 0x80
-	void pushStatusToStack()
-	{
-		uint8_t Status = 0x00;
-		Status += (N ? 0x80 : 0);
-		Status += (V ? 0x40 : 0);
-		Status += 0x20;
-		Status += 0x10;
-		Status += (D ? 0x08 : 0);
-		Status += (I ? 0x04 : 0);
-		Status += (Z ? 0x02 : 0);
-		Status += (C ? 0x01 : 0);
-		mMemory[stackOffset + mStackPointer] = Status;
-		mStackPointer--;
-		if (ISDEBUG) { std::cout << "PHP" << "\t"; }
-	}
-
-	void pullStatusFromStack()
-	{
-		mStackPointer++;
-		uint8_t Status = mMemory[stackOffset + mStackPointer];
-		C = (Status & 0x01) != 0;
-		Z = (Status & 0x02) != 0;
-		I = (Status & 0x04) != 0;
-		D = (Status & 0x08) != 0;
-		V = (Status & 0x40) != 0;
-		N = (Status & 0x80) != 0;
-		if (ISDEBUG) { std::cout << "PLP" << "\t"; }
-	}
-
-	void pushAccToStack()
-	{
-		mMemory[stackOffset + mStackPointer] = mAccumulator;
-		mStackPointer--;
-		if (ISDEBUG) { std::cout << "PHA" << "\t"; }
-	}
-
-	void pullAccFromStack()
-	{
-		mStackPointer++;
-		mAccumulator = mMemory[stackOffset + mStackPointer];
-		if (ISDEBUG) { std::cout << "PLA" << "\t"; }
-	}
-
-	void returnFromInterrupt()
-	{
-		mStackPointer++;
-		uint8_t Status = mMemory[stackOffset + mStackPointer];
-		C = (Status & 0x01) != 0;
-		Z = (Status & 0x02) != 0;
-		I = (Status & 0x04) != 0;
-		D = (Status & 0x08) != 0;
-		V = (Status & 0x40) != 0;
-		N = (Status & 0x80) != 0;
-		mStackPointer++;
-		uint16_t ProgramCounter = mMemory[stackOffset + mStackPointer];
-		mStackPointer++;
-		ProgramCounter += (mMemory[stackOffset + mStackPointer] << 8);
-		mProgramCounter = ProgramCounter;
-		if (ISDEBUG) { std::cout << "RTI" << "\t"; }
-	}
-
-	void returnFromSubroutine()
-	{
-		mStackPointer++;
-		uint16_t ProgramCounter = mMemory[stackOffset + mStackPointer];
-		mStackPointer++;
-		ProgramCounter += (mMemory[stackOffset + mStackPointer] << 8);
-		mProgramCounter = ProgramCounter + 1;
-		if (ISDEBUG) { std::cout << "RTS" << "\t"; }
-	}
-
-	void rotateLeftAccumulator()
-	{
-		mAccumulator = rotateleft(mAccumulator);
-		OutForComAndModeENUM("ROL", A, 0);
-		//if (ISDEBUG) { std::cout << "ROL" << "\t" << "A"; }
-	}
-
-	void rotateLeftZeroPage()
-	{
-		uint8_t addr = fetch();                               // ADDR WILL BE NEEDED FOR OUTPUT, NO QUESTIONS ASKED, IT WONT WORK OTHER WAY
-		mMemory[addr] = rotateleft(mMemory[addr]);
-		//OutForComAndMode("instructionname", "addressingmode", "addr");
-		OutForComAndModeENUM("ROL", ZPG, addr);
-		//if (ISDEBUG) { std::cout << "ROL" << "\t" << std::hex << std::setw(2) << std::setfill('0') << addr; }
-	}
-
-	void rotateLeftZeroPageX()
-	{
-		uint8_t addr = fetch();
-		mMemory[addr + mRegisterX] = rotateleft(mMemory[addr + mRegisterX]);
-		OutForComAndModeENUM("ROL", ZPG, addr);
-		//if (ISDEBUG) { std::cout << "ROL" << "\t" << std::hex << std::setw(2) << std::setfill('0') << addr << ",x"; }
-	}
-
-	void rotateLeftAbsoluteX()
-	{
-		uint16_t addr = fetch16();
-		mMemory[addr + mRegisterX] = rotateleft(mMemory[addr + mRegisterX]);
-		OutForComAndModeENUM("ROL", ABX, addr);
-		//if (ISDEBUG) { std::cout << "ROL" << "\t" << std::hex << std::setw(4) << std::setfill('0') << addr << ",x"; }
-	}
-
-	void rotateLeftAbsolute()
-	{
-		uint16_t addr = fetch16();
-		mMemory[addr] = rotateleft(mMemory[addr]);
-		OutForComAndModeENUM("ROL", ABS, addr);
-		//if (ISDEBUG) { std::cout << "ROL" << "\t" << std::hex << std::setw(2) << std::setfill('0') << addr; }
-	}
-
-
-
-	void shiftLeftAccumulator()
-	{
-		mAccumulator = shiftleft(mAccumulator);
-		OutForComAndModeENUM("ASL", A, 0);
-		//if (ISDEBUG) { std::cout << "ASL" << "\t" << "A"; }
-	}
-
-	void shiftLeftZeroPage()
-	{
-		uint8_t addr = fetch();                               // ADDR WILL BE NEEDED FOR OUTPUT, NO QUESTIONS ASKED, IT WONT WORK OTHER WAY
-		mMemory[addr] = shiftleft(mMemory[addr]);
-		//OutForComAndMode("instructionname", "addressingmode", "addr");
-		OutForComAndModeENUM("ASL", ZPG, addr);
-		//if (ISDEBUG) { std::cout << "ASL" << "\t" << std::hex << std::setw(2) << std::setfill('0') << addr; }
-	}
-
-	void shiftLeftZeroPageX()
-	{
-		uint8_t addr = fetch();
-		mMemory[addr + mRegisterX] = shiftleft(mMemory[addr + mRegisterX]);
-		OutForComAndModeENUM("ASL", ZPG, addr);
-		//if (ISDEBUG) { std::cout << "ASL" << "\t" << std::hex << std::setw(2) << std::setfill('0') << addr << ",x"; }
-	}
-
-	void shiftLeftAbsoluteX()
-	{
-		uint16_t addr = fetch16();
-		mMemory[addr + mRegisterX] = shiftleft(mMemory[addr + mRegisterX]);
-		OutForComAndModeENUM("ASL", ABX, addr);
-		//if (ISDEBUG) { std::cout << "ASL" << "\t" << std::hex << std::setw(4) << std::setfill('0') << addr << ",x"; }
-	}
-
-	void shiftLeftAbsolute()
-	{
-		uint16_t addr = fetch16();
-		mMemory[addr] = shiftleft(mMemory[addr]);
-		OutForComAndModeENUM("ASL", ABS, addr);
-		//if (ISDEBUG) { std::cout << "ASL" << "\t" << std::hex << std::setw(2) << std::setfill('0') << addr; }
-	}
-
-
-
-	void rotateRightZeroPage()
-	{
-		uint8_t addr = fetch();
-		mMemory[addr] = rotateright(mMemory[addr]);
-		OutForComAndModeENUM("ROR", ZPG, addr);
-		//if (ISDEBUG) { std::cout << "ROL" << "\t" << std::hex << std::setw(2) << std::setfill('0') << addr; }
-	}
-
-	void rotateRightAccumulator()
-	{
-		mAccumulator = rotateright(mAccumulator);
-		OutForComAndModeENUM("ROR", A, 0);
-	}
-
-	void rotateRightZeroPageX()
-	{
-		uint8_t addr = fetch();
-		mMemory[addr + mRegisterX] = rotateright(mMemory[addr + mRegisterX]);
-		OutForComAndModeENUM("ROR", ZPX, addr);
-		//if (ISDEBUG) { std::cout << "ROL" << "\t" << std::hex << std::setw(2) << std::setfill('0') << addr << ",x"; }
-	}
-
-	void rotateRightAbsoluteX()
-	{
-		uint16_t addr = fetch16();
-		mMemory[addr + mRegisterX] = rotateright(mMemory[addr + mRegisterX]);
-		OutForComAndModeENUM("ROR", ABX, addr);
-		//if (ISDEBUG) { std::cout << "ROL" << "\t" << std::hex << std::setw(4) << std::setfill('0') << addr << ",x"; }
-	}
-
-	void rotateRightAbsolute()
-	{
-		uint16_t addr = fetch16();
-		mMemory[addr] = rotateright(mMemory[addr]);
-		OutForComAndModeENUM("ROR", ABS, addr);
-		//if (ISDEBUG) { std::cout << "ROL" << "\t" << std::hex << std::setw(2) << std::setfill('0') << addr; }
-	}
-
-
-
-	void shiftRightZeroPage()
-	{
-		uint8_t addr = fetch();
-		mMemory[addr] = rotateright(mMemory[addr]);
-		OutForComAndModeENUM("LSR", ZPG, addr);
-		//if (ISDEBUG) { std::cout << "LSR" << "\t" << std::hex << std::setw(2) << std::setfill('0') << addr; }
-	}
-
-	void shiftRightAccumulator()
-	{
-		mAccumulator = rotateright(mAccumulator);
-		OutForComAndModeENUM("LSR", A, 0);
-	}
-
-	void shiftRightZeroPageX()
-	{
-		uint8_t addr = fetch();
-		mMemory[addr + mRegisterX] = rotateright(mMemory[addr + mRegisterX]);
-		OutForComAndModeENUM("LSR", ZPX, addr);
-		//if (ISDEBUG) { std::cout << "LSR" << "\t" << std::hex << std::setw(2) << std::setfill('0') << addr << ",x"; }
-	}
-
-	void shiftRightAbsoluteX()
-	{
-		uint16_t addr = fetch16();
-		mMemory[addr + mRegisterX] = rotateright(mMemory[addr + mRegisterX]);
-		OutForComAndModeENUM("LSR", ABX, addr);
-		//if (ISDEBUG) { std::cout << "LSR" << "\t" << std::hex << std::setw(4) << std::setfill('0') << addr << ",x"; }
-	}
-
-	void shiftRightAbsolute()
-	{
-		uint16_t addr = fetch16();
-		mMemory[addr] = rotateright(mMemory[addr]);
-		OutForComAndModeENUM("LSR", ABS, addr);
-		//if (ISDEBUG) { std::cout << "LSR" << "\t" << std::hex << std::setw(2) << std::setfill('0') << addr; }
-	}
-
-
-
-	void transferAccToX()
-	{
-		if (ISDEBUG) { std::cout << "TAX" << "\t"; }
-		mRegisterX = mAccumulator;
-		setZeroAndNegativeFlags(mRegisterX);
-	}
-
-	void transferAccToY()
-	{
-		if (ISDEBUG) { std::cout << "TAY" << "\t"; }
-		mRegisterY = mAccumulator;
-		setZeroAndNegativeFlags(mRegisterY);
-	}
-
-	void transferStackToX()
-	{
-		if (ISDEBUG) { std::cout << "TSX" << "\t"; }
-		mRegisterX = mStackPointer;
-		setZeroAndNegativeFlags(mRegisterX);
-	}
-
-	void transferXToAcc()
-	{
-		if (ISDEBUG) { std::cout << "TXA" << "\t"; }
-		mAccumulator = mRegisterX;
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void transferYToAcc()
-	{
-		if (ISDEBUG) { std::cout << "TYA" << "\t"; }
-		mAccumulator = mRegisterY;
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void transferXToStack()
-	{
-		if (ISDEBUG) { std::cout << "TXS" << "\t"; }
-		mStackPointer = mRegisterX;
-	}
-
-	uint8_t add(uint8_t valueA, uint8_t valueB, bool carry, bool bcd)
-	{
-		uint16_t result;
-
-		if (bcd)
-		{
-			bool bcdCarry = false;
-			result = (valueA & 0xF) + (valueB & 0xF) + carry;
-			if (result > 9)
-			{
-				result -= 10;
-				bcdCarry = true;
-			}
-
-			uint16_t leftNibble = ((valueA & 0xF0) >> 4) + ((valueB & 0xF0) >> 4) + bcdCarry;
-			if (leftNibble > 9)
-			{
-				leftNibble -= 10;
-			}
-
-			result += leftNibble << 4;
-		}
-		else
-		{
-			result = valueA + valueB + (carry ? 1 : 0);
-		}
-
-		C = (result & 0x100) != 0;
-		V = ((valueA ^ valueB) & 0x80) == 0 && ((valueA ^ result) & 0x80) != 0;
-		Z = (result & 0xFF) == 0;
-		N = (result & 0x80) != 0;
-
-		return static_cast<uint8_t>(result & 0xFF);
-	}
-
-	uint8_t sub(uint8_t valueA, uint8_t valueB, bool carry, bool bcd)
-	{
-		uint16_t result;
-
-		if (bcd)
-		{
-			bool bcdCarry = true;
-			result = (valueA & 0xF) + ((~valueB) & 0xF) + (bcdCarry ? 1 : 0); //BCDcarry will always be true here, if i am not mistaken?
-			if ((valueA & 0xF) < (valueB & 0xF))
-				bcdCarry = false;
-
-			uint16_t leftNibble = (valueA & 0xF0) + ((~valueB) & 0xF0) + (bcdCarry ? 1 : 0);
-			result += leftNibble << 4;
-		}
-		else
-		{
-			result = valueA - valueB - (carry ? 0 : 1); // CF inverted on sub
-		}
-
-		C = (result & 0x100) == 0; // CF inverted on sub
-		V = ((valueA ^ valueB) & 0x80) == 0 && ((valueA ^ result) & 0x80) != 0;
-		Z = (result & 0xFF) == 0;
-		N = (result & 0x80) != 0;
-
-		return static_cast<uint8_t>(result & 0xFF);
-	}
-
-	void compareBase(uint8_t valueA, uint8_t valueB)
-	{
-		uint8_t tempVSave = V;
-		uint8_t result = sub(valueA, valueB, true, false);
-		V = tempVSave;
-	}
-
-	//OR WITH MEMORY OR ACCUMULATOR
-
-	void orWithMemoryOrAccImmediate()
-	{
-		uint8_t value = fetch();
-		mAccumulator = value | mAccumulator;
-		if (ISDEBUG) { std::cout << "ORA" << "\t" << "#" << (int)value; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void orWithMemoryOrAccZeroP()
-	{
-		uint8_t addr = fetch();
-		uint8_t value = mMemory[addr];
-		mAccumulator = value | mAccumulator;
-		if (ISDEBUG) { std::cout << "ORA" << "\t" << std::hex << std::setw(2) << std::setfill('0') << addr; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void orWithMemoryOrAccZeroPX()
-	{
-		uint8_t addr = fetch();
-		uint8_t value = mMemory[addr + mRegisterX];
-		mAccumulator = value | mAccumulator;
-		if (ISDEBUG) { std::cout << "ORA" << "\t" << std::hex << std::setw(2) << std::setfill('0') << addr << ",x"; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void orWithMemoryOrAccAbs()
-	{
-		uint16_t addr = fetch16();
-		uint8_t value = mMemory[addr];
-		mAccumulator = value | mAccumulator;
-		if (ISDEBUG) { std::cout << "ORA" << "\t" << std::hex << std::setw(4) << std::setfill('0') << addr; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void orWithMemoryOrAccAbsX()
-	{
-		uint16_t addr = fetch16();
-		uint8_t value = mMemory[addr + mRegisterX];
-		mAccumulator = value | mAccumulator;
-		if (ISDEBUG) { std::cout << "ORA" << "\t" << std::hex << std::setw(4) << std::setfill('0') << addr << ",x"; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void orWithMemoryOrAccAbsY()
-	{
-		uint16_t addr = fetch16();
-		uint8_t value = mMemory[addr + mRegisterY];
-		mAccumulator = value | mAccumulator;
-		if (ISDEBUG) { std::cout << "ORA" << "\t" << std::hex << std::setw(4) << std::setfill('0') << addr << ",y"; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void orWithMemoryOrAccIndX()
-	{
-		uint8_t lookupaddress = fetch() + mRegisterX;
-		uint8_t value = mMemory[mMemory[lookupaddress] + (mMemory[lookupaddress + 1] << 8)];
-		mAccumulator = value | mAccumulator;
-		if (ISDEBUG) { std::cout << "ORA" << "\t" << "(" << std::hex << std::setw(4) << std::setfill('0') << lookupaddress << ",x)"; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void orWithMemoryOrAccIndY()
-	{
-		uint8_t lookupaddress = fetch();
-		uint8_t value = mMemory[(mMemory[lookupaddress] + (mMemory[lookupaddress + 1] << 8)) + mRegisterY];
-		mAccumulator = value | mAccumulator;
-		if (ISDEBUG) { std::cout << "ORA" << "\t" << "(" << std::hex << std::setw(4) << std::setfill('0') << lookupaddress << "),y"; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	//XOR WITH MEMORY OR ACCUMULATOR
-
-	void xorWithMemoryOrAccImmediate()
-	{
-		uint8_t value = fetch();
-		mAccumulator = value ^ mAccumulator;
-		if (ISDEBUG) { std::cout << "EOR" << "\t" << "#" << (int)value; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void xorWithMemoryOrAccZeroP()
-	{
-		uint8_t addr = fetch();
-		uint8_t value = mMemory[addr];
-		mAccumulator = value ^ mAccumulator;
-		if (ISDEBUG) { std::cout << "EOR" << "\t" << std::hex << std::setw(2) << std::setfill('0') << addr; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void xorWithMemoryOrAccZeroPX()
-	{
-		uint8_t addr = fetch();
-		uint8_t value = mMemory[addr + mRegisterX];
-		mAccumulator = value ^ mAccumulator;
-		if (ISDEBUG) { std::cout << "EOR" << "\t" << std::hex << std::setw(2) << std::setfill('0') << addr << ",x"; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void xorWithMemoryOrAccAbs()
-	{
-		uint16_t addr = fetch16();
-		uint8_t value = mMemory[addr];
-		mAccumulator = value ^ mAccumulator;
-		if (ISDEBUG) { std::cout << "EOR" << "\t" << std::hex << std::setw(4) << std::setfill('0') << addr; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void xorWithMemoryOrAccAbsX()
-	{
-		uint16_t addr = fetch16();
-		uint8_t value = mMemory[addr + mRegisterX];
-		mAccumulator = value ^ mAccumulator;
-		if (ISDEBUG) { std::cout << "EOR" << "\t" << std::hex << std::setw(4) << std::setfill('0') << addr << ",x"; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void xorWithMemoryOrAccAbsY()
-	{
-		uint16_t addr = fetch16();
-		uint8_t value = mMemory[addr + mRegisterY];
-		mAccumulator = value ^ mAccumulator;
-		if (ISDEBUG) { std::cout << "EOR" << "\t" << std::hex << std::setw(4) << std::setfill('0') << addr << ",y"; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void xorWithMemoryOrAccIndX()
-	{
-		uint8_t lookupaddress = fetch() + mRegisterX;
-		uint8_t value = mMemory[mMemory[lookupaddress] + (mMemory[lookupaddress + 1] << 8)];
-		mAccumulator = value ^ mAccumulator;
-		if (ISDEBUG) { std::cout << "EOR" << "\t" << "(" << std::hex << std::setw(4) << std::setfill('0') << lookupaddress << ",x)"; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void xorWithMemoryOrAccIndY()
-	{
-		uint8_t lookupaddress = fetch();
-		uint8_t value = mMemory[(mMemory[lookupaddress] + (mMemory[lookupaddress + 1] << 8)) + mRegisterY];
-		mAccumulator = value ^ mAccumulator;
-		if (ISDEBUG) { std::cout << "EOR" << "\t" << "(" << std::hex << std::setw(4) << std::setfill('0') << lookupaddress << "),y"; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	// AND WITH MEMORY OR ACCUMULATOR
-
-	void andWithMemoryOrAccImmediate()
-	{
-		uint8_t value = fetch();
-		mAccumulator = value & mAccumulator;
-		if (ISDEBUG) { std::cout << "AND" << "\t" << "#" << (int)value; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void andWithMemoryOrAccZeroP()
-	{
-		uint8_t addr = fetch();
-		uint8_t value = mMemory[addr];
-		mAccumulator = value & mAccumulator;
-		if (ISDEBUG) { std::cout << "AND" << "\t" << std::hex << std::setw(2) << std::setfill('0') << addr; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void andWithMemoryOrAccZeroPX()
-	{
-		uint8_t addr = fetch();
-		uint8_t value = mMemory[addr + mRegisterX];
-		mAccumulator = value & mAccumulator;
-		if (ISDEBUG) { std::cout << "AND" << "\t" << std::hex << std::setw(2) << std::setfill('0') << addr << ",x"; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void andWithMemoryOrAccAbs()
-	{
-		uint16_t addr = fetch16();
-		uint8_t value = mMemory[addr];
-		mAccumulator = value & mAccumulator;
-		if (ISDEBUG) { std::cout << "AND" << "\t" << std::hex << std::setw(4) << std::setfill('0') << addr; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void andWithMemoryOrAccAbsX()
-	{
-		uint16_t addr = fetch16();
-		uint8_t value = mMemory[addr + mRegisterX];
-		mAccumulator = value & mAccumulator;
-		if (ISDEBUG) { std::cout << "AND" << "\t" << std::hex << std::setw(4) << std::setfill('0') << addr << ",x"; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void andWithMemoryOrAccAbsY()
-	{
-		uint16_t addr = fetch16();
-		uint8_t value = mMemory[addr + mRegisterY];
-		mAccumulator = value & mAccumulator;
-		if (ISDEBUG) { std::cout << "AND" << "\t" << std::hex << std::setw(4) << std::setfill('0') << addr << ",y"; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void andWithMemoryOrAccIndX()
-	{
-		uint8_t lookupaddress = fetch() + mRegisterX;
-		uint8_t value = mMemory[mMemory[lookupaddress] + (mMemory[lookupaddress + 1] << 8)];
-		mAccumulator = value & mAccumulator;
-		if (ISDEBUG) { std::cout << "AND" << "\t" << "(" << std::hex << std::setw(4) << std::setfill('0') << lookupaddress << ",x)"; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	void andWithMemoryOrAccIndY()
-	{
-		uint8_t lookupaddress = fetch();
-		uint8_t value = mMemory[(mMemory[lookupaddress] + (mMemory[lookupaddress + 1] << 8)) + mRegisterY];
-		mAccumulator = value & mAccumulator;
-		if (ISDEBUG) { std::cout << "AND" << "\t" << "(" << std::hex << std::setw(4) << std::setfill('0') << lookupaddress << "),y"; }
-		setZeroAndNegativeFlags(mAccumulator);
-	}
-
-	//ADC
-
-	void adcWithMemoryOrAccImmediate()
-	{
-		uint8_t value = fetch();
-		mAccumulator = add(value, mAccumulator, C, D);
-		if (ISDEBUG) { std::cout << "ADC" << "\t" << "#" << (int)value; }
-	}
-
-	void adcWithMemoryOrAccZeroP()
-	{
-		uint8_t addr = fetch();
-		uint8_t value = mMemory[addr];
-		mAccumulator = add(value, mAccumulator, C, D);
-		if (ISDEBUG) { std::cout << "ADC" << "\t" << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(addr); }
-	}
-
-	void adcWithMemoryOrAccZeroPX()
-	{
-		uint8_t addr = fetch();
-		uint8_t value = mMemory[addr + mRegisterX];
-		mAccumulator = add(value, mAccumulator, C, D);
-		if (ISDEBUG) { std::cout << "ADC" << "\t" << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(addr) << ",x"; }
-	}
-
-	void adcWithMemoryOrAccAbs()
-	{
-		uint16_t addr = fetch16();
-		uint8_t value = mMemory[addr];
-		mAccumulator = add(value, mAccumulator, C, D);
-		if (ISDEBUG) { std::cout << "ADC" << "\t" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(addr); }
-	}
-
-	void adcWithMemoryOrAccAbsX()
-	{
-		uint16_t addr = fetch16();
-		uint8_t value = mMemory[addr + mRegisterX];
-		mAccumulator = add(value, mAccumulator, C, D);
-		if (ISDEBUG) { std::cout << "ADC" << "\t" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(addr) << ",x"; }
-	}
-
-	void adcWithMemoryOrAccAbsY()
-	{
-		uint16_t addr = fetch16();
-		uint8_t value = mMemory[addr + mRegisterY];
-		mAccumulator = add(value, mAccumulator, C, D);
-		if (ISDEBUG) { std::cout << "ADC" << "\t" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(addr) << ",y"; }
-	}
-
-	void adcWithMemoryOrAccIndX()
-	{
-		uint8_t lookupaddress = fetch() + mRegisterX;
-		uint8_t value = mMemory[mMemory[lookupaddress] + (mMemory[lookupaddress + 1] << 8)];
-		mAccumulator = add(value, mAccumulator, C, D);
-		if (ISDEBUG) { std::cout << "ADC" << "\t" << "(" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(lookupaddress) << ",x)"; }
-	}
-
-	void adcWithMemoryOrAccIndY()
-	{
-		uint8_t lookupaddress = fetch();
-		uint8_t value = mMemory[(mMemory[lookupaddress] + (mMemory[lookupaddress + 1] << 8)) + mRegisterY];
-		mAccumulator = add(value, mAccumulator, C, D);
-		if (ISDEBUG) { std::cout << "ADC" << "\t" << "(" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(lookupaddress) << "),y"; }
-	}
-
-	//SBC
-
-	void sbcWithMemoryOrAccImmediate()
-	{
-		uint8_t value = fetch();
-		mAccumulator = sub(mAccumulator, value, C, D);
-		if (ISDEBUG) { std::cout << "SBC" << "\t" << "#" << "$" << std::hex << std::setw(2) << std::setfill('0') << (uint16_t)value; }
-	}
-
-	void sbcWithMemoryOrAccZeroP()
-	{
-		uint8_t addr = fetch();
-		uint8_t value = mMemory[addr];
-		mAccumulator = sub(mAccumulator, value, C, D);
-		if (ISDEBUG) { std::cout << "SBC" << "\t" << "$" << std::hex << std::setw(2) << std::setfill('0') << (uint16_t)addr; }
-	}
-
-	void sbcWithMemoryOrAccZeroPX()
-	{
-		uint8_t addr = fetch();
-		uint8_t value = mMemory[addr + mRegisterX];
-		mAccumulator = add(mAccumulator, value, C, D);
-		if (ISDEBUG) { std::cout << "SBC" << "\t" << "$" << std::hex << std::setw(2) << std::setfill('0') << (uint16_t)addr << ",x"; }
-	}
-
-	void sbcWithMemoryOrAccAbs()
-	{
-		uint16_t addr = fetch16();
-		uint8_t value = mMemory[addr];
-		mAccumulator = sub(mAccumulator, value, C, D);
-		if (ISDEBUG) { std::cout << "SBC" << "\t" << "$" << std::hex << std::setw(4) << std::setfill('0') << addr; }
-	}
-
-	void sbcWithMemoryOrAccAbsX()
-	{
-		uint16_t addr = fetch16();
-		uint8_t value = mMemory[addr + mRegisterX];
-		mAccumulator = sub(mAccumulator, value, C, D);
-		if (ISDEBUG) { std::cout << "SBC" << "\t" << "$" << std::hex << std::setw(4) << std::setfill('0') << addr << ",x"; }
-	}
-
-	void sbcWithMemoryOrAccAbsY()
-	{
-		uint16_t addr = fetch16();
-		uint8_t value = mMemory[addr + mRegisterY];
-		mAccumulator = sub(mAccumulator, value, C, D);
-		if (ISDEBUG) { std::cout << "SBC" << "\t" << "$" << std::hex << std::setw(4) << std::setfill('0') << addr << ",y"; }
-	}
-
-	void sbcWithMemoryOrAccIndX()
-	{
-		uint8_t lookupaddress = fetch() + mRegisterX;
-		uint8_t value = mMemory[mMemory[lookupaddress] + (mMemory[lookupaddress + 1] << 8)];
-		mAccumulator = sub(mAccumulator, value, C, D);
-		if (ISDEBUG) { std::cout << "SBC" << "\t" << "(" << "$" << std::hex << std::setw(4) << std::setfill('0') << (uint16_t)lookupaddress << ",x)"; }
-	}
-
-	void sbcWithMemoryOrAccIndY()
-	{
-		uint8_t lookupaddress = fetch();
-		uint8_t value = mMemory[(mMemory[lookupaddress] + (mMemory[lookupaddress + 1] << 8)) + mRegisterY];
-		mAccumulator = sub(mAccumulator, value, C, D);
-		if (ISDEBUG) { std::cout << "SBC" << "\t" << "(" << "$" << std::hex << std::setw(4) << std::setfill('0') << (uint16_t)lookupaddress << "),y"; }
-	}
-
-	//"VAL" IN ALL COMPARE OPERATIONS IS VALUE OF THE CHOSEN REGISTER AND IS NOT THE VALUE IT IS BEING COMPARED WITH.
-	//VALUE THAT IT IS BEING COMPARED TO IS NAMED "VALUE" IN CODE
-
-
-
-	void compareImmediate(const char* instruction, uint8_t val)
-	{
-		uint8_t value = fetch();
-		if (ISDEBUG) { std::cout << instruction << "\t" << "#" << "$" << std::hex << std::setw(2) << std::setfill('0') << (uint16_t)value; }
-		compareBase(val, value);
-	}
-
-	void compareAbsolute(const char* instruction, uint8_t val)
-	{
-		uint16_t addr = fetch16();
-		uint8_t value = mMemory[addr];
-		if (ISDEBUG) { std::cout << instruction << "\t" << "$" << std::hex << std::setw(4) << std::setfill('0') << addr; }
-		compareBase(val, value);
-	}
-
-	void compareZeroPage(const char* instruction, uint8_t val)
-	{
-		uint8_t addr = fetch();
-		uint8_t value = mMemory[addr];
-		if (ISDEBUG) { std::cout << instruction << "\t" << "$" << std::hex << std::setw(2) << std::setfill('0') << (uint16_t)addr; }
-		compareBase(val, value);
-	}
-
-	void compareZeroPageX(const char* instruction, uint8_t val)
-	{
-		uint8_t addr = fetch();
-		uint8_t value = mMemory[addr + mRegisterX];
-		if (ISDEBUG) { std::cout << instruction << "\t" << "$" << std::hex << std::setw(2) << std::setfill('0') << (uint16_t)addr << ",x"; }
-		compareBase(val, value);
-	}
-
-	void compareAbsoluteX(const char* instruction, uint8_t val)
-	{
-		uint16_t addr = fetch16();
-		uint8_t value = mMemory[addr + mRegisterX];
-		if (ISDEBUG) { std::cout << instruction << "\t" << "$" << std::hex << std::setw(4) << std::setfill('0') << addr << ",x"; }
-		compareBase(val, value);
-	}
-
-	void compareAbsoluteY(const char* instruction, uint8_t val)
-	{
-		uint16_t addr = fetch16();
-		uint8_t value = mMemory[addr + mRegisterY];
-		if (ISDEBUG) { std::cout << instruction << "\t" << "$" << std::hex << std::setw(4) << std::setfill('0') << addr << ",y"; }
-		compareBase(val, value);
-	}
-
-	void compareIndY(const char* instruction, uint8_t val)
-	{
-		uint8_t lookupaddress = fetch();
-
-		//uint16_t addr = (mMemory[lookupaddress] + mMemory[lookupaddress + 1] << 8) + mRegisterY;
-		uint8_t value = mMemory[(mMemory[lookupaddress] + (mMemory[lookupaddress + 1] << 8)) + mRegisterY];
-		if (ISDEBUG) { std::cout << instruction << "\t" << "(" << "$" << std::hex << std::setw(4) << std::setfill('0') << (uint16_t)lookupaddress << "),y"; }
-		compareBase(val, value);
-	}
-
-	void compareIndX(const char* instruction, uint8_t val)
-	{
-		uint8_t lookupaddress = fetch() + mRegisterX;
-
-		//uint16_t addr = (mMemory[lookupaddress + mRegisterX] + mMemory[lookupaddress + mRegisterX + 1] << 8);
-		uint8_t value = mMemory[mMemory[lookupaddress] + (mMemory[lookupaddress + 1] << 8)];
-		if (ISDEBUG) { std::cout << instruction << "\t" << "(" << "$" << std::hex << std::setw(4) << std::setfill('0') << (uint16_t)lookupaddress << ",x)"; }
-		compareBase(val, value);
-	}
-
-
+// basicOpsProgram translated by 6502_Recompiler from tests/images/basic_ops.bin at build time, see CMakeLists.txt
+extern const RecompiledCpu::Translation basicOpsTranslation;
 
+static bool TestBasicOps()
+{
+	bool isOk = true;
 
-	void bitTestAbsolute()
-	{
-		uint16_t addr = fetch16();
-		uint8_t value = mMemory[addr];
-		N = (value & 0x80) != 0;
-		V = (value & 0x40) != 0;
-		Z = (value & mAccumulator) == 0;
-		if (ISDEBUG) { std::cout << "BIT" << "\t" << std::hex << std::setw(4) << std::setfill('0') << addr; }
-	}
+	auto cpu = std::make_shared<MOS6502Debug>();
+	cpu->loadProgram(basicOpsProgram, sizeof(basicOpsProgram), 0x1000);
 
-	//THIS is never used, delete or change code
-	void bitTestZeroPage()
+	if (isOk)
 	{
-		uint8_t addr = fetch();
-		uint8_t value = mMemory[addr];
-		N = (value & 0x80) != 0;
-		V = (value & 0x40) != 0;
-		Z = (value & mAccumulator) == 0;
-		if (ISDEBUG) { std::cout << "BIT" << "\t" << std::hex << std::setw(2) << std::setfill('0') << addr; }
-	}
-
-
+		// ; test ADC_XY16
+		cpu->executeFrom(0x1000);
 
-	void branchNonZero()
-	{
-		int8_t fetchedByte = branchBase("BNE");
-		if (Z == 0)
+		if (cpu->getMemory(0x05) != 0x04)
 		{
-			mProgramCounter += fetchedByte;
-			branchDebugPrint("BNE", fetchedByte);
+			isOk = false;
 		}
-	}
 
-	void branchCarrySet()
-	{
-		int8_t fetchedByte = branchBase("BCS");
-		if (C == 1)
+		if (cpu->getMemory(0x06) != 0x79)
 		{
-			mProgramCounter += fetchedByte;
-			branchDebugPrint("BCS", fetchedByte);
+			isOk = false;
 		}
-	}
 
-	void branchCarryClear()
-	{
-		int8_t fetchedByte = branchBase("BCC");
-		if (C == 0)
-		{
-			mProgramCounter += fetchedByte;
-			branchDebugPrint("BCC", fetchedByte);
-		}
+		std::cout << "Test ADC_XY16:" << ((isOk) ? "OK" : "FAIL") << "\n";
 	}
 
-	void branchZero()
+	if (isOk)
 	{
-		int8_t fetchedByte = branchBase("BEQ");
-		if (Z == 1)
-		{
-			mProgramCounter += fetchedByte;
-			branchDebugPrint("BEQ", fetchedByte);
-		}
-	}
+		cpu->executeFrom(0x1019);
 
-	void branchMinus()
-	{
-		int8_t fetchedByte = branchBase("BMI");
-		if (N == 1)
+		if (cpu->getMemory(0x03) != 0xEE)
 		{
-			mProgramCounter += fetchedByte;
-			branchDebugPrint("BMI", fetchedByte);
+			isOk = false;
 		}
-	}
 
-	void branchPlus()
-	{
-		int8_t fetchedByte = branchBase("BPL");
-		if (N == 0)
+		if (cpu->getMemory(0x04) != 0x02)
 		{
-			mProgramCounter += fetchedByte;
-			branchDebugPrint("BPL", fetchedByte);
+			isOk = false;
 		}
+
+		std::cout << "Test MUL_XY16:" << ((isOk) ? "OK" : "FAIL") << "\n";
 	}
 
-	void branchOverflowClear()
+	if (isOk)
 	{
-		int8_t fetchedByte = branchBase("BVC");
-		if (V == 0)
+		cpu->executeFrom(0x1035);
+
+		if (cpu->getMemory(0x03) != 0x02)
 		{
-			mProgramCounter += fetchedByte;
-			branchDebugPrint("BVC", fetchedByte);
+			isOk = false;
 		}
-	}
 
-	void branchOverflowSet()
-	{
-		int8_t fetchedByte = branchBase("BVS");
-		if (V == 1)
+		if (cpu->getMemory(0x04) != 0x00)
 		{
-			mProgramCounter += fetchedByte;
-			branchDebugPrint("BVS", fetchedByte);
+			isOk = false;
 		}
-	}
 
-	int8_t branchBase(char const* instruction)
-	{
-		if (ISDEBUG) { std::cout << instruction; }
-		int8_t offset = fetch();
-		if (ISDEBUG) { std::cout << "\t" << (uint16_t)(mProgramCounter + offset); }
-		return offset;
+		std::cout << "Test DIV_XY:" << ((isOk) ? "OK" : "FAIL") << "\n";
 	}
 
-	void branchDebugPrint(const char* instruction, int8_t fetchedByte)
+	return(isOk);
+}
+
+static bool TestImageSharing()
+{
+	// two CPUs map the same image: a write copies only the page it hits, and only in the CPU that wrote
+	ImageStore store;
+	std::shared_ptr<const ProgramImage> image = store.load(basicOpsProgram, sizeof(basicOpsProgram), 0x1000);
+	MOS6502Debug writer;
+	MOS6502Debug reader;
+	writer.ISDEBUG = false;
+	reader.ISDEBUG = false;
+	writer.mapImage(image);
+	reader.mapImage(image);
+
+	bool isOk = store.load(basicOpsProgram, sizeof(basicOpsProgram), 0x1000) == image && store.residentImages() == 1
+		&& writer.privatePages() == 0 && reader.privatePages() == 0;
+	writer.setMemory(0x1001, 0x42);
+	isOk = isOk && writer.getMemory(0x1001) == 0x42 && reader.getMemory(0x1001) == basicOpsProgram[1]
+		&& writer.getMemory(0x1002) == basicOpsProgram[2] && writer.privatePages() == 1 && reader.privatePages() == 0;
+
+	std::cout << "Test image sharing:" << ((isOk) ? "OK" : "FAIL") << "\n";
+	return isOk;
+}
+
+static bool TestWarmStart()
+{
+	// ADC_XY16 runs once up to the HALT behind its JSR; both clones start right there and share all of its pages
+	WarmStartCache<MOS6502Debug> cache;
+	ImageStore store;
+	WarmStartCache<MOS6502Debug>::Images images = { store.load(basicOpsProgram, sizeof(basicOpsProgram), 0x1000) };
+	std::unique_ptr<MOS6502Debug> first = cache.clone(images, 0x1000, 0x1018);
+	std::unique_ptr<MOS6502Debug> second = cache.clone(images, 0x1000, 0x1018);
+
+	bool isOk = first && second && cache.misses() == 1 && cache.hits() == 1;
+	isOk = isOk && first->privatePages() == 0 && second->privatePages() == 0
+		&& first->getProgramCounter() == 0x1018 && second->getProgramCounter() == 0x1018
+		&& first->getAccumulator() == second->getAccumulator() && first->getStatus() == second->getStatus()
+		&& first->getStackPointer() == second->getStackPointer() && first->cycles() == second->cycles()
+		&& first->getMemory(0x05) == 0x04 && first->getMemory(0x06) == 0x79
+		&& second->getMemory(0x05) == 0x04 && second->getMemory(0x06) == 0x79;
+	if (isOk)
 	{
-		if (ISDEBUG)
-		{
-			std::cout << ";+";
-		}
+		first->setMemory(0x05, 0x00);
+		isOk = first->privatePages() == 1 && second->privatePages() == 0 && second->getMemory(0x05) == 0x04;
 	}
 
-	uint16_t jumpAbsolute()
-	{
-		//std::cout << "JMP (absolute) started, PC: " << mProgramCounter << std::endl;
+	// the same contents loaded again are the same image and hit; a program that differs in one byte boots anew
+	std::vector<uint8_t> changed(std::begin(basicOpsProgram), std::end(basicOpsProgram));
+	changed[1] ^= 0x01;
+	WarmStartCache<MOS6502Debug>::Images same = { store.load(basicOpsProgram, sizeof(basicOpsProgram), 0x1000) };
+	WarmStartCache<MOS6502Debug>::Images other = { store.load(changed.data(), changed.size(), 0x1000) };
+	isOk = isOk && cache.warm(same, 0x1000, 0x1018) && cache.hits() == 2 && cache.warm(other, 0x1000, 0x1018) != cache.warm(images, 0x1000, 0x1018)
+		&& cache.misses() == 2;
 
-		uint16_t jumpAddress = fetch16();
+	std::cout << "Test warm start:" << ((isOk) ? "OK" : "FAIL") << "\n";
+	return isOk;
+}
 
-		//std::cout << "New Address: " << jumpAddress << std::endl;
-		if (ISDEBUG) { std::cout << "JMP" << "\t" << "#" << jumpAddress; }
-		return jumpAddress;
-	}
+static bool TestMemoryProfile(const std::string& heatmap)
+{
+	// ADC_XY16 stores its four operands and the two result bytes to page 0 and its return address to the stack.
+	// The run's summary is printed; with --heatmap prefix the counts are also written to prefix.csv and
+	// prefix_read/write/execute.pgm
+	MOS6502Debug cpu;
+	MemoryProfile profile(true);
+	cpu.ISDEBUG = false;
+	cpu.loadProgram(basicOpsProgram, sizeof(basicOpsProgram), 0x1000);
+	cpu.attachProfile(&profile);
+	cpu.executeFrom(0x1000);
+	cpu.attachProfile(nullptr);
+
+	bool isOk = profile.pageHits(MemoryProfile::Write, 0x00) == 6 && profile.pageHits(MemoryProfile::Read, 0x00) == 4
+		&& profile.pageHits(MemoryProfile::Write, 0x01) == 2 && profile.pageHits(MemoryProfile::Read, 0x01) == 2
+		&& profile.pageHits(MemoryProfile::Execute, 0x10) == 25 + 13 && profile.total(MemoryProfile::Execute) == 25 + 13
+		&& profile.byteHits(MemoryProfile::Write, 0x05) == 1 && profile.byteHits(MemoryProfile::Execute, 0x1044) == 1
+		&& profile.byteHits(MemoryProfile::Execute, 0x1019) == 0;
+	std::ostringstream summary;
+	profile.printSummary(summary, 2);
+	std::cout << summary.str();
+	isOk = isOk && summary.str() == "reads: 6\t; $00xx:4 $01xx:2\nwrites: 8\t; $00xx:6 $01xx:2\nexecutes: 38\t; $10xx:38\n";
+	if (!heatmap.empty())
+	{
+		isOk = profile.writeCsv(heatmap + ".csv") && profile.writePgm(heatmap + "_read.pgm", MemoryProfile::Read)
+			&& profile.writePgm(heatmap + "_write.pgm", MemoryProfile::Write)
+			&& profile.writePgm(heatmap + "_execute.pgm", MemoryProfile::Execute) && isOk;
+	}
+
+	std::cout << "Test memory profile:" << ((isOk) ? "OK" : "FAIL") << "\n";
+	return isOk;
+}
+
+static bool TestBreakpoints()
+{
+	// INX, JMP $0200 with a breakpoint on the JMP; quanta that end exactly on it, by instruction count or by
+	// cycle deadline, have to stop there on the next call, and only resuming from the stop steps over it
+	const uint8_t loop[] = { 0xE8, 0x4C, 0x00, 0x02 };
+	MOS6502Debug cpu;
+	cpu.ISDEBUG = false;
+	cpu.loadProgram(loop, sizeof(loop), 0x0200);
+	cpu.setProgramCounter(0x0200);
+	cpu.addBreakpoint(0x0201);
+
+	bool isOk = cpu.execute(1) == STOP_BUDGET && cpu.execute(2) == STOP_BREAKPOINT && cpu.instructions() == 1
+		&& cpu.getTrapHit().pc == 0x0201;
+	isOk = isOk && cpu.execute(2) == STOP_BUDGET && cpu.getProgramCounter() == 0x0201 && cpu.instructions() == 3;
+	isOk = isOk && cpu.execute() == STOP_BREAKPOINT && cpu.instructions() == 3;
+	isOk = isOk && cpu.execute(UINT64_MAX, cpu.cycles() + 3 + 2) == STOP_BUDGET && cpu.getProgramCounter() == 0x0201
+		&& cpu.execute() == STOP_BREAKPOINT && cpu.instructions() == 5 && cpu.getRegisterX() == 3;
+
+	std::cout << "Test breakpoints:" << ((isOk) ? "OK" : "FAIL") << "\n";
+	return isOk;
+}
 
-	uint16_t jumpAbsoluteSavingAddress()
+#ifndef _WIN32
+static int connectUnix(const std::string& path)
+{
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+	if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
 	{
-		//std::cout << "JMP (absolute) started, PC: " << mProgramCounter << std::endl;
-
-		uint16_t jumpAddress = fetch16();
-		uint16_t savedPosition = mProgramCounter - 1; // address of end of current instruction
-		mMemory[stackOffset + mStackPointer] = ((savedPosition >> 8) & 0xFF);
-		mStackPointer--;
-		mMemory[stackOffset + mStackPointer] = savedPosition & 0xFF;
-		mStackPointer--;
-		//std::cout << "New Address: " << jumpAddress << std::endl;
-		if (ISDEBUG) { std::cout << "JSR" << "\t" << "#" << jumpAddress; }
-		return jumpAddress;
+		::close(fd);
+		return -1;
 	}
+	return fd;
+}
 
-	uint16_t jumpIndirect()
-	{
-		//std::cout << "JMP (indirect) started, PC: " << mProgramCounter << std::endl;
+static void sendBytes(int fd, const std::string& data)
+{
+	// one raw write, so that a packet and a Ctrl-C after it reach the stub together
+	::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+}
 
-		uint16_t lookupAddress = fetch16();
-		mProgramCounter = lookupAddress;
-		//std::cout << "Lookup Address: " << lookupAddress << std::endl;
+static std::string rspPacket(const std::string& payload)
+{
+	static const char digits[] = "0123456789abcdef";
+	uint8_t sum = 0;
+	for (char c : payload) { sum += static_cast<uint8_t>(c); }
+	return "$" + payload + "#" + digits[sum >> 4] + digits[sum & 0xF];
+}
 
-		uint16_t jumpAddress = fetch16();
-		//std::cout << "New Address: " << jumpAddress << std::endl;
-		if (ISDEBUG) { std::cout << "JMP" << "\t" << "(" << "$" << std::hex << std::setw(4) << std::setfill('0') << lookupAddress << ")"; }
-		return jumpAddress;
-	}
+static std::string rspReply(int fd)
+{
+	// skips acks up to the next packet, acknowledges it and returns its payload
+	std::string payload;
+	char c = 0;
+	while (recv(fd, &c, 1, 0) == 1 && c != '$') {}
+	while (recv(fd, &c, 1, 0) == 1 && c != '#') { payload += c; }
+	char checksum[2];
+	if (c != '#' || recv(fd, checksum, 2, MSG_WAITALL) != 2) { return "<closed>"; }
+	sendBytes(fd, "+");
+	return payload;
+}
 
-	uint8_t loadIndirectX(const char* instruction)
+static bool TestGdbStub()
+{
+	// a breakpoint in ADC_XY16, registers and memory at it, and a watchpoint inserted twice and removed once that
+	// must not stop the rest of the run; then a spinning guest that is interrupted while a packet is queued
+	// behind the Ctrl-C, and one whose client goes away while it runs; last a stub whose quanta end on a breakpoint
+	MOS6502Debug cpu;
+	cpu.ISDEBUG = false;
+	cpu.loadProgram(basicOpsProgram, sizeof(basicOpsProgram), 0x1000);
+	cpu.setProgramCounter(0x1000);
+	std::string path = "/tmp/6502_gdb_test." + std::to_string(getpid());
+	GdbStub stub(cpu, 1000);
+	if (!stub.listenUnix(path))
 	{
-		uint8_t lookupAddress = fetch();
+		std::cout << "Test GDB stub:FAIL\n";
+		return false;
+	}
 
-		if (ISDEBUG) { std::cout << instruction << "\t" << "(" << (int)lookupAddress << ",x)"; }
+	bool isOk = true;
+	auto exchange = [&](int fd, const std::string& payload, const std::string& expected) {
+		sendBytes(fd, rspPacket(payload));
+		std::string reply = rspReply(fd);
+		isOk = isOk && (expected == "*" || reply == expected);
+		return reply;
+	};
 
-		lookupAddress += mRegisterX;
-		//if (ISDEBUG) { std::cout << instruction << "\t" << "(" << (int)lookupAddress << ",x)"; }
-		//std::cout << "Lookup address: " << std::hex << static_cast<int>(lookupAddress) << ", x being: " << std::hex << static_cast<int>(mRegisterX) << std::endl;
+	std::thread served([&]() { isOk = stub.serve() && isOk; });
+	int fd = connectUnix(path);
+	exchange(fd, "?", "S05");
+	exchange(fd, "Z0,1044,1", "OK");
+	exchange(fd, "Z2,5,1", "OK");
+	exchange(fd, "Z2,5,1", "OK");
+	exchange(fd, "z2,5,1", "OK");
+	exchange(fd, "c", "T05swbreak:;");
+	isOk = isOk && exchange(fd, "g", "*").substr(8, 4) == "4410";
+	exchange(fd, "m1,4", "83058173");
+	exchange(fd, "z0,1044,1", "OK");
+	exchange(fd, "c", "W00");
+	sendBytes(fd, rspPacket("k"));
+	served.join();
+	::close(fd);
+	isOk = isOk && cpu.getMemory(0x05) == 0x04 && cpu.watchpointSlots() == 0;
+
+	served = std::thread([&]() { isOk = stub.serve() && isOk; });
+	fd = connectUnix(path);
+	exchange(fd, "M2000,3:4c0020", "OK");
+	sendBytes(fd, rspPacket("c2000") + rspPacket("?") + "\x03");
+	isOk = isOk && rspReply(fd) == "S02" && rspReply(fd) == "S05";
+	sendBytes(fd, rspPacket("c"));
+	::close(fd);
+	served.join();
+	isOk = isOk && cpu.getProgramCounter() == 0x2000;
+
+	// INX, INX, JMP $2100 in quanta of two instructions: every quantum ends on the breakpoint on the JMP
+	GdbStub sliced(cpu, 2);
+	isOk = sliced.listenUnix(path + "s") && isOk;
+	served = std::thread([&]() { isOk = sliced.serve() && isOk; });
+	fd = connectUnix(path + "s");
+	exchange(fd, "M2100,5:e8e84c0021", "OK");
+	exchange(fd, "Z0,2102,1", "OK");
+	exchange(fd, "c2100", "T05swbreak:;");
+	isOk = isOk && exchange(fd, "g", "*").substr(8, 4) == "0221";
+	exchange(fd, "c", "T05swbreak:;");
+	isOk = isOk && exchange(fd, "g", "*").substr(8, 4) == "0221";
+	exchange(fd, "z0,2102,1", "OK");
+	sendBytes(fd, rspPacket("k"));
+	served.join();
+	::close(fd);
+
+	std::cout << "Test GDB stub:" << ((isOk) ? "OK" : "FAIL") << "\n";
+	return isOk;
+}
+#endif
 
-		uint16_t address = mMemory[lookupAddress] + (mMemory[lookupAddress + 1] << 8);
-		//std::cout << "Address: " << std::hex << static_cast<int>(address) << " lookupA: " << std::hex << static_cast<int>(lookupAddress) << std::endl;
+static bool TestDisassembler()
+{
+	// lines of the basicOpsProgram listing, every addressing mode the program lacks, an undefined opcode and a
+	// JMP cut short by the end of the code; then the same listing into a buffer too small for all of it
+	char text[4096];
+	std::size_t consumed = 0;
+	std::string listing(text, Disassembler::formatListing(basicOpsProgram, sizeof(basicOpsProgram), 0x1000, text, sizeof(text), &consumed));
+	bool isOk = consumed == sizeof(basicOpsProgram) && std::count(listing.begin(), listing.end(), '\n') == 86;
+	for (const char* line : { "1000  A9 83     LDA #$83\n", "1002  8D 01 00  STA $0001\n", "1014  18        CLC\n",
+		"1015  20 44 10  JSR $1044\n", "1018  FF        HLT\n", "1044  A5 01     LDA $01\n", "105B  F0 16     BEQ $1073\n",
+		"106C  90 EF     BCC $105D\n", "10A8  30 03     BMI $10AD\n", "10AE  FF        HLT\n" })
+	{
+		isOk = isOk && listing.find(line) != std::string::npos;
+	}
+
+	const uint8_t forms[] = { 0xB1, 0x40, 0x0A, 0x02, 0x05, 0x9D, 0x00, 0x02, 0x6C, 0x34, 0x12, 0xA1, 0x10, 0xB6, 0x20, 0xD0, 0xF1, 0x03, 0x4C, 0x00 };
+	isOk = isOk && std::string(text, Disassembler::formatListing(forms, sizeof(forms), 0x0200, text, sizeof(text))) ==
+		"0200  B1 40     LDA ($40),Y\n"
+		"0202  0A        ASL A\n"
+		"0203  02 05     HYP #$05\n"
+		"0205  9D 00 02  STA $0200,X\n"
+		"0208  6C 34 12  JMP ($1234)\n"
+		"020B  A1 10     LDA ($10,X)\n"
+		"020D  B6 20     LDX $20,Y\n"
+		"020F  D0 F1     BNE $0202\n"
+		"0211  03        .byte $03\n"
+		"0212  4C 00     JMP $0000\n";
+
+	char small[110];
+	std::size_t written = Disassembler::formatListing(basicOpsProgram, sizeof(basicOpsProgram), 0x1000, small, sizeof(small), &consumed);
+	isOk = isOk && consumed == 10 && listing.compare(0, written, small, written) == 0 && listing[written - 1] == '\n';
+
+	std::cout << "Test disassembler:" << ((isOk) ? "OK" : "FAIL") << "\n";
+	return isOk;
+}
 
-		uint8_t result = mMemory[address];
-		//std::cout << "Loading " << std::hex << static_cast<int>(result) << " into A" << std::endl;
+static bool TestRecompiled()
+{
+	// the three routines natively and interpreted: same registers, memory, instruction and cycle counts
+	bool isOk = true;
+	for (uint16_t entry : { 0x1000, 0x1019, 0x1035 })
+	{
+		RecompiledCpu native;
+		MOS6502Debug interpreted;
+		native.ISDEBUG = false;
+		interpreted.ISDEBUG = false;
+		native.loadProgram(basicOpsProgram, sizeof(basicOpsProgram), 0x1000);
+		interpreted.loadProgram(basicOpsProgram, sizeof(basicOpsProgram), 0x1000);
+		native.attachTranslation(&basicOpsTranslation);
+		const uint8_t vector[] = { static_cast<uint8_t>(entry & 0xFF), static_cast<uint8_t>(entry >> 8) };
+		for (MOS6502* cpu : { static_cast<MOS6502*>(&native), static_cast<MOS6502*>(&interpreted) })
+		{
+			cpu->loadProgram(vector, sizeof(vector), 0xFFFE);
+			cpu->reset();
+		}
 
-		return result;
+		isOk = isOk && native.run() == STOP_HALT && interpreted.execute() == STOP_HALT && native.nativeInstructions() != 0
+			&& native.stateHash() == interpreted.stateHash() && native.a() == interpreted.getAccumulator()
+			&& native.programCounter() == interpreted.getProgramCounter()
+			&& native.instructions() == interpreted.instructions() && native.cycles() == interpreted.cycles();
 	}
 
-	uint8_t loadZeroPage(const char* instruction)
+	// MUL_XY16 in slices of a few cycles: every slice has to stop on the same instruction as the interpreter's
+	RecompiledCpu native;
+	MOS6502Debug interpreted;
+	native.ISDEBUG = false;
+	interpreted.ISDEBUG = false;
+	const uint8_t vector[] = { 0x19, 0x10 };
+	for (MOS6502* cpu : { static_cast<MOS6502*>(&native), static_cast<MOS6502*>(&interpreted) })
 	{
-		uint8_t addr = fetch();
-		uint8_t result = mMemory[addr];
-		if (ISDEBUG) { std::cout << instruction << "\t" << (int)addr; }
-		//std::cout << "Loading " << std::hex << static_cast<int>(result) << " into A" << std::endl;
-		return result;
+		cpu->loadProgram(basicOpsProgram, sizeof(basicOpsProgram), 0x1000);
+		cpu->loadProgram(vector, sizeof(vector), 0xFFFE);
+		cpu->reset();
 	}
-
-	uint8_t loadImmediate(const char* instruction)
+	native.attachTranslation(&basicOpsTranslation);
+	StopReason nativeStop = STOP_BUDGET;
+	StopReason interpretedStop = STOP_BUDGET;
+	for (uint64_t slice = 1; nativeStop == STOP_BUDGET && interpretedStop == STOP_BUDGET && isOk; slice = slice % 13 + 1)
 	{
-		uint8_t result = fetch();
-		if (ISDEBUG) { std::cout << instruction << "\t" << "#" << (int)result; }
-		//std::cout << "Loading " << std::hex << static_cast<int>(result) << " into A" << std::endl;
-		return result;
+		nativeStop = native.run(UINT64_MAX, native.cycles() + slice);
+		interpretedStop = interpreted.execute(UINT64_MAX, interpreted.cycles() + slice);
+		isOk = nativeStop == interpretedStop && native.programCounter() == interpreted.getProgramCounter()
+			&& native.cycles() == interpreted.cycles() && native.stateHash() == interpreted.stateHash();
 	}
+	isOk = isOk && nativeStop == STOP_HALT && native.nativeInstructions() != 0;
+
+	std::cout << "Test recompiled:" << ((isOk) ? "OK" : "FAIL") << "\n";
+	return isOk;
+}
 
-	uint8_t loadAbsolute(const char* instruction)
+static bool TestBusScheduler()
+{
+	// two CPUs on one shared page: the first posts a 1 and waits for an answer, the second waits for the 1
+	// and answers with 2. Both runs of the same setup have to interleave the same way, cycle for cycle
+	const uint8_t ping[] = { 0xA9, 0x01, 0x8D, 0x00, 0x02, 0xAD, 0x01, 0x02, 0xF0, 0xFB, 0xFF };  // LDA #1, STA $0200, wait for $0201, HALT
+	const uint8_t pong[] = { 0xAD, 0x00, 0x02, 0xF0, 0xFB, 0x0A, 0x8D, 0x01, 0x02, 0xFF };        // wait for $0200, ASL A, STA $0201, HALT
+	bool isOk = true;
+	uint64_t cycles[2][2] = {};
+	for (int run = 0; run < 2; run++)
 	{
-		uint16_t addr = fetch16();
-		uint8_t result = mMemory[addr];
-		if (ISDEBUG) { std::cout << instruction << "\t" << (int)addr; }
-		//std::cout << "Loading " << std::hex << static_cast<int>(result) << " into A" << std::endl;
-		return result;
-	}
+		uint8_t shared[256] = {};
+		MOS6502Debug first;
+		MOS6502Debug second;
+		for (MOS6502Debug* cpu : { &first, &second })
+		{
+			cpu->ISDEBUG = false;
+			cpu->loadProgram(cpu == &first ? ping : pong, cpu == &first ? sizeof(ping) : sizeof(pong), 0x0300);
+			cpu->setProgramCounter(0x0300);
+			cpu->mapSharedPage(0x02, shared);
+		}
+		// the second CPU starts first and spins until the first one's store lands
+		BusScheduler scheduler(8);
+		std::size_t answering = scheduler.addCpu(second);
+		std::size_t posting = scheduler.addCpu(first);
+		isOk = isOk && scheduler.run() == 0 && scheduler.result(posting) == STOP_HALT && scheduler.result(answering) == STOP_HALT
+			&& shared[0] == 1 && shared[1] == 2 && first.getAccumulator() == 2 && scheduler.switches() > 4;
+		cycles[run][0] = first.cycles();
+		cycles[run][1] = second.cycles();
+	}
+	isOk = isOk && cycles[0][0] == cycles[1][0] && cycles[0][1] == cycles[1][1];
+
+	// INX, INX, JMP $0400 in quanta of four cycles: the first quantum ends on the breakpoint on the JMP
+	const uint8_t loop[] = { 0xE8, 0xE8, 0x4C, 0x00, 0x04 };
+	MOS6502Debug looper;
+	looper.ISDEBUG = false;
+	looper.loadProgram(loop, sizeof(loop), 0x0400);
+	looper.setProgramCounter(0x0400);
+	looper.addBreakpoint(0x0402);
+	BusScheduler sliced(4);
+	std::size_t looping = sliced.addCpu(looper);
+	isOk = isOk && sliced.run(100) == 0 && sliced.result(looping) == STOP_BREAKPOINT && looper.getRegisterX() == 2
+		&& looper.cycles() == 4;
+
+	std::cout << "Test bus scheduler:" << ((isOk) ? "OK" : "FAIL") << "\n";
+	return isOk;
+}
 
-	uint8_t loadIndirectY(const char* instruction)
+static bool TestParallelScheduler()
+{
+	// mailbox ping-pong between two threads: the first CPU posts 1..100 in $0200 and waits for each one to come
+	// back in $0201, the second echoes every number it sees. Whatever the quantum, both must get to 100
+	const uint8_t ping[] = { 0xA2, 0x00, 0xE8, 0x8E, 0x00, 0x02, 0xEC, 0x01, 0x02, 0xD0, 0xFB, 0xE0, 0x64, 0xD0, 0xF3, 0xFF };
+	const uint8_t pong[] = { 0xA2, 0x00, 0xE8, 0xEC, 0x00, 0x02, 0xD0, 0xFB, 0x8E, 0x01, 0x02, 0xE0, 0x64, 0xD0, 0xF3, 0xFF };
+	bool isOk = true;
+	for (uint64_t quantum : { 1, 50, 1000 })
 	{
-		uint8_t lookupAddress = fetch();
-		if (ISDEBUG) { std::cout << instruction << "\t" << "(" << (int)lookupAddress << "),y"; }
-		//std::cout << "Lookup address: " << std::hex << static_cast<int>(lookupAddress) << ", y: " << std::hex << static_cast<int>(mRegisterY) << std::endl;
+		uint8_t mailbox[256] = {};
+		MOS6502Debug first;
+		MOS6502Debug second;
+		for (MOS6502Debug* cpu : { &first, &second })
+		{
+			cpu->ISDEBUG = false;
+			cpu->loadProgram(cpu == &first ? ping : pong, sizeof(ping), 0x0300);
+			cpu->setProgramCounter(0x0300);
+			cpu->mapSharedPage(0x02, mailbox, true);
+		}
+		ParallelScheduler scheduler(quantum);
+		std::size_t posting = scheduler.addCpu(first);
+		std::size_t echoing = scheduler.addCpu(second);
+		scheduler.run();
+		isOk = isOk && scheduler.result(posting) == STOP_HALT && scheduler.result(echoing) == STOP_HALT
+			&& mailbox[0] == 100 && mailbox[1] == 100 && scheduler.quanta() != 0;
+	}
+
+	// loading a program over a shared page makes it private again, the shared memory no longer sees its writes
+	uint8_t mailbox[256] = {};
+	MOS6502Debug cpu;
+	cpu.ISDEBUG = false;
+	cpu.mapSharedPage(0x02, mailbox, true);
+	cpu.setMemory(0x0210, 0x55);
+	cpu.loadProgram(ping, sizeof(ping), 0x0200);
+	cpu.setMemory(0x0220, 0x66);
+	isOk = isOk && mailbox[0x10] == 0x55 && mailbox[0x00] == 0 && mailbox[0x20] == 0
+		&& cpu.getMemory(0x0200) == ping[0] && cpu.getMemory(0x0210) == 0x55 && cpu.getMemory(0x0220) == 0x66;
+
+	// INX, INX, JMP $0400 beside the spinning CPU, in quanta of four cycles: the first barrier falls on the
+	// breakpoint on the JMP, where the looping CPU has to stop while the other one runs to the end
+	const uint8_t loop[] = { 0xE8, 0xE8, 0x4C, 0x00, 0x04 };
+	const uint8_t spin[] = { 0x4C, 0x00, 0x04 };
+	MOS6502Debug looper;
+	MOS6502Debug spinner;
+	for (MOS6502Debug* each : { &looper, &spinner })
+	{
+		each->ISDEBUG = false;
+		each->loadProgram(each == &looper ? loop : spin, each == &looper ? sizeof(loop) : sizeof(spin), 0x0400);
+		each->setProgramCounter(0x0400);
+	}
+	looper.addBreakpoint(0x0402);
+	ParallelScheduler sliced(4);
+	std::size_t looping = sliced.addCpu(looper);
+	std::size_t spinning = sliced.addCpu(spinner);
+	sliced.run(100);
+	isOk = isOk && sliced.result(looping) == STOP_BREAKPOINT && looper.getRegisterX() == 2 && looper.cycles() == 4
+		&& sliced.result(spinning) == STOP_BUDGET;
+
+	std::cout << "Test parallel scheduler:" << ((isOk) ? "OK" : "FAIL") << "\n";
+	return isOk;
+}
 
-		uint16_t address = (mMemory[lookupAddress] + (mMemory[lookupAddress + 1] << 8)) + mRegisterY;
-		//std::cout << "Address: " << std::hex << static_cast<int>(address) << std::endl;
+#ifndef _WIN32
+static std::vector<uint8_t> jobMessage(uint32_t id, const std::vector<uint8_t>& image, uint16_t rangeAddress, uint32_t rangeSize)
+{
+	// JOB loading image at $0300 and starting there, with no patches and one range, framed with its length
+	std::vector<uint8_t> message(4);
+	auto put = [&message](uint64_t value, unsigned bytes) {
+		for (unsigned i = 0; i < bytes; i++) { message.push_back(static_cast<uint8_t>(value >> (8 * i))); }
+	};
+	put(JobServer::MSG_JOB, 1);
+	put(id, 4);
+	put(0x0300, 2);
+	put(0x0300, 2);
+	put(100000, 8);
+	put(image.size(), 4);
+	message.insert(message.end(), image.begin(), image.end());
+	put(0, 2);
+	put(1, 2);
+	put(rangeAddress, 2);
+	put(rangeSize, 4);
+	for (unsigned i = 0; i < 4; i++) { message[i] = static_cast<uint8_t>((message.size() - 4) >> (8 * i)); }
+	return message;
+}
 
-		uint8_t result = mMemory[address];
-		//std::cout << "Loading " << std::hex << static_cast<int>(result) << " into A" << std::endl;
-		return result;
-	}
+static std::vector<uint8_t> jobReply(int fd)
+{
+	// payload of the next message, type byte first; empty once the connection is gone
+	uint8_t header[4];
+	if (recv(fd, header, sizeof(header), MSG_WAITALL) != sizeof(header)) { return {}; }
+	std::vector<uint8_t> payload(header[0] | (header[1] << 8) | (header[2] << 16) | (static_cast<uint32_t>(header[3]) << 24));
+	if (recv(fd, payload.data(), payload.size(), MSG_WAITALL) != static_cast<ssize_t>(payload.size())) { return {}; }
+	return payload;
+}
 
-	uint8_t loadZeroPageX(const char* instruction)
-	{
-		uint8_t base = fetch();
-		uint8_t	address = mRegisterX + base;
-		uint8_t result = mMemory[address];
-		if (ISDEBUG) { std::cout << instruction << "\t" << (int)base << ",x"; }
-		//std::cout << "LDA " << std::hex << static_cast<int>(result) << " into A, address: " << std::hex << static_cast<int>(address) << std::endl;
-		return result;
-	}
+static bool TestJobServer()
+{
+	// one worker: a client that never reads its many large replies must not hold up a RESULT, an ERROR and the
+	// METRICS reply for another client. The stalled client's jobs are all the same, all but one are answered
+	// from the result cache
+	const std::vector<uint8_t> program = { 0xA9, 0x42, 0x85, 0x10, 0xFF };      // LDA #$42, STA $10, HALT
+	std::string path = "/tmp/6502_jobs_test." + std::to_string(getpid());
+	JobServer server(1);
+	if (!server.listen(path))
+	{
+		std::cout << "Test job server:FAIL\n";
+		return false;
+	}
+	std::thread serving([&server]() { server.serve(); });
+
+	int stalled = connectUnix(path);
+	for (uint32_t id = 0; id < 64; id++)
+	{
+		std::vector<uint8_t> message = jobMessage(id, program, 0x0000, 0x10000);
+		sendBytes(stalled, std::string(message.begin(), message.end()));
+	}
+
+	int fd = connectUnix(path);
+	std::vector<uint8_t> message = jobMessage(7, program, 0x0010, 1);
+	std::vector<uint8_t> rejected = jobMessage(8, program, 0xFFFF, 2);
+	const uint8_t metrics[] = { 1, 0, 0, 0, JobServer::MSG_METRICS };
+	sendBytes(fd, std::string(message.begin(), message.end()));
+	std::vector<uint8_t> result = jobReply(fd);
+	sendBytes(fd, std::string(rejected.begin(), rejected.end()));
+	std::vector<uint8_t> error = jobReply(fd);
+	sendBytes(fd, std::string(std::begin(metrics), std::end(metrics)));
+	std::vector<uint8_t> counters = jobReply(fd);
+
+	// RESULT id, reason, PC, A, X, Y, SP, P, cycles, then the range; METRICS accepted and rejected after the depths
+	auto field = [](const std::vector<uint8_t>& payload, std::size_t offset, unsigned bytes) {
+		uint64_t value = 0;
+		for (unsigned i = 0; i < bytes && offset + i < payload.size(); i++) { value |= static_cast<uint64_t>(payload[offset + i]) << (8 * i); }
+		return value;
+	};
+	bool isOk = result.size() == 1 + 4 + 1 + 2 + 5 + 8 + 1 && result[0] == JobServer::MSG_RESULT && field(result, 1, 4) == 7
+		&& result[5] == STOP_HALT && result[8] == 0x42 && result.back() == 0x42
+		&& error.size() > 5 && error[0] == JobServer::MSG_ERROR && field(error, 1, 4) == 8
+		&& std::string(error.begin() + 5, error.end()) == "range past $FFFF"
+		&& counters.size() == 1 + 4 + 4 + 8 * 6 + 8 * JobServer::latencyBuckets + 8 && counters[0] == JobServer::MSG_METRICS_REPLY
+		&& field(counters, 9, 8) == 65 && field(counters, 25, 8) == 1 && field(counters, counters.size() - 8, 8) == 63;
+
+	::close(fd);
+	::close(stalled);
+	server.requestStop();
+	serving.join();
+
+	std::cout << "Test job server:" << ((isOk) ? "OK" : "FAIL") << "\n";
+	return isOk;
+}
 
-	uint8_t loadZeroPageY(const char* instruction)
+static bool TestLiveMetrics()
+{
+	// three slots, one given back again; a reader sees the other two with their names escaped for labels
+	std::string name = "6502_metrics_test." + std::to_string(getpid());
+	LiveMetrics publisher;
+	bool isOk = publisher.create(name, 3);
+	LiveMetrics::Slot* quoted = publisher.claim("say \"hi\" \\o/");
+	LiveMetrics::Slot* released = publisher.claim("released");
+	LiveMetrics::Slot* split = publisher.claim("two\nlines");
+	isOk = isOk && quoted && released && split && !publisher.claim("fourth");
+	if (isOk)
 	{
-		uint8_t base = fetch();
-		uint8_t	address = mRegisterY + base;
-		uint8_t result = mMemory[address];
-		if (ISDEBUG) { std::cout << instruction << "\t" << (int)base << ",y"; }
-		//std::cout << "LDA " << std::hex << static_cast<int>(result) << " into A, address: " << std::hex << static_cast<int>(address) << std::endl;
-		return result;
-	}
+		quoted->running(true, STOP_NONE);
+		quoted->update(0x1234, 100, 250, 2);
+		quoted->cacheLookup(true);
+		quoted->cacheLookup(false);
+		quoted->running(false, STOP_HALT);
+		publisher.release(released);
+	}
+
+	LiveMetrics reader;
+	std::ostringstream text;
+	isOk = isOk && reader.open(name) && reader.slotCount() == 3 && !reader.claim("reader") && reader.creatorAlive();
+	reader.writePrometheus(text);
+	std::string labels = "{segment=\"" + name + "\",slot=\"0\",name=\"say \\\"hi\\\" \\\\o/\"";
+	for (const std::string& line : { "# TYPE m6502_pc gauge\n" + std::string(),
+		"m6502_instructions_total" + labels + "} 100\n", "m6502_cycles_total" + labels + "} 250\n",
+		"m6502_interrupts_total" + labels + "} 2\n", "m6502_cache_lookups_total" + labels + "} 2\n",
+		"m6502_cache_hits_total" + labels + "} 1\n", "m6502_updates_total" + labels + "} 1\n",
+		"m6502_pc" + labels + "} 4660\n", "m6502_running" + labels + "} 0\n",
+		"m6502_last_stop" + labels + ",reason=\"halt\"} 1\n",
+		"m6502_updates_total{segment=\"" + name + "\",slot=\"2\",name=\"two lines\"} 0\n" })
+	{
+		isOk = isOk && text.str().find(line) != std::string::npos;
+	}
+	isOk = isOk && text.str().find("slot=\"1\"") == std::string::npos;
+
+	std::cout << "Test live metrics:" << ((isOk) ? "OK" : "FAIL") << "\n";
+	return isOk;
+}
+#endif
 
-	uint8_t loadAbsoluteY(const char* instruction)
+static HostResult multiplyXY16(MOS6502::Host& host)
+{
+	// native MUL_XY16 ($1051): $04:$03 = $01 * $02 by repeated addition. Leaves what the guest loop leaves,
+	// $02 counted down to zero, A = 0 with Z and C set, V from the last ADC, and charges its base cycles
+	if (host.d())
 	{
-		uint16_t base = fetch16();
-		uint8_t result = mMemory[base + mRegisterY];
-		if (ISDEBUG) { std::cout << instruction << "\t" << (int)base << ",y"; }
-		//std::cout << "Loading " << std::hex << static_cast<int>(result) << " into A" << std::endl;
-		return result;
+		return HOST_EMULATE; // the guest ADCs would add in decimal mode
 	}
 
-	uint8_t loadAbsoluteX(const char* instruction)
+	uint8_t multiplicand = host.read(0x01);
+	uint8_t count = host.read(0x02);
+	uint16_t product = 0;
+	uint64_t cycles = 15 + 6;             // LDA, STA, STA, LDA, CMP, BEQ ... RTS
+	if (multiplicand != 0)
 	{
-		uint16_t base = fetch16();
-		uint8_t result = mMemory[base + mRegisterX];
-		if (ISDEBUG) { std::cout << instruction << "\t" << (int)base << ",x"; }
-		//std::cout << "Loading " << std::hex << static_cast<int>(result) << " into A" << std::endl;
-		return result;
-	}
-
+		cycles += 7;                      // final LDA, CMP, BEQ of the loop head
+		for (unsigned i = 0; i < count; i++)
+		{
+			uint8_t low = product & 0xFF;
+			uint16_t sum = low + multiplicand;
+			host.v() = ((multiplicand ^ low) & 0x80) == 0 && ((multiplicand ^ sum) & 0x80) != 0;
+			cycles += sum > 0xFF ? 25 + 8 : 25;
+			product += multiplicand;
+		}
+		host.write(0x02, 0);
+	}
+	host.write(0x03, product & 0xFF);
+	host.write(0x04, product >> 8);
+	host.a() = 0;
+	host.z() = 1;
+	host.n() = 0;
+	host.c() = 1;
+	host.addCycles(cycles);
+	host.returnFromSubroutine();
+	return HOST_CONTINUE;
+}
 
+static bool TestHostHooks()
+{
+	// the hooked MUL_XY16 has to end in exactly the state of the emulated one
+	bool isOk = true;
+	const uint8_t operands[][2] = { { 0xFA, 0x03 }, { 0x07, 0x06 }, { 0x00, 0x09 }, { 0x81, 0xFF }, { 0x10, 0x00 } };
 
-	//save instructions
+	MOS6502Debug emulated;
+	MOS6502Debug hooked;
+	emulated.ISDEBUG = false;
+	hooked.ISDEBUG = false;
+	emulated.loadProgram(basicOpsProgram, sizeof(basicOpsProgram), 0x1000);
+	hooked.loadProgram(basicOpsProgram, sizeof(basicOpsProgram), 0x1000);
+	emulated.enableHostCalls(false);
+	hooked.addHook(0x1051, multiplyXY16);
 
-	void saveIndirectY(const char* instruction, uint8_t value)
+	for (const auto& pair : operands)
 	{
-		uint8_t lookupAddress = fetch();
-		if (ISDEBUG) { std::cout << instruction << "\t" << "(" << (int)lookupAddress << "),y"; }
-
-		uint16_t address = (mMemory[lookupAddress] + (mMemory[lookupAddress + 1] << 8)) + mRegisterY;
-
-		mMemory[address] = value;
+		for (MOS6502Debug* cpu : { &emulated, &hooked })
+		{
+			cpu->setMemory(0x01, pair[0]);
+			cpu->setMemory(0x02, pair[1]);
+			cpu->executeFrom(0x1023);        // JSR MUL_XY16, HALT
+		}
+		for (uint16_t addr = 0; addr < 0x200; addr++)
+		{
+			isOk = isOk && emulated.getMemory(addr) == hooked.getMemory(addr);
+		}
+		isOk = isOk && emulated.getAccumulator() == hooked.getAccumulator() && emulated.getStatus() == hooked.getStatus()
+			&& emulated.getStackPointer() == hooked.getStackPointer() && emulated.getProgramCounter() == hooked.getProgramCounter()
+			&& emulated.cycles() == hooked.cycles();
 	}
 
-	void saveIndirectX(const char* instruction, uint8_t value)
-	{
-		uint8_t lookupAddress = fetch();
+	std::cout << "Test MUL_XY16 hook:" << ((isOk) ? "OK" : "FAIL") << "\n";
+	return isOk;
+}
 
-		if (ISDEBUG) { std::cout << instruction << "\t" << "(" << (int)lookupAddress << ",x)"; }
-		lookupAddress += mRegisterX;
-		uint16_t address = mMemory[lookupAddress] + (mMemory[lookupAddress + 1] << 8);
-		mMemory[address] = value;
-	}
+static bool TestSubroutineMemo()
+{
+	// repeated MUL_XY16 calls are replayed from the memo and have to end in the state of the emulated ones
+	bool isOk = true;
+	const uint8_t operands[][2] = { { 0xFA, 0x03 }, { 0x07, 0x06 }, { 0xFA, 0x03 }, { 0x07, 0x06 }, { 0x00, 0x09 },
+		{ 0xFA, 0x03 }, { 0x07, 0x06 }, { 0x00, 0x09 }, { 0xFA, 0x03 } };
+
+	for (bool verify : { false, true })
+	{
+		MOS6502Debug emulated;
+		MOS6502Debug memoized;
+		emulated.ISDEBUG = false;
+		memoized.ISDEBUG = false;
+		emulated.loadProgram(basicOpsProgram, sizeof(basicOpsProgram), 0x1000);
+		memoized.loadProgram(basicOpsProgram, sizeof(basicOpsProgram), 0x1000);
+		SubroutineMemo memo(memoized);
+		memo.memoize(0x1051);
+		memo.setVerify(verify);
+
+		for (const auto& pair : operands)
+		{
+			for (MOS6502Debug* cpu : { &emulated, &memoized })
+			{
+				cpu->setMemory(0x01, pair[0]);
+				cpu->setMemory(0x02, pair[1]);
+				cpu->executeFrom(0x1023);    // JSR MUL_XY16, HALT
+			}
+			for (uint16_t addr = 0; addr < 0x200; addr++)
+			{
+				isOk = isOk && emulated.getMemory(addr) == memoized.getMemory(addr);
+			}
+			isOk = isOk && emulated.getAccumulator() == memoized.getAccumulator() && emulated.getStatus() == memoized.getStatus()
+				&& emulated.getStackPointer() == memoized.getStackPointer() && emulated.getProgramCounter() == memoized.getProgramCounter()
+				&& emulated.cycles() == memoized.cycles();
+		}
 
-	void saveZeroPage(const char* instruction, uint8_t value)
-	{
-		uint8_t addr = fetch();
-		mMemory[addr] = value;
-		if (ISDEBUG) { std::cout << instruction << "\t" << (int)addr; }
+		SubroutineMemo::Statistics statistics = memo.statistics(0x1051);
+		isOk = isOk && statistics.hits != 0 && statistics.verifyFailures == 0 && !statistics.impure;
 	}
 
-	void saveAbsolute(const char* instruction, uint8_t value)
-	{
-		uint16_t addr = fetch16();
-		mMemory[addr] = value;
-		if (ISDEBUG) { std::cout << instruction << "\t" << (int)addr; }
-	}
+	std::cout << "Test MUL_XY16 memo:" << ((isOk) ? "OK" : "FAIL") << "\n";
+	return isOk;
+}
 
-	void saveZeroPageX(const char* instruction, uint8_t value)
-	{
-		uint8_t base = fetch();
-		uint8_t	address = mRegisterX + base;
-		mMemory[address] = value;
-		if (ISDEBUG) { std::cout << instruction << "\t" << (int)base << ",x"; }
-	}
+static bool TestCheckpoints()
+{
+	// a write only one of two otherwise identical runs does has to show up from the next checkpoint on
+	bool isOk = true;
+	MOS6502Debug reference;
+	MOS6502Debug diverging;
+	for (MOS6502Debug* cpu : { &reference, &diverging })
+	{
+		cpu->ISDEBUG = false;
+		cpu->loadProgram(basicOpsProgram, sizeof(basicOpsProgram), 0x1000);
+		cpu->setMemory(0x01, 0x07);
+		cpu->setMemory(0x02, 0x09);
+		cpu->setProgramCounter(0x1023);      // JSR MUL_XY16, HALT
+	}
+
+	CheckpointStream expected(8);
+	CheckpointStream actual(8);
+	expected.record(reference);
+	uint64_t executed = 0;
+	actual.record(diverging, UINT64_MAX, [&](uint64_t count)
+	{
+		StopReason reason = diverging.execute(count);
+		executed += count;
+		if (executed == 40)
+		{
+			diverging.setMemory(0x0300, 0x01);
+		}
+		return reason;
+	});
 
-	void saveZeroPageY(const char* instruction, uint8_t value)
-	{
-		uint8_t base = fetch();
-		uint8_t	address = mRegisterY + base;
-		mMemory[address] = value;
-		if (ISDEBUG) { std::cout << instruction << "\t" << (int)base << ",y"; }
-	}
+	isOk = expected.checkpoints().size() > 6 && expected.checkpoints().size() == actual.checkpoints().size()
+		&& CheckpointStream::firstDivergence(expected, actual) == 5
+		&& reference.differingPages(diverging) == std::vector<uint8_t>{ 0x03 };
+
+	std::cout << "Test checkpoints:" << ((isOk) ? "OK" : "FAIL") << "\n";
+	return isOk;
+}
 
-	void saveAbsoluteY(const char* instruction, uint8_t value)
+static bool TestMemoryDump()
+{
+	// 1000 bytes, so the last 8 are past the final 16-byte compare; changes at both ends, and two ranges
+	// 6 bytes apart that a gap of 6 merges and a gap of 5 does not
+	bool isOk = true;
+	std::vector<uint8_t> before(1000);
+	for (std::size_t i = 0; i < before.size(); i++)
 	{
-		uint16_t base = fetch16();
-		mMemory[base + mRegisterY] = value;
-		if (ISDEBUG) { std::cout << instruction << "\t" << (int)base << ",y"; }
+		before[i] = static_cast<uint8_t>(i * 7);
 	}
-
-	void saveAbsoluteX(const char* instruction, uint8_t value)
+	std::vector<uint8_t> after = before;
+	for (std::size_t offset : { 0, 37, 100, 101, 102, 103, 110, 111, 500, 501, 502, 998, 999 })
 	{
-		uint16_t base = fetch16();
-		mMemory[base + mRegisterX] = value;
-		if (ISDEBUG) { std::cout << instruction << "\t" << (int)base << ",x"; }
+		after[offset] ^= 0x5A;
 	}
 
-	void setZeroAndNegativeFlags(uint8_t value)
+	auto ranges = [&](std::size_t mergeGap)
 	{
-		Z = value == 0;
-		N = (value & 0x80) != 0;
-	}
-};
+		std::vector<std::pair<uint32_t, uint32_t>> found;
+		for (const MemoryDump::Range& range : MemoryDump::diff(before.data(), after.data(), before.size(), mergeGap))
+		{
+			found.emplace_back(range.first, range.size);
+		}
+		return found;
+	};
+	isOk = isOk && ranges(0) == std::vector<std::pair<uint32_t, uint32_t>>{ { 0, 1 }, { 37, 1 }, { 100, 4 }, { 110, 2 }, { 500, 3 }, { 998, 2 } };
+	isOk = isOk && ranges(5) == ranges(0);
+	isOk = isOk && ranges(6) == std::vector<std::pair<uint32_t, uint32_t>>{ { 0, 1 }, { 37, 1 }, { 100, 12 }, { 500, 3 }, { 998, 2 } };
+	isOk = isOk && MemoryDump::diff(before.data(), before.data(), before.size()).empty();
+
+	// one changed byte in the tail of a 20 byte snapshot
+	uint8_t zeros[20] = {};
+	uint8_t changed[20] = {};
+	changed[17] = 'A';
+	std::ostringstream text;
+	MemoryDump::printDiff(text, zeros, changed, sizeof(zeros), 0x2000);
+	isOk = isOk && text.str() == "2011-2011 (1 byte)\n"
+		"- 2011  00" + std::string(48, ' ') + "|.|\n"
+		"+ 2011  41" + std::string(48, ' ') + "|A|\n";
+
+	std::string path = "memorydump_test.bin";
+	isOk = isOk && MemoryDump::writeBinary(path, after.data(), after.size());
+	{
+		std::ifstream file(path, std::ios::binary);
+		std::vector<uint8_t> written((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		isOk = isOk && written == after;
+	}
+	std::remove(path.c_str());
+
+	std::cout << "Test memory dump:" << ((isOk) ? "OK" : "FAIL") << "\n";
+	return isOk;
+}
 
-class MOS6502Debug : public MOS6502
+static bool TestCodeCoverage(const std::string& prefix)
 {
-public:
-	uint8_t  getAccumulator() { return mAccumulator; }
-	uint16_t getProgramCounter() { return mProgramCounter; }
-	uint8_t  getStackPointer() { return mStackPointer; }
-	uint8_t  getRegisterX() { return mRegisterX; }
-	uint8_t  getRegisterY() { return mRegisterY; }
-
-	uint8_t  getMemory(uint16_t addr) { return mMemory[addr]; }
-};
+	// MUL_XY16 with a non-zero multiplier: its entry test never branches, the loop test and the carry test go both
+	// ways. Its lcov report is written against a listing of 1051-1073; with --coverage prefix the report stays in
+	// prefix.info and prefix.lst, next to prefix.json
+	MOS6502Debug cpu;
+	CodeCoverage coverage;
+	cpu.ISDEBUG = false;
+	cpu.loadProgram(basicOpsProgram, sizeof(basicOpsProgram), 0x1000);
+	cpu.attachCodeCoverage(&coverage);
+	cpu.setMemory(0x01, 0xFA);
+	cpu.setMemory(0x02, 0x03);
+	cpu.executeFrom(0x1023);             // JSR MUL_XY16, HALT
+
+	CodeCoverage::Summary summary = coverage.summary();
+	bool isOk = coverage.executed(0x1051) && !coverage.executed(0x1052) && !coverage.executed(0x1000)
+		&& !coverage.taken(0x105B) && coverage.notTaken(0x105B)
+		&& coverage.taken(0x1061) && coverage.notTaken(0x1061)
+		&& coverage.taken(0x106C) && coverage.notTaken(0x106C)
+		&& summary.branches == 3 && summary.bothWays == 2;
+
+	std::string base = prefix.empty() ? "codecoverage_test" : prefix;
+	std::vector<uint8_t> memory(CodeCoverage::addressCount);
+	cpu.copyMemory(0x0000, memory.data(), memory.size());
+	isOk = coverage.writeLcov(base + ".info", base + ".lst", memory.data(), 0x1027, 0x1073) && isOk;
+
+	// 20 lines of code that did not run in front of the 18 of MUL_XY16; its branches are lines 26, 29 and 35
+	std::string expected = "TN:\nSF:" + base + ".lst\n"
+		"BRDA:26,0,0,0\nBRDA:26,0,1,1\nBRDA:29,0,0,1\nBRDA:29,0,1,1\nBRDA:35,0,0,1\nBRDA:35,0,1,1\n";
+	for (int line = 1; line <= 38; line++)
+	{
+		expected += "DA:" + std::to_string(line) + (line <= 20 ? ",0\n" : ",1\n");
+	}
+	expected += "BRF:6\nBRH:5\nLF:38\nLH:18\nend_of_record\n";
+	std::ifstream report(base + ".info");
+	std::ostringstream text;
+	text << report.rdbuf();
+	isOk = isOk && text.str() == expected;
+
+	std::ifstream listing(base + ".lst");
+	std::vector<std::string> lines;
+	for (std::string line; std::getline(listing, line);)
+	{
+		lines.push_back(line);
+	}
+	isOk = isOk && lines.size() == 38 && lines[0] == "1027  A9 07     LDA #$07" && lines[20] == "1051  A9 00     LDA #$00"
+		&& lines[25] == "105B  F0 16     BEQ $1073" && lines[37] == "1073  60        RTS";
+	report.close();
+	listing.close();
+	if (prefix.empty())
+	{
+		std::remove((base + ".info").c_str());
+		std::remove((base + ".lst").c_str());
+	}
+	else
+	{
+		isOk = coverage.writeJson(prefix + ".json") && isOk;
+	}
+
+	std::cout << "Test code coverage:" << ((isOk) ? "OK" : "FAIL") << "\n";
+	return isOk;
+}
 
-static bool TestBasicOps()
+static bool TestSamplingProfiler()
 {
-	bool isOk = true;
-
-	uint8_t program[] = {
-	 0xA9, 0x83, 0x8D, 0x01, 0x00, 0xA9, 0x05, 0x8D,
-	 0x02, 0x00, 0xA9, 0x81, 0x8D, 0x03, 0x00, 0xA9,
-	 0x73, 0x8D, 0x04, 0x00, 0x18, 0x20, 0x44, 0x10,
-	 0xFF, 0xA9, 0xFA, 0x8D, 0x01, 0x00, 0xA9, 0x03, //first was 0xea but changed to 0xff (halt)
-	 0x8D, 0x02, 0x00, 0x20, 0x51, 0x10, 0xFF, 0xA9, // seventh was ea but is now ff
-	 0x07, 0x8D, 0x01, 0x00, 0xA9, 0x06, 0x8D, 0x02,
-	 0x00, 0x20, 0x74, 0x10, 0xEA, 0xA9, 0x0A, 0x8D,
-	 0x01, 0x00, 0xA9, 0x05, 0x8D, 0x02, 0x00, 0x20,
-	 0x91, 0x10, 0xFF, 0x00, 0xA5, 0x01, 0x65, 0x03, // third was EA, now is 0xff
-	 0x85, 0x05, 0xA5, 0x02, 0x65, 0x04, 0x85, 0x06,
-	 0x60, 0xA9, 0x00, 0x85, 0x03, 0x85, 0x04, 0xA5,
-	 0x01, 0xC9, 0x00, 0xF0, 0x16, 0xA5, 0x02, 0xC9,
-	 0x00, 0xF0, 0x10, 0xC6, 0x02, 0xA5, 0x03, 0x18,
-	 0x65, 0x01, 0x85, 0x03, 0x90, 0xEF, 0xE6, 0x04,
-	 0x4C, 0x5D, 0x10, 0x60, 0xA9, 0x00, 0x85, 0x03,
-	 0xA5, 0x01, 0xC9, 0x00, 0xF0, 0x12, 0xA5, 0x02,
-	 0xC9, 0x00, 0xF0, 0x0C, 0xC6, 0x02, 0xA5, 0x03,
-	 0x18, 0x65, 0x01, 0x85, 0x03, 0x4C, 0x7E, 0x10,
-	 0x60, 0xA9, 0x00, 0x85, 0x03, 0xA5, 0x01, 0x85,
-	 0x04, 0xC5, 0x02, 0x30, 0x10, 0xE6, 0x03, 0xA5,
-	 0x04, 0x38, 0xE5, 0x02, 0x85, 0x04, 0xC5, 0x02,
-	 0x30, 0x03, 0x4C, 0x9D, 0x10, 0x60, 0xFF
-	};
-
-	auto cpu = std::make_shared<MOS6502Debug>();
-	cpu->loadProgram(program, sizeof(program), 0x1000);
-
-	if (isOk)
-	{
-		// ; test ADC_XY16
-		cpu->executeFrom(0x1000);
-
-		if (cpu->getMemory(0x05) != 0x04)
-		{
-			isOk = false;
-		}
+	// every sample of a MUL_XY16 call lands inside it, with it as the only frame on the shadow call stack
+	MOS6502Debug cpu;
+	SamplingProfiler profiler(4);
+	cpu.ISDEBUG = false;
+	cpu.loadProgram(basicOpsProgram, sizeof(basicOpsProgram), 0x1000);
+	cpu.setMemory(0x01, 0xFA);
+	cpu.setMemory(0x02, 0x30);
+	cpu.setProgramCounter(0x1023);       // JSR MUL_XY16, HALT
+
+	bool isOk = profiler.run(cpu) == STOP_HALT && profiler.samples() > 50;
+	uint64_t inside = 0;
+	for (uint16_t pc = 0x1051; pc <= 0x1073; pc++)
+	{
+		inside += profiler.samplesAt(pc);
+	}
+	std::vector<SamplingProfiler::Stack> stacks = profiler.stacks();
+	isOk = isOk && inside == profiler.samples() && stacks.size() == 1
+		&& stacks[0].entries == std::vector<uint16_t>{ 0x1051 } && stacks[0].samples == profiler.samples();
+
+	// the same as a flame graph stack and as the three hottest PCs, all of them inside MUL_XY16
+	std::string path = "samplingprofiler_test.folded";
+	isOk = isOk && profiler.writeFolded(path);
+	std::ifstream folded(path);
+	std::ostringstream text;
+	text << folded.rdbuf();
+	folded.close();
+	std::remove(path.c_str());
+	isOk = isOk && text.str() == "guest;1051 " + std::to_string(profiler.samples()) + "\n";
+
+	std::ostringstream top;
+	profiler.printTop(top, 3);
+	std::istringstream lines(top.str());
+	std::string line;
+	isOk = isOk && std::getline(lines, line) && line == std::to_string(profiler.samples()) + " samples";
+	for (int i = 0; i < 3; i++)
+	{
+		isOk = isOk && std::getline(lines, line) && line.size() == 27 && line.compare(0, 4, "  10") == 0 && line.back() == '%';
+	}
+	isOk = isOk && !std::getline(lines, line);
+
+	std::cout << "Test sampling profiler:" << ((isOk) ? "OK" : "FAIL") << "\n";
+	return isOk;
+}
 
-		if (cpu->getMemory(0x06) != 0x79)
+static bool TestAsyncCpu()
+{
+	// a busy loop is paused, stepped and interrupted into a handler that halts, all from this thread; with a
+	// two-instruction quantum the breakpoint on the loop falls exactly on a boundary
+	const uint8_t loop[] = { 0xE8, 0x4C, 0x00, 0x02 };             // INX, JMP $0200
+	const uint8_t handler[] = { 0xA9, 0x42, 0x85, 0x10, 0xFF };    // LDA #$42, STA $10, HALT
+	MOS6502Debug cpu;
+	cpu.ISDEBUG = false;
+	cpu.setProgramCounter(0x0200);
+
+	bool isOk;
+	{
+		AsyncCpu async(cpu, 2);
+		async.write(0x0200, { std::begin(loop), std::end(loop) });
+		async.write(0x0300, { std::begin(handler), std::end(handler) });
+		async.write(0xFFFE, { 0x00, 0x03 });
+		std::future<AsyncCpu::Reply> run = async.resume();
+		while (async.instructions() < 100)
 		{
-			isOk = false;
+			std::this_thread::yield();
 		}
+		AsyncCpu::Reply paused = async.pause().get();
+		AsyncCpu::Reply stepped = async.step(5).get();
+		isOk = run.get().reason == STOP_NONE && paused.instructions >= 100
+			&& stepped.reason == STOP_BUDGET && stepped.instructions == paused.instructions + 5;
 
-		std::cout << "Test ADC_XY16:" << ((isOk) ? "OK" : "FAIL") << "\n";
+		std::future<AsyncCpu::Reply> taken = async.irq();
+		AsyncCpu::Reply halted = async.resume().get();
+		isOk = isOk && halted.reason == STOP_HALT && taken.get().pc == 0x0300
+			&& async.read(0x10, 1).get().bytes == std::vector<uint8_t>{ 0x42 } && !async.running();
 	}
 
-	if (isOk)
+	cpu.setProgramCounter(0x0200);
+	cpu.addBreakpoint(0x0200);
+	uint64_t start = cpu.instructions();
 	{
-		cpu->executeFrom(0x1019);
-
-		if (cpu->getMemory(0x03) != 0xEE)
-		{
-			isOk = false;
-		}
-
-		if (cpu->getMemory(0x04) != 0x02)
-		{
-			isOk = false;
-		}
-
-		std::cout << "Test MUL_XY16:" << ((isOk) ? "OK" : "FAIL") << "\n";
+		AsyncCpu async(cpu, 2);
+		AsyncCpu::Reply stopped = async.resume().get();
+		isOk = isOk && stopped.reason == STOP_BREAKPOINT && stopped.pc == 0x0200 && stopped.instructions == start + 2;
 	}
 
-	if (isOk)
-	{
-		cpu->executeFrom(0x1035);
+	std::cout << "Test async CPU:" << ((isOk) ? "OK" : "FAIL") << "\n";
+	return isOk;
+}
 
-		if (cpu->getMemory(0x03) != 0x02)
+static bool TestGuestScheduler()
+{
+	// one host thread for a guest that never stops and one that HALTs twice: the second one only gets its
+	// second turn because the spinning guest is preempted at the end of every quantum
+	const uint8_t spin[] = { 0xE6, 0x10, 0x4C, 0x00, 0x03 };             // INC $10, JMP $0300
+	const uint8_t waits[] = { 0xE6, 0x10, 0xFF, 0xE6, 0x10, 0xFF };      // INC $10, HALT, INC $10, HALT
+	MOS6502Debug spinner;
+	MOS6502Debug waiter;
+	spinner.ISDEBUG = false;
+	waiter.ISDEBUG = false;
+	spinner.loadProgram(spin, sizeof(spin), 0x0300);
+	spinner.setProgramCounter(0x0300);
+	waiter.loadProgram(waits, sizeof(waits), 0x0200);
+	waiter.setProgramCounter(0x0200);
+
+	GuestScheduler scheduler(1, 100);
+	GuestScheduler::GuestId spinning = scheduler.add(spinner);
+	GuestScheduler::GuestId waiting = scheduler.add(waiter);
+	scheduler.start();
+	auto parks = [&](uint64_t count) {
+		while (scheduler.stats().parks < count)
 		{
-			isOk = false;
+			std::this_thread::yield();
 		}
-
-		if (cpu->getMemory(0x04) != 0x00)
+	};
+	parks(1);
+	bool isOk = scheduler.state(waiting) == GuestScheduler::GUEST_PARKED;
+	isOk = scheduler.wake(waiting) && isOk;
+	parks(2);
+	while (scheduler.cycles(spinning) < 1000)
+	{
+		std::this_thread::yield();
+	}
+	scheduler.stop();
+	// waking a guest that is still runnable does nothing
+	isOk = isOk && !scheduler.wake(spinning);
+	GuestScheduler::Stats stats = scheduler.stats();
+	isOk = isOk && waiter.getMemory(0x10) == 2 && scheduler.lastStop(waiting) == STOP_HALT
+		&& scheduler.state(spinning) == GuestScheduler::GUEST_RUNNABLE && stats.wakes == 1 && stats.quanta > 10;
+
+	// INX, INX, JMP $0400 in quanta of four cycles: the first quantum ends on the breakpoint on the JMP, so the
+	// guest parks there; woken, it steps over the breakpoint once and parks on it in its second quantum
+	const uint8_t loop[] = { 0xE8, 0xE8, 0x4C, 0x00, 0x04 };
+	MOS6502Debug looper;
+	looper.ISDEBUG = false;
+	looper.loadProgram(loop, sizeof(loop), 0x0400);
+	looper.setProgramCounter(0x0400);
+	looper.addBreakpoint(0x0402);
+	GuestScheduler sliced(1, 4);
+	GuestScheduler::GuestId looping = sliced.add(looper);
+	sliced.start();
+	auto parked = [&](uint64_t count) {
+		while (sliced.stats().parks < count || sliced.state(looping) != GuestScheduler::GUEST_PARKED)
 		{
-			isOk = false;
+			std::this_thread::yield();
 		}
-
-		std::cout << "Test DIV_XY:" << ((isOk) ? "OK" : "FAIL") << "\n";
-	}
-
-	return(isOk);
+	};
+	parked(1);
+	isOk = isOk && sliced.lastStop(looping) == STOP_BREAKPOINT && looper.getRegisterX() == 2 && sliced.cycles(looping) == 4;
+	isOk = sliced.wake(looping) && isOk;
+	parked(2);
+	sliced.stop();
+	isOk = isOk && looper.getRegisterX() == 4 && looper.getProgramCounter() == 0x0402 && sliced.cycles(looping) == 4 + 5 + 2;
+
+	std::cout << "Test guest scheduler:" << ((isOk) ? "OK" : "FAIL") << "\n";
+	return isOk;
 }
 
 void test_config_module()
@@ -2263,11 +1123,118 @@ void test_config_module()
         });
 }
 
-int main()
+#ifndef _WIN32
+static bool serveGdb(MOS6502Debug& cpu, const std::string& endpoint)
+{
+	// a plain number is a localhost TCP port, anything else a Unix domain socket path
+	GdbStub stub(cpu);
+	bool isPort = endpoint.find_first_not_of("0123456789") == std::string::npos;
+	if (isPort ? !stub.listenTcp(static_cast<uint16_t>(std::stoi(endpoint))) : !stub.listenUnix(endpoint))
+	{
+		return false;
+	}
+	std::cout << "Waiting for GDB on " << endpoint << std::endl;
+	return stub.serve();
+}
+
+static JobServer* runningServer = nullptr;
+
+static bool serveJobs(const std::string& path, unsigned workers, const std::string& metricsSegment)
+{
+	// runs until SIGINT or SIGTERM
+	JobServer server(workers);
+	if (!server.listen(path) || (!metricsSegment.empty() && !server.publishLiveMetrics(metricsSegment)))
+	{
+		return false;
+	}
+	runningServer = &server;
+	auto stop = [](int) { runningServer->requestStop(); };
+	std::signal(SIGINT, stop);
+	std::signal(SIGTERM, stop);
+	std::cout << "Serving jobs on " << path << std::endl;
+	bool served = server.serve();
+	std::signal(SIGINT, SIG_DFL);
+	std::signal(SIGTERM, SIG_DFL);
+	runningServer = nullptr;
+	return served;
+}
+#endif
+
+int main(int argc, char** argv)
 {
+	std::string gdbEndpoint;
+	std::string jobSocket;
+	unsigned jobWorkers = 0;
+	std::string metricsSegment;
+	std::string heatmapPrefix;
+	std::string dumpPath;
+	std::string coveragePrefix;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (std::string(argv[i]) == "--gdb")
+		{
+			gdbEndpoint = argv[i + 1];
+		}
+		else if (std::string(argv[i]) == "--serve")
+		{
+			jobSocket = argv[i + 1];
+		}
+		else if (std::string(argv[i]) == "--workers")
+		{
+			jobWorkers = static_cast<unsigned>(std::stoul(argv[i + 1]));
+		}
+		else if (std::string(argv[i]) == "--metrics")
+		{
+			metricsSegment = argv[i + 1];
+		}
+		else if (std::string(argv[i]) == "--heatmap")
+		{
+			heatmapPrefix = argv[i + 1];
+		}
+		else if (std::string(argv[i]) == "--dump")
+		{
+			dumpPath = argv[i + 1];
+		}
+		else if (std::string(argv[i]) == "--coverage")
+		{
+			coveragePrefix = argv[i + 1];
+		}
+	}
+
+#ifndef _WIN32
+	if (!jobSocket.empty())
+	{
+		// server mode skips the self tests below, jobs bring their own programs
+		return serveJobs(jobSocket, jobWorkers, metricsSegment) ? 0 : 1;
+	}
+#endif
+
         test_config_module();
 
 	TestBasicOps();
+	TestImageSharing();
+	TestWarmStart();
+	TestMemoryProfile(heatmapPrefix);
+	TestBreakpoints();
+#ifndef _WIN32
+	TestGdbStub();
+#endif
+	TestDisassembler();
+	TestRecompiled();
+	TestBusScheduler();
+	TestParallelScheduler();
+#ifndef _WIN32
+	TestJobServer();
+	TestLiveMetrics();
+#endif
+	TestHostHooks();
+	TestSubroutineMemo();
+	TestCheckpoints();
+	TestMemoryDump();
+	TestCodeCoverage(coveragePrefix);
+	TestSamplingProfiler();
+	TestAsyncCpu();
+	TestGuestScheduler();
 
 	uint8_t program[] = {
 		0xE8,
@@ -2313,7 +1280,7 @@ int main()
 		0x45
 	};
 
-	auto cpu = std::make_shared<MOS6502>();
+	auto cpu = std::make_shared<MOS6502Debug>();
 	cpu->loadProgram(program, sizeof(program), 0x0000);
 	cpu->loadProgram(startingB0, sizeof(startingB0), 0x00B0);
 	cpu->loadProgram(starting0842, sizeof(starting0842), 0x0842);
@@ -2322,5 +1289,24 @@ int main()
 	cpu->loadProgram(twoProgram, sizeof(twoProgram), 0x0120);
 	cpu->loadProgram(threeProgram, sizeof(threeProgram), 0x0150);
 	cpu->loadProgram(memory, sizeof(memory), 0x0A24);
+
+#ifndef _WIN32
+	if (!gdbEndpoint.empty())
+	{
+		cpu->ISDEBUG = false;
+		return serveGdb(*cpu, gdbEndpoint) ? 0 : 1;
+	}
+#endif
+
+	std::vector<uint8_t> initial(0x10000);
+	cpu->copyMemory(0x0000, initial.data(), initial.size());
 	cpu->execute();
+	if (!dumpPath.empty())
+	{
+		// what the run wrote, then all of memory as it left it
+		std::vector<uint8_t> after(0x10000);
+		cpu->copyMemory(0x0000, after.data(), after.size());
+		MemoryDump::printDiff(std::cout, initial.data(), after.data(), after.size(), 0x0000, 8);
+		return MemoryDump::writeBinary(dumpPath, after.data(), after.size()) ? 0 : 1;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include "MemoryDump.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+static inline char* putHex8(char* out, uint8_t value)
+{
+	out[0] = hexDigits[value >> 4];
+	out[1] = hexDigits[value & 0xF];
+	return out + 2;
+}
+
+static inline char* putHex16(char* out, uint16_t value)
+{
+	return putHex8(putHex8(out, value >> 8), value & 0xFF);
+}
+
+static char* putLine(char* out, const uint8_t* bytes, std::size_t count, uint16_t address)
+{
+	// "1000  A9 83 ... 8D  02 00 ... A9  |..ab............|\n", a short last line padded to the full width
+	out = putHex16(out, address);
+	memset(out, ' ', 2 + MemoryDump::bytesPerLine * 3 + 1);
+	out += 2;
+	for (std::size_t i = 0; i < count; i++)
+	{
+		putHex8(out + i * 3 + (i >= 8), bytes[i]);
+	}
+	out += MemoryDump::bytesPerLine * 3 + 1;
+	*out++ = ' ';
+	*out++ = '|';
+	for (std::size_t i = 0; i < count; i++)
+	{
+		*out++ = bytes[i] >= 0x20 && bytes[i] < 0x7F ? static_cast<char>(bytes[i]) : '.';
+	}
+	*out++ = '|';
+	*out++ = '\n';
+	return out;
+}
+
+std::size_t MemoryDump::formatHex(const uint8_t* memory, std::size_t size, uint16_t base, char* out, std::size_t outSize, std::size_t* position)
+{
+	char* start = out;
+	std::size_t offset = *position;
+	while (offset < size && outSize - (out - start) >= maxLine)
+	{
+		std::size_t count = std::min(bytesPerLine, size - offset);
+		bool repeated = offset >= bytesPerLine && count == bytesPerLine
+			&& memcmp(memory + offset, memory + offset - bytesPerLine, bytesPerLine) == 0;
+		if (!repeated)
+		{
+			out = putLine(out, memory + offset, count, static_cast<uint16_t>(base + offset));
+			offset += count;
+			continue;
+		}
+		// the whole run at once, so it only costs one line however long it is
+		std::size_t end = offset + bytesPerLine;
+		while (end + bytesPerLine <= size && memcmp(memory + end, memory + offset, bytesPerLine) == 0)
+		{
+			end += bytesPerLine;
+		}
+		memcpy(out, "*     to ", 9);
+		out = putHex16(out + 9, static_cast<uint16_t>(base + end - 1));
+		*out++ = '\n';
+		offset = end;
+	}
+	*position = offset;
+	return out - start;
+}
+
+void MemoryDump::printHex(std::ostream& out, const uint8_t* memory, std::size_t size, uint16_t base)
+{
+	char buffer[256 * maxLine];
+	std::size_t position = 0;
+	while (position < size)
+	{
+		out.write(buffer, formatHex(memory, size, base, buffer, sizeof(buffer), &position));
+	}
+}
+
+bool MemoryDump::writeBinary(const std::string& path, const uint8_t* memory, std::size_t size)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file.write(reinterpret_cast<const char*>(memory), size))
+	{
+		std::cerr << "Memory dump: could not write " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+static std::size_t nextDifference(const uint8_t* before, const uint8_t* after, std::size_t offset, std::size_t size)
+{
+	// first offset >= offset where the snapshots differ, size if there is none; unchanged memory is skipped
+	// 16 bytes (or 8 without SSE2) per compare
+#if defined(__SSE2__) || defined(_M_X64)
+	for (; offset + 16 <= size; offset += 16)
+	{
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(before + offset));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(after + offset));
+		unsigned equal = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)));
+		if (equal != 0xFFFF)
+		{
+			return offset + std::countr_zero(~equal & 0xFFFF);
+		}
+	}
+#else
+	for (; offset + 8 <= size; offset += 8)
+	{
+		uint64_t a, b;
+		memcpy(&a, before + offset, sizeof(a));
+		memcpy(&b, after + offset, sizeof(b));
+		if (a != b) { break; }
+	}
+#endif
+	while (offset < size && before[offset] == after[offset]) { offset++; }
+	return offset;
+}
+
+static std::size_t nextSame(const uint8_t* before, const uint8_t* after, std::size_t offset, std::size_t size)
+{
+	// first offset >= offset where the snapshots agree again; changed runs are short, bytewise is fine
+	while (offset < size && before[offset] != after[offset]) { offset++; }
+	return offset;
+}
+
+std::vector<MemoryDump::Range> MemoryDump::diff(const uint8_t* before, const uint8_t* after, std::size_t size, std::size_t mergeGap)
+{
+	std::vector<Range> ranges;
+	std::size_t offset = nextDifference(before, after, 0, size);
+	while (offset < size)
+	{
+		std::size_t end = nextSame(before, after, offset, size);
+		if (!ranges.empty() && offset - (ranges.back().first + ranges.back().size) <= mergeGap)
+		{
+			ranges.back().size = static_cast<uint32_t>(end - ranges.back().first);
+		}
+		else
+		{
+			ranges.push_back({ static_cast<uint32_t>(offset), static_cast<uint32_t>(end - offset) });
+		}
+		offset = nextDifference(before, after, end, size);
+	}
+	return ranges;
+}
+
+void MemoryDump::printDiff(std::ostream& out, const uint8_t* before, const uint8_t* after, std::size_t size, uint16_t base, std::size_t mergeGap)
+{
+	char line[2 * maxLine];
+	for (const Range& range : diff(before, after, size, mergeGap))
+	{
+		char* end = putHex16(line, static_cast<uint16_t>(base + range.first));
+		*end++ = '-';
+		end = putHex16(end, static_cast<uint16_t>(base + range.first + range.size - 1));
+		out.write(line, end - line) << " (" << std::dec << range.size << (range.size == 1 ? " byte)\n" : " bytes)\n");
+
+		for (uint32_t offset = range.first; offset < range.first + range.size; offset += bytesPerLine)
+		{
+			std::size_t count = std::min<std::size_t>(bytesPerLine, range.first + range.size - offset);
+			for (const uint8_t* side : { before, after })
+			{
+				end = line;
+				*end++ = side == before ? '-' : '+';
+				*end++ = ' ';
+				end = putLine(end, side + offset, count, static_cast<uint16_t>(base + offset));
+				out.write(line, end - line);
+			}
+		}
+	}
+}
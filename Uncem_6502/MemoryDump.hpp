@@ -0,0 +1,44 @@
+#ifndef MEMORYDUMP_HPP
+#define MEMORYDUMP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Inspection of guest memory copied out of a CPU (see MOS6502::copyMemory()): hexdumps that collapse runs
+// of identical lines, binary dumps, and a diff between two snapshots that reports the changed ranges.
+// Text is formatted into caller-provided buffers like the Disassembler's, never a stream operation per byte.
+class MemoryDump
+{
+public:
+	static constexpr std::size_t bytesPerLine = 16;
+	// "1000  A9 83 8D 01 00 A9 05 8D  02 00 A9 81 8D 03 00 A9  |................|\n"
+	static constexpr std::size_t maxLine = 80;
+
+	struct Range
+	{
+		uint32_t first;       // offset of the first changed byte
+		uint32_t size;
+	};
+
+	// hexdump of memory[0, size) loaded at base, from *position on, 16 bytes per line. A line equal to the one
+	// before it is not printed; a run of them becomes a single "*" line naming where the run ends, e.g.
+	// "*     to 10FF". Stops before a line that would not fit into out, returns the characters written and
+	// advances *position, so a dump can be formatted in chunks
+	static std::size_t formatHex(const uint8_t* memory, std::size_t size, uint16_t base, char* out, std::size_t outSize, std::size_t* position);
+
+	static void printHex(std::ostream& out, const uint8_t* memory, std::size_t size, uint16_t base);
+
+	static bool writeBinary(const std::string& path, const uint8_t* memory, std::size_t size);
+
+	// changed byte ranges between two snapshots of the same size, in address order; ranges at most mergeGap
+	// unchanged bytes apart are reported as one
+	static std::vector<Range> diff(const uint8_t* before, const uint8_t* after, std::size_t size, std::size_t mergeGap = 0);
+
+	// every changed range as "1000-100F (16 bytes)" followed by the old and new bytes, 16 per line
+	static void printDiff(std::ostream& out, const uint8_t* before, const uint8_t* after, std::size_t size, uint16_t base, std::size_t mergeGap = 0);
+};
+
+#endif
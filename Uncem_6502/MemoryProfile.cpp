@@ -0,0 +1,124 @@
+#include "MemoryProfile.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+static const char* accessNames[MemoryProfile::AccessKinds] = { "reads", "writes", "executes" };
+
+MemoryProfile::MemoryProfile(bool byteGranularity)
+{
+	if (byteGranularity)
+	{
+		mByteCounts = std::make_unique<uint64_t[]>(AccessKinds * addressCount);
+	}
+	reset();
+}
+
+uint64_t MemoryProfile::byteHits(Access kind, uint16_t addr) const
+{
+	return mByteCounts ? mByteCounts[kind * addressCount + addr] : 0;
+}
+
+uint64_t MemoryProfile::total(Access kind) const
+{
+	uint64_t sum = 0;
+	for (std::size_t page = 0; page < pageCount; page++)
+	{
+		sum += mPageCounts[kind][page];
+	}
+	return sum;
+}
+
+void MemoryProfile::reset()
+{
+	memset(mPageCounts, 0, sizeof(mPageCounts));
+	if (mByteCounts)
+	{
+		std::fill(mByteCounts.get(), mByteCounts.get() + AccessKinds * addressCount, 0);
+	}
+}
+
+bool MemoryProfile::writeCsv(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "Could not open heatmap file \"" << path << "\" !" << std::endl;
+		return false;
+	}
+
+	std::size_t cells = mByteCounts ? addressCount : pageCount;
+	file << (mByteCounts ? "address" : "page") << ",reads,writes,executes\n";
+	for (std::size_t cell = 0; cell < cells; cell++)
+	{
+		uint64_t counts[AccessKinds];
+		for (int kind = 0; kind < AccessKinds; kind++)
+		{
+			counts[kind] = mByteCounts ? mByteCounts[kind * addressCount + cell] : mPageCounts[kind][cell];
+		}
+		if (counts[Read] == 0 && counts[Write] == 0 && counts[Execute] == 0)
+		{
+			continue;
+		}
+		file << "0x" << std::hex << std::setw(mByteCounts ? 4 : 2) << std::setfill('0') << cell << std::dec
+			<< "," << counts[Read] << "," << counts[Write] << "," << counts[Execute] << "\n";
+	}
+	return file.good();
+}
+
+bool MemoryProfile::writePgm(const std::string& path, Access kind) const
+{
+	std::ofstream file(path, std::ios::out | std::ios::trunc | std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cerr << "Could not open heatmap file \"" << path << "\" !" << std::endl;
+		return false;
+	}
+
+	std::size_t side = mByteCounts ? 256 : 16;
+	std::vector<uint64_t> counts(side * side);
+	for (std::size_t cell = 0; cell < counts.size(); cell++)
+	{
+		counts[cell] = mByteCounts ? mByteCounts[kind * addressCount + cell] : mPageCounts[kind][cell];
+	}
+
+	// log scale, otherwise a single hot loop turns every other cell black
+	double top = std::log1p(static_cast<double>(*std::max_element(counts.begin(), counts.end())));
+	std::vector<uint8_t> pixels(counts.size());
+	for (std::size_t cell = 0; cell < counts.size(); cell++)
+	{
+		pixels[cell] = top > 0 ? static_cast<uint8_t>(255.0 * std::log1p(static_cast<double>(counts[cell])) / top) : 0;
+	}
+
+	file << "P5\n" << side << " " << side << "\n255\n";
+	file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+	return file.good();
+}
+
+void MemoryProfile::printSummary(std::ostream& out, std::size_t topPages) const
+{
+	for (int kind = 0; kind < AccessKinds; kind++)
+	{
+		std::vector<std::size_t> pages(pageCount);
+		for (std::size_t page = 0; page < pageCount; page++)
+		{
+			pages[page] = page;
+		}
+		std::size_t shown = std::min(topPages, pageCount);
+		std::partial_sort(pages.begin(), pages.begin() + shown, pages.end(), [&](std::size_t a, std::size_t b) {
+			return mPageCounts[kind][a] > mPageCounts[kind][b];
+		});
+
+		out << std::dec << accessNames[kind] << ": " << total(static_cast<Access>(kind)) << "\t;";
+		for (std::size_t i = 0; i < shown && mPageCounts[kind][pages[i]] != 0; i++)
+		{
+			out << " $" << std::hex << std::setw(2) << std::setfill('0') << pages[i] << "xx:" << std::dec << mPageCounts[kind][pages[i]];
+		}
+		out << std::setfill(' ') << "\n";
+	}
+}
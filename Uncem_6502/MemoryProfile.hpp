@@ -0,0 +1,58 @@
+#ifndef MEMORYPROFILE_HPP
+#define MEMORYPROFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+
+// Read/write/execute counters for guest memory, always per 256-byte page and optionally per byte.
+// A CPU only pays for a null check per access while no profile is attached (see MOS6502::attachProfile).
+class MemoryProfile
+{
+public:
+	enum Access
+	{
+		Read = 0,
+		Write = 1,
+		Execute = 2,
+		AccessKinds = 3
+	};
+
+	static constexpr std::size_t pageCount = 256;
+	static constexpr std::size_t addressCount = 65536;
+
+	explicit MemoryProfile(bool byteGranularity = false);
+
+	void record(Access kind, uint16_t addr)
+	{
+		mPageCounts[kind][addr >> 8]++;
+		if (mByteCounts)
+		{
+			mByteCounts[kind * addressCount + addr]++;
+		}
+	}
+
+	bool hasByteCounts() const { return mByteCounts != nullptr; }
+	uint64_t pageHits(Access kind, uint8_t page) const { return mPageCounts[kind][page]; }
+	uint64_t byteHits(Access kind, uint16_t addr) const;
+	uint64_t total(Access kind) const;
+
+	void reset();
+
+	// page,reads,writes,executes (or address,... with byte granularity), one line per touched page/byte
+	bool writeCsv(const std::string& path) const;
+
+	// binary greyscale PGM, log-scaled: 16x16 pixels (one per page), or 256x256 (one per byte) with byte granularity
+	bool writePgm(const std::string& path, Access kind) const;
+
+	// totals and the hottest pages for each kind of access
+	void printSummary(std::ostream& out, std::size_t topPages = 8) const;
+
+private:
+	uint64_t mPageCounts[AccessKinds][pageCount];
+	std::unique_ptr<uint64_t[]> mByteCounts;
+};
+
+#endif
@@ -0,0 +1,99 @@
+// Reader for the live metrics segments of running emulators (see LiveMetrics): prints every claimed slot in
+// the Prometheus text format, once or every interval milliseconds. With --textfile the output replaces the
+// file atomically instead, for node_exporter's textfile collector or anything else that polls a file.
+//
+//   6502_Metrics [--interval ms] [--textfile path] <segment>
+//
+// A job server started with --metrics <segment> publishes one slot per worker.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "LiveMetrics.hpp"
+
+static bool writeTextfile(const std::string& path, const std::string& text)
+{
+	// rename() replaces the file in one step, so a collector never reads half of it
+	std::string temporary = path + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::out | std::ios::trunc);
+		if (!(file << text))
+		{
+			std::cerr << "Metrics: could not write " << temporary << std::endl;
+			return false;
+		}
+	}
+	if (std::rename(temporary.c_str(), path.c_str()) != 0)
+	{
+		std::cerr << "Metrics: could not replace " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned long interval = 0;
+	std::string textfile;
+	std::string segment;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--interval" && i + 1 < argc)
+		{
+			interval = std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--textfile" && i + 1 < argc)
+		{
+			textfile = argv[++i];
+		}
+		else if (segment.empty())
+		{
+			segment = arg;
+		}
+		else
+		{
+			segment.clear();
+			break;
+		}
+	}
+	if (segment.empty())
+	{
+		std::cerr << "Usage: " << argv[0] << " [--interval ms] [--textfile path] <segment>" << std::endl;
+		return 2;
+	}
+
+	LiveMetrics metrics;
+	if (!metrics.open(segment))
+	{
+		return 1;
+	}
+	for (;;)
+	{
+		std::ostringstream text;
+		metrics.writePrometheus(text);
+		if (textfile.empty())
+		{
+			std::cout << text.str() << std::flush;
+		}
+		else if (!writeTextfile(textfile, text.str()))
+		{
+			return 1;
+		}
+		if (interval == 0)
+		{
+			return 0;
+		}
+		if (!metrics.creatorAlive())
+		{
+			std::cerr << "Metrics: the process publishing " << segment << " has exited" << std::endl;
+			return 1;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+	}
+}
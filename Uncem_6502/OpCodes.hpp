@@ -0,0 +1,221 @@
+#ifndef OPCODES_HPP
+#define OPCODES_HPP
+
+enum OpCode
+{
+	BRK = 0,
+	JMPAbs = 0x4C,
+	JMPInd = 0x6C,
+	JSRAbs = 0x20,
+	NOP = 0xEA,
+	PHP = 0x08,
+	PLP = 0x28,
+	PLA = 0x68,
+	PHA = 0x48,
+	RTS = 0x60,
+	RTI = 0x40,
+
+	//Load Instructions
+
+	LDAIndX = 0xA1,
+	LDAZeroP = 0xA5,
+	LDAImmediate = 0xA9,
+	LDAAbs = 0xAD,
+	LDAIndY = 0xB1,
+	LDAZeroPX = 0xB5,
+	LDAAbsY = 0xB9,
+	LDAAbsX = 0xBD,
+
+	LDXImmediate = 0xA2,
+	LDXZeroP = 0xA6,
+	LDXZeroPY = 0xB6,
+	LDXAbs = 0xAE,
+	LDXAbsY = 0xBE,
+
+	LDYImmediate = 0xA0,
+	LDYZeroP = 0xA4,
+	LDYZeroPX = 0xB4,
+	LDYAbs = 0xAC,
+	LDYAbsX = 0xBC,
+
+	//Save instructions
+
+	STAZeroP = 0x85,
+	STAZeroPX = 0x95,
+	STAAbs = 0x8D,
+	STAAbsX = 0x9D,
+	STAAbsY = 0x99,
+	STAIndX = 0x81,
+	STAIndY = 0x91,
+
+	STXZeroP = 0x86,
+	STXZeroPY = 0x96,
+	STXAbs = 0x8E,
+
+	STYZeroP = 0x84,
+	STYZeroPX = 0x94,
+	STYAbs = 0x8C,
+
+	//increment, decrement instructions
+
+	INY = 0xC8,
+	INX = 0xE8,
+	INCZeroP = 0xE6,
+	INCZeroPX = 0xF6,
+	INCAbs = 0xEE,
+	INCAbsX = 0xFE,
+
+	DEX = 0xCA, // Decrement X by 1
+	DEY = 0x88, // Decrement Y by 1
+	DECZeroP = 0xC6,
+	DECZeroPX = 0xD6,
+	DECAbs = 0xCE,
+	DECAbsX = 0xDE,
+
+
+	//flag instructions
+
+	CLC = 0x18, //Clear carry
+	CLD = 0xD8, //Clear Decimal Mode
+	CLI = 0x58, //Clear Interrupt Disable Bit
+	CLV = 0xB8, //Clear Overflow flag
+	SEC = 0x38, //Set carry flag
+	SEI = 0x78, //Set Interruption flag
+	SED = 0xF8, //Set Decimal Flag
+
+	//Transfer instructions
+
+	TAX = 0xAA, //Transfer Accumulator to X
+	TAY = 0xA8, //Transfer Accumulator to Y
+	TSX = 0xBA, //Transfer Stack Pointer to X
+	TXA = 0x8A, //Transfer X to Accumulator
+	TXS = 0x9A, //Transfer X to Stack Pointer
+	TYA = 0x98, // Transfer Y to Accumulator
+
+	// Logical and arithmetical instructions
+
+	ADCImmediate = 0x69, // immediate	ADC #oper	69	2	2
+	ADCZeroP = 0x65,      // zeropage	ADC oper	65	2	3
+	ADCZeroPX = 0x75,    //zeropage, X	ADC oper, X	75	2	4
+	ADCAbs = 0x6D,        //absolute	ADC oper	6D	3	4
+	ADCAbsX = 0x7D,       //absolute, X	ADC oper, X	7D	3	4 *
+	ADCAbsY = 0x79,       //absolute, Y	ADC oper, Y	79	3	4 *
+	ADCIndX = 0x61,        //(indirect, X)	ADC(oper, X)	61	2	6
+	ADCIndY = 0x71,		//(indirect), Y	ADC(oper), Y	71	2	5 *
+
+	SBCImmediate = 0xE9,//immediate	SBC #oper	E9	2	2
+	SBCZeroP = 0xE5,//zeropage	SBC oper	E5	2	3
+	SBCZeroPX = 0xF5,//zeropage, X	SBC oper, X	F5	2	4
+	SBCAbs = 0xED,//absolute	SBC oper	ED	3	4
+	SBCAbsX = 0xFD,//absolute, X	SBC oper, X	FD	3	4 *
+	SBCAbsY = 0xF9,//absolute, Y	SBC oper, Y	F9	3	4 *
+	SBCIndX = 0xE1,//(indirect, X)	SBC(oper, X)	E1	2	6
+	SBCIndY = 0xF1,//(indirect), Y	SBC(oper), Y	F1	2	5 *
+
+
+	ROLAcc = 0x2A, // Rotate left
+	ROLZeroP = 0x26,
+	ROLZeroPX = 0x36,
+	ROLAbs = 0x2E,
+	ROLAbsX = 0x3E,
+
+	RORAcc = 0x6A, // Rotate right
+	RORZeroP = 0x66,
+	RORZeroPX = 0x76,
+	RORAbs = 0x6E,
+	RORAbsX = 0x7E,
+
+	ASLAcc = 0x0A, //Arithmetic shift left
+	ASLZeroP = 0x06,
+	ASLZeroPX = 0x16,
+	ASLAbs = 0x0E,
+	ASLAbsX = 0x1E,
+
+	LSRAcc = 0x4A, //Logical shift right
+	LSRZeroP = 0x46,
+	LSRZeroPX = 0x56,
+	LSRAbs = 0x4E,
+	LSRAbsX = 0x5E,
+
+	ORAImmediate = 0x09,  //or with memory or accumulator
+	ORAZeroP = 0x05,
+	ORAZeroPX = 0x15,
+	ORAAbs = 0x0D,
+	ORAAbsX = 0x1D,
+	ORAAbsY = 0x19,
+	ORAIndX = 0x01,
+	ORAIndY = 0x11,
+
+	EORImmediate = 0x49,  //xor with memory or accumulator
+	EORZeroP = 0x45,
+	EORZeroPX = 0x55,
+	EORAbs = 0x4D,
+	EORAbsX = 0x5D,
+	EORAbsY = 0x59,
+	EORIndX = 0x41,
+	EORIndY = 0x51,
+
+	ANDImmediate = 0x29, //and with memory or accumulator
+	ANDZeroP = 0x25,
+	ANDZeroPX = 0x35,
+	ANDAbs = 0x2D,
+	ANDAbsX = 0x3D,
+	ANDAbsY = 0x39,
+	ANDIndX = 0x21,
+	ANDIndY = 0x31,
+
+	//Branch instructions
+
+	BCC = 0x90, //Branch on Carry Clear
+	BCS = 0xB0, //Branch on Carry Set
+	BEQ = 0xF0, //Branch on Result Zero
+	BMI = 0x30,  //Branch on result minus
+	BNE = 0xD0,  //Branch on result non zero
+	BPL = 0x10,  //Branch on result plus
+	BVC = 0x50,
+	BVS = 0x70,
+
+	//Compare instructions
+
+	CMPImmediate = 0xC9,
+	CMPZeroP = 0xC5,
+	CMPZeroPX = 0xD5,
+	CMPAbs = 0xCD,
+	CMPAbsX = 0xDD,
+	CMPAbsY = 0xD9,
+	CMPIndX = 0xC1,
+	CMPIndY = 0xD1,
+
+	CPXImmediate = 0xE0, //Compare X With Memory
+	CPXZeroP = 0xE4,
+	CPXAbs = 0xEC,
+
+	CPYImmediate = 0xC0, //Compare Y With Memory
+	CPYZeroP = 0xC4,
+	CPYAbs = 0xCC,
+
+	BITAbs = 0x2C,
+	BITZeroP = 0x24,
+
+	HYPERCALL = 0x02, // Undocumented code, HYP #nn calls host function nn, see MOS6502::setHypercall()
+	HALT = 0xFF // Undocumented code, used for testing
+};
+
+enum addressMode // addressing modes, used by the instruction table in Disassembler.hpp
+{
+	IMD = 1,
+	ZPG = 2,
+	ZPX = 3,
+	ZPY = 4,
+	ABS = 5,
+	ABX = 6,
+	ABY = 7,
+	INDX = 8,
+	INDY = 9,
+	NON = 10,
+	A = 11, //Accumulator as address mode, used in few commands
+	IND = 12, // (indirect), JMP only
+	REL = 13  // relative, branches
+};
+
+#endif
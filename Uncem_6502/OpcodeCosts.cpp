@@ -0,0 +1,308 @@
+// Host cost of the interpreter per guest opcode: runs a workload one step() at a time, reads the host counters
+// (see HostCounters) around every dispatch and charges the difference to the opcode that ran. What reading
+// the counters costs by itself is measured up front and taken off again.
+//
+// Prints 16x16 matrices in opcode table layout (row = high nibble, column = low nibble) of host cycles and
+// branch mispredicts per dispatch, the same figures per addressing mode, and the opcodes that cost the most
+// in total, which are the executeOpcode() handlers worth optimizing. Without hardware counters (most
+// containers and VMs) only nanoseconds per dispatch are shown; they include the clock read and are noisy.
+//
+//   6502_OpcodeCosts [--instructions n] [--start address] [--top n] <binary> [load address]
+//
+// The binary is loaded at the load address (default 0) and runs from the start address (default the load
+// address) until it halts, hits an unknown opcode or ran n instructions (default 100000000). Addresses may be
+// given in hex with a 0x or $ prefix.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "HostCounters.hpp"
+#include "MOS6502.hpp"
+
+namespace
+{
+	struct Cost
+	{
+		uint64_t dispatches = 0;
+		uint64_t totals[HostCounters::counterCount] = {};
+	};
+
+	const char* modeName(addressMode mode)
+	{
+		switch (mode)
+		{
+		case IMD: return "#imm";
+		case ZPG: return "zp";
+		case ZPX: return "zp,X";
+		case ZPY: return "zp,Y";
+		case ABS: return "abs";
+		case ABX: return "abs,X";
+		case ABY: return "abs,Y";
+		case INDX: return "(zp,X)";
+		case INDY: return "(zp),Y";
+		case NON: return "implied";
+		case A: return "A";
+		case IND: return "(abs)";
+		case REL: return "rel";
+		}
+		return "?";
+	}
+
+	class OpcodeCosts
+	{
+	public:
+		void open()
+		{
+			mCounters.open();
+			mCounters.calibrate(mOverhead);
+		}
+
+		StopReason run(MOS6502& cpu, uint64_t maxInstructions)
+		{
+			MOS6502::Host host(cpu);
+			uint64_t before[HostCounters::counterCount];
+			uint64_t after[HostCounters::counterCount];
+			for (uint64_t executed = 0; executed < maxInstructions; executed++)
+			{
+				Cost& cost = mCosts[host.peek(cpu.programCounter())];
+				mCounters.read(before);
+				StopReason reason = cpu.step();
+				mCounters.read(after);
+				cost.dispatches++;
+				for (std::size_t counter = 0; counter < HostCounters::counterCount; counter++)
+				{
+					cost.totals[counter] += after[counter] - before[counter];
+				}
+				if (reason != STOP_NONE) { return reason; }
+			}
+			return STOP_BUDGET;
+		}
+
+		void print(std::ostream& out, std::size_t top) const
+		{
+			HostCounters::Counter primary = mCounters.available(HostCounters::CYCLES) ? HostCounters::CYCLES : HostCounters::NANOSECONDS;
+			out << "Counters:";
+			for (std::size_t counter = 0; counter < HostCounters::counterCount; counter++)
+			{
+				auto which = static_cast<HostCounters::Counter>(counter);
+				if (!mCounters.available(which)) { continue; }
+				out << " " << HostCounters::name(which) << (mCounters.userRead(which) ? "" : " (read() per sample)")
+					<< " overhead " << mOverhead[counter] << ";";
+			}
+			out << "\n\n";
+
+			printMatrix(out, primary);
+			if (mCounters.available(HostCounters::BRANCH_MISSES))
+			{
+				printMatrix(out, HostCounters::BRANCH_MISSES);
+			}
+
+			// per addressing mode
+			Cost modes[REL + 1];
+			for (std::size_t opcode = 0; opcode < 256; opcode++)
+			{
+				Cost& mode = modes[instructionTable[opcode].mode];
+				mode.dispatches += mCosts[opcode].dispatches;
+				for (std::size_t counter = 0; counter < HostCounters::counterCount; counter++)
+				{
+					mode.totals[counter] += mCosts[opcode].totals[counter];
+				}
+			}
+			out << std::left << std::setw(18) << "Mode" << std::right;
+			printHeader(out);
+			for (int mode = IMD; mode <= REL; mode++)
+			{
+				if (modes[mode].dispatches == 0) { continue; }
+				out << std::left << std::setw(18) << modeName(static_cast<addressMode>(mode)) << std::right;
+				printRow(out, modes[mode]);
+			}
+
+			// the opcodes that cost the most in total
+			std::vector<std::size_t> order;
+			uint64_t total = 0;
+			for (std::size_t opcode = 0; opcode < 256; opcode++)
+			{
+				if (mCosts[opcode].dispatches == 0) { continue; }
+				order.push_back(opcode);
+				total += net(mCosts[opcode], primary);
+			}
+			top = std::min(top, order.size());
+			std::partial_sort(order.begin(), order.begin() + top, order.end(), [&](std::size_t a, std::size_t b)
+			{
+				return net(mCosts[a], primary) > net(mCosts[b], primary);
+			});
+			out << "\n" << std::left << std::setw(11) << "Opcode" << std::setw(7) << "share" << std::right;
+			printHeader(out);
+			for (std::size_t i = 0; i < top; i++)
+			{
+				std::size_t opcode = order[i];
+				const InstructionInfo& info = instructionTable[opcode];
+				char name[16];
+				std::snprintf(name, sizeof(name), "%02X %s", static_cast<unsigned>(opcode), info.mnemonic ? info.mnemonic : "???");
+				char share[16];
+				std::snprintf(share, sizeof(share), "%5.1f%%", total ? 100.0 * net(mCosts[opcode], primary) / total : 0.0);
+				out << std::left << std::setw(11) << name << std::setw(7) << share << std::right;
+				printRow(out, mCosts[opcode]);
+			}
+		}
+
+	private:
+		uint64_t net(const Cost& cost, HostCounters::Counter counter) const
+		{
+			// the cost of reading the counters comes off every dispatch, as far as there is anything to take off
+			uint64_t overhead = cost.dispatches * mOverhead[counter];
+			return cost.totals[counter] > overhead ? cost.totals[counter] - overhead : 0;
+		}
+
+		double perDispatch(const Cost& cost, HostCounters::Counter counter) const
+		{
+			return cost.dispatches ? static_cast<double>(net(cost, counter)) / cost.dispatches : 0.0;
+		}
+
+		void printMatrix(std::ostream& out, HostCounters::Counter counter) const
+		{
+			out << HostCounters::name(counter) << " per dispatch\n   ";
+			for (int low = 0; low < 16; low++)
+			{
+				out << std::setw(7) << ("x" + std::string(1, "0123456789ABCDEF"[low]));
+			}
+			out << "\n";
+			for (int high = 0; high < 16; high++)
+			{
+				out << "0123456789ABCDEF"[high] << "x ";
+				for (int low = 0; low < 16; low++)
+				{
+					const Cost& cost = mCosts[high * 16 + low];
+					char cell[16];
+					if (cost.dispatches == 0)
+					{
+						std::snprintf(cell, sizeof(cell), "%7s", ".");
+					}
+					else
+					{
+						std::snprintf(cell, sizeof(cell), "%7.2f", perDispatch(cost, counter));
+					}
+					out << cell;
+				}
+				out << "\n";
+			}
+			out << "\n";
+		}
+
+		void printHeader(std::ostream& out) const
+		{
+			out << std::setw(14) << "dispatches";
+			for (std::size_t counter = 0; counter < HostCounters::counterCount; counter++)
+			{
+				auto which = static_cast<HostCounters::Counter>(counter);
+				if (mCounters.available(which)) { out << std::setw(15) << HostCounters::name(which); }
+			}
+			if (mCounters.available(HostCounters::CYCLES) && mCounters.available(HostCounters::INSTRUCTIONS))
+			{
+				out << std::setw(8) << "IPC";
+			}
+			out << "\n";
+		}
+
+		void printRow(std::ostream& out, const Cost& cost) const
+		{
+			out << std::setw(14) << cost.dispatches;
+			for (std::size_t counter = 0; counter < HostCounters::counterCount; counter++)
+			{
+				auto which = static_cast<HostCounters::Counter>(counter);
+				if (!mCounters.available(which)) { continue; }
+				char value[24];
+				std::snprintf(value, sizeof(value), "%15.2f", perDispatch(cost, which));
+				out << value;
+			}
+			if (mCounters.available(HostCounters::CYCLES) && mCounters.available(HostCounters::INSTRUCTIONS))
+			{
+				uint64_t cycles = net(cost, HostCounters::CYCLES);
+				char ipc[16];
+				std::snprintf(ipc, sizeof(ipc), "%8.2f", cycles ? static_cast<double>(net(cost, HostCounters::INSTRUCTIONS)) / cycles : 0.0);
+				out << ipc;
+			}
+			out << "\n";
+		}
+
+		HostCounters mCounters;
+		uint64_t mOverhead[HostCounters::counterCount] = {};
+		Cost mCosts[256];
+	};
+
+	bool parseAddress(const std::string& text, uint16_t& address)
+	{
+		std::string digits = text;
+		int base = 10;
+		if (digits.rfind("0x", 0) == 0 || digits.rfind("0X", 0) == 0) { digits = digits.substr(2); base = 16; }
+		else if (digits.rfind("$", 0) == 0) { digits = digits.substr(1); base = 16; }
+		char* end = nullptr;
+		unsigned long value = std::strtoul(digits.c_str(), &end, base);
+		if (digits.empty() || *end != '\0' || value > 0xFFFF) { return false; }
+		address = static_cast<uint16_t>(value);
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint64_t maxInstructions = 100000000;
+	std::size_t top = 20;
+	std::string startText;
+	std::vector<std::string> positional;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--instructions" && i + 1 < argc)
+		{
+			maxInstructions = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--start" && i + 1 < argc)
+		{
+			startText = argv[++i];
+		}
+		else if (arg == "--top" && i + 1 < argc)
+		{
+			top = std::strtoul(argv[++i], nullptr, 10);
+		}
+		else
+		{
+			positional.push_back(arg);
+		}
+	}
+	uint16_t load = 0;
+	uint16_t start = 0;
+	if (positional.empty() || positional.size() > 2 || (positional.size() == 2 && !parseAddress(positional[1], load))
+		|| (!startText.empty() && !parseAddress(startText, start)))
+	{
+		std::cerr << "Usage: " << argv[0] << " [--instructions n] [--start address] [--top n] <binary> [load address]" << std::endl;
+		return 2;
+	}
+	if (startText.empty()) { start = load; }
+
+	std::ifstream file(positional[0], std::ios::binary);
+	std::vector<uint8_t> program((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (!file.is_open() || program.empty() || program.size() > 0x10000u - load)
+	{
+		std::cerr << "OpcodeCosts: could not load " << positional[0] << " at " << load << std::endl;
+		return 1;
+	}
+
+	MOS6502Debug cpu;
+	cpu.ISDEBUG = false;
+	cpu.loadProgram(program.data(), program.size(), load);
+	cpu.setProgramCounter(start);
+
+	OpcodeCosts costs;
+	costs.open();
+	StopReason reason = costs.run(cpu, maxInstructions);
+	std::cout << "Stopped: " << (reason == STOP_HALT ? "halt" : reason == STOP_BUDGET ? "instruction limit" : "unknown opcode") << "\n";
+	costs.print(std::cout, top);
+	return reason == STOP_UNKNOWN_OPCODE ? 1 : 0;
+}
@@ -0,0 +1,57 @@
+#include "ParallelScheduler.hpp"
+
+#include <barrier>
+#include <thread>
+
+ParallelScheduler::ParallelScheduler(uint64_t quantumCycles)
+	: mQuantum(quantumCycles ? quantumCycles : 1), mQuanta(0)
+{
+}
+
+std::size_t ParallelScheduler::addCpu(MOS6502& cpu)
+{
+	mCpus.push_back(&cpu);
+	mResults.push_back(STOP_NONE);
+	return mCpus.size() - 1;
+}
+
+void ParallelScheduler::run(uint64_t maxCycles)
+{
+	mQuanta = 0;
+	if (mCpus.empty())
+	{
+		return;
+	}
+
+	// the completion step runs on one thread while all others wait, so the plain counter is safe
+	auto phaseDone = [this]() noexcept { mQuanta++; };
+	std::barrier<decltype(phaseDone)> barrier(static_cast<std::ptrdiff_t>(mCpus.size()), phaseDone);
+
+	std::vector<std::thread> threads;
+	for (std::size_t i = 0; i < mCpus.size(); i++)
+	{
+		threads.emplace_back([this, i, maxCycles, &barrier]() {
+			MOS6502& cpu = *mCpus[i];
+			uint64_t start = cpu.cycles();
+			uint64_t end = maxCycles > UINT64_MAX - start ? UINT64_MAX : start + maxCycles;
+			uint64_t deadline = start;
+			for (;;)
+			{
+				deadline = mQuantum > end - deadline ? end : deadline + mQuantum;
+				StopReason reason = cpu.execute(UINT64_MAX, deadline);
+				if (reason != STOP_BUDGET || deadline == end)
+				{
+					// a stopped CPU leaves the barrier, the others carry on without waiting for it
+					mResults[i] = reason;
+					barrier.arrive_and_drop();
+					return;
+				}
+				barrier.arrive_and_wait();
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+}
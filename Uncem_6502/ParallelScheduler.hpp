@@ -0,0 +1,41 @@
+#ifndef PARALLELSCHEDULER_HPP
+#define PARALLELSCHEDULER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MOS6502.hpp"
+
+// Runs loosely coupled CPUs on one host thread each. The CPUs talk through pages mapped with
+// MOS6502::mapSharedPage(page, memory, true), which are accessed atomically; all other memory stays on
+// the ordinary non-atomic path. Every CPU runs one quantum of guest cycles and then waits on a barrier
+// for the others, so no two running CPUs are ever more than a quantum (plus one instruction) apart.
+//
+// Unlike BusScheduler, the order of accesses to shared pages within a quantum depends on the host, so
+// guests have to synchronise through their mailboxes rather than rely on timing.
+class ParallelScheduler
+{
+public:
+	explicit ParallelScheduler(uint64_t quantumCycles = 1000);
+
+	// the scheduler does not own cpu; each one runs from its current program counter
+	std::size_t addCpu(MOS6502& cpu);
+
+	uint64_t quantum() const { return mQuantum; }
+
+	// start one thread per CPU and wait until every CPU has stopped or run for maxCycles
+	void run(uint64_t maxCycles = UINT64_MAX);
+
+	// why a CPU stopped, STOP_BUDGET if maxCycles ran out first
+	StopReason result(std::size_t cpu) const { return mResults[cpu]; }
+	// barrier phases completed by the last run()
+	uint64_t quanta() const { return mQuanta; }
+
+private:
+	uint64_t mQuantum;
+	uint64_t mQuanta;
+	std::vector<MOS6502*> mCpus;
+	std::vector<StopReason> mResults;
+};
+
+#endif
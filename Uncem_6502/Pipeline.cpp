@@ -0,0 +1,550 @@
+// Runs a guest routine over a stream of records like a filter in a shell pipeline: records come from stdin or
+// a file, the routine is called once per record and what it leaves in its output window goes to stdout or a
+// file, in input order.
+//
+//   6502_Pipeline [--entry address] [--init address] [--lines | --fixed n | --prefixed] [--workers n]
+//                 [--batch n] [--limit n] [--input path] [--output path] [--stats] <binary> [load address]
+//
+// Calling convention: the record is in the input window at $C000 with its length in X (low) and Y (high);
+// the routine writes its result into the output window at $D000 and returns with RTS, the result length in
+// X and Y. Returning with the carry set drops the record. Both windows are 4 KiB of host memory mapped into
+// the guest with mapSharedPage(), so records go in and results come out without copy-on-write or hashing.
+// The CPU is not reset between records: zero page, stack and whatever the --init routine (called once per
+// CPU, like an empty record) set up stay as the guest left them. A call that does not return within --limit
+// instructions (default 10000000) or stops the CPU ends the pipeline with an error.
+//
+// Framing: --lines (default) takes newline-terminated records without the newline and appends one to every
+// result; --fixed n takes records of n bytes and writes results as they are; --prefixed takes and writes
+// records behind a 16-bit little-endian length.
+//
+// Reading, running and writing overlap: a reader thread fills the next batch of records while the CPUs work
+// on the current one and a writer thread writes out the one before. With --workers n, n CPUs share every
+// batch; each keeps its own state, so that is only right for records that do not depend on each other.
+
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MOS6502.hpp"
+
+namespace
+{
+	constexpr uint16_t inputWindow = 0xC000;
+	constexpr uint16_t outputWindow = 0xD000;
+	constexpr std::size_t windowSize = 0x1000;
+	constexpr uint16_t returnAddress = 0xFFF0;    // the routine returns here; never executed, executeUntil() stops first
+	constexpr std::size_t batchCount = 3;         // being read, being run, being written
+
+	enum Framing
+	{
+		LINES,
+		FIXED,
+		PREFIXED
+	};
+
+	struct Batch
+	{
+		std::vector<uint8_t> input;
+		std::vector<std::pair<std::size_t, std::size_t>> records;    // offset and size in input
+		std::vector<std::vector<uint8_t>> results;                   // per record, kept across batches for their capacity
+		std::vector<uint8_t> dropped;
+	};
+
+	template <typename T>
+	class Channel
+	{
+	public:
+		void push(T value)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mLock);
+				mItems.push_back(value);
+			}
+			mReady.notify_one();
+		}
+
+		T pop()
+		{
+			std::unique_lock<std::mutex> lock(mLock);
+			mReady.wait(lock, [this]() { return !mItems.empty(); });
+			T value = mItems.front();
+			mItems.pop_front();
+			return value;
+		}
+
+	private:
+		std::mutex mLock;
+		std::condition_variable mReady;
+		std::deque<T> mItems;
+	};
+
+	class RecordReader
+	{
+	public:
+		RecordReader(std::FILE* file, Framing framing, std::size_t recordSize)
+			: mFile(file), mFraming(framing), mRecordSize(recordSize)
+		{
+		}
+
+		// up to count records into batch, none at the end of the input; false on a read or framing error
+		bool fill(Batch& batch, std::size_t count)
+		{
+			batch.input.clear();
+			batch.records.clear();
+			while (batch.records.size() < count)
+			{
+				const uint8_t* record = nullptr;
+				std::size_t size = 0;
+				if (!next(record, size)) { return false; }
+				if (!record) { break; }
+				batch.records.emplace_back(batch.input.size(), size);
+				batch.input.insert(batch.input.end(), record, record + size);
+			}
+			return true;
+		}
+
+	private:
+		// at least size bytes from mBegin on, as far as the input goes
+		std::size_t available(std::size_t size)
+		{
+			while (mBuffer.size() - mBegin < size && !mEnd)
+			{
+				if (mBegin > 0)
+				{
+					mBuffer.erase(mBuffer.begin(), mBuffer.begin() + static_cast<std::ptrdiff_t>(mBegin));
+					mBegin = 0;
+				}
+				std::size_t filled = mBuffer.size();
+				mBuffer.resize(filled + readSize);
+				std::size_t got = std::fread(mBuffer.data() + filled, 1, readSize, mFile);
+				mBuffer.resize(filled + got);
+				if (got < readSize)
+				{
+					mEnd = true;
+					mFailed = std::ferror(mFile) != 0;
+				}
+			}
+			return mBuffer.size() - mBegin;
+		}
+
+		// record is nullptr at the end of the input
+		bool next(const uint8_t*& record, std::size_t& size)
+		{
+			record = nullptr;
+			std::size_t header = mFraming == PREFIXED ? 2 : 0;
+			if (mFraming == LINES)
+			{
+				// a line has to fit the input window, one byte more is enough to tell it does not
+				std::size_t scanned = 0;
+				for (;;)
+				{
+					std::size_t have = available(scanned + 1);
+					const void* newline = have > scanned ? std::memchr(mBuffer.data() + mBegin + scanned, '\n', have - scanned) : nullptr;
+					if (newline)
+					{
+						size = static_cast<const uint8_t*>(newline) - (mBuffer.data() + mBegin);
+						if (size > windowSize) { return error("a line is longer than the input window"); }
+						header = 1;    // the newline, skipped like a header but after the record
+						break;
+					}
+					if (have > windowSize) { return error("a line is longer than the input window"); }
+					if (mEnd)
+					{
+						if (have == 0) { return !mFailed || error("could not read the input"); }
+						size = have;
+						header = 0;
+						break;
+					}
+					scanned = have;
+				}
+				record = mBuffer.data() + mBegin;
+				mBegin += size + header;
+				return true;
+			}
+
+			std::size_t have = available(header ? header : mRecordSize);
+			if (have == 0) { return !mFailed || error("could not read the input"); }
+			if (mFraming == PREFIXED)
+			{
+				if (have < 2) { return error("the input ends inside a length prefix"); }
+				size = mBuffer[mBegin] | (mBuffer[mBegin + 1] << 8);
+				if (size > windowSize) { return error("a record is longer than the input window"); }
+			}
+			else
+			{
+				size = mRecordSize;
+			}
+			if (available(header + size) < header + size) { return error(mFailed ? "could not read the input" : "the input ends inside a record"); }
+			record = mBuffer.data() + mBegin + header;
+			mBegin += header + size;
+			return true;
+		}
+
+		bool error(const char* message)
+		{
+			std::cerr << "Pipeline: " << message << std::endl;
+			return false;
+		}
+
+		static constexpr std::size_t readSize = 1 << 16;
+
+		std::FILE* mFile;
+		Framing mFraming;
+		std::size_t mRecordSize;
+		std::vector<uint8_t> mBuffer;
+		std::size_t mBegin = 0;
+		bool mEnd = false;
+		bool mFailed = false;
+	};
+
+	class Worker
+	{
+	public:
+		Worker(const MOS6502Debug& prototype, uint64_t limit)
+			: mCpu(prototype), mLimit(limit)
+		{
+			for (std::size_t page = 0; page < windowSize / ProgramImage::pageSize; page++)
+			{
+				mCpu.mapSharedPage(static_cast<uint8_t>((inputWindow >> 8) + page), mInput + page * ProgramImage::pageSize);
+				mCpu.mapSharedPage(static_cast<uint8_t>((outputWindow >> 8) + page), mOutput + page * ProgramImage::pageSize);
+			}
+		}
+
+		bool call(uint16_t entry, const uint8_t* record, std::size_t size, std::vector<uint8_t>& result, bool& dropped)
+		{
+			// like a JSR from returnAddress - 3, so the routine's RTS lands on returnAddress
+			MOS6502::Host host(mCpu);
+			if (size) { memcpy(mInput, record, size); }
+			host.x() = static_cast<uint8_t>(size);
+			host.y() = static_cast<uint8_t>(size >> 8);
+			host.c() = 0;
+			uint16_t back = returnAddress - 1;
+			host.write(0x100 + host.sp(), back >> 8);
+			host.sp()--;
+			host.write(0x100 + host.sp(), back & 0xFF);
+			host.sp()--;
+			if (!mCpu.executeUntil(entry, returnAddress, mLimit))
+			{
+				std::cerr << "Pipeline: the routine at " << entry << " did not return, stopped at " << mCpu.programCounter() << std::endl;
+				return false;
+			}
+			std::size_t length = host.x() | (host.y() << 8);
+			if (length > windowSize)
+			{
+				std::cerr << "Pipeline: the routine at " << entry << " returned " << length << " bytes, more than the output window" << std::endl;
+				return false;
+			}
+			dropped = host.c() != 0;
+			result.assign(mOutput, mOutput + length);
+			return true;
+		}
+
+		uint64_t instructions() const { return mCpu.instructions(); }
+
+	private:
+		alignas(64) uint8_t mInput[windowSize] = {};
+		alignas(64) uint8_t mOutput[windowSize] = {};
+		MOS6502Debug mCpu;
+		uint64_t mLimit;
+	};
+
+	// the CPUs that share every batch; the calling thread is worker 0, the others wait on a barrier in between
+	class WorkerPool
+	{
+	public:
+		WorkerPool(const MOS6502Debug& prototype, std::size_t workers, uint64_t limit, uint16_t entry)
+			: mEntry(entry), mStart(static_cast<std::ptrdiff_t>(workers)), mDone(static_cast<std::ptrdiff_t>(workers))
+		{
+			for (std::size_t i = 0; i < workers; i++)
+			{
+				mWorkers.push_back(std::make_unique<Worker>(prototype, limit));
+			}
+			for (std::size_t i = 1; i < workers; i++)
+			{
+				mThreads.emplace_back([this, i]() {
+					for (;;)
+					{
+						mStart.arrive_and_wait();
+						if (mQuit) { return; }
+						work(*mWorkers[i]);
+						mDone.arrive_and_wait();
+					}
+				});
+			}
+		}
+
+		~WorkerPool()
+		{
+			mQuit = true;
+			if (!mThreads.empty()) { mStart.arrive_and_wait(); }
+			for (std::thread& thread : mThreads)
+			{
+				thread.join();
+			}
+		}
+
+		// every CPU once, before the first record
+		bool init(uint16_t entry)
+		{
+			std::vector<uint8_t> result;
+			bool dropped;
+			for (std::unique_ptr<Worker>& worker : mWorkers)
+			{
+				if (!worker->call(entry, nullptr, 0, result, dropped)) { return false; }
+			}
+			return true;
+		}
+
+		bool run(Batch& batch)
+		{
+			batch.results.resize(std::max(batch.results.size(), batch.records.size()));
+			batch.dropped.assign(batch.records.size(), 0);
+			mBatch = &batch;
+			mNext.store(0, std::memory_order_relaxed);
+			mFailed.store(false, std::memory_order_relaxed);
+			if (!mThreads.empty()) { mStart.arrive_and_wait(); }
+			work(*mWorkers[0]);
+			if (!mThreads.empty()) { mDone.arrive_and_wait(); }
+			return !mFailed.load(std::memory_order_relaxed);
+		}
+
+		uint64_t instructions() const
+		{
+			uint64_t total = 0;
+			for (const std::unique_ptr<Worker>& worker : mWorkers)
+			{
+				total += worker->instructions();
+			}
+			return total;
+		}
+
+	private:
+		static constexpr std::size_t chunk = 16;    // records claimed at a time, keeps neighbours on one CPU
+
+		void work(Worker& worker)
+		{
+			Batch& batch = *mBatch;
+			for (;;)
+			{
+				std::size_t first = mNext.fetch_add(chunk, std::memory_order_relaxed);
+				if (first >= batch.records.size() || mFailed.load(std::memory_order_relaxed)) { return; }
+				std::size_t last = std::min(first + chunk, batch.records.size());
+				for (std::size_t i = first; i < last; i++)
+				{
+					bool dropped = false;
+					if (!worker.call(mEntry, batch.input.data() + batch.records[i].first, batch.records[i].second, batch.results[i], dropped))
+					{
+						mFailed.store(true, std::memory_order_relaxed);
+						return;
+					}
+					batch.dropped[i] = dropped;
+				}
+			}
+		}
+
+		uint16_t mEntry;
+		std::vector<std::unique_ptr<Worker>> mWorkers;
+		std::vector<std::thread> mThreads;
+		std::barrier<> mStart;
+		std::barrier<> mDone;
+		bool mQuit = false;
+		Batch* mBatch = nullptr;
+		std::atomic<std::size_t> mNext{ 0 };
+		std::atomic<bool> mFailed{ false };
+	};
+
+	bool writeBatch(std::FILE* file, Framing framing, const Batch& batch, std::vector<uint8_t>& buffer, uint64_t& written)
+	{
+		// one fwrite per batch
+		buffer.clear();
+		for (std::size_t i = 0; i < batch.records.size(); i++)
+		{
+			if (batch.dropped[i]) { continue; }
+			const std::vector<uint8_t>& result = batch.results[i];
+			if (framing == PREFIXED)
+			{
+				buffer.push_back(static_cast<uint8_t>(result.size()));
+				buffer.push_back(static_cast<uint8_t>(result.size() >> 8));
+			}
+			buffer.insert(buffer.end(), result.begin(), result.end());
+			if (framing == LINES) { buffer.push_back('\n'); }
+			written++;
+		}
+		if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+		{
+			std::cerr << "Pipeline: could not write the output" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	bool parseAddress(const std::string& text, uint16_t& address)
+	{
+		std::string digits = text;
+		int base = 10;
+		if (digits.rfind("0x", 0) == 0 || digits.rfind("0X", 0) == 0) { digits = digits.substr(2); base = 16; }
+		else if (digits.rfind("$", 0) == 0) { digits = digits.substr(1); base = 16; }
+		char* end = nullptr;
+		unsigned long value = std::strtoul(digits.c_str(), &end, base);
+		if (digits.empty() || *end != '\0' || value > 0xFFFF) { return false; }
+		address = static_cast<uint16_t>(value);
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string entryText;
+	std::string initText;
+	Framing framing = LINES;
+	std::size_t recordSize = 0;
+	std::size_t workers = 1;
+	std::size_t batchSize = 256;
+	uint64_t limit = 10000000;
+	std::string inputPath;
+	std::string outputPath;
+	bool stats = false;
+	bool usage = false;
+	std::vector<std::string> positional;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--entry" && hasValue) { entryText = argv[++i]; }
+		else if (arg == "--init" && hasValue) { initText = argv[++i]; }
+		else if (arg == "--lines") { framing = LINES; }
+		else if (arg == "--fixed" && hasValue) { framing = FIXED; recordSize = std::strtoul(argv[++i], nullptr, 10); }
+		else if (arg == "--prefixed") { framing = PREFIXED; }
+		else if (arg == "--workers" && hasValue) { workers = std::strtoul(argv[++i], nullptr, 10); }
+		else if (arg == "--batch" && hasValue) { batchSize = std::strtoul(argv[++i], nullptr, 10); }
+		else if (arg == "--limit" && hasValue) { limit = std::strtoull(argv[++i], nullptr, 10); }
+		else if (arg == "--input" && hasValue) { inputPath = argv[++i]; }
+		else if (arg == "--output" && hasValue) { outputPath = argv[++i]; }
+		else if (arg == "--stats") { stats = true; }
+		else if (arg.rfind("--", 0) == 0) { usage = true; }
+		else { positional.push_back(arg); }
+	}
+	uint16_t load = 0;
+	uint16_t entry = 0;
+	uint16_t init = 0;
+	if (usage || positional.empty() || positional.size() > 2 || (positional.size() == 2 && !parseAddress(positional[1], load))
+		|| (!entryText.empty() && !parseAddress(entryText, entry)) || (!initText.empty() && !parseAddress(initText, init))
+		|| (framing == FIXED && (recordSize == 0 || recordSize > windowSize)) || workers == 0 || batchSize == 0)
+	{
+		std::cerr << "Usage: " << argv[0] << " [--entry address] [--init address] [--lines | --fixed n | --prefixed] [--workers n]\n"
+			<< "       [--batch n] [--limit n] [--input path] [--output path] [--stats] <binary> [load address]" << std::endl;
+		return 2;
+	}
+	if (entryText.empty()) { entry = load; }
+
+	std::ifstream file(positional[0], std::ios::binary);
+	std::vector<uint8_t> program((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (!file.is_open() || program.empty() || program.size() > 0x10000u - load)
+	{
+		std::cerr << "Pipeline: could not load " << positional[0] << " at " << load << std::endl;
+		return 1;
+	}
+	if (load < outputWindow + windowSize && load + program.size() > inputWindow)
+	{
+		std::cerr << "Pipeline: " << positional[0] << " overlaps the input and output windows at " << inputWindow << std::endl;
+		return 1;
+	}
+
+	std::FILE* input = inputPath.empty() ? stdin : std::fopen(inputPath.c_str(), "rb");
+	std::FILE* output = outputPath.empty() ? stdout : std::fopen(outputPath.c_str(), "wb");
+	if (!input || !output)
+	{
+		std::cerr << "Pipeline: could not open " << (input ? outputPath : inputPath) << std::endl;
+		return 1;
+	}
+
+	MOS6502Debug prototype;
+	prototype.ISDEBUG = false;
+	prototype.loadProgram(program.data(), program.size(), load);
+	WorkerPool pool(prototype, workers, limit, entry);
+	if (!initText.empty() && !pool.init(init))
+	{
+		return 1;
+	}
+
+	auto started = std::chrono::steady_clock::now();
+	Batch batches[batchCount];
+	Channel<Batch*> empty;
+	Channel<Batch*> filled;
+	Channel<Batch*> finished;
+	for (Batch& batch : batches)
+	{
+		empty.push(&batch);
+	}
+	std::atomic<bool> stop{ false };
+	bool readFailed = false;
+	bool writeFailed = false;
+	uint64_t records = 0;
+	uint64_t written = 0;
+
+	// a nullptr ends the next stage; after an error the batches still go round until the reader has stopped
+	std::thread reader([&]() {
+		RecordReader source(input, framing, recordSize);
+		for (;;)
+		{
+			Batch* batch = empty.pop();
+			if (stop.load(std::memory_order_relaxed) || (readFailed = !source.fill(*batch, batchSize)) || batch->records.empty())
+			{
+				filled.push(nullptr);
+				return;
+			}
+			filled.push(batch);
+		}
+	});
+	std::thread writer([&]() {
+		std::vector<uint8_t> buffer;
+		for (Batch* batch = finished.pop(); batch; batch = finished.pop())
+		{
+			if (!writeFailed && !writeBatch(output, framing, *batch, buffer, written))
+			{
+				writeFailed = true;
+				stop.store(true, std::memory_order_relaxed);
+			}
+			empty.push(batch);
+		}
+	});
+
+	bool runFailed = false;
+	for (Batch* batch = filled.pop(); batch; batch = filled.pop())
+	{
+		if (!runFailed && !stop.load(std::memory_order_relaxed) && !pool.run(*batch))
+		{
+			runFailed = true;
+			stop.store(true, std::memory_order_relaxed);
+		}
+		records += batch->records.size();
+		(stop.load(std::memory_order_relaxed) ? empty : finished).push(batch);
+	}
+	finished.push(nullptr);
+	reader.join();
+	writer.join();
+	std::fflush(output);
+
+	if (stats)
+	{
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+		std::cerr << "Pipeline: " << records << " records in, " << written << " out, " << pool.instructions()
+			<< " guest instructions, " << seconds << " s" << std::endl;
+	}
+	if (inputPath.size()) { std::fclose(input); }
+	if (outputPath.size() && std::fclose(output) != 0) { writeFailed = true; }
+	return readFailed || runFailed || writeFailed ? 1 : 0;
+}
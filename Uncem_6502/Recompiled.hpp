@@ -0,0 +1,205 @@
+#ifndef RECOMPILED_HPP
+#define RECOMPILED_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include "MOS6502.hpp"
+
+// MOS6502 that runs code translated ahead of time by the Recompiler (see Recompiler.hpp) and interprets
+// everything else. The translation is a table of basic blocks, each one a native function that executes
+// the block's instructions and returns the address execution continues at.
+//
+// A block only runs natively if its bytes in guest memory still match the bytes it was translated from,
+// so code patched at runtime and anything the translator could not follow statically (JMP (ind) targets,
+// BRK, RTI, code reached only through computed addresses) simply falls back to the interpreter.
+class RecompiledCpu : public MOS6502
+{
+public:
+	using BlockFunction = uint16_t (*)(RecompiledCpu& cpu);
+
+	struct Block
+	{
+		uint16_t address;
+		uint16_t length;             // bytes of guest code covered, all of them compared before running it
+		uint16_t instructions;       // instructions retired when the block runs to its end
+		uint32_t cycles;             // and their base cycles, see InstructionInfo::cycles
+		const uint8_t* bytes;        // guest code the block was translated from
+		BlockFunction function;
+	};
+
+	struct Translation
+	{
+		const Block* blocks;
+		std::size_t blockCount;
+	};
+
+	RecompiledCpu() = default;
+
+	void attachTranslation(const Translation* translation)
+	{
+		// nullptr detaches; the index is shared by copies of this CPU
+		if (!translation)
+		{
+			mIndex.reset();
+			return;
+		}
+		auto index = std::make_shared<BlockIndex>();
+		for (std::size_t i = 0; i < translation->blockCount; i++)
+		{
+			const Block& block = translation->blocks[i];
+			auto& page = index->pages[block.address >> 8];
+			if (!page)
+			{
+				page = std::make_unique<const Block*[]>(pageSize);
+			}
+			page[block.address & 0xFF] = &block;
+			for (uint32_t addr = block.address; addr < static_cast<uint32_t>(block.address) + block.length; addr++)
+			{
+				index->codePages[(addr >> 8) & 0xFF] = 1;
+			}
+		}
+		mIndex = std::move(index);
+	}
+
+	StopReason run(uint64_t maxInstructions = UINT64_MAX, uint64_t untilCycle = UINT64_MAX)
+	{
+		// same contract as execute(); tracing, profiling, access observers, coverage, call stacks, breakpoints
+		// and PC hooks need every instruction to go through step(), so any of them switches off the native path.
+		// A block only runs natively if it ends by untilCycle, the instructions around a deadline are interpreted
+		if (!mIndex || ISDEBUG || mProfile || mObserver || mCoverage || mCodeCoverage || mCallStack || hasTraps())
+		{
+			return execute(maxInstructions, untilCycle);
+		}
+
+		uint64_t executed = 0;
+		while (executed < maxInstructions && mCycles < untilCycle)
+		{
+			const Block* block = findBlock(mProgramCounter);
+			if (block && block->instructions <= maxInstructions - executed && block->cycles <= untilCycle - mCycles && matches(*block))
+			{
+				mCodeWritten = false;
+				mProgramCounter = block->function(*this);
+				executed += mRetired;
+				mInstructions += mRetired;
+				mCycles += mRetiredCycles;
+				mNativeInstructions += mRetired;
+				continue;
+			}
+			StopReason reason = step();
+			executed++;
+			if (reason != STOP_NONE) { return reason; }
+		}
+		return STOP_BUDGET;
+	}
+
+	uint64_t nativeInstructions() const { return mNativeInstructions; }
+
+	// the rest is the interface generated code is written against
+
+	uint8_t& a() { return mAccumulator; }
+	uint8_t& x() { return mRegisterX; }
+	uint8_t& y() { return mRegisterY; }
+	uint8_t& s() { return mStackPointer; }
+	uint8_t& c() { return C; }
+	uint8_t& z() { return Z; }
+	uint8_t& i() { return I; }
+	uint8_t& d() { return D; }
+	uint8_t& v() { return V; }
+	uint8_t& n() { return N; }
+	uint16_t pc() const { return mProgramCounter; }
+
+	uint8_t load(uint16_t addr) { return read(addr); }
+
+	void store(uint16_t addr, uint8_t value)
+	{
+		write(addr, value);
+		if (mIndex->codePages[addr >> 8]) { mCodeWritten = true; }
+	}
+
+	// set by store() when the write hit a page holding translated code, the block then returns early so
+	// that the next instruction is checked against its translation again
+	bool codeWritten() const { return mCodeWritten; }
+
+	uint16_t pointer(uint8_t zeroPage) { return load(zeroPage) | (load(static_cast<uint8_t>(zeroPage + 1)) << 8); }
+
+	void push(uint8_t value)
+	{
+		write(stackOffset + mStackPointer, value);
+		mStackPointer--;
+	}
+
+	void nz(uint8_t value) { setZeroAndNegativeFlags(value); }
+	void adc(uint8_t value) { mAccumulator = add(value, mAccumulator, C, D); }
+	void sbc(uint8_t value) { mAccumulator = sub(mAccumulator, value, C, D); }
+	void cmp(uint8_t reg, uint8_t value) { compareBase(reg, value); }
+
+	void bit(uint8_t value)
+	{
+		N = (value & 0x80) != 0;
+		V = (value & 0x40) != 0;
+		Z = (value & mAccumulator) == 0;
+	}
+
+	uint8_t asl(uint8_t value) { return shiftleft(value); }
+	uint8_t lsr(uint8_t value) { return shifteright(value); }
+	uint8_t rol(uint8_t value) { return rotateleft(value); }
+	uint8_t ror(uint8_t value) { return rotateright(value); }
+
+	void pha() { pushAccToStack(); }
+	void pla() { pullAccFromStack(); }
+	void php() { pushStatusToStack(); }
+	void plp() { pullStatusFromStack(); }
+	void rts() { returnFromSubroutine(); }
+
+	// an early exit (taken branch, write to code) retires only the instructions up to it and their cycles
+	uint16_t leave(uint16_t next, uint16_t instructions, uint32_t cycles)
+	{
+		mRetired = instructions;
+		mRetiredCycles = cycles;
+		return next;
+	}
+
+private:
+	struct BlockIndex
+	{
+		std::unique_ptr<const Block*[]> pages[pageCount];   // block starting at each address, per guest page
+		uint8_t codePages[pageCount] = {};                   // pages holding bytes of any block
+	};
+
+	const Block* findBlock(uint16_t addr) const
+	{
+		const auto& page = mIndex->pages[addr >> 8];
+		return page ? page[addr & 0xFF] : nullptr;
+	}
+
+	bool matches(const Block& block) const
+	{
+		if (static_cast<std::size_t>((block.address & 0xFF) + block.length) <= pageSize)
+		{
+			return memcmp(mPages[block.address >> 8] + (block.address & 0xFF), block.bytes, block.length) == 0;
+		}
+		for (uint16_t i = 0; i < block.length; i++)
+		{
+			if (peek(block.address + i) != block.bytes[i]) { return false; }
+		}
+		return true;
+	}
+
+	bool hasTraps() const
+	{
+		for (std::size_t page = 0; page < pageCount; page++)
+		{
+			if (mTrapPages[page] & (TRAP_EXECUTE | TRAP_READ | TRAP_WRITE | PAGE_HOOK)) { return true; }
+		}
+		return false;
+	}
+
+	std::shared_ptr<const BlockIndex> mIndex;
+	bool mCodeWritten = false;
+	uint16_t mRetired = 0;
+	uint32_t mRetiredCycles = 0;
+	uint64_t mNativeInstructions = 0;
+};
+
+#endif
@@ -0,0 +1,423 @@
+#include "Recompiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "Disassembler.hpp"
+
+static const uint32_t addressCount = 0x10000;
+
+static std::string hex(uint32_t value, int digits)
+{
+	std::string text = "0x";
+	for (int shift = (digits - 1) * 4; shift >= 0; shift -= 4)
+	{
+		text += "0123456789ABCDEF"[(value >> shift) & 0xF];
+	}
+	return text;
+}
+
+static bool isMnemonic(const InstructionInfo& info, const char* mnemonic)
+{
+	return strncmp(info.mnemonic, mnemonic, 3) == 0;
+}
+
+static bool isBranch(const InstructionInfo& info)
+{
+	return info.mode == REL;
+}
+
+// instructions that end a block after themselves, their successors are known statically
+static bool endsBlock(uint8_t opcode)
+{
+	return opcode == JMPAbs || opcode == JSRAbs || opcode == RTS || isBranch(instructionTable[opcode]);
+}
+
+// instructions that are never translated and end a block before themselves
+static bool leftToInterpreter(uint8_t opcode)
+{
+	return opcode == JMPInd || opcode == RTI || opcode == BRK || opcode == HALT || opcode == HYPERCALL;
+}
+
+// instructions writing to their operand address
+static bool isStore(const InstructionInfo& info)
+{
+	if (info.mode == A || info.mode == IMD || info.mode == NON || info.mode == REL)
+	{
+		return false;
+	}
+	static const char* const stores[] = { "STA", "STX", "STY", "INC", "DEC", "ASL", "LSR", "ROL", "ROR" };
+	for (const char* store : stores)
+	{
+		if (isMnemonic(info, store)) { return true; }
+	}
+	return false;
+}
+
+Recompiler::Recompiler()
+	: mMemory(addressCount), mFlags(addressCount)
+{
+}
+
+void Recompiler::load(const uint8_t* program, std::size_t size, uint16_t offset)
+{
+	for (std::size_t i = 0; i < size && offset + i < addressCount; i++)
+	{
+		mMemory[offset + i] = program[i];
+		mFlags[offset + i] |= LOADED;
+	}
+}
+
+void Recompiler::addEntry(uint16_t address)
+{
+	mEntries.push_back(address);
+}
+
+bool Recompiler::addResetVector()
+{
+	// same vector as MOS6502::reset()
+	static const uint16_t resetVector = 0xFFFE;
+	if (!(mFlags[resetVector] & LOADED) || !(mFlags[resetVector + 1] & LOADED))
+	{
+		return false;
+	}
+	addEntry(mMemory[resetVector] | (mMemory[resetVector + 1] << 8));
+	return true;
+}
+
+std::size_t Recompiler::instructionCount() const
+{
+	std::size_t count = 0;
+	for (const BlockInfo& block : mBlocks)
+	{
+		count += block.instructions;
+	}
+	return count;
+}
+
+std::size_t Recompiler::interpretedCount() const
+{
+	return std::count_if(mFlags.begin(), mFlags.end(), [](uint8_t flags) { return (flags & INSTRUCTION) && (flags & INTERPRET); });
+}
+
+bool Recompiler::decodable(uint16_t addr) const
+{
+	const InstructionInfo& info = instructionTable[mMemory[addr]];
+	if (!info.mnemonic || addr + info.length > addressCount)
+	{
+		return false;
+	}
+	for (uint32_t i = 0; i < info.length; i++)
+	{
+		if (!(mFlags[addr + i] & LOADED)) { return false; }
+	}
+	return true;
+}
+
+void Recompiler::analyse()
+{
+	for (uint16_t entry : mEntries)
+	{
+		descend(entry);
+	}
+	markPatchedInstructions();
+	formBlocks();
+}
+
+void Recompiler::descend(uint16_t entry)
+{
+	std::vector<uint16_t> pending = { entry };
+	mFlags[entry] |= LEADER;
+	while (!pending.empty())
+	{
+		uint32_t addr = pending.back();
+		pending.pop_back();
+
+		// follow the straight line until it leaves known code or reaches code decoded before
+		while (addr < addressCount && !(mFlags[addr] & INSTRUCTION) && decodable(addr))
+		{
+			uint8_t opcode = mMemory[addr];
+			const InstructionInfo& info = instructionTable[opcode];
+			uint32_t next = addr + info.length;
+			uint16_t operand = info.length == 3 ? mMemory[addr + 1] | (mMemory[addr + 2] << 8) : info.length == 2 ? mMemory[addr + 1] : 0;
+			mFlags[addr] |= INSTRUCTION;
+
+			if (isStore(info) && (info.mode == ZPG || info.mode == ABS))
+			{
+				mFlags[operand] |= PATCHED;
+			}
+
+			if (isBranch(info))
+			{
+				uint16_t target = static_cast<uint16_t>(next + static_cast<int8_t>(operand));
+				mFlags[target] |= LEADER;
+				pending.push_back(target);
+				if (next < addressCount) { mFlags[next] |= LEADER; }
+			}
+			else if (opcode == JSRAbs)
+			{
+				mFlags[operand] |= LEADER;
+				pending.push_back(operand);
+				if (next < addressCount) { mFlags[next] |= LEADER; }
+			}
+			else if (opcode == JMPAbs)
+			{
+				mFlags[operand] |= LEADER;
+				pending.push_back(operand);
+				break;
+			}
+			else if (opcode == RTS || leftToInterpreter(opcode))
+			{
+				break;
+			}
+			addr = next;
+		}
+	}
+}
+
+void Recompiler::markPatchedInstructions()
+{
+	// an instruction any of whose bytes is the constant target of a store runs interpreted, and the
+	// instruction after it starts a new block
+	for (uint32_t addr = 0; addr < addressCount; addr++)
+	{
+		if (!(mFlags[addr] & INSTRUCTION))
+		{
+			continue;
+		}
+		uint32_t next = addr + instructionTable[mMemory[addr]].length;
+		for (uint32_t i = addr; i < next; i++)
+		{
+			if (mFlags[i] & PATCHED)
+			{
+				mFlags[addr] |= INTERPRET;
+				if (next < addressCount) { mFlags[next] |= LEADER; }
+				break;
+			}
+		}
+	}
+}
+
+void Recompiler::formBlocks()
+{
+	mBlocks.clear();
+	for (uint32_t start = 0; start < addressCount; start++)
+	{
+		if ((mFlags[start] & (LEADER | INSTRUCTION)) != (LEADER | INSTRUCTION))
+		{
+			continue;
+		}
+		BlockInfo block = { static_cast<uint16_t>(start), 0, 0, 0 };
+		uint32_t addr = start;
+		while (addr < addressCount && (mFlags[addr] & INSTRUCTION) && !(mFlags[addr] & INTERPRET)
+			&& !leftToInterpreter(mMemory[addr]) && (addr == start || !(mFlags[addr] & LEADER)))
+		{
+			uint8_t opcode = mMemory[addr];
+			addr += instructionTable[opcode].length;
+			block.instructions++;
+			block.cycles += instructionTable[opcode].cycles;
+			if (endsBlock(opcode))
+			{
+				break;
+			}
+		}
+		if (block.instructions == 0)
+		{
+			continue;
+		}
+		block.length = static_cast<uint16_t>(addr - start);
+		mBlocks.push_back(block);
+	}
+}
+
+void Recompiler::writeBlock(std::ostream& out, const BlockInfo& block) const
+{
+	out << "static uint16_t block_" << hex(block.address, 4).substr(2) << "(RecompiledCpu& cpu)\n{\n";
+
+	uint32_t addr = block.address;
+	uint8_t lastOpcode = NOP;
+	uint32_t cycles = 0;
+	for (uint16_t done = 1; done <= block.instructions; done++)
+	{
+		uint8_t opcode = mMemory[addr];
+		const InstructionInfo& info = instructionTable[opcode];
+		uint32_t next = addr + info.length;
+		lastOpcode = opcode;
+		uint8_t low = info.length > 1 ? mMemory[addr + 1] : 0;
+		uint16_t word = info.length > 2 ? low | (mMemory[addr + 2] << 8) : low;
+		cycles += info.cycles;
+		// instructions and base cycles retired by an exit after this instruction
+		std::string retired = std::to_string(done) + ", " + std::to_string(cycles);
+		std::string leave = "return cpu.leave(" + hex(next & 0xFFFF, 4) + ", " + retired + ");";
+
+		char text[Disassembler::maxInstructionText];
+		std::size_t textLength = Disassembler::formatInstruction(&mMemory[addr], info.length, addr, text);
+		out << "\t// " << hex(addr, 4).substr(2) << "  " << std::string(text, textLength) << "\n";
+
+		// effective address, correct zero page wrap included
+		std::string ea;
+		bool constantAddress = info.mode == ZPG || info.mode == ABS;
+		switch (info.mode)
+		{
+		case ZPG: ea = hex(low, 2); break;
+		case ZPX: ea = "uint8_t(" + hex(low, 2) + " + cpu.x())"; break;
+		case ZPY: ea = "uint8_t(" + hex(low, 2) + " + cpu.y())"; break;
+		case ABS: ea = hex(word, 4); break;
+		case ABX: ea = "uint16_t(" + hex(word, 4) + " + cpu.x())"; break;
+		case ABY: ea = "uint16_t(" + hex(word, 4) + " + cpu.y())"; break;
+		case INDX: ea = "cpu.pointer(uint8_t(" + hex(low, 2) + " + cpu.x()))"; break;
+		case INDY: ea = "uint16_t(cpu.pointer(" + hex(low, 2) + ") + cpu.y())"; break;
+		default: break;
+		}
+		std::string value = info.mode == IMD ? hex(low, 2) : "cpu.load(" + ea + ")";
+		std::string reg = isMnemonic(info, "LDX") || isMnemonic(info, "STX") || isMnemonic(info, "CPX") ? "cpu.x()"
+			: isMnemonic(info, "LDY") || isMnemonic(info, "STY") || isMnemonic(info, "CPY") ? "cpu.y()" : "cpu.a()";
+
+		std::string code;
+		if (isMnemonic(info, "LDA") || isMnemonic(info, "LDX") || isMnemonic(info, "LDY"))
+		{
+			code = reg + " = " + value + "; cpu.nz(" + reg + ");";
+		}
+		else if (isMnemonic(info, "STA") || isMnemonic(info, "STX") || isMnemonic(info, "STY"))
+		{
+			code = "cpu.store(" + ea + ", " + reg + ");";
+		}
+		else if (isMnemonic(info, "INC") || isMnemonic(info, "DEC"))
+		{
+			code = std::string("{ uint16_t addr = ") + ea + "; uint8_t value = uint8_t(cpu.load(addr) " + (info.mnemonic[0] == 'I' ? "+" : "-")
+				+ " 1); cpu.store(addr, value); cpu.nz(value); }";
+		}
+		else if (isMnemonic(info, "ASL") || isMnemonic(info, "LSR") || isMnemonic(info, "ROL") || isMnemonic(info, "ROR"))
+		{
+			std::string operation = "cpu." + std::string(info.mnemonic, 3);
+			std::transform(operation.begin(), operation.end(), operation.begin(), ::tolower);
+			code = info.mode == A ? "cpu.a() = " + operation + "(cpu.a());"
+				: "{ uint16_t addr = " + ea + "; cpu.store(addr, " + operation + "(cpu.load(addr))); }";
+		}
+		else if (isMnemonic(info, "ORA")) { code = "cpu.a() |= " + value + "; cpu.nz(cpu.a());"; }
+		else if (isMnemonic(info, "EOR")) { code = "cpu.a() ^= " + value + "; cpu.nz(cpu.a());"; }
+		else if (isMnemonic(info, "AND")) { code = "cpu.a() &= " + value + "; cpu.nz(cpu.a());"; }
+		else if (isMnemonic(info, "ADC")) { code = "cpu.adc(" + value + ");"; }
+		else if (isMnemonic(info, "SBC")) { code = "cpu.sbc(" + value + ");"; }
+		else if (isMnemonic(info, "CMP") || isMnemonic(info, "CPX") || isMnemonic(info, "CPY")) { code = "cpu.cmp(" + reg + ", " + value + ");"; }
+		else if (isMnemonic(info, "BIT")) { code = "cpu.bit(" + value + ");"; }
+		else
+		{
+			switch (opcode)
+			{
+			case INX: code = "cpu.x()++; cpu.nz(cpu.x());"; break;
+			case INY: code = "cpu.y()++; cpu.nz(cpu.y());"; break;
+			case DEX: code = "cpu.x()--; cpu.nz(cpu.x());"; break;
+			case DEY: code = "cpu.y()--; cpu.nz(cpu.y());"; break;
+			case CLC: code = "cpu.c() = 0;"; break;
+			case CLD: code = "cpu.d() = 0;"; break;
+			case CLI: code = "cpu.i() = 0;"; break;
+			case CLV: code = "cpu.v() = 0;"; break;
+			case SEC: code = "cpu.c() = 1;"; break;
+			case SED: code = "cpu.d() = 1;"; break;
+			case SEI: code = "cpu.i() = 1;"; break;
+			case TAX: code = "cpu.x() = cpu.a(); cpu.nz(cpu.x());"; break;
+			case TAY: code = "cpu.y() = cpu.a(); cpu.nz(cpu.y());"; break;
+			case TSX: code = "cpu.x() = cpu.s(); cpu.nz(cpu.x());"; break;
+			case TXA: code = "cpu.a() = cpu.x(); cpu.nz(cpu.a());"; break;
+			case TYA: code = "cpu.a() = cpu.y(); cpu.nz(cpu.a());"; break;
+			case TXS: code = "cpu.s() = cpu.x();"; break;
+			case PHA: code = "cpu.pha();"; break;
+			case PLA: code = "cpu.pla();"; break;
+			case PHP: code = "cpu.php();"; break;
+			case PLP: code = "cpu.plp();"; break;
+			case JMPAbs: code = "return cpu.leave(" + hex(word, 4) + ", " + retired + ");"; break;
+			case JSRAbs:
+				code = "cpu.push(" + hex(((next - 1) >> 8) & 0xFF, 2) + "); cpu.push(" + hex((next - 1) & 0xFF, 2) + "); return cpu.leave("
+					+ hex(word, 4) + ", " + retired + ");";
+				break;
+			case RTS: code = "cpu.rts(); return cpu.leave(cpu.pc(), " + retired + ");"; break;
+			default: break;
+			}
+		}
+
+		if (isBranch(info))
+		{
+			static const struct { OpCode opcode; const char* condition; } conditions[] = {
+				{ BCC, "cpu.c() == 0" }, { BCS, "cpu.c() != 0" }, { BNE, "cpu.z() == 0" }, { BEQ, "cpu.z() != 0" },
+				{ BPL, "cpu.n() == 0" }, { BMI, "cpu.n() != 0" }, { BVC, "cpu.v() == 0" }, { BVS, "cpu.v() != 0" }
+			};
+			for (const auto& branch : conditions)
+			{
+				if (branch.opcode == opcode)
+				{
+					uint16_t target = static_cast<uint16_t>(next + static_cast<int8_t>(low));
+					code = std::string("if (") + branch.condition + ") { return cpu.leave(" + hex(target, 4) + ", "
+						+ retired + "); }\n\t" + leave;
+				}
+			}
+		}
+
+		if (!code.empty())
+		{
+			out << "\t" << code << "\n";
+		}
+		// constant targets inside code are interpreted (markPatchedInstructions()), only computed ones can hit a block
+		if (isStore(info) && done < block.instructions && !constantAddress)
+		{
+			out << "\tif (cpu.codeWritten()) { " << leave << " }\n";
+		}
+		addr = next;
+	}
+
+	if (!endsBlock(lastOpcode))
+	{
+		out << "\treturn cpu.leave(" << hex(addr & 0xFFFF, 4) << ", " << block.instructions << ", " << block.cycles << ");\n";
+	}
+	out << "}\n\n";
+}
+
+void Recompiler::writeCpp(std::ostream& out, const std::string& symbol) const
+{
+	out << "// Generated by 6502_Recompiler from " << mEntries.size() << " entry point(s): " << mBlocks.size() << " blocks, "
+		<< instructionCount() << " instructions. Do not edit.\n\n";
+	out << "#include \"Recompiled.hpp\"\n\n";
+
+	for (const BlockInfo& block : mBlocks)
+	{
+		writeBlock(out, block);
+	}
+
+	for (const BlockInfo& block : mBlocks)
+	{
+		out << "static const uint8_t bytes_" << hex(block.address, 4).substr(2) << "[] = {";
+		for (uint32_t i = 0; i < block.length; i++)
+		{
+			out << (i ? ", " : " ") << hex(mMemory[block.address + i], 2);
+		}
+		out << " };\n";
+	}
+
+	out << "\nstatic const RecompiledCpu::Block blocks[] = {\n";
+	for (const BlockInfo& block : mBlocks)
+	{
+		std::string name = hex(block.address, 4).substr(2);
+		out << "\t{ " << hex(block.address, 4) << ", " << block.length << ", " << block.instructions << ", " << block.cycles << ", bytes_" << name
+			<< ", block_" << name << " },\n";
+	}
+	if (mBlocks.empty())
+	{
+		out << "\t{ 0, 0, 0, 0, nullptr, nullptr },\n";
+	}
+	out << "};\n\n";
+	out << "extern const RecompiledCpu::Translation " << symbol << ";\n";
+	out << "const RecompiledCpu::Translation " << symbol << " = { blocks, " << mBlocks.size() << " };\n";
+}
+
+bool Recompiler::writeCpp(const std::string& path, const std::string& symbol) const
+{
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "Could not open output file \"" << path << "\" !" << std::endl;
+		return false;
+	}
+	writeCpp(file, symbol);
+	return file.good();
+}
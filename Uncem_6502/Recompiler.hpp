@@ -0,0 +1,67 @@
+#ifndef RECOMPILER_HPP
+#define RECOMPILER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Ahead-of-time translator from a 6502 program image to a C++ translation unit for RecompiledCpu.
+//
+// Control flow is recovered by recursive descent from the entry points (the reset vector, JSR targets and
+// any address added by hand) over JMP, JSR and branches. Every recovered basic block becomes one function;
+// what descent cannot follow (JMP (ind), BRK, RTI, HALT, HYP, unknown opcodes) ends a block and is left to the
+// interpreter at runtime. Instructions that the program itself stores to through a constant address are
+// left to the interpreter as well, since their bytes are expected to change.
+class Recompiler
+{
+public:
+	Recompiler();
+
+	void load(const uint8_t* program, std::size_t size, uint16_t offset);
+	void addEntry(uint16_t address);
+	// entry at the address MOS6502::reset() reads, false if the vector is not part of the loaded bytes
+	bool addResetVector();
+
+	void analyse();
+
+	// symbol is the name of the RecompiledCpu::Translation the generated code defines
+	void writeCpp(std::ostream& out, const std::string& symbol) const;
+	bool writeCpp(const std::string& path, const std::string& symbol) const;
+
+	std::size_t blockCount() const { return mBlocks.size(); }
+	std::size_t instructionCount() const;
+	std::size_t interpretedCount() const;
+
+private:
+	enum addressFlags
+	{
+		LOADED = 1,
+		INSTRUCTION = 2,         // an instruction starts here
+		LEADER = 4,              // a block has to start here
+		INTERPRET = 8,           // instruction patched by the program, never translated
+		PATCHED = 16             // constant target of a store
+	};
+
+	struct BlockInfo
+	{
+		uint16_t address;
+		uint16_t length;
+		uint16_t instructions;
+		uint32_t cycles;
+	};
+
+	bool decodable(uint16_t addr) const;
+	void descend(uint16_t entry);
+	void markPatchedInstructions();
+	void formBlocks();
+	void writeBlock(std::ostream& out, const BlockInfo& block) const;
+
+	std::vector<uint8_t> mMemory;
+	std::vector<uint8_t> mFlags;
+	std::vector<uint16_t> mEntries;
+	std::vector<BlockInfo> mBlocks;
+};
+
+#endif
@@ -0,0 +1,101 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "Recompiler.hpp"
+
+// 6502_Recompiler <image.bin> <load address> <output.cpp> [--symbol name] [--entry address]...
+//
+// Translates a raw program image into a C++ file defining a RecompiledCpu::Translation. Descent starts at
+// the reset vector if the image covers it, at every --entry, and at the load address if there is neither.
+static void usage()
+{
+	std::cerr << "usage: 6502_Recompiler <image.bin> <load address> <output.cpp> [--symbol name] [--entry address]..." << std::endl;
+}
+
+static bool parseAddress(const std::string& text, uint16_t& address)
+{
+	// hex, with or without 0x or $
+	std::string digits = text.rfind("0x", 0) == 0 ? text.substr(2) : text.rfind("$", 0) == 0 ? text.substr(1) : text;
+	char* end = nullptr;
+	unsigned long value = std::strtoul(digits.c_str(), &end, 16);
+	if (digits.empty() || *end != '\0' || value > 0xFFFF)
+	{
+		std::cerr << "Invalid address \"" << text << "\" !" << std::endl;
+		return false;
+	}
+	address = static_cast<uint16_t>(value);
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		usage();
+		return 1;
+	}
+
+	uint16_t offset;
+	if (!parseAddress(argv[2], offset))
+	{
+		return 1;
+	}
+
+	std::ifstream file(argv[1], std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cerr << "Could not open image \"" << argv[1] << "\" !" << std::endl;
+		return 1;
+	}
+	std::vector<uint8_t> image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	Recompiler recompiler;
+	recompiler.load(image.data(), image.size(), offset);
+
+	std::string symbol = "recompiledProgram";
+	bool hasEntry = recompiler.addResetVector();
+	for (int i = 4; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (i + 1 >= argc)
+		{
+			usage();
+			return 1;
+		}
+		if (option == "--symbol")
+		{
+			symbol = argv[++i];
+		}
+		else if (option == "--entry")
+		{
+			uint16_t entry;
+			if (!parseAddress(argv[++i], entry))
+			{
+				return 1;
+			}
+			recompiler.addEntry(entry);
+			hasEntry = true;
+		}
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+	if (!hasEntry)
+	{
+		recompiler.addEntry(offset);
+	}
+
+	recompiler.analyse();
+	if (!recompiler.writeCpp(argv[3], symbol))
+	{
+		return 1;
+	}
+	std::cout << recompiler.blockCount() << " blocks, " << recompiler.instructionCount() << " instructions translated, "
+		<< recompiler.interpretedCount() << " left to the interpreter" << std::endl;
+	return 0;
+}
@@ -0,0 +1,157 @@
+#include "SamplingProfiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+SamplingProfiler::SamplingProfiler(uint64_t interval, bool callStacks)
+	: mInterval(interval ? interval : 1),
+	  mCallStacks(callStacks),
+	  mPcSamples(new std::atomic<uint64_t>[65536]()),
+	  mSlots(new Slot[stackSlots])
+{
+}
+
+uint64_t SamplingProfiler::nextGap()
+{
+	// xorshift64, deterministic so that two profiles of the same run sample the same instructions
+	mRandom ^= mRandom << 13;
+	mRandom ^= mRandom >> 7;
+	mRandom ^= mRandom << 17;
+	uint64_t half = mInterval / 2;
+	return mInterval - half + mRandom % (2 * half + 1);
+}
+
+StopReason SamplingProfiler::run(MOS6502& cpu, uint64_t maxInstructions, const Runner& run)
+{
+	return runWindows(cpu, maxInstructions, run, [this]() { return nextGap(); }, []() { return true; });
+}
+
+StopReason SamplingProfiler::runTimed(MOS6502& cpu, std::chrono::microseconds period, uint64_t maxInstructions, const Runner& run)
+{
+	auto next = std::chrono::steady_clock::now() + period;
+	auto due = [&]()
+	{
+		auto now = std::chrono::steady_clock::now();
+		if (now < next) { return false; }
+		// a guest that fell behind by several periods gets one sample, not a burst of them
+		next = std::max(next + period, now);
+		return true;
+	};
+	return runWindows(cpu, maxInstructions, run, []() { return clockInterval; }, due);
+}
+
+StopReason SamplingProfiler::runWindows(MOS6502& cpu, uint64_t maxInstructions, const Runner& run, const std::function<uint64_t()>& window,
+	const std::function<bool()>& due)
+{
+	if (mCallStacks) { cpu.attachCallStack(&mCallStack); }
+	StopReason reason = STOP_BUDGET;
+	uint64_t done = 0;
+	while (done < maxInstructions)
+	{
+		uint64_t count = std::min(window(), maxInstructions - done);
+		reason = run ? run(count) : cpu.execute(count);
+		if (reason != STOP_BUDGET) { break; }
+		done += count;
+		if (due()) { sample(cpu); }
+	}
+	if (mCallStacks) { cpu.attachCallStack(nullptr); }
+	return reason;
+}
+
+void SamplingProfiler::sample(const MOS6502& cpu)
+{
+	mPcSamples[cpu.programCounter()].fetch_add(1, std::memory_order_relaxed);
+	mSamples.fetch_add(1, std::memory_order_relaxed);
+	if (!mCallStacks) { return; }
+
+	uint16_t entries[CallStack::maxDepth];
+	std::size_t depth = mCallStack.depth();
+	for (std::size_t i = 0; i < depth; i++)
+	{
+		entries[i] = mCallStack.frames()[i].entry;
+	}
+	uint64_t key = ProgramImage::hashBytes(reinterpret_cast<const uint8_t*>(entries), depth * sizeof(entries[0]), 0xCBF29CE484222325ULL ^ depth);
+	key = key ? key : 1;
+
+	// open addressing; this is the only writer, so a free slot can be filled and then published
+	for (std::size_t probe = 0; probe < stackSlots; probe++)
+	{
+		Slot& slot = mSlots[(key + probe) & (stackSlots - 1)];
+		uint64_t slotKey = slot.key.load(std::memory_order_relaxed);
+		if (slotKey == 0)
+		{
+			std::copy(entries, entries + depth, slot.entries);
+			slot.depth = static_cast<uint16_t>(depth);
+			slot.samples.store(1, std::memory_order_relaxed);
+			slot.key.store(key, std::memory_order_release);
+			return;
+		}
+		// equal keys are almost always the same stack, but two stacks whose hashes collide must not be merged
+		if (slotKey == key && slot.depth == depth && std::equal(entries, entries + depth, slot.entries))
+		{
+			slot.samples.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+	}
+	mDroppedStacks.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<SamplingProfiler::Stack> SamplingProfiler::stacks() const
+{
+	std::vector<Stack> stacks;
+	for (std::size_t i = 0; i < stackSlots; i++)
+	{
+		const Slot& slot = mSlots[i];
+		if (slot.key.load(std::memory_order_acquire) == 0) { continue; }
+		stacks.push_back({ std::vector<uint16_t>(slot.entries, slot.entries + slot.depth), slot.samples.load(std::memory_order_relaxed) });
+	}
+	std::sort(stacks.begin(), stacks.end(), [](const Stack& a, const Stack& b) { return a.entries < b.entries; });
+	return stacks;
+}
+
+bool SamplingProfiler::writeFolded(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "Could not open profile file \"" << path << "\" !" << std::endl;
+		return false;
+	}
+	for (const Stack& stack : stacks())
+	{
+		file << "guest";
+		for (uint16_t entry : stack.entries)
+		{
+			char name[6];
+			std::snprintf(name, sizeof(name), ";%04X", entry);
+			file << name;
+		}
+		file << " " << stack.samples << "\n";
+	}
+	return file.good();
+}
+
+void SamplingProfiler::printTop(std::ostream& out, std::size_t count) const
+{
+	std::vector<std::pair<uint64_t, uint16_t>> hottest;
+	for (uint32_t pc = 0; pc < 65536; pc++)
+	{
+		uint64_t samples = samplesAt(static_cast<uint16_t>(pc));
+		if (samples != 0) { hottest.push_back({ samples, static_cast<uint16_t>(pc) }); }
+	}
+	count = std::min(count, hottest.size());
+	std::partial_sort(hottest.begin(), hottest.begin() + count, hottest.end(), std::greater<>());
+
+	uint64_t total = std::max<uint64_t>(samples(), 1);
+	out << std::dec << samples() << " samples" << std::endl;
+	for (std::size_t i = 0; i < count; i++)
+	{
+		out << "  " << std::hex << std::uppercase << std::setw(4) << std::setfill('0') << hottest[i].second << std::setfill(' ')
+			<< std::nouppercase << std::dec << std::setw(12) << hottest[i].first << std::fixed << std::setprecision(2)
+			<< std::setw(8) << 100.0 * hottest[i].first / total << "%" << std::endl;
+	}
+	out << std::defaultfloat;
+}
@@ -0,0 +1,84 @@
+#ifndef SAMPLINGPROFILER_HPP
+#define SAMPLINGPROFILER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "CallStack.hpp"
+#include "MOS6502.hpp"
+
+// Statistical profile of a long-running guest: every so often the guest PC, and the shadow call stack kept by
+// JSR and RTS, is counted into histograms. Sampling happens between runs of the guest, so a sample costs one
+// return from the runner and the guest runs at full speed in between; only keeping the call stack costs
+// anything per instruction, and it switches RecompiledCpu back to the interpreter. Profile with
+// callStacks = false to keep native code.
+//
+// The histograms are lock-free: samples(), samplesAt(), stacks() and the report functions can be called from
+// any thread while the guest runs. A profiler samples one CPU at a time.
+class SamplingProfiler
+{
+public:
+	struct Stack
+	{
+		std::vector<uint16_t> entries;    // called addresses, outermost first; empty outside any subroutine
+		uint64_t samples;
+	};
+
+	// runs up to the given number of instructions and returns why it stopped; the default runs execute()
+	using Runner = std::function<StopReason(uint64_t instructions)>;
+
+	static constexpr std::size_t stackSlots = 4096;     // distinct call stacks kept, see droppedStacks()
+	static constexpr uint64_t clockInterval = 1024;     // instructions between clock reads in runTimed()
+
+	// interval is the mean number of instructions between samples; each gap is drawn from [interval / 2,
+	// interval * 3 / 2] so that sampling does not lock onto a loop of the same length
+	explicit SamplingProfiler(uint64_t interval = 10000, bool callStacks = true);
+
+	// sample by instruction count until the guest stops or maxInstructions ran
+	StopReason run(MOS6502& cpu, uint64_t maxInstructions = UINT64_MAX, const Runner& run = nullptr);
+
+	// sample every period of host time instead, for guests that wait on the host
+	StopReason runTimed(MOS6502& cpu, std::chrono::microseconds period, uint64_t maxInstructions = UINT64_MAX, const Runner& run = nullptr);
+
+	uint64_t samples() const { return mSamples.load(std::memory_order_relaxed); }
+	uint64_t samplesAt(uint16_t pc) const { return mPcSamples[pc].load(std::memory_order_relaxed); }
+	// samples whose call stack did not fit into the stack table any more; they are still counted by PC
+	uint64_t droppedStacks() const { return mDroppedStacks.load(std::memory_order_relaxed); }
+	std::vector<Stack> stacks() const;
+
+	// call stacks in the folded format of flamegraph.pl: "guest;1051;1044 42", addresses in hex
+	bool writeFolded(const std::string& path) const;
+	// the count hottest PCs with their share of the samples
+	void printTop(std::ostream& out, std::size_t count = 20) const;
+
+private:
+	struct Slot
+	{
+		std::atomic<uint64_t> key{ 0 };     // hash of the entries, 0 while free; published after them
+		std::atomic<uint64_t> samples{ 0 };
+		uint16_t depth = 0;
+		uint16_t entries[CallStack::maxDepth];
+	};
+
+	uint64_t nextGap();
+	void sample(const MOS6502& cpu);
+	StopReason runWindows(MOS6502& cpu, uint64_t maxInstructions, const Runner& run, const std::function<uint64_t()>& window,
+		const std::function<bool()>& due);
+
+	uint64_t mInterval;
+	bool mCallStacks;
+	uint64_t mRandom = 0x9E3779B97F4A7C15ULL;
+	CallStack mCallStack;
+	std::unique_ptr<std::atomic<uint64_t>[]> mPcSamples;
+	std::unique_ptr<Slot[]> mSlots;
+	std::atomic<uint64_t> mSamples{ 0 };
+	std::atomic<uint64_t> mDroppedStacks{ 0 };
+};
+
+#endif
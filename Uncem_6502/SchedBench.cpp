@@ -0,0 +1,137 @@
+// Load test for GuestScheduler: batch guests that never stop share the host threads with interactive
+// guests that do a little work and HALT until an event thread wakes them again. Prints what the scheduler
+// itself costs, how long woken guests wait for a thread (the tail is what interactive guests feel) and
+// whether batch guests got cycles in proportion to their weights (every other one has twice the
+// default weight).
+//
+//   6502_SchedBench [--threads n] [--batch n] [--interactive n] [--wakes per second] [--quantum cycles]
+//                   [--seconds s]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "GuestScheduler.hpp"
+#include "ImageStore.hpp"
+#include "MOS6502.hpp"
+
+namespace
+{
+	// INC $10, JMP $0300
+	const uint8_t batchProgram[] = { 0xE6, 0x10, 0x4C, 0x00, 0x03 };
+	// LDX #40, loop: INC $10, DEX, BNE loop, HALT, JMP $0200
+	const uint8_t interactiveProgram[] = { 0xA2, 0x28, 0xE6, 0x10, 0xCA, 0xD0, 0xFB, 0xFF, 0x4C, 0x00, 0x02 };
+
+	struct Options
+	{
+		std::size_t threads = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+		std::size_t batch = 64;
+		std::size_t interactive = 256;
+		uint64_t wakesPerSecond = 20000;
+		uint64_t quantum = 10000;
+		double seconds = 2;
+	};
+
+	bool parse(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (i + 1 >= argc) { return false; }
+			if (arg == "--threads") { options.threads = std::strtoul(argv[++i], nullptr, 10); }
+			else if (arg == "--batch") { options.batch = std::strtoul(argv[++i], nullptr, 10); }
+			else if (arg == "--interactive") { options.interactive = std::strtoul(argv[++i], nullptr, 10); }
+			else if (arg == "--wakes") { options.wakesPerSecond = std::strtoull(argv[++i], nullptr, 10); }
+			else if (arg == "--quantum") { options.quantum = std::strtoull(argv[++i], nullptr, 10); }
+			else if (arg == "--seconds") { options.seconds = std::strtod(argv[++i], nullptr); }
+			else { return false; }
+		}
+		return options.threads != 0 && options.seconds > 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!parse(argc, argv, options))
+	{
+		std::cerr << "Usage: " << argv[0] << " [--threads n] [--batch n] [--interactive n] [--wakes per second] [--quantum cycles]\n"
+			<< "       [--seconds s]" << std::endl;
+		return 2;
+	}
+
+	auto batchImage = std::make_shared<const ProgramImage>(batchProgram, sizeof(batchProgram), 0x0300);
+	auto interactiveImage = std::make_shared<const ProgramImage>(interactiveProgram, sizeof(interactiveProgram), 0x0200);
+	std::vector<std::unique_ptr<MOS6502Debug>> cpus;
+	GuestScheduler scheduler(options.threads, options.quantum);
+	std::vector<GuestScheduler::GuestId> batch;
+	std::vector<GuestScheduler::GuestId> interactive;
+	for (std::size_t i = 0; i < options.batch + options.interactive; i++)
+	{
+		bool isBatch = i < options.batch;
+		auto cpu = std::make_unique<MOS6502Debug>();
+		cpu->ISDEBUG = false;
+		cpu->mapImage(isBatch ? batchImage : interactiveImage);
+		cpu->setProgramCounter(isBatch ? 0x0300 : 0x0200);
+		unsigned weight = isBatch && i % 2 ? 2 * GuestScheduler::defaultWeight : GuestScheduler::defaultWeight;
+		(isBatch ? batch : interactive).push_back(scheduler.add(*cpu, weight));
+		cpus.push_back(std::move(cpu));
+	}
+
+	// the event source: wakes random interactive guests at the given rate, in bursts every millisecond
+	using Clock = std::chrono::steady_clock;
+	scheduler.start();
+	Clock::time_point started = Clock::now();
+	Clock::time_point end = started + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.seconds));
+	std::mt19937_64 random(1);
+	uint64_t sent = 0;
+	for (Clock::time_point tick = started; tick < end; tick += std::chrono::milliseconds(1))
+	{
+		std::this_thread::sleep_until(tick);
+		double elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+		for (; !interactive.empty() && sent < elapsed * options.wakesPerSecond; sent++)
+		{
+			scheduler.wake(interactive[random() % interactive.size()]);
+		}
+	}
+	scheduler.stop();
+	double seconds = std::chrono::duration<double>(Clock::now() - started).count();
+
+	GuestScheduler::Stats stats = scheduler.stats();
+	uint64_t cycles[2] = {};
+	for (std::size_t i = 0; i < batch.size(); i++)
+	{
+		cycles[i % 2] += scheduler.cycles(batch[i]);
+	}
+	uint64_t guestCycles = 0;
+	for (GuestScheduler::GuestId id : batch) { guestCycles += scheduler.cycles(id); }
+	for (GuestScheduler::GuestId id : interactive) { guestCycles += scheduler.cycles(id); }
+
+	char line[200];
+	std::printf("%zu threads, %zu batch and %zu interactive guests, quantum %llu cycles, %.2f s\n", scheduler.threads(),
+		options.batch, options.interactive, static_cast<unsigned long long>(options.quantum), seconds);
+	std::snprintf(line, sizeof(line), "quanta %llu (%.0f/s), steals %llu, parks %llu, wakes %llu, guest MHz %.1f\n",
+		static_cast<unsigned long long>(stats.quanta), stats.quanta / seconds, static_cast<unsigned long long>(stats.steals),
+		static_cast<unsigned long long>(stats.parks), static_cast<unsigned long long>(stats.wakes), guestCycles / seconds / 1e6);
+	std::cout << line;
+	double busy = static_cast<double>(stats.guestNs + stats.schedulerNs);
+	std::snprintf(line, sizeof(line), "scheduler overhead %.2f%% of busy time, %.0f ns per quantum\n",
+		busy ? 100.0 * stats.schedulerNs / busy : 0.0, stats.quanta ? static_cast<double>(stats.schedulerNs) / stats.quanta : 0.0);
+	std::cout << line;
+	std::snprintf(line, sizeof(line), "wait for a thread (upper bounds): p50 %llu ns, p99 %llu ns, p99.9 %llu ns, max %llu ns\n",
+		static_cast<unsigned long long>(stats.latencyPercentile(0.5)), static_cast<unsigned long long>(stats.latencyPercentile(0.99)),
+		static_cast<unsigned long long>(stats.latencyPercentile(0.999)), static_cast<unsigned long long>(stats.latencyPercentile(1.0)));
+	std::cout << line;
+	if (cycles[0] && cycles[1])
+	{
+		std::snprintf(line, sizeof(line), "batch cycles, weight %u over weight %u: %.2f (fair share 2.00)\n",
+			2 * GuestScheduler::defaultWeight, GuestScheduler::defaultWeight, static_cast<double>(cycles[1]) / cycles[0]);
+		std::cout << line;
+	}
+	return 0;
+}
@@ -0,0 +1,60 @@
+#ifndef SPSCQUEUE_HPP
+#define SPSCQUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded single-producer single-consumer ring without locks: exactly one thread may push and exactly one
+// other thread may pop. Head and tail sit on their own cache lines, and each side keeps a private copy of
+// the other side's index so that it only touches the shared line when the ring looks full or empty.
+template <typename T, std::size_t Capacity>
+class SpscQueue
+{
+	static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "the capacity has to be a power of two");
+
+public:
+	// producer: false while the ring is full, value is left untouched then
+	bool push(T&& value)
+	{
+		std::size_t tail = mTail.load(std::memory_order_relaxed);
+		if (tail - mHeadCache == Capacity)
+		{
+			mHeadCache = mHead.load(std::memory_order_acquire);
+			if (tail - mHeadCache == Capacity) { return false; }
+		}
+		mItems[tail & (Capacity - 1)] = std::move(value);
+		mTail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer: false while the ring is empty
+	bool pop(T& value)
+	{
+		std::size_t head = mHead.load(std::memory_order_relaxed);
+		if (head == mTailCache)
+		{
+			mTailCache = mTail.load(std::memory_order_acquire);
+			if (head == mTailCache) { return false; }
+		}
+		value = std::move(mItems[head & (Capacity - 1)]);
+		mHead.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer: whether a pop() would fail right now
+	bool empty() const
+	{
+		return mHead.load(std::memory_order_relaxed) == mTail.load(std::memory_order_acquire);
+	}
+
+private:
+	alignas(64) std::atomic<std::size_t> mHead{ 0 };
+	std::size_t mTailCache = 0;          // consumer's view of mTail
+	alignas(64) std::atomic<std::size_t> mTail{ 0 };
+	std::size_t mHeadCache = 0;          // producer's view of mHead
+	alignas(64) std::array<T, Capacity> mItems;
+};
+
+#endif
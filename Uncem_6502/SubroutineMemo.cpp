@@ -0,0 +1,349 @@
+#include "SubroutineMemo.hpp"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace
+{
+	// a call that has not returned after this many instructions is not a subroutine worth memoizing
+	constexpr uint64_t maxRecordedInstructions = 1 << 20;
+	constexpr std::size_t keyRegisters = 11;
+	constexpr uint8_t rtsOpcode = 0x60;
+}
+
+bool SubroutineMemo::Result::operator==(const Result& other) const
+{
+	return std::equal(registers, registers + sizeof(registers), other.registers) && writes == other.writes
+		&& cycles == other.cycles;
+}
+
+SubroutineMemo::SubroutineMemo(MOS6502& cpu, unsigned validationCalls, std::size_t maxEntries)
+	: mCpu(cpu), mValidationCalls(validationCalls), mMaxEntries(maxEntries ? maxEntries : 1),
+	mReadMark(0x10000, 0), mWriteMark(0x10000, 0)
+{
+}
+
+SubroutineMemo::~SubroutineMemo()
+{
+	for (const auto& routine : mRoutines)
+	{
+		mCpu.removeHook(routine.first);
+	}
+}
+
+void SubroutineMemo::memoize(uint16_t routine)
+{
+	// routine is the address a JSR jumps to
+	if (mRoutines.count(routine))
+	{
+		return;
+	}
+	Routine& state = mRoutines[routine];
+	mCpu.addHook(routine, [this, routine, &state](MOS6502::Host& host) { return enter(host, routine, state); });
+}
+
+void SubroutineMemo::clear()
+{
+	// forget every recording and verdict, the routines stay memoized
+	for (auto& routine : mRoutines)
+	{
+		routine.second = Routine();
+	}
+}
+
+SubroutineMemo::Statistics SubroutineMemo::statistics(uint16_t routine) const
+{
+	auto found = mRoutines.find(routine);
+	if (found == mRoutines.end())
+	{
+		return {};
+	}
+	const Routine& state = found->second;
+	return { state.calls, state.hits, state.misses, state.verifyFailures, state.entries.size(), state.inputs.size(), state.impure };
+}
+
+void SubroutineMemo::printStatistics(std::ostream& out) const
+{
+	for (const auto& routine : mRoutines)
+	{
+		const Routine& state = routine.second;
+		out << "$" << std::hex << std::setw(4) << std::setfill('0') << routine.first << std::setfill(' ') << std::dec
+			<< ": calls " << state.calls << " hits " << state.hits << " misses " << state.misses;
+		if (state.calls != 0)
+		{
+			out << " (" << state.hits * 100 / state.calls << "%)";
+		}
+		out << " entries " << state.entries.size() << " inputs " << state.inputs.size();
+		if (state.verifyFailures != 0)
+		{
+			out << " verify failures " << state.verifyFailures;
+		}
+		out << (state.impure ? " impure" : "") << "\n";
+	}
+}
+
+HostResult SubroutineMemo::enter(MOS6502::Host& host, uint16_t address, Routine& routine)
+{
+	// the routine calling itself, or one memoized routine calling another, runs inside the outer recording
+	if (mRecording || routine.impure)
+	{
+		return HOST_EMULATE;
+	}
+	routine.calls++;
+
+	makeKey(host, routine, mKey);
+	uint64_t hash = ProgramImage::hashBytes(mKey.data(), mKey.size());
+	const Result* cached = nullptr;
+	if (routine.stableCalls >= mValidationCalls)
+	{
+		auto range = routine.entries.equal_range(hash);
+		for (auto entry = range.first; entry != range.second && !cached; ++entry)
+		{
+			if (entry->second.key == mKey)
+			{
+				cached = &entry->second.result;
+			}
+		}
+	}
+	if (cached && !mVerify)
+	{
+		routine.hits++;
+		replay(host, *cached);
+		return HOST_CONTINUE;
+	}
+
+	std::vector<uint8_t> key = mKey;
+	Result result;
+	StopReason reason = record(host, result);
+	if (reason != STOP_NONE)
+	{
+		// left through something else than its RTS; the instructions that ran stay run, nothing is learned
+		routine.misses++;
+		return reason == STOP_HALT || reason == STOP_UNKNOWN_OPCODE ? HOST_STOP : HOST_CONTINUE;
+	}
+
+	if (cached)
+	{
+		routine.hits++;
+		if (!(*cached == result))
+		{
+			std::cerr << "Memoized routine $" << std::hex << std::setw(4) << std::setfill('0')
+				<< address << std::setfill(' ') << std::dec << " is not pure" << std::endl;
+			routine.verifyFailures++;
+			routine.impure = true;
+			routine.entries.clear();
+		}
+		return HOST_CONTINUE;
+	}
+	routine.misses++;
+	learn(routine, key, result);
+	return HOST_CONTINUE;
+}
+
+StopReason SubroutineMemo::record(MOS6502::Host& host, Result& result)
+{
+	// run the routine up to the RTS that pops the return address pushed by its caller
+	uint8_t entrySp = host.sp();
+	mReturnLow = 0x100 + static_cast<uint8_t>(entrySp + 1);
+	mReturnHigh = 0x100 + static_cast<uint8_t>(entrySp + 2);
+	uint16_t returnTo = static_cast<uint16_t>((host.peek(mReturnLow) | (host.peek(mReturnHigh) << 8)) + 1);
+	uint64_t startCycles = mCpu.cycles();
+
+	if (++mGeneration == 0)
+	{
+		std::fill(mReadMark.begin(), mReadMark.end(), 0);
+		std::fill(mWriteMark.begin(), mWriteMark.end(), 0);
+		mGeneration = 1;
+	}
+	mInputs.clear();
+	mWritten.clear();
+	mClobbered = false;
+	mRecording = true;
+	mCpu.attachObserver(this);
+
+	StopReason reason = STOP_BUDGET;
+	for (uint64_t executed = 0; executed < maxRecordedInstructions; executed++)
+	{
+		mReturning = host.sp() == entrySp && host.peek(host.pc()) == rtsOpcode;
+		StopReason stepped = host.step();
+		if (stepped != STOP_NONE)
+		{
+			reason = stepped;
+			break;
+		}
+		if (host.pc() == returnTo && host.sp() == static_cast<uint8_t>(entrySp + 2))
+		{
+			reason = STOP_NONE;
+			break;
+		}
+	}
+
+	mCpu.attachObserver(nullptr);
+	mRecording = false;
+	mReturning = false;
+	if (reason != STOP_NONE)
+	{
+		return reason;
+	}
+
+	result.registers[0] = host.a();
+	result.registers[1] = host.x();
+	result.registers[2] = host.y();
+	result.registers[3] = host.c();
+	result.registers[4] = host.z();
+	result.registers[5] = host.i();
+	result.registers[6] = host.d();
+	result.registers[7] = host.b();
+	result.registers[8] = host.v();
+	result.registers[9] = host.n();
+	result.writes.clear();
+	for (uint16_t addr : mWritten)
+	{
+		result.writes.push_back({ addr, host.peek(addr) });
+	}
+	result.cycles = mCpu.cycles() - startCycles;
+	return STOP_NONE;
+}
+
+void SubroutineMemo::learn(Routine& routine, const std::vector<uint8_t>& key, const Result& result)
+{
+	if (mClobbered)
+	{
+		// returns somewhere else than its caller, not a function of its inputs in any useful sense
+		routine.impure = true;
+		routine.entries.clear();
+		return;
+	}
+
+	// a read outside the input set means earlier recordings may have missed an input, start over with the union
+	std::vector<uint8_t> fullKey = key;
+	bool grown = false;
+	for (const auto& input : mInputs)
+	{
+		if (!std::binary_search(routine.inputs.begin(), routine.inputs.end(), input.first))
+		{
+			grown = true;
+			break;
+		}
+	}
+	if (grown)
+	{
+		std::vector<uint16_t> inputs = routine.inputs;
+		for (const auto& input : mInputs)
+		{
+			inputs.push_back(input.first);
+		}
+		std::sort(inputs.begin(), inputs.end());
+		inputs.erase(std::unique(inputs.begin(), inputs.end()), inputs.end());
+
+		// values at entry: inputs read this call were read before being written, the others were in the old key
+		fullKey.resize(keyRegisters);
+		for (uint16_t addr : inputs)
+		{
+			auto read = std::find_if(mInputs.begin(), mInputs.end(), [addr](const auto& input) { return input.first == addr; });
+			if (read != mInputs.end())
+			{
+				fullKey.push_back(read->second);
+			}
+			else
+			{
+				auto old = std::lower_bound(routine.inputs.begin(), routine.inputs.end(), addr);
+				fullKey.push_back(key[keyRegisters + (old - routine.inputs.begin())]);
+			}
+		}
+		routine.inputs = std::move(inputs);
+		routine.entries.clear();
+		routine.stableCalls = 0;
+	}
+	else
+	{
+		routine.stableCalls++;
+	}
+
+	uint64_t hash = ProgramImage::hashBytes(fullKey.data(), fullKey.size());
+	auto range = routine.entries.equal_range(hash);
+	for (auto entry = range.first; entry != range.second; ++entry)
+	{
+		if (entry->second.key == fullKey)
+		{
+			if (!(entry->second.result == result))
+			{
+				// same inputs, different outcome: something the memoizer cannot see, e.g. another CPU
+				routine.impure = true;
+				routine.entries.clear();
+			}
+			return;
+		}
+	}
+	if (routine.entries.size() >= mMaxEntries)
+	{
+		routine.entries.clear();
+	}
+	routine.entries.insert({ hash, { std::move(fullKey), result } });
+}
+
+void SubroutineMemo::makeKey(MOS6502::Host& host, const Routine& routine, std::vector<uint8_t>& key) const
+{
+	key.clear();
+	key.push_back(host.sp());
+	key.push_back(host.a());
+	key.push_back(host.x());
+	key.push_back(host.y());
+	key.push_back(host.c());
+	key.push_back(host.z());
+	key.push_back(host.i());
+	key.push_back(host.d());
+	key.push_back(host.b());
+	key.push_back(host.v());
+	key.push_back(host.n());
+	for (uint16_t addr : routine.inputs)
+	{
+		key.push_back(host.peek(addr));
+	}
+}
+
+void SubroutineMemo::replay(MOS6502::Host& host, const Result& result) const
+{
+	for (const auto& write : result.writes)
+	{
+		host.write(write.first, write.second);
+	}
+	host.a() = result.registers[0];
+	host.x() = result.registers[1];
+	host.y() = result.registers[2];
+	host.c() = result.registers[3];
+	host.z() = result.registers[4];
+	host.i() = result.registers[5];
+	host.d() = result.registers[6];
+	host.b() = result.registers[7];
+	host.v() = result.registers[8];
+	host.n() = result.registers[9];
+	host.returnFromSubroutine();
+	host.addCycles(result.cycles);
+}
+
+void SubroutineMemo::observe(MemoryProfile::Access kind, uint16_t addr, uint8_t value)
+{
+	if (kind == MemoryProfile::Write)
+	{
+		if (addr == mReturnLow || addr == mReturnHigh)
+		{
+			mClobbered = true;
+		}
+		if (mWriteMark[addr] != mGeneration)
+		{
+			mWriteMark[addr] = mGeneration;
+			mWritten.push_back(addr);
+		}
+		return;
+	}
+	if (mReturning && (addr == mReturnLow || addr == mReturnHigh))
+	{
+		return;
+	}
+	if (mWriteMark[addr] != mGeneration && mReadMark[addr] != mGeneration)
+	{
+		mReadMark[addr] = mGeneration;
+		mInputs.push_back({ addr, value });
+	}
+}
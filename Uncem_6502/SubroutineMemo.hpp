@@ -0,0 +1,102 @@
+#ifndef SUBROUTINEMEMO_HPP
+#define SUBROUTINEMEMO_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+#include "MOS6502.hpp"
+
+// Opt-in memoizer for pure guest subroutines. Each memoized routine gets a PC hook on its entry (after the
+// JSR). On a miss the hook runs the routine itself up to the RTS that returns from this call and records
+// the inputs (bytes read, code included, before the routine wrote them, plus SP, A, X, Y and flags) and the
+// outputs (final bytes written, registers, flags and cycles). Later calls whose inputs match a recording
+// are replayed instead of run.
+//
+// A routine is only replayed once validationCalls calls in a row were recorded without it reading any
+// address outside the input set seen so far. In verify mode hits are run anyway and compared with the
+// recording; a difference marks the routine impure and it is never memoized again.
+//
+// A memoized call counts as one instruction towards execute()'s budget, and breakpoints inside the routine
+// are not checked while it is recorded. The memoizer uses the CPU's AccessObserver slot while it records.
+// enableHostCalls(false) switches it off together with the other hooks.
+class SubroutineMemo : private AccessObserver
+{
+public:
+	struct Statistics
+	{
+		uint64_t calls;
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t verifyFailures;
+		std::size_t entries;
+		std::size_t inputs;                // size of the input set
+		bool impure;
+	};
+
+	explicit SubroutineMemo(MOS6502& cpu, unsigned validationCalls = 2, std::size_t maxEntries = 4096);
+	~SubroutineMemo();
+
+	SubroutineMemo(const SubroutineMemo&) = delete;
+	SubroutineMemo& operator=(const SubroutineMemo&) = delete;
+
+	void memoize(uint16_t routine);
+	void setVerify(bool verify) { mVerify = verify; }
+	void clear();
+
+	Statistics statistics(uint16_t routine) const;
+	void printStatistics(std::ostream& out) const;
+
+private:
+	struct Result
+	{
+		uint8_t registers[10];             // A, X, Y, C, Z, I, D, B, V, N
+		std::vector<std::pair<uint16_t, uint8_t>> writes;
+		uint64_t cycles;
+
+		bool operator==(const Result& other) const;
+	};
+
+	struct Entry
+	{
+		std::vector<uint8_t> key;          // SP and the registers, then the values of Routine::inputs
+		Result result;
+	};
+
+	struct Routine
+	{
+		std::vector<uint16_t> inputs;      // sorted
+		std::unordered_multimap<uint64_t, Entry> entries;
+		unsigned stableCalls = 0;
+		bool impure = false;
+		uint64_t calls = 0, hits = 0, misses = 0, verifyFailures = 0;
+	};
+
+	HostResult enter(MOS6502::Host& host, uint16_t address, Routine& routine);
+	StopReason record(MOS6502::Host& host, Result& result);
+	void learn(Routine& routine, const std::vector<uint8_t>& key, const Result& result);
+	void makeKey(MOS6502::Host& host, const Routine& routine, std::vector<uint8_t>& key) const;
+	void replay(MOS6502::Host& host, const Result& result) const;
+	void observe(MemoryProfile::Access kind, uint16_t addr, uint8_t value) override;
+
+	MOS6502& mCpu;
+	unsigned mValidationCalls;
+	std::size_t mMaxEntries;
+	bool mVerify = false;
+	std::map<uint16_t, Routine> mRoutines;
+
+	// state of the call being recorded
+	bool mRecording = false;
+	bool mClobbered = false;              // the routine wrote its own return address
+	bool mReturning = false;              // the final RTS is running, its pops are not inputs
+	uint16_t mReturnLow = 0, mReturnHigh = 0;
+	uint32_t mGeneration = 0;
+	std::vector<uint32_t> mReadMark, mWriteMark;
+	std::vector<std::pair<uint16_t, uint8_t>> mInputs;
+	std::vector<uint16_t> mWritten;
+	std::vector<uint8_t> mKey;
+};
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef WARMSTART_HPP
+#define WARMSTART_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+#include "ImageStore.hpp"
+#include "MOS6502.hpp"
+
+// Fork-server style warm start: the first request for a set of images boots a CPU once, runs the init
+// code from entry until it reaches the ready address and freezes that state. Every later request with the
+// same images, entry and ready address is served by copying the frozen CPU, which only copies registers and
+// the page table. Images are told apart by identity, so load them through one ImageStore, which hands out
+// one image per contents.
+template <class Cpu = MOS6502>
+class WarmStartCache
+{
+public:
+	using Images = std::vector<std::shared_ptr<const ProgramImage>>;
+
+	explicit WarmStartCache(uint64_t maxBootInstructions = 100000000)
+		: mMaxBootInstructions(maxBootInstructions), mHits(0), mMisses(0)
+	{
+	}
+
+	// frozen ready state, booted on the first call; nullptr if the init code never reaches ready
+	std::shared_ptr<const Cpu> warm(const Images& images, uint16_t entry, uint16_t ready)
+	{
+		std::shared_ptr<Entry> slot;
+		{
+			std::lock_guard<std::mutex> guard(mLock);
+			auto& found = mEntries[Key(images, entry, ready)];
+			if (!found)
+			{
+				found = std::make_shared<Entry>();
+			}
+			slot = found;
+		}
+
+		bool booted = false;
+		std::call_once(slot->once, [&]() {
+			slot->cpu = boot(images, entry, ready);
+			booted = true;
+		});
+		(booted ? mMisses : mHits)++;
+		return slot->cpu;
+	}
+
+	std::unique_ptr<Cpu> clone(const Images& images, uint16_t entry, uint16_t ready)
+	{
+		std::shared_ptr<const Cpu> frozen = warm(images, entry, ready);
+		if (!frozen)
+		{
+			return nullptr;
+		}
+		return std::make_unique<Cpu>(*frozen);
+	}
+
+	void evict(const Images& images, uint16_t entry, uint16_t ready)
+	{
+		std::lock_guard<std::mutex> guard(mLock);
+		mEntries.erase(Key(images, entry, ready));
+	}
+
+	uint64_t hits() const { return mHits; }
+	uint64_t misses() const { return mMisses; }
+
+private:
+	// holds on to the images, so an image's address is not reused for another one while its entry exists
+	using Key = std::tuple<Images, uint16_t, uint16_t>;
+
+	struct Entry
+	{
+		std::once_flag once;
+		std::shared_ptr<const Cpu> cpu;
+	};
+
+	std::shared_ptr<const Cpu> boot(const Images& images, uint16_t entry, uint16_t ready)
+	{
+		auto cpu = std::make_shared<Cpu>();
+		cpu->ISDEBUG = false;
+		for (const auto& image : images)
+		{
+			cpu->mapImage(image);
+		}
+		if (!cpu->executeUntil(entry, ready, mMaxBootInstructions))
+		{
+			std::cerr << "Warm start: init code did not reach the ready address " << std::hex << ready << std::dec << std::endl;
+			return nullptr;
+		}
+		cpu->freeze();
+		return cpu;
+	}
+
+	uint64_t mMaxBootInstructions;
+	std::mutex mLock;
+	std::map<Key, std::shared_ptr<Entry>> mEntries;
+	std::atomic<uint64_t> mHits;
+	std::atomic<uint64_t> mMisses;
+};
+
+#endif
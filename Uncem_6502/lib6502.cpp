@@ -0,0 +1,148 @@
+#include "lib6502.h"
+
+#include <cstring>
+#include <new>
+#include "MOS6502.hpp"
+
+static_assert(M6502_STOP_BUDGET == static_cast<int>(STOP_BUDGET), "m6502_stop has to mirror StopReason");
+
+// the handle is the CPU itself, so no call goes through an extra indirection or allocates
+struct m6502 : public MOS6502Debug
+{
+	m6502()
+	{
+		ISDEBUG = false;
+	}
+
+	const uint8_t* page(uint8_t page) const { return mPages[page]; }
+	uint8_t* ownPage(uint8_t page) { return writablePage(page); }
+	uint8_t* exposedPage(uint8_t page) { return exposePage(page); }
+	uint64_t cycleCount() const { return mCycles; }
+};
+
+extern "C" {
+
+unsigned m6502_api_version(void)
+{
+	return M6502_API_VERSION;
+}
+
+m6502* m6502_create(void)
+{
+	return new (std::nothrow) m6502();
+}
+
+void m6502_destroy(m6502* cpu)
+{
+	delete cpu;
+}
+
+size_t m6502_load(m6502* cpu, const uint8_t* image, size_t size, uint16_t address)
+{
+	size_t loaded = size < 0x10000u - address ? size : 0x10000u - address;
+	cpu->loadProgram(image, loaded, address);
+	return loaded;
+}
+
+void m6502_reset(m6502* cpu)
+{
+	cpu->reset();
+}
+
+m6502_stop m6502_run_cycles(m6502* cpu, uint64_t cycles)
+{
+	uint64_t now = cpu->cycleCount();
+	uint64_t until = cycles > UINT64_MAX - now ? UINT64_MAX : now + cycles;
+	return static_cast<m6502_stop>(cpu->execute(UINT64_MAX, until));
+}
+
+m6502_stop m6502_step(m6502* cpu, size_t count, uint16_t* trace, size_t* executed)
+{
+	StopReason reason = STOP_BUDGET;
+	size_t done = 0;
+	while (done < count)
+	{
+		if (trace) { trace[done] = cpu->getProgramCounter(); }
+		reason = cpu->step();
+		if (reason != STOP_NONE)
+		{
+			// a watchpoint stops after its instruction completed, every other reason before
+			done += reason == STOP_WATCHPOINT;
+			break;
+		}
+		done++;
+	}
+	if (executed) { *executed = done; }
+	return reason == STOP_NONE ? M6502_STOP_BUDGET : static_cast<m6502_stop>(reason);
+}
+
+void m6502_get_registers(const m6502* cpu, m6502_registers* registers)
+{
+	m6502& state = const_cast<m6502&>(*cpu); // the getters are not const
+	registers->pc = state.getProgramCounter();
+	registers->a = state.getAccumulator();
+	registers->x = state.getRegisterX();
+	registers->y = state.getRegisterY();
+	registers->sp = state.getStackPointer();
+	registers->status = state.getStatus();
+	registers->reserved = 0;
+	registers->cycles = state.cycleCount();
+}
+
+void m6502_set_registers(m6502* cpu, const m6502_registers* registers)
+{
+	cpu->setProgramCounter(registers->pc);
+	cpu->setAccumulator(registers->a);
+	cpu->setRegisterX(registers->x);
+	cpu->setRegisterY(registers->y);
+	cpu->setStackPointer(registers->sp);
+	cpu->setStatus(registers->status);
+}
+
+uint8_t m6502_read(const m6502* cpu, uint16_t address)
+{
+	return cpu->page(address >> 8)[address & 0xFF];
+}
+
+void m6502_write(m6502* cpu, uint16_t address, uint8_t value)
+{
+	cpu->setMemory(address, value);
+}
+
+void m6502_read_block(const m6502* cpu, uint16_t address, uint8_t* data, size_t size)
+{
+	while (size > 0)
+	{
+		size_t chunk = 0x100 - (address & 0xFF);
+		chunk = chunk < size ? chunk : size;
+		memcpy(data, cpu->page(address >> 8) + (address & 0xFF), chunk);
+		data += chunk;
+		size -= chunk;
+		address = static_cast<uint16_t>(address + chunk);
+	}
+}
+
+void m6502_write_block(m6502* cpu, uint16_t address, const uint8_t* data, size_t size)
+{
+	while (size > 0)
+	{
+		size_t chunk = 0x100 - (address & 0xFF);
+		chunk = chunk < size ? chunk : size;
+		memcpy(cpu->ownPage(address >> 8) + (address & 0xFF), data, chunk);
+		data += chunk;
+		size -= chunk;
+		address = static_cast<uint16_t>(address + chunk);
+	}
+}
+
+const uint8_t* m6502_page(const m6502* cpu, uint8_t page)
+{
+	return cpu->page(page);
+}
+
+uint8_t* m6502_page_writable(m6502* cpu, uint8_t page)
+{
+	return cpu->exposedPage(page);
+}
+
+}
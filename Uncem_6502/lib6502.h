@@ -0,0 +1,98 @@
+#ifndef LIB6502_H
+#define LIB6502_H
+
+/* C interface of lib6502, for embedding the emulator in other programs and languages.
+ *
+ * The interface is versioned by M6502_API_VERSION: functions are only ever added, existing ones keep their
+ * signature and behaviour, and structs passed by pointer are never reordered. No function throws, and none
+ * allocates except m6502_create(), so the calls can be made in a tight loop.
+ *
+ * A handle may be used from one thread at a time; different handles are independent. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && !defined(M6502_STATIC)
+#ifdef M6502_BUILD
+#define M6502_API __declspec(dllexport)
+#else
+#define M6502_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define M6502_API __attribute__((visibility("default")))
+#else
+#define M6502_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define M6502_API_VERSION 1
+
+typedef struct m6502 m6502;
+
+/* same values as StopReason */
+typedef enum m6502_stop
+{
+	M6502_STOP_NONE = 0,
+	M6502_STOP_HALT,
+	M6502_STOP_UNKNOWN_OPCODE,
+	M6502_STOP_BREAKPOINT,
+	M6502_STOP_WATCHPOINT,
+	M6502_STOP_BUDGET
+} m6502_stop;
+
+typedef struct m6502_registers
+{
+	uint16_t pc;
+	uint8_t a;
+	uint8_t x;
+	uint8_t y;
+	uint8_t sp;
+	uint8_t status;                /* NV1BDIZC, the layout PHP pushes */
+	uint8_t reserved;
+	uint64_t cycles;               /* read only, ignored by m6502_set_registers() */
+} m6502_registers;
+
+/* M6502_API_VERSION the library was built with */
+M6502_API unsigned m6502_api_version(void);
+
+/* NULL when out of memory; memory starts out zero, registers as after power on */
+M6502_API m6502* m6502_create(void);
+M6502_API void m6502_destroy(m6502* cpu);
+
+/* copy size bytes to address onwards, bytes past $FFFF are dropped; returns the number of bytes loaded */
+M6502_API size_t m6502_load(m6502* cpu, const uint8_t* image, size_t size, uint16_t address);
+/* start at the address in the reset vector */
+M6502_API void m6502_reset(m6502* cpu);
+
+/* run until cycles more base cycles have passed or the CPU stops; returns M6502_STOP_BUDGET when the
+ * cycles ran out. The instruction that crosses the limit is completed */
+M6502_API m6502_stop m6502_run_cycles(m6502* cpu, uint64_t cycles);
+/* run up to count instructions; when trace is not NULL the address of each instruction is stored there,
+ * it has to hold count entries. *executed (may be NULL) receives the number of instructions completed */
+M6502_API m6502_stop m6502_step(m6502* cpu, size_t count, uint16_t* trace, size_t* executed);
+
+M6502_API void m6502_get_registers(const m6502* cpu, m6502_registers* registers);
+M6502_API void m6502_set_registers(m6502* cpu, const m6502_registers* registers);
+
+/* single bytes and blocks, without side effects on traps or profiles; blocks wrap at $FFFF */
+M6502_API uint8_t m6502_read(const m6502* cpu, uint16_t address);
+M6502_API void m6502_write(m6502* cpu, uint16_t address, uint8_t value);
+M6502_API void m6502_read_block(const m6502* cpu, uint16_t address, uint8_t* data, size_t size);
+M6502_API void m6502_write_block(m6502* cpu, uint16_t address, const uint8_t* data, size_t size);
+
+/* zero-copy view of the 256 bytes of a page. The read-only view may be shared with other pages or
+ * instances and is valid until the next write to the page or m6502_load(). The writable view is the
+ * page's own memory and stays valid until m6502_destroy(); writes through it need no further calls.
+ * A page that was handed out writable is rehashed on every state hash from then on, so hashing costs
+ * a little more per such page */
+M6502_API const uint8_t* m6502_page(const m6502* cpu, uint8_t page);
+M6502_API uint8_t* m6502_page_writable(m6502* cpu, uint8_t page);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,86 @@
+/* C99 client of lib6502.h, linked against the shared library: what an embedder in C sees of the API.
+ * Prints "Test C API:OK" and exits with 0, or names the first check that failed and exits with 1. */
+
+#include <stdio.h>
+#include <string.h>
+#include "lib6502.h"
+
+#define CHECK(condition) \
+	do { if (!(condition)) { printf("Test C API:FAIL (%s, line %d)\n", #condition, __LINE__); return 1; } } while (0)
+
+int main(void)
+{
+	/* LDX #3; loop: DEX; BNE loop; LDA #$42; STA $0310; HALT */
+	static const uint8_t countdown[] = { 0xA2, 0x03, 0xCA, 0xD0, 0xFD, 0xA9, 0x42, 0x8D, 0x10, 0x03, 0xFF };
+	/* JMP $0400 */
+	static const uint8_t spin[] = { 0x4C, 0x00, 0x04 };
+	static const uint8_t vector[] = { 0x00, 0x03 };
+	m6502_registers registers;
+	uint16_t trace[4];
+	size_t executed = 0;
+	uint8_t block[4];
+	const uint8_t* view;
+	uint8_t* writable;
+
+	m6502* cpu = m6502_create();
+	CHECK(cpu != NULL);
+	CHECK(m6502_api_version() == M6502_API_VERSION);
+	CHECK(m6502_load(cpu, countdown, sizeof(countdown), 0x0300) == sizeof(countdown));
+	CHECK(m6502_load(cpu, spin, sizeof(spin), 0x0400) == sizeof(spin));
+	/* bytes past $FFFF are dropped */
+	CHECK(m6502_load(cpu, vector, sizeof(vector), 0xFFFE) == 2);
+	CHECK(m6502_load(cpu, countdown, sizeof(countdown), 0xFFFF) == 1);
+	CHECK(m6502_load(cpu, vector, sizeof(vector), 0xFFFE) == 2);
+
+	m6502_reset(cpu);
+	m6502_get_registers(cpu, &registers);
+	CHECK(registers.pc == 0x0300 && registers.cycles == 0);
+	registers.a = 0x11;
+	registers.sp = 0xF0;
+	registers.status = 0x20;
+	m6502_set_registers(cpu, &registers);
+
+	/* LDX, DEX, BNE, DEX */
+	CHECK(m6502_step(cpu, 4, trace, &executed) == M6502_STOP_BUDGET && executed == 4);
+	CHECK(trace[0] == 0x0300 && trace[1] == 0x0302 && trace[2] == 0x0303 && trace[3] == 0x0302);
+	m6502_get_registers(cpu, &registers);
+	CHECK(registers.x == 1 && registers.a == 0x11 && registers.sp == 0xF0 && registers.cycles == 8);
+
+	/* the rest of the loop, LDA, STA and the HALT */
+	CHECK(m6502_run_cycles(cpu, 1000) == M6502_STOP_HALT);
+	m6502_get_registers(cpu, &registers);
+	CHECK(registers.a == 0x42 && registers.x == 0 && (registers.status & 0x02) == 0 && registers.cycles == 20);
+	/* HALT leaves the program counter behind it */
+	CHECK(registers.pc == 0x030B);
+	registers.pc = 0x030A;
+	m6502_set_registers(cpu, &registers);
+	CHECK(m6502_step(cpu, 3, trace, &executed) == M6502_STOP_HALT && executed == 0 && trace[0] == 0x030A);
+
+	/* a budget that ends on an instruction boundary, and one the next instruction overshoots */
+	registers.pc = 0x0400;
+	m6502_set_registers(cpu, &registers);
+	CHECK(m6502_run_cycles(cpu, 9) == M6502_STOP_BUDGET);
+	m6502_get_registers(cpu, &registers);
+	CHECK(registers.pc == 0x0400 && registers.cycles == 29);
+	CHECK(m6502_run_cycles(cpu, 1) == M6502_STOP_BUDGET);
+	m6502_get_registers(cpu, &registers);
+	CHECK(registers.cycles == 32);
+
+	/* single bytes, blocks across a page boundary and the page views */
+	CHECK(m6502_read(cpu, 0x0310) == 0x42);
+	m6502_write(cpu, 0x04FF, 0x12);
+	m6502_write_block(cpu, 0x0500, (const uint8_t*)"\x34\x56\x78", 3);
+	m6502_read_block(cpu, 0x04FF, block, sizeof(block));
+	CHECK(memcmp(block, "\x12\x34\x56\x78", 4) == 0);
+	view = m6502_page(cpu, 0x03);
+	CHECK(view[0x10] == 0x42 && view[0x00] == 0xA2);
+	writable = m6502_page_writable(cpu, 0x06);
+	writable[0x80] = 0x99;
+	CHECK(m6502_read(cpu, 0x0680) == 0x99 && m6502_page(cpu, 0x06)[0x80] == 0x99);
+	m6502_write(cpu, 0x0681, 0x77);
+	CHECK(writable[0x81] == 0x77);
+
+	m6502_destroy(cpu);
+	printf("Test C API:OK\n");
+	return 0;
+}
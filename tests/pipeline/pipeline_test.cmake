@@ -0,0 +1,89 @@
+# cmake -DPIPELINE=<6502_Pipeline> -DSOURCE=<tests directory> -DWORK=<scratch directory> [-DWORKERS=n] -P pipeline_test.cmake
+#
+# Runs tests/images/upper_filter.bin, loaded and entered at $0200, over records piped into 6502_Pipeline:
+#
+#   0200  E0 00     CPX #$00        empty record: returned as is
+#   0202  F0 26     BEQ $022A
+#   0204  AD 00 C0  LDA $C000
+#   0207  C9 23     CMP #'#'        "#..." is dropped
+#   0209  F0 21     BEQ $022C
+#   020B  C9 21     CMP #'!'        "!..." never returns
+#   020D  F0 1F     BEQ $022E
+#   020F  86 00     STX $00         the record, up to 255 bytes, upper-cased into the output window
+#   0211  A0 00     LDY #$00
+#   0213  B9 00 C0  LDA $C000,Y
+#   0216  C9 61     CMP #'a'
+#   0218  90 06     BCC $0220
+#   021A  C9 7B     CMP #'z'+1
+#   021C  B0 02     BCS $0220
+#   021E  29 DF     AND #$DF
+#   0220  99 00 D0  STA $D000,Y
+#   0223  C8        INY
+#   0224  C4 00     CPY $00
+#   0226  D0 EB     BNE $0213
+#   0228  A0 00     LDY #$00
+#   022A  18        CLC
+#   022B  60        RTS
+#   022C  38        SEC
+#   022D  60        RTS
+#   022E  4C 2E 02  JMP $022E
+
+if (NOT WORKERS)
+    set(WORKERS 1)
+endif ()
+set(FILTER ${PIPELINE} --workers ${WORKERS} --batch 24 ${SOURCE}/images/upper_filter.bin 0x200)
+
+# runs the filter with stdin from INPUT_FILE into OUTPUT_FILE, fails the test unless it exits with EXPECTED
+function(run_filter NAME EXPECTED INPUT_FILE OUTPUT_FILE)
+    execute_process(COMMAND ${FILTER} ${ARGN}
+            INPUT_FILE ${INPUT_FILE} OUTPUT_FILE ${OUTPUT_FILE}
+            RESULT_VARIABLE result ERROR_VARIABLE errors)
+    if (NOT result EQUAL EXPECTED)
+        message(FATAL_ERROR "${NAME}: exit code ${result}, expected ${EXPECTED}\n${errors}")
+    endif ()
+    set(errors "${errors}" PARENT_SCOPE)
+endfunction()
+
+# 100 lines, every seventh dropped; more than a batch and more than one chunk of 16 per worker, so the
+# output order is that of the input only if the batches and the workers' results are put back in order
+set(input "")
+set(expected "")
+foreach (i RANGE 99)
+    math(EXPR kept "${i} % 7")
+    if (kept EQUAL 0)
+        string(APPEND input "# comment ${i}\n")
+    else ()
+        string(APPEND input "record ${i}, Mixed case\n")
+        string(APPEND expected "RECORD ${i}, MIXED CASE\n")
+    endif ()
+endforeach ()
+# the last line without its newline, and an empty one before it
+string(APPEND input "\nlast")
+string(APPEND expected "\nLAST\n")
+file(WRITE ${WORK}/pipeline_lines.txt "${input}")
+run_filter(lines 0 ${WORK}/pipeline_lines.txt ${WORK}/pipeline_lines.out --lines)
+file(READ ${WORK}/pipeline_lines.out output)
+if (NOT output STREQUAL expected)
+    message(FATAL_ERROR "lines: got\n${output}\nexpected\n${expected}")
+endif ()
+
+# "abc", "#drop me", "", "Hello, World", "z{a`" behind their 16-bit lengths
+run_filter(prefixed 0 ${SOURCE}/pipeline/records.bin ${WORK}/pipeline_prefixed.out --prefixed)
+file(READ ${WORK}/pipeline_prefixed.out output HEX)
+if (NOT output STREQUAL "030041424300000c0048454c4c4f2c20574f524c4404005a7b4160")
+    message(FATAL_ERROR "prefixed: got ${output}")
+endif ()
+
+# a line one byte longer than the 4 KiB input window
+string(REPEAT "a" 4097 long)
+file(WRITE ${WORK}/pipeline_long.txt "short\n${long}\n")
+run_filter(long 1 ${WORK}/pipeline_long.txt ${WORK}/pipeline_long.out --lines)
+if (NOT errors MATCHES "a line is longer than the input window")
+    message(FATAL_ERROR "long: ${errors}")
+endif ()
+
+file(WRITE ${WORK}/pipeline_hang.txt "fine\n!hangs\n")
+run_filter(hang 1 ${WORK}/pipeline_hang.txt ${WORK}/pipeline_hang.out --lines --limit 1000)
+if (NOT errors MATCHES "did not return")
+    message(FATAL_ERROR "hang: ${errors}")
+endif ()
@@ -0,0 +1,254 @@
+#!/usr/bin/env python3
+# Writes the vectors in this directory: python3 generate.py tests/vectors
+#
+# A small NMOS 6502 model written apart from the core, for the opcodes whose encoding or flags were fixed, and
+# hand-picked cases for each fix. This is regression data, not a reference: the cases are not taken from
+# SingleStepTests, and they are only as right as this model. "cycles" lists the bus accesses the model makes,
+# padded with reads of the next PC up to the opcode's base cycle count; Conformance only compares the count.
+# Page crossing penalties are left out, like in the core.
+import json, os, sys
+
+N, V, U, B, D, I, Z, C = 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01
+
+class Cpu:
+    def __init__(s, pc, a, x, y, sp, p, ram):
+        s.pc, s.a, s.x, s.y, s.s, s.p = pc, a, x, y, sp, p
+        s.mem = dict(ram)
+        s.written = set()
+        s.bus = []
+    def rd(s, addr):
+        v = s.mem.get(addr & 0xFFFF, 0)
+        s.bus.append([addr & 0xFFFF, v, 'read'])
+        return v
+    def wr(s, addr, v):
+        s.mem[addr & 0xFFFF] = v & 0xFF
+        s.written.add(addr & 0xFFFF)
+        s.bus.append([addr & 0xFFFF, v & 0xFF, 'write'])
+    def fetch(s):
+        v = s.rd(s.pc); s.pc = (s.pc + 1) & 0xFFFF; return v
+    def fetch16(s):
+        lo = s.fetch(); return lo | (s.fetch() << 8)
+    def flag(s, f, on): s.p = (s.p | f) if on else (s.p & ~f & 0xFF)
+    def nz(s, v): s.flag(Z, v == 0); s.flag(N, v & 0x80)
+    def push(s, v): s.wr(0x100 | s.s, v); s.s = (s.s - 1) & 0xFF
+    def pull(s): s.s = (s.s + 1) & 0xFF; return s.rd(0x100 | s.s)
+
+    # effective addresses
+    def ea(s, mode):
+        if mode == 'zp': return s.fetch()
+        if mode == 'zpx': return (s.fetch() + s.x) & 0xFF
+        if mode == 'zpy': return (s.fetch() + s.y) & 0xFF
+        if mode == 'abs': return s.fetch16()
+        if mode == 'absx': return (s.fetch16() + s.x) & 0xFFFF
+        if mode == 'absy': return (s.fetch16() + s.y) & 0xFFFF
+        if mode == 'indx':
+            z = (s.fetch() + s.x) & 0xFF
+            return s.rd(z) | (s.rd((z + 1) & 0xFF) << 8)
+        if mode == 'indy':
+            z = s.fetch()
+            return ((s.rd(z) | (s.rd((z + 1) & 0xFF) << 8)) + s.y) & 0xFFFF
+        raise ValueError(mode)
+
+    def adc(s, b):
+        a, c = s.a, s.p & C
+        binary = a + b + c
+        s.flag(Z, (binary & 0xFF) == 0)
+        if not s.p & D:
+            s.flag(C, binary > 0xFF)
+            s.flag(V, (a ^ binary) & (b ^ binary) & 0x80)
+            s.flag(N, binary & 0x80)
+            s.a = binary & 0xFF
+            return
+        al = (a & 0x0F) + (b & 0x0F) + c
+        if al >= 0x0A: al = ((al + 0x06) & 0x0F) + 0x10
+        r = (a & 0xF0) + (b & 0xF0) + al
+        sr = sx(a & 0xF0) + sx(b & 0xF0) + al
+        s.flag(N, r & 0x80)
+        s.flag(V, sr < -128 or sr > 127)
+        if r >= 0xA0: r += 0x60
+        s.flag(C, r > 0xFF)
+        s.a = r & 0xFF
+
+    def sbc(s, b):
+        a, c = s.a, s.p & C
+        binary = a - b - (1 - c)
+        s.flag(C, binary >= 0)
+        s.flag(V, (a ^ b) & (a ^ binary) & 0x80)
+        s.flag(Z, (binary & 0xFF) == 0)
+        s.flag(N, binary & 0x80)
+        if s.p & D:
+            al = (a & 0x0F) - (b & 0x0F) - (1 - c)
+            if al < 0: al = ((al - 0x06) & 0x0F) - 0x10
+            r = (a & 0xF0) - (b & 0xF0) + al
+            if r < 0: r -= 0x60
+            s.a = r & 0xFF
+        else:
+            s.a = binary & 0xFF
+
+    def shift(s, kind, v):
+        c = s.p & C
+        if kind == 'asl': out, r = v & 0x80, (v << 1) & 0xFF
+        elif kind == 'lsr': out, r = v & 0x01, v >> 1
+        elif kind == 'rol': out, r = v & 0x80, ((v << 1) | c) & 0xFF
+        else: out, r = v & 0x01, (v >> 1) | (0x80 if c else 0)
+        s.flag(C, out); s.nz(r)
+        return r
+
+def sx(v): return v - 0x100 if v & 0x80 else v
+
+MODES = {'zp': 1, 'zpx': 1, 'zpy': 1, 'abs': 2, 'absx': 2, 'absy': 2, 'indx': 1, 'indy': 1, 'imm': 1, 'acc': 0, 'impl': 0}
+
+# opcode -> (mnemonic, mode)
+OPS = {
+    0xAE: ('ldx', 'abs'), 0xBE: ('ldx', 'absy'), 0xB6: ('ldx', 'zpy'),
+    0xAC: ('ldy', 'abs'), 0xBC: ('ldy', 'absx'),
+    0xB5: ('lda', 'zpx'), 0xA1: ('lda', 'indx'), 0xB1: ('lda', 'indy'),
+    0x95: ('sta', 'zpx'),
+    0x49: ('eor', 'imm'), 0x45: ('eor', 'zp'), 0x55: ('eor', 'zpx'), 0x4D: ('eor', 'abs'),
+    0x5D: ('eor', 'absx'), 0x59: ('eor', 'absy'), 0x41: ('eor', 'indx'), 0x51: ('eor', 'indy'),
+    0x0A: ('asl', 'acc'), 0x06: ('asl', 'zp'), 0x16: ('asl', 'zpx'), 0x0E: ('asl', 'abs'), 0x1E: ('asl', 'absx'),
+    0x4A: ('lsr', 'acc'), 0x46: ('lsr', 'zp'), 0x56: ('lsr', 'zpx'), 0x4E: ('lsr', 'abs'), 0x5E: ('lsr', 'absx'),
+    0x2A: ('rol', 'acc'), 0x26: ('rol', 'zp'), 0x36: ('rol', 'zpx'), 0x2E: ('rol', 'abs'), 0x3E: ('rol', 'absx'),
+    0x6A: ('ror', 'acc'), 0x66: ('ror', 'zp'), 0x76: ('ror', 'zpx'), 0x6E: ('ror', 'abs'), 0x7E: ('ror', 'absx'),
+    0x24: ('bit', 'zp'), 0x2C: ('bit', 'abs'),
+    0x6C: ('jmp', 'ind'),
+    0x69: ('adc', 'imm'), 0xE9: ('sbc', 'imm'),
+    0x00: ('brk', 'impl'), 0x68: ('pla', 'impl'),
+}
+
+# NMOS base cycles, without page crossing penalties
+CYCLES = {
+    0xAE: 4, 0xBE: 4, 0xB6: 4, 0xAC: 4, 0xBC: 4, 0xB5: 4, 0xA1: 6, 0xB1: 5, 0x95: 4,
+    0x49: 2, 0x45: 3, 0x55: 4, 0x4D: 4, 0x5D: 4, 0x59: 4, 0x41: 6, 0x51: 5,
+    0x0A: 2, 0x06: 5, 0x16: 6, 0x0E: 6, 0x1E: 7, 0x4A: 2, 0x46: 5, 0x56: 6, 0x4E: 6, 0x5E: 7,
+    0x2A: 2, 0x26: 5, 0x36: 6, 0x2E: 6, 0x3E: 7, 0x6A: 2, 0x66: 5, 0x76: 6, 0x6E: 6, 0x7E: 7,
+    0x24: 3, 0x2C: 4, 0x6C: 5, 0x69: 2, 0xE9: 2, 0x00: 7, 0x68: 4,
+}
+
+def run(cpu):
+    op = cpu.fetch()
+    name, mode = OPS[op]
+    if name == 'brk':
+        cpu.fetch()                                          # padding byte
+        cpu.push(cpu.pc >> 8); cpu.push(cpu.pc & 0xFF); cpu.push(cpu.p | B | U)
+        cpu.flag(I, True)
+        cpu.pc = cpu.rd(0xFFFE) | (cpu.rd(0xFFFF) << 8)
+        return
+    if name == 'pla':
+        cpu.a = cpu.pull(); cpu.nz(cpu.a); return
+    if name == 'jmp':
+        ptr = cpu.fetch16()
+        hi = (ptr & 0xFF00) | ((ptr + 1) & 0x00FF)          # the page wrap bug
+        cpu.pc = cpu.rd(ptr) | (cpu.rd(hi) << 8)
+        return
+    if mode == 'acc':
+        cpu.a = cpu.shift(name, cpu.a); return
+    if mode == 'imm':
+        v = cpu.fetch()
+    else:
+        addr = cpu.ea(mode)
+        if name == 'sta':
+            cpu.wr(addr, cpu.a); return
+        v = cpu.rd(addr)
+        if name in ('asl', 'lsr', 'rol', 'ror'):
+            cpu.wr(addr, cpu.shift(name, v)); return
+    if name == 'lda': cpu.a = v; cpu.nz(v)
+    elif name == 'ldx': cpu.x = v; cpu.nz(v)
+    elif name == 'ldy': cpu.y = v; cpu.nz(v)
+    elif name == 'eor': cpu.a ^= v; cpu.nz(cpu.a)
+    elif name == 'adc': cpu.adc(v)
+    elif name == 'sbc': cpu.sbc(v)
+    elif name == 'bit':
+        cpu.flag(Z, (cpu.a & v) == 0); cpu.flag(N, v & 0x80); cpu.flag(V, v & 0x40)
+    else: raise ValueError(name)
+
+def case(op, operand=(), pc=0x0400, a=0, x=0, y=0, s=0xFD, p=U, ram=()):
+    code = [op] + list(operand)
+    init = {pc + i: b for i, b in enumerate(code)}
+    init.update(dict(ram))
+    cpu = Cpu(pc, a, x, y, s, p, init)
+    run(cpu)
+    assert len(cpu.bus) <= CYCLES[op]
+    while len(cpu.bus) < CYCLES[op]:
+        cpu.bus.append([cpu.pc, cpu.mem.get(cpu.pc, 0), 'read'])
+    addrs = sorted(set(init) | cpu.written)
+    state = lambda c, m: {'pc': c[0], 's': c[4], 'a': c[1], 'x': c[2], 'y': c[3], 'p': c[5],
+                          'ram': [[ad, m.get(ad, 0)] for ad in addrs]}
+    return {'initial': state((pc, a, x, y, s, p), init),
+            'final': state((cpu.pc, cpu.a, cpu.x, cpu.y, cpu.s, cpu.p), cpu.mem),
+            'cycles': cpu.bus}
+
+CASES = {
+    # LDX/LDY absolute must not add an index; the indexed forms add the other register
+    0xAE: [dict(operand=(0x34, 0x12), y=5, ram=[(0x1234, 0x80), (0x1239, 0x11)]),
+           dict(operand=(0x34, 0x12), y=5, ram=[(0x1234, 0x00), (0x1239, 0x11)])],
+    0xBE: [dict(operand=(0x34, 0x12), y=5, ram=[(0x1234, 0x11), (0x1239, 0x80)]),
+           dict(operand=(0xFF, 0x12), y=1, ram=[(0x12FF, 0x11), (0x1300, 0x42)])],
+    0xB6: [dict(operand=(0xF0,), y=0x20, ram=[(0x0010, 0x7F), (0x0110, 0x11)])],
+    0xAC: [dict(operand=(0x34, 0x12), x=5, ram=[(0x1234, 0x80), (0x1239, 0x11)]),
+           dict(operand=(0x34, 0x12), x=5, ram=[(0x1234, 0x00), (0x1239, 0x11)])],
+    0xBC: [dict(operand=(0x34, 0x12), x=5, ram=[(0x1234, 0x11), (0x1239, 0x80)]),
+           dict(operand=(0xFF, 0x12), x=1, ram=[(0x12FF, 0x11), (0x1300, 0x42)])],
+    # zero page indexing wraps inside page zero, also for the pointer of the indirect modes
+    0xB5: [dict(operand=(0xF0,), x=0x20, ram=[(0x0010, 0x80), (0x0110, 0x11)])],
+    0x95: [dict(operand=(0xF0,), a=0x5A, x=0x20, ram=[(0x0010, 0x00), (0x0110, 0x00)])],
+    0xA1: [dict(operand=(0xFE,), x=0x01, ram=[(0x00FF, 0x34), (0x0000, 0x12), (0x0100, 0x56), (0x1234, 0x99), (0x5634, 0x11)])],
+    0xB1: [dict(operand=(0xFF,), y=0x02, ram=[(0x00FF, 0x30), (0x0000, 0x12), (0x0100, 0x56), (0x1232, 0x00), (0x5632, 0x11)])],
+    0x49: [dict(operand=(0xFF,), a=0xF0), dict(operand=(0x55,), a=0x55), dict(operand=(0x80,), a=0x01)],
+    0x45: [dict(operand=(0x10,), a=0x0F, ram=[(0x0010, 0xF3)])],
+    0x55: [dict(operand=(0xF0,), a=0xAA, x=0x20, ram=[(0x0010, 0xAA), (0x0110, 0x01)])],
+    0x4D: [dict(operand=(0x34, 0x12), a=0x81, ram=[(0x1234, 0x01)])],
+    0x5D: [dict(operand=(0xFF, 0x12), a=0x00, x=1, ram=[(0x1300, 0xC3)])],
+    0x59: [dict(operand=(0x34, 0x12), a=0xFF, y=3, ram=[(0x1237, 0x0F)])],
+    0x41: [dict(operand=(0xFE,), a=0x3C, x=0x01, ram=[(0x00FF, 0x34), (0x0000, 0x12), (0x1234, 0xC3)])],
+    0x51: [dict(operand=(0x20,), a=0x80, y=0x10, ram=[(0x0020, 0xF8), (0x0021, 0x12), (0x1308, 0x80)])],
+    0x0A: [dict(a=0x81), dict(a=0x40, p=U | C)],
+    0x06: [dict(operand=(0x10,), ram=[(0x0010, 0x80)])],
+    0x16: [dict(operand=(0xF0,), x=0x20, ram=[(0x0010, 0x41), (0x0110, 0x00)])],
+    0x0E: [dict(operand=(0x34, 0x12), ram=[(0x1234, 0xC0)])],
+    0x1E: [dict(operand=(0xFF, 0x12), x=1, ram=[(0x1300, 0x01)])],
+    0x4A: [dict(a=0x01), dict(a=0x80, p=U | C)],
+    0x46: [dict(operand=(0x10,), ram=[(0x0010, 0x03)])],
+    0x56: [dict(operand=(0xF0,), x=0x20, ram=[(0x0010, 0x80), (0x0110, 0x00)])],
+    0x4E: [dict(operand=(0x34, 0x12), ram=[(0x1234, 0xFF)])],
+    0x5E: [dict(operand=(0xFF, 0x12), x=1, ram=[(0x1300, 0x02)])],
+    0x2A: [dict(a=0x80, p=U | C), dict(a=0x40)],
+    0x26: [dict(operand=(0x10,), p=U | C, ram=[(0x0010, 0x7F)])],
+    0x36: [dict(operand=(0xF0,), x=0x20, ram=[(0x0010, 0x80), (0x0110, 0x00)])],
+    0x2E: [dict(operand=(0x34, 0x12), p=U | C, ram=[(0x1234, 0x00)])],
+    0x3E: [dict(operand=(0xFF, 0x12), x=1, ram=[(0x1300, 0xC0)])],
+    0x6A: [dict(a=0x01, p=U | C), dict(a=0x02)],
+    0x66: [dict(operand=(0x10,), p=U | C, ram=[(0x0010, 0xFE)])],
+    0x76: [dict(operand=(0xF0,), x=0x20, ram=[(0x0010, 0x01), (0x0110, 0x00)])],
+    0x6E: [dict(operand=(0x34, 0x12), ram=[(0x1234, 0x00)])],
+    0x7E: [dict(operand=(0xFF, 0x12), x=1, p=U | C, ram=[(0x1300, 0x03)])],
+    # BIT copies bits 7 and 6 of memory, Z from the and
+    0x24: [dict(operand=(0x10,), a=0x3F, ram=[(0x0010, 0xC0)]), dict(operand=(0x10,), a=0x01, p=U | N | V, ram=[(0x0010, 0x01)])],
+    0x2C: [dict(operand=(0x34, 0x12), a=0xFF, ram=[(0x1234, 0x40)])],
+    # JMP (ind) does not carry into the high byte of the pointer
+    0x6C: [dict(operand=(0x20, 0x12), ram=[(0x1220, 0x00), (0x1221, 0x30)]),
+           dict(operand=(0xFF, 0x12), ram=[(0x12FF, 0x34), (0x1200, 0x56), (0x1300, 0x78)])],
+    # binary overflow, decimal adjust, Z from the binary sum in decimal mode
+    0x69: [dict(operand=(0x50,), a=0x50), dict(operand=(0x90,), a=0xD0), dict(operand=(0x27,), a=0x15, p=U | D),
+           dict(operand=(0x01,), a=0x99, p=U | D), dict(operand=(0x58,), a=0x46, p=U | D | C)],
+    0xE9: [dict(operand=(0xB0,), a=0x50, p=U | C), dict(operand=(0x70,), a=0xD0, p=U | C),
+           dict(operand=(0x15,), a=0x42, p=U | D | C), dict(operand=(0x20,), a=0x10, p=U | D | C),
+           dict(operand=(0x01,), a=0x00, p=U | D)],
+    # BRK pushes PC+2 and P with B set, then sets I
+    0x00: [dict(operand=(0xEA,), s=0xFD, p=U, ram=[(0x01FD, 0), (0x01FC, 0), (0x01FB, 0), (0xFFFE, 0x00), (0xFFFF, 0x80)]),
+           dict(operand=(0xEA,), pc=0x12FF, s=0x00, p=U | D | C, ram=[(0x0100, 0), (0x01FF, 0), (0x01FE, 0), (0xFFFE, 0x34), (0xFFFF, 0x12)])],
+    0x68: [dict(s=0xFC, a=0x11, ram=[(0x01FD, 0x80)]), dict(s=0xFC, a=0x11, p=U | N, ram=[(0x01FD, 0x00)]),
+           dict(s=0xFF, ram=[(0x0100, 0x42)])],
+}
+
+out = sys.argv[1]
+os.makedirs(out, exist_ok=True)
+for op, cases in CASES.items():
+    tests = []
+    for i, c in enumerate(cases):
+        t = case(op, **c)
+        tests.append({'name': '%02x %d' % (op, i + 1), **t})
+    with open(os.path.join(out, '%02x.json' % op), 'w') as f:
+        f.write('[\n')
+        f.write(',\n'.join(json.dumps(t, separators=(',', ':')) for t in tests))
+        f.write('\n]\n')